@@ -0,0 +1,43 @@
+#pragma once
+
+#include <EventLoop.hpp>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+// Unix domain socket serving the metrics to local scrapers (curl --unix-socket, a node
+// exporter textfile job...). Every connection sends one HTTP request, gets one HTTP/1.0
+// response and is closed. Connections are non-blocking and driven by the server's event loop
+// like client sockets, a slow scraper never holds up the loop.
+class AdminSocket
+{
+public:
+    AdminSocket(const std::string &path, EventLoop &eventLoop);
+    ~AdminSocket();
+    AdminSocket(const AdminSocket &) = delete;
+    AdminSocket &operator=(const AdminSocket &) = delete;
+
+    int getFd() const;
+    // the listening socket or one of the connections it accepted
+    bool owns(int fd) const;
+    // render is only called once a connection has sent its whole request
+    void handle(const Event &event, const std::function<std::string()> &render);
+
+private:
+    struct Connection
+    {
+        std::string request;
+        std::string response;
+        size_t sent = 0;
+    };
+
+    int _fd;
+    std::string _path;
+    EventLoop &_eventLoop;
+    std::unordered_map<int, Connection> _connections;
+
+    void accept();
+    bool receive(int fd, Connection &connection, const std::function<std::string()> &render);
+    bool flush(int fd, Connection &connection);
+    void drop(int fd);
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <IpAddress.hpp>
+
+// Path-compressed binary trie of banned address prefixes (K/D-lines). Nodes sit in one vector
+// and refer to each other by index, a lookup follows at most one node per distinguishing bit,
+// so it is O(prefix length) whatever the number of bans.
+class BanTrie
+{
+public:
+    BanTrie();
+
+    // "a.b.c.d/n" or "x:y::/n", false if the text is not a valid CIDR
+    bool add(const std::string &cidr, const std::string &reason);
+    void add(const IpAddress &prefix, unsigned length, const std::string &reason);
+    // reason of the shortest matching ban, nullptr if the address is not banned
+    const std::string *match(const IpAddress &address) const;
+    size_t size() const;
+
+    // one "<cidr> [reason]" per line, '#' starts a comment. Lines that are not valid bans are
+    // skipped and described in warnings for the caller to log. Throws ServerError if unreadable
+    static BanTrie loadFile(const std::string &path, std::vector<std::string> &warnings);
+
+private:
+    struct Node
+    {
+        IpAddress prefix;
+        uint8_t length;
+        bool banned;
+        uint32_t reason;
+        int32_t child[2];
+    };
+
+    std::vector<Node> _nodes;
+    std::vector<std::string> _reasons;
+    std::unordered_map<std::string, uint32_t> _reasonIds;
+    size_t _bans;
+
+    int32_t newNode(const IpAddress &prefix, unsigned length);
+    void markBanned(int32_t node, const std::string &reason);
+};
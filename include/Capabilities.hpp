@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <stdint.h>
+
+// IRCv3 capabilities a client can enable with CAP REQ, one bit each in Client::getCaps()
+enum Capability : uint32_t
+{
+    CAP_NONE = 0,
+    CAP_SERVER_TIME = 1 << 0,
+    CAP_MESSAGE_TAGS = 1 << 1,
+    CAP_ACCOUNT_TAG = 1 << 2,
+    CAP_MULTI_PREFIX = 1 << 3,
+    CAP_ECHO_MESSAGE = 1 << 4,
+    CAP_BATCH = 1 << 5,
+    CAP_RESUME = 1 << 6
+};
+
+// CAP_NONE for names we don't offer
+Capability capabilityFromName(const std::string &name);
+// space separated names of every bit set in caps
+std::string capabilityNames(uint32_t caps);
+const uint32_t CAP_ALL = CAP_SERVER_TIME | CAP_MESSAGE_TAGS | CAP_ACCOUNT_TAG | CAP_MULTI_PREFIX |
+                         CAP_ECHO_MESSAGE | CAP_BATCH | CAP_RESUME;
@@ -2,8 +2,19 @@
 
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <functional>
+#include <ctime>
+#include <NameReplyCache.hpp>
+#include <MaskList.hpp>
+#include <MessageHistory.hpp>
 
 class Client;
+class ClientIndex;
+class ImageWriter;
+class ImageReader;
+struct ChannelRecord;
 
 enum ChannelMode
 {
@@ -11,14 +22,31 @@ enum ChannelMode
     KEY = 'k',
     LIMIT = 'l',
     PROTECTED_TOPIC = 't',
-    OP = 'o'
+    DELAYED_JOIN = 'D',
+    OP = 'o',
+    BAN = 'b',
+    EXCEPTION = 'e',
+    INVITE_EXCEPTION = 'I'
+};
+
+// one validated +/- flag of a MODE command, applied and broadcast in batches
+struct ModeChange
+{
+    bool enable;
+    char mode;
+    std::string param;
 };
 
 class Channel
 {
 public:
-    Channel(const std::string &name, Client &creator);
+    // a registered channel comes back with its record, which its first member must get past
+    Channel(const std::string &name, Client &creator, const ChannelRecord *record = nullptr,
+            const std::string &key = "");
+    // hot upgrade, members are looked up by nick in clients, which must be restored already
+    Channel(ImageReader &image, const ClientIndex &clients);
     ~Channel();
+    void save(ImageWriter &image) const;
     void join(Client &client, std::string const &key = "");
     void part(Client &client, std::string const &reason);
     void quit(Client &client, std::string const &reason);
@@ -27,19 +55,43 @@ public:
     void changeTopic(Client &client, std::string &newTopic);
     void checkTopic(Client &client);
     const std::string &getName() const;
+    const std::string &getTopic() const;
+    size_t getMemberCount() const;
+    const NameReplyCache &getNames(Client &requester);
+    // a hidden +D member is not in getNames() but still sees itself, NAMES replies add it
+    bool missesOwnName(Client &requester);
     const std::string &getCreatedTime();
+    time_t getCreatedAt() const;
+    time_t getTopicSetAt() const;
+    // lets ChannelManager keep its LIST indexes in step with membership and topic changes
+    void setIndexHooks(std::function<void(Channel &, size_t)> onMemberCountChange,
+                       std::function<void(Channel &, const std::string &)> onTopicChange);
+    // lets ChannelManager persist topic and mode changes
+    void setMetadataHook(std::function<void(Channel &)> onMetadataChange);
+    ChannelRecord getRecord() const;
     bool hasMode(ChannelMode mode) const;
     bool hasMode(const char mode) const;
     void setMode(Client &client, bool enable, ChannelMode mode, std::string param = "");
     void setMode(Client &client, bool enable, const char mode, std::string param = "");
+    void applyModes(Client &client, const std::vector<ModeChange> &changes);
     void printModes(Client &client);
     bool isEmpty() const;
     void broadcastMessage(const std::string &message);
     void broadcastToOthers(Client &client, const std::string &message);
+    // PRIVMSG/NOTICE, also recorded for CHATHISTORY
+    void relayMessage(Client &sender, const std::string &message);
+    const MessageHistory &getHistory() const;
     bool hasOp(Client &client);
     void eraseNickHistory(const std::string &nick);
     void updateNick(Client &client, const std::string &newNick);
     bool isOnChannel(Client &client);
+    void removeMember(Client &client);
+    bool isHidden(Client &client) const;
+    // banned and not excepted, ops are never banned from speaking
+    bool isBanned(Client &client);
+    bool canSend(Client &client);
+    void sendMaskList(Client &client, char mode);
+    const std::unordered_map<std::string, Client *> &getMembers() const;
 
 private:
     std::string _channelName;
@@ -54,15 +106,37 @@ private:
     std::string _key;
     size_t _userLimit;
     std::string _createdTime;
+    NameReplyCache _names;
+    // +D: members whose JOIN nobody has seen yet, and the names non-ops may see
+    std::unordered_set<Client *> _hidden;
+    NameReplyCache _visibleNames;
+    // +b/+e/+I, and each member's ban status as of the list version it was computed for
+    MaskList _bans;
+    MaskList _exceptions;
+    MaskList _inviteExceptions;
+    uint64_t _banListVersion;
+    MessageHistory _history;
+    std::unordered_map<Client *, std::pair<uint64_t, bool>> _banStatus;
+    std::function<void(Channel &, size_t)> _onMemberCountChange;
+    std::function<void(Channel &, const std::string &)> _onTopicChange;
+    std::function<void(Channel &)> _onMetadataChange;
 
+    void restore(const ChannelRecord &record);
     void enableMode(ChannelMode mode);
     void disableMode(ChannelMode mode);
     std::string prefixNick(Client &client);
     void sendNameReply(Client &client);
+    void reveal(Client &client);
+    void revealAll();
     void sendTopic(Client &client);
     bool isInvited(Client &client);
     bool isJoinable(Client &client, std::string key);
     void removeFromInvites(Client &client);
-    void addOp(std::string &nick, const std::string &modeMsg = "");
-    void removeOp(const std::string &nick, const std::string &modeMsg = "");
+    bool applyMode(Client &client, ModeChange &change);
+    bool applyListMode(Client &client, ModeChange &change);
+    MaskList &getMaskList(char mode);
+    bool computeBanned(const std::string &subject) const;
+    void broadcastModeChanges(Client &client, const std::vector<ModeChange> &changes);
+    bool addOp(const std::string &nick);
+    bool removeOp(const std::string &nick);
 };
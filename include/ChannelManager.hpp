@@ -5,9 +5,31 @@
 #include <memory>
 #include <unordered_map>
 #include <functional>
+#include <set>
+#include <cstdint>
+#include <ctime>
+#include <TrigramIndex.hpp>
 
 class Channel;
 class Client;
+class ClientIndex;
+class ImageWriter;
+class ImageReader;
+class ChannelRegistry;
+
+// ELIST style LIST filters, ages are in seconds
+struct ListFilter
+{
+    size_t minUsers = 0;
+    size_t maxUsers = SIZE_MAX;
+    std::string nameMask;
+    std::string excludedNameMask;
+    std::string topicMask;
+    int64_t minCreatedAge = 0;
+    int64_t maxCreatedAge = INT64_MAX;
+    int64_t minTopicAge = 0;
+    int64_t maxTopicAge = INT64_MAX;
+};
 
 class ChannelManager
 {
@@ -16,15 +38,35 @@ public:
     ~ChannelManager();
 
     bool channelExists(const std::string &name) const;
-    void createChannel(const std::string &name, Client &creator);
+    // a channel in the registry is created with its record, key is checked against it
+    void createChannel(const std::string &name, Client &creator, const std::string &key = "");
     void removeChannel(const std::string &name);
     Channel &getChannel(const std::string &name) const;
+    Channel *findChannel(const std::string &name) const;
+    std::vector<std::string> getChannelNames() const;
+    std::vector<std::string> findChannels(const ListFilter &filter) const;
+    bool matchesFilter(const Channel &channel, const ListFilter &filter) const;
     void rmEmptyChannels();
     void clearNickHistory(const std::string &nickname);
     void forEachChannel(std::function<void(Channel &)> callback);
+    // channels created or changed from now on are persisted in registry
+    void setRegistry(ChannelRegistry *registry);
+    // hot upgrade, clients must be loaded first
+    void save(ImageWriter &image) const;
+    void load(ImageReader &image, const ClientIndex &clients);
 
 private:
     std::unordered_map<std::string, std::unique_ptr<Channel>> _channels;
+    // LIST indexes: (member count, casemapped name) in count order, and name/topic trigrams
+    std::set<std::pair<size_t, std::string>> _byMemberCount;
+    TrigramIndex _nameIndex;
+    TrigramIndex _topicIndex;
+    ChannelRegistry *_registry;
+
+    void track(const std::string &key, Channel &channel);
+    void memberCountChanged(Channel &channel, size_t oldCount);
+    void topicChanged(Channel &channel, const std::string &oldTopic);
+    void metadataChanged(Channel &channel);
 
     // ascii casemapping, Defines the characters a to z
     // to be considered the lower-case equivalents of the characters A to Z only.
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+#include <ctime>
+#include <sys/types.h>
+#include <WriteAheadLog.hpp>
+#include <Clock.hpp>
+
+class ImageWriter;
+class ImageReader;
+
+// what outlives a channel's members: topic, modes and the +b/+e/+I lists
+struct ChannelRecord
+{
+    struct Mask
+    {
+        char mode;
+        std::string mask;
+        std::string setBy;
+        time_t setAt;
+    };
+
+    std::string name;
+    std::string topic;
+    std::string topicAuthor;
+    std::string topicTime;
+    std::string modes;
+    std::string key;
+    size_t userLimit = 0;
+    std::string createdTime;
+    std::vector<Mask> masks;
+
+    // nothing set that a fresh channel would not have, so nothing worth keeping
+    bool isDefault() const;
+    void save(ImageWriter &image) const;
+    void load(ImageReader &image);
+};
+
+// Persistent channel metadata, keyed by casemapped name. Every change is appended to a WAL;
+// every SNAPSHOT_INTERVAL_SEC (or SNAPSHOT_CHANGES changes) the whole registry is serialised
+// and a forked child writes and syncs it, after which the WAL segments it covers are dropped.
+// Startup maps the snapshot and the remaining segments and replays them.
+class ChannelRegistry
+{
+public:
+    explicit ChannelRegistry(const std::string &directory);
+    ~ChannelRegistry();
+
+    const ChannelRecord *find(const std::string &key) const;
+    void put(const std::string &key, const ChannelRecord &record);
+    void erase(const std::string &key);
+    size_t size() const;
+
+    // once per loop iteration: reaps a finished snapshot and forks the next one when due
+    void maintain();
+    // false while one is still running or if fork failed
+    bool snapshot();
+    // waits for the WAL writer and a running snapshot, nothing is in flight afterwards
+    void sync();
+
+private:
+    std::string _directory;
+    std::unordered_map<std::string, ChannelRecord> _records;
+    WriteAheadLog _wal;
+    pid_t _snapshotPid;
+    uint64_t _snapshotGeneration;
+    size_t _changesSinceSnapshot;
+    Clock::TimePoint _lastSnapshot;
+
+    std::string snapshotPath() const;
+    uint64_t loadSnapshot();
+    void replay(ImageReader &record);
+    void finishSnapshot(int status);
+    void serialise(ImageWriter &image, uint64_t generation) const;
+    static bool writeSnapshot(const std::string &data, const char *temporary, const char *path,
+                              const char *directory);
+};
@@ -5,9 +5,17 @@
 #include <netinet/in.h>
 #include <unordered_map>
 #include <chrono>
+#include <stdint.h>
+#include <deque>
+#include <memory>
 #include <responses.hpp>
+#include <TokenBucket.hpp>
+#include <Capabilities.hpp>
 
 class Channel;
+class ReplyCursor;
+class ImageWriter;
+class ImageReader;
 class Client
 {
 public:
@@ -32,6 +40,8 @@ public:
     std::string &getMessageBuf();
     void setIsRegistered(bool registered);
     void setPasswordVerified(bool verified);
+    bool isOper() const;
+    void setOper(bool oper);
     void untrackChannel(Channel *channel);
     void trackChannel(Channel *channel);
     bool isOnChannel(Channel *channel);
@@ -49,6 +59,54 @@ public:
     const std::string &getLastPingToken() const;
     int getTimeSinceLastPing() const;
     std::string getPrefixPrivmsg();
+    bool markFanout(uint64_t epoch);
+    TokenBucket &getFloodBucket();
+
+    // CAP negotiation, registration waits for CAP END once it has started
+    uint32_t getCaps() const;
+    bool hasCap(Capability cap) const;
+    void setCaps(uint32_t caps);
+    bool isNegotiatingCaps() const;
+    void setNegotiatingCaps(bool negotiating);
+
+    // session resumption, a detached client has no socket (fd -1) until it is resumed
+    const std::string &getResumeToken() const;
+    void setResumeToken(const std::string &token);
+    void rebind(int fd);
+
+    // where ConnectionManager has queued the client, kept here so its checks are O(1)
+    bool isInputScheduled() const;
+    void setInputScheduled(bool scheduled);
+    bool isInputDeferred() const;
+    void setInputDeferred(bool deferred);
+    bool isDisconnecting() const;
+    void setDisconnecting(bool disconnecting);
+    bool isDetaching() const;
+    void setDetaching(bool detaching);
+    bool isResumePending() const;
+    void setResumePending(bool pending);
+    // output is discarded until the client is dropped at the end of the round
+    bool isSlow() const;
+    void setSlow(bool slow);
+
+    // output queue
+    bool deliver(const std::string &line);
+    bool deliver(const std::shared_ptr<const std::string> &line);
+    bool flushOutput();
+    bool hasPendingOutput() const;
+    size_t getSendQueueSize() const;
+    void clearOutput();
+
+    // long replies streamed across loop iterations
+    bool hasPendingReplies() const;
+    void addReply(std::unique_ptr<ReplyCursor> cursor);
+    void clearReplies();
+    bool continueReply(size_t maxLines);
+
+    // hot upgrade: identity, negotiated state and both buffers. The fd is the index's business,
+    // channels restore their own membership and streamed replies are dropped
+    void save(ImageWriter &image) const;
+    void load(ImageReader &image);
 
 private:
     int _fd;
@@ -57,6 +115,7 @@ private:
     std::string _realname;
     bool _passwordVerified;
     bool _isRegistered;
+    bool _isOper;
     std::string _nickname;
     std::string _ip;
     std::string _userHost;
@@ -67,4 +126,27 @@ private:
     std::chrono::steady_clock::time_point _lastPingSentTime;
     bool _waitingForPong;
     std::string _lastPingToken;
+
+    // last fan-out this client received, so shared channels deliver only once
+    uint64_t _fanoutEpoch;
+
+    // flood control, lines over budget wait in _messageBuf
+    TokenBucket _floodBucket;
+
+    uint32_t _caps;
+    bool _negotiatingCaps;
+    std::string _resumeToken;
+
+    bool _inputScheduled;
+    bool _inputDeferred;
+    bool _disconnecting;
+    bool _detaching;
+    bool _resumePending;
+    bool _slow;
+
+    // whatever the socket did not take yet, _sendOffset into the front buffer
+    std::deque<std::shared_ptr<const std::string>> _sendQueue;
+    size_t _sendOffset;
+    size_t _sendQueueSize;
+    std::deque<std::unique_ptr<ReplyCursor>> _replies;
 };
@@ -5,8 +5,12 @@
 #include <vector>
 #include <memory>
 #include <functional>
+#include <chrono>
+#include <MonitorIndex.hpp>
 
 class Client;
+class ImageWriter;
+class ImageReader;
 
 class ClientIndex
 {
@@ -14,7 +18,7 @@ public:
     ClientIndex() = default;
     ~ClientIndex();
 
-    // Core operations
+    // Core operations, registered nicks coming and going notify their MONITOR watchers
     void add(int clientFd);
     void addNick(int clientFd);
     void remove(Client &client);
@@ -23,16 +27,47 @@ public:
     // Lookup functions
     Client &getByFd(int fd) const;
     Client &getByNick(const std::string &nick) const;
+    Client *findByFd(int fd) const;
+    Client *findByNick(const std::string &nick) const;
 
     // Utility functions
     void forEachClient(std::function<void(Client &)> callback);
     bool nickExists(const std::string &nick) const;
+    std::vector<std::string> getNicks() const;
     size_t size() const;
+    MonitorIndex &getMonitor();
+
+    // Session resumption. A detached client keeps its nick and channels but no fd; RESUME
+    // with its token moves it onto a new connection, otherwise it expires after a grace period
+    std::string issueResumeToken(Client &client);
+    void detach(Client &client, const std::string &reason,
+                std::chrono::steady_clock::time_point expires);
+    Client *findDetached(const std::string &token) const;
+    // replaces the client at fd, which presented the token, with the detached one
+    Client &resume(const std::string &token, int fd);
+    // expired clients with the reason they were detached for, still owned by the index
+    std::vector<std::pair<Client *, std::string>>
+    expiredDetached(std::chrono::steady_clock::time_point now) const;
+    size_t detachedCount() const;
+
+    // hot upgrade. Live clients are written with the fd they have here, fds maps those to the
+    // descriptors the new process received; detached ones keep what is left of their grace time
+    void save(ImageWriter &image) const;
+    void load(ImageReader &image, const std::unordered_map<int, int> &fds);
+
+    static std::string caseMapped(const std::string &name);
 
 private:
     // std::unordered_map<int, Client *> byFd;
     std::unordered_map<int, std::unique_ptr<Client>> _byFd;
     std::unordered_map<std::string, Client *> _byNick;
+    MonitorIndex _monitor;
 
-    std::string caseMapped(const std::string &name) const;
+    struct DetachedSession
+    {
+        std::unique_ptr<Client> client;
+        std::string reason;
+        std::chrono::steady_clock::time_point expires;
+    };
+    std::unordered_map<std::string, DetachedSession> _detached;
 };
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <chrono>
+
+// The time timeouts and rate limits are measured against: ping scheduling, idle times, flood
+// buckets, connect throttling and resume grace. It is steady_clock unless a test installs a
+// VirtualClock, which only moves when told to.
+class Clock
+{
+public:
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    virtual ~Clock() = default;
+    virtual TimePoint current() const = 0;
+
+    static TimePoint now();
+    // nullptr goes back to steady_clock
+    static void install(Clock *clock);
+
+private:
+    static Clock *_installed;
+};
+
+class VirtualClock : public Clock
+{
+public:
+    VirtualClock();
+
+    TimePoint current() const override;
+    void advance(std::chrono::nanoseconds by);
+
+private:
+    TimePoint _now;
+};
@@ -11,6 +11,7 @@
 #include <ConnectionManager.hpp>
 #include <vector>
 #include <PongManager.hpp>
+#include <Metrics.hpp>
 
 enum ParamType
 {
@@ -69,6 +70,16 @@ private:
     void invite();
     void privmsg();
     void notice();
+    void list();
+    void who();
+    void whois();
+    void names();
+    void chathistory();
+    void monitor();
+    void resume();
+    void oper();
+    void stats();
+    void deliverDirect(Client &target, const std::string &message);
 
     // utils
     void leaveAllChannels();
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// A nick!user@host glob compiled once when it is set. Matching checks the literal head and
+// tail first and finds the literal pieces between '*'s with memchr, so most non-matching
+// subjects are rejected after a couple of byte compares.
+class CompiledMask
+{
+public:
+    explicit CompiledMask(const std::string &mask);
+
+    // fills in missing parts: "nick" -> "nick!*@*", "user@host" -> "*!user@host"
+    static std::string normalize(const std::string &mask);
+    // ascii casemapping, subjects are mapped once and matched against many masks
+    static std::string casemap(const std::string &text);
+
+    // subject must already be casemapped
+    bool matches(const std::string &subject) const;
+    const std::string &getMask() const;
+    // literal end of the host part, every matching subject's host ends with it
+    const std::string &getHostSuffix() const;
+
+private:
+    std::string _mask;
+    std::string _pattern;
+    std::string _prefix;
+    std::string _suffix;
+    std::vector<std::string> _segments;
+    bool _hasWildcard;
+    bool _hasSingle;
+    std::string _hostSuffix;
+
+    static bool findSegment(const std::string &subject, size_t &from, size_t end,
+                            const std::string &segment);
+};
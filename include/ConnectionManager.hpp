@@ -11,6 +11,28 @@
 #include <MessageParser.hpp>
 #include <PongManager.hpp>
 #include <ChannelManager.hpp>
+#include <ReplyCursor.hpp>
+#include <ConnectionThrottle.hpp>
+#include <ServerBans.hpp>
+#include <TrafficCapture.hpp>
+#include <Tracer.hpp>
+#include <common.hpp>
+#include <Clock.hpp>
+#include <map>
+#include <unordered_map>
+
+// per-client input rate limit, lines over budget are held back ("fake lag") not dropped
+struct FloodPolicy
+{
+    bool enabled = true;
+    double burst = FLOOD_BURST;
+    double ratePerSec = FLOOD_RATE;
+    size_t maxDeferredBytes = MAX_RECVQ;
+    // tokens a line costs by command, anything not listed costs defaultCost
+    std::unordered_map<std::string, double> commandCosts = {
+        {"PING", 0}, {"PONG", 0}, {"JOIN", 2}, {"LIST", 3}, {"WHO", 3}, {"NAMES", 2}};
+    double defaultCost = 1;
+};
 
 class ConnectionManager
 {
@@ -20,12 +42,48 @@ public:
     ~ConnectionManager();
 
     void handleNewClient();
+    // clients restored by a hot upgrade, their sockets are watched again and buffered input runs
+    void adoptClients();
     void disconnectClient(Client &client, const std::string &reason);
+    // the socket died without a QUIT, a resumable session is detached instead of quitting
+    void connectionLost(Client &client, const std::string &reason);
+    // RESUME takes effect at the end of the input round, lines after it wait until then
+    void requestResume(Client &client, const std::string &token);
+    void completeResumes();
+    void expireDetachedClients();
     void receiveData(int clientFd);
     std::vector<Client *> &getDisconnectedClients();
     void markClientForDisconnection(Client &client);
     void rmDisconnectedClients();
 
+    // output path, lines the socket can't take right away wait in the client's send queue
+    void deliver(int fd, const std::string &line);
+    void deliver(int fd, const std::shared_ptr<const std::string> &line);
+    void flushClient(int fd);
+    // long replies are streamed in batches of REPLY_BATCH_LINES between loop iterations
+    void startReply(Client &client, std::unique_ptr<ReplyCursor> cursor);
+    void continueReplies();
+    bool hasPendingReplies() const;
+
+    void setFloodPolicy(const FloodPolicy &policy);
+    void setThrottlePolicy(const ThrottlePolicy &policy);
+    ServerBans &getServerBans();
+    // records every connection accepted and every byte received from then on into path
+    void startCapture(const std::string &path);
+    // housekeeping, a quiet server still gets its captured tail to disk
+    void flushStaleCapture();
+    // follows rate of the inbound lines through dispatch and fan-out, exported to path
+    void startTracing(const std::string &path, double rate);
+    // nullptr unless tracing was started
+    Tracer *getTracer();
+    // puts clients held back by flood control back on the ready list once their wake time is due
+    void releaseDeferredInput();
+    // how long the loop may wait before a held back client is due, at most limit
+    int msUntilDeferredInput(int limit) const;
+    // one scheduling round, every ready client gets at most INPUT_LINES_PER_ROUND lines run
+    void processInputRound();
+    bool hasReadyInput() const;
+
     void cleanUp();
 
 private:
@@ -34,9 +92,40 @@ private:
     EventLoop &_EventLoop;
     ChannelManager &_channels;
     std::vector<Client *> _clientsToDisconnect;
+    std::vector<std::pair<Client *, std::string>> _clientsToDetach;
+    std::vector<std::pair<int, std::string>> _pendingResumes;
+    // output failed or overflowed, with the reason they quit for
+    std::vector<std::pair<int, std::string>> _slowClients;
+    std::vector<int> _streaming;
+    FloodPolicy _floodPolicy;
+    ConnectionThrottle _throttle;
+    ServerBans _bans;
+    std::unique_ptr<TrafficCapture> _capture;
+    std::unique_ptr<Tracer> _tracer;
+    // clients with complete lines waiting, in round-robin order, and those out of tokens by the
+    // time they can afford their next line
+    std::vector<int> _readyInput;
+    std::multimap<Clock::TimePoint, int> _deferredInput;
+
+    enum InputState
+    {
+        INPUT_IDLE,
+        INPUT_READY,
+        INPUT_DEFERRED
+    };
+
+    double lineCost(const std::string &line) const;
+    InputState dispatchLines(Client &client, size_t maxLines);
+    void deferInput(Client &client, double cost);
+    void scheduleInput(Client &client);
+    bool isMarkedForDisconnection(Client &client) const;
 
-    void extractFullMessages(Client &client, std::string &messageBuffer);
     void truncateAndProcessMessage(Client &client, std::string &message);
 
     void deleteClient(Client &client);
+    void detachClient(Client &client, const std::string &reason);
+    void forgetFd(Client &client);
+    void rejectConnection(int fd, const std::string &ip, const std::string &reason);
+    void checkSendQueue(Client &client, bool queueStarted);
+    void dropOutput(Client &client, const std::string &reason);
 };
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <sys/socket.h>
+#include <common.hpp>
+#include <IpAddress.hpp>
+
+struct ThrottlePolicy
+{
+    size_t maxPerHost = MAX_CONNECTIONS_PER_HOST;
+    double connectBurst = CONNECT_BURST;
+    double connectRatePerSec = CONNECT_RATE;
+    // local connections (tests, bouncers on the same box) are never throttled
+    bool exemptLoopback = true;
+};
+
+// Per-source connection counts and connect-rate buckets, checked before a Client exists.
+// IPv4 hosts are keyed by their full address, IPv6 hosts by their /64, in an open-addressing
+// table so the bookkeeping for a connection is a couple of cache lines and no allocation.
+class ConnectionThrottle
+{
+public:
+    enum Verdict
+    {
+        ADMIT,
+        TOO_MANY_CONNECTIONS,
+        TOO_FAST
+    };
+
+    ConnectionThrottle();
+
+    void setPolicy(const ThrottlePolicy &policy);
+    // counts the connection on success
+    Verdict admit(const sockaddr *addr);
+    void release(const std::string &ip);
+    // counts a connection accepted by an earlier process, never refused
+    void restore(const std::string &ip);
+    size_t trackedHosts() const;
+
+private:
+    struct Entry
+    {
+        IpAddress key;
+        uint32_t connections;
+        bool used;
+        float tokens;
+        int64_t lastRefillUs;
+    };
+
+    ThrottlePolicy _policy;
+    std::vector<Entry> _table;
+    size_t _used;
+
+    static IpAddress hostKey(const IpAddress &address);
+    Entry *find(const IpAddress &key);
+    Entry &insert(const IpAddress &key);
+    void refill(Entry &entry, int64_t nowUs) const;
+    void sweep();
+    size_t slot(const IpAddress &key) const;
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Heap allocations and syscalls charged to the command being run. Only builds with
+// FT_IRC_ACCOUNTING (cmake -DFT_IRC_ACCOUNTING=ON) replace operator new and count syscalls,
+// elsewhere COST_ACCOUNT() and COUNT_SYSCALL() compile to nothing.
+#ifdef FT_IRC_ACCOUNTING
+#define COST_ACCOUNT(command) CostAccounting::Scope costScope(command)
+#define COUNT_SYSCALL() (CostAccounting::syscall())
+#else
+#define COST_ACCOUNT(command) ((void)0)
+#define COUNT_SYSCALL() ((void)0)
+#endif
+
+struct CommandCost
+{
+    uint64_t invocations = 0;
+    uint64_t allocations = 0;
+    uint64_t allocatedBytes = 0;
+    uint64_t syscalls = 0;
+
+    double allocationsPerCall() const;
+    double bytesPerCall() const;
+    double syscallsPerCall() const;
+};
+
+class CostAccounting
+{
+public:
+    // charges what this thread allocates and calls from construction to destruction to
+    // command, which must outlive the scope
+    class Scope
+    {
+    public:
+        explicit Scope(const std::string &command);
+        ~Scope();
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        const std::string &_command;
+        uint64_t _allocations;
+        uint64_t _allocatedBytes;
+        uint64_t _syscalls;
+    };
+
+    // whether operator new is counted, syscalls are wherever COUNT_SYSCALL() is compiled in
+    static bool enabled();
+    static void allocation(size_t bytes);
+    static void syscall();
+
+    static CommandCost costOf(const std::string &command);
+    // one line per command seen, by name, for STATS a
+    static std::vector<std::string> report();
+    static void reset();
+};
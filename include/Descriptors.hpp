@@ -0,0 +1,5 @@
+#pragma once
+
+// closes every descriptor from lowest up; a forked child calls it so it holds no client socket
+// open behind the server's back. Only async-signal-safe calls inside
+void closeDescriptorsFrom(int lowest);
@@ -4,6 +4,14 @@
 #include <vector>
 #include <memory>
 
+// readiness bits of Event::events, each backend translates its own flags into these
+enum EventFlag
+{
+    EVENT_READ = 1 << 0,
+    EVENT_WRITE = 1 << 1,
+    EVENT_CLOSE = 1 << 2
+};
+
 struct Event
 {
     int fd;
@@ -16,6 +24,7 @@ public:
     virtual ~EventLoop() = default;
     virtual void addToWatch(int fd) = 0;
     virtual void removeFromWatch(int fd) = 0;
+    virtual void watchWritable(int fd, bool enable) = 0;
     virtual std::vector<Event> waitForEvents(int timeoutMs) = 0;
     virtual void shutdown() = 0;
 
@@ -16,6 +16,7 @@ public:
 
     void addToWatch(int fd);
     void removeFromWatch(int fd);
+    void watchWritable(int fd, bool enable);
     std::vector<Event> waitForEvents(int timeoutMs);
     void shutdown();
 
@@ -14,6 +14,7 @@ public:
     ~EventLoopPoll();
     void addToWatch(int fd);
     void removeFromWatch(int fd);
+    void watchWritable(int fd, bool enable);
     std::vector<Event> waitForEvents(int timeoutMs);
     void shutdown();
 
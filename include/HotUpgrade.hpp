@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+class Server;
+
+// what a process started with --upgrade got from the one it replaces
+struct UpgradeInheritance
+{
+    int channel; // the upgrade socket, acknowledged once the state is restored
+    int port;
+    std::string password;
+    std::string createdTime;
+    int serverFd;
+    std::unordered_map<int, int> fds; // client fd in the old process -> fd received here
+    std::string state;                // ClientIndex image followed by ChannelManager image
+};
+
+// Hot upgrade. The running server execs its binary again with --upgrade, sends it a state
+// image and every socket over a Unix socket pair (SCM_RIGHTS), and once the new process has
+// taken over it exits without closing anything. Clients stay connected throughout.
+class HotUpgrade
+{
+public:
+    // true once the new process acknowledged, the caller must then leave through _exit
+    static bool handOff(Server &server);
+    // the new process's side, throws ServerError on an incomplete handover
+    static UpgradeInheritance receive(int channel);
+    static void acknowledge(int channel);
+
+    // descriptors travel UPGRADE_FDS_PER_MESSAGE to a message
+    static bool sendFds(int socket, const std::vector<int> &fds);
+    static bool receiveFds(int socket, size_t count, std::vector<int> &fds);
+
+private:
+    static std::string currentBinary();
+    static std::string snapshot(Server &server, std::vector<int> &fds);
+    static bool writeAll(int fd, const std::string &data);
+    static bool readAll(int fd, size_t length, std::string &data);
+    static bool waitForAcknowledge(int channel);
+};
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <sys/socket.h>
+
+// An IPv4 or IPv6 address as 128 bits, most significant bit first. IPv4 addresses are stored
+// in the IPv4-mapped range ::ffff:0:0/96 so both families share one key space.
+struct IpAddress
+{
+    uint64_t high = 0;
+    uint64_t low = 0;
+
+    static bool fromSockaddr(const sockaddr *addr, IpAddress &out);
+    static bool fromString(const std::string &text, IpAddress &out);
+    // "a.b.c.d/n" or "x:y::/n", a bare address is a full length prefix.
+    // IPv4 prefix lengths come back shifted into the mapped range
+    static bool parseCidr(const std::string &text, IpAddress &out, unsigned &prefixLength);
+
+    bool isIPv4() const;
+    bool isLoopback() const;
+    bool bit(unsigned index) const;
+    // the first length bits, the rest zeroed
+    IpAddress masked(unsigned length) const;
+    // number of leading bits shared with other, at most limit
+    unsigned commonPrefix(const IpAddress &other, unsigned limit) const;
+    bool operator==(const IpAddress &other) const;
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <ostream>
+
+// Where the server's log goes: std::cout unless a test installs another Log. Simulation tests
+// install a QuietLog so thousands of clients don't have every line they send formatted.
+class Log
+{
+public:
+    virtual ~Log() = default;
+    virtual std::ostream &stream() = 0;
+    // false when stream() drops what it is given, per-line logging skips formatting then
+    virtual bool enabled() const = 0;
+
+    static std::ostream &out();
+    static bool isEnabled();
+    // nullptr goes back to std::cout
+    static void install(Log *log);
+
+private:
+    static Log *_installed;
+};
+
+class QuietLog : public Log
+{
+public:
+    QuietLog();
+
+    std::ostream &stream() override;
+    bool enabled() const override;
+
+private:
+    // no buffer, every write is dropped
+    std::ostream _discard;
+};
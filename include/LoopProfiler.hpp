@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+// Per-iteration timing of Server::loop. Hooks in the loop only exist when the build enables
+// FT_IRC_PROFILE (cmake -DFT_IRC_PROFILE=ON), otherwise LOOP_PROFILE() compiles to nothing.
+#ifdef FT_IRC_PROFILE
+#define LOOP_PROFILE(call) (_profiler->call)
+#else
+#define LOOP_PROFILE(call) ((void)0)
+#endif
+
+enum LoopPhase
+{
+    PHASE_WAIT,         // waitForEvents
+    PHASE_ACCEPT,       // handleNewClient
+    PHASE_RECEIVE,      // flushing and reading sockets
+    PHASE_DISPATCH,     // parsing and running buffered lines
+    PHASE_REPLIES,      // resumes and streamed LIST/WHO/NAMES
+    PHASE_HOUSEKEEPING, // ban reloads, channel registry
+    PHASE_PING,         // pingSchedule
+    PHASE_DISCONNECT,   // expireDetachedClients, rmDisconnectedClients
+    PHASE_CHANNELS,     // rmEmptyChannels
+    PHASE_COUNT
+};
+
+class LoopProfiler
+{
+public:
+    explicit LoopProfiler(uint64_t slowIterationUs);
+
+    // TSC ticks where the CPU has one, steady_clock ns elsewhere
+    static uint64_t now();
+
+    void beginIteration();
+    // charges the time since the previous mark to phase
+    void mark(LoopPhase phase);
+    // true when the iteration, not counting waitForEvents, took longer than the threshold
+    bool endIteration();
+
+    uint64_t getIterations() const;
+    uint64_t getSlowIterations() const;
+    // mean, max and share of every phase over the last LOOP_PROFILE_WINDOW iterations
+    std::vector<std::string> report() const;
+
+    static const char *phaseName(LoopPhase phase);
+
+private:
+    typedef std::array<uint64_t, PHASE_COUNT> Sample;
+
+    double _ticksPerUs;
+    uint64_t _slowTicks;
+    uint64_t _last;
+    uint64_t _lastWarning;
+    Sample _current;
+    std::vector<Sample> _window;
+    size_t _next;
+    uint64_t _iterations;
+    uint64_t _slowIterations;
+
+    void warn(const Sample &sample, uint64_t busy);
+    std::string micros(uint64_t ticks) const;
+};
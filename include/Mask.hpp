@@ -0,0 +1,9 @@
+#pragma once
+
+#include <string>
+
+// case-insensitive glob match, '*' matches any run of characters and '?' exactly one
+bool matchMask(const std::string &mask, const std::string &text);
+
+// true when the mask contains '*' or '?'
+bool isMask(const std::string &text);
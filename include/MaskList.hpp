@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <ctime>
+#include <CompiledMask.hpp>
+
+class ImageWriter;
+class ImageReader;
+
+// One channel list mode (+b, +e or +I). Entries are bucketed by the last few characters of
+// their literal host suffix, so a lookup only tries the masks that can match the host.
+class MaskList
+{
+public:
+    struct Entry
+    {
+        CompiledMask mask;
+        std::string setBy;
+        time_t setAt;
+    };
+
+    // false if the mask is already listed
+    bool add(const std::string &mask, const std::string &setBy, time_t setAt = time(0));
+    bool remove(const std::string &mask);
+    // subject is a casemapped nick!user@host
+    bool matches(const std::string &subject) const;
+    const std::list<Entry> &getEntries() const;
+    size_t size() const;
+    void save(ImageWriter &image) const;
+    void load(ImageReader &image);
+
+private:
+    std::list<Entry> _entries;
+    std::unordered_map<std::string, std::list<Entry>::iterator> _byMask;
+    std::unordered_multimap<std::string, const Entry *> _byHostSuffix;
+
+    static std::string suffixKey(const std::string &hostSuffix);
+};
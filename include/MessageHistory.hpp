@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdint.h>
+#include <common.hpp>
+
+// A channel's recent PRIVMSG/NOTICE lines in a fixed size ring. Entries keep the buffer the live
+// broadcast was sent from, so recording a message copies nothing. Bytes are capped per channel
+// and against one budget shared by all channels; the oldest entries make room.
+class MessageHistory
+{
+public:
+    struct Entry
+    {
+        std::shared_ptr<const std::string> line; // serialised, \r\n terminated
+        uint64_t id;
+        int64_t timeMs; // unix time, never decreases along the ring
+    };
+
+    // a CHATHISTORY reference, "msgid=..." or "timestamp=..."
+    struct Ref
+    {
+        bool isId;
+        uint64_t id;
+        int64_t timeMs;
+    };
+
+    explicit MessageHistory(size_t maxLines = HISTORY_LINES,
+                            size_t maxBytes = HISTORY_CHANNEL_BYTES);
+    ~MessageHistory();
+    MessageHistory(const MessageHistory &) = delete;
+    MessageHistory &operator=(const MessageHistory &) = delete;
+
+    // a new msgid and a time no earlier than the newest entry's
+    Entry stamp(const std::shared_ptr<const std::string> &line) const;
+    // false when the line alone is over a budget and was not recorded
+    bool add(const Entry &entry);
+    bool add(const std::shared_ptr<const std::string> &line);
+
+    // every query returns entries oldest first
+    std::vector<Entry> latest(const Ref *after, size_t limit) const;
+    std::vector<Entry> before(const Ref &ref, size_t limit) const;
+    std::vector<Entry> after(const Ref &ref, size_t limit) const;
+    std::vector<Entry> around(const Ref &ref, size_t limit) const;
+    std::vector<Entry> between(const Ref &from, const Ref &to, size_t limit) const;
+
+    size_t size() const;
+    size_t getBytes() const;
+    static size_t getTotalBytes();
+    static int64_t nowMs();
+    static uint64_t newMessageId();
+
+    static std::string formatMsgId(uint64_t id);
+    // 2019-01-04T14:33:26.123Z
+    static std::string formatTime(int64_t timeMs);
+    static bool parseRef(const std::string &text, Ref &ref);
+
+private:
+    std::vector<Entry> _ring;
+    size_t _head;
+    size_t _count;
+    size_t _maxBytes;
+    size_t _bytes;
+
+    const Entry &at(size_t index) const;
+    void dropOldest();
+    size_t lowerBound(const Ref &ref) const;
+    size_t upperBound(const Ref &ref) const;
+    std::vector<Entry> range(size_t begin, size_t end) const;
+};
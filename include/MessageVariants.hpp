@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <MessageHistory.hpp>
+
+class Client;
+
+// One outgoing message in the wire forms recipients negotiated with CAP. Only server-time and
+// message-tags change the bytes, so there are at most four forms; each is serialised the first
+// time a recipient needs it and then shared by every recipient that wants the same one.
+class MessageVariants
+{
+public:
+    // stamped with the current time, no msgid
+    explicit MessageVariants(const std::string &message);
+    // PRIVMSG/NOTICE, tagged with the history entry's time and msgid
+    explicit MessageVariants(const MessageHistory::Entry &entry);
+
+    const std::shared_ptr<const std::string> &forClient(const Client &client);
+
+private:
+    std::string _time;
+    std::string _msgid;
+    std::shared_ptr<const std::string> _variants[4];
+};
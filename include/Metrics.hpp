@@ -0,0 +1,99 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <array>
+#include <map>
+#include <atomic>
+#include <utility>
+#include <stdint.h>
+
+class Counter
+{
+public:
+    void add(uint64_t amount = 1);
+    uint64_t value() const;
+
+private:
+    std::atomic<uint64_t> _value{0};
+};
+
+// HDR-style histogram: exact below 16, above that 8 linear sub-buckets per power of two, so
+// any recorded value is off by at most 12.5%. Each thread records into its own shard with
+// relaxed atomic adds, a snapshot sums the shards.
+class Histogram
+{
+public:
+    static constexpr size_t BUCKETS = 16 + 8 * 60;
+    static constexpr size_t SHARDS = 4;
+
+    struct Snapshot
+    {
+        std::array<uint64_t, BUCKETS> counts{};
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t max = 0;
+
+        // the upper bound of the bucket holding the q-th value, q in [0, 1]
+        uint64_t percentile(double q) const;
+        // values recorded at or below limit, to bucket resolution
+        uint64_t countAtMost(uint64_t limit) const;
+    };
+
+    void record(uint64_t value);
+    Snapshot snapshot() const;
+
+    static size_t bucketOf(uint64_t value);
+    static uint64_t upperBound(size_t bucket);
+
+private:
+    struct alignas(64) Shard
+    {
+        std::array<std::atomic<uint64_t>, BUCKETS> counts{};
+        std::atomic<uint64_t> sum{0};
+        std::atomic<uint64_t> max{0};
+    };
+    std::array<Shard, SHARDS> _shards;
+
+    static size_t shardIndex();
+};
+
+// sampled from server state when the metrics are rendered
+struct Gauge
+{
+    std::string name;
+    std::string help;
+    double value;
+};
+
+// Process wide counters and histograms. Everything is recorded lock-free; commands are
+// registered up front (CommandRunner::initCommandMap) so recording one never inserts.
+class Metrics
+{
+public:
+    Counter connectionsAccepted;
+    Counter connectionsRejected;
+    Counter registrations;
+    Counter bytesIn;
+    Counter bytesOut;
+    Counter linesIn;
+    Counter linesOut;
+    // recipients of one channel broadcast or one fan-out to shared channels
+    Histogram fanout;
+
+    void registerCommand(const std::string &command);
+    // ns spent running one command, unregistered commands are not recorded
+    void recordCommand(const std::string &command, uint64_t nanoseconds);
+    uint64_t commandCount(const std::string &command) const;
+    std::vector<std::pair<std::string, Histogram::Snapshot>> commands() const;
+
+    // Prometheus text exposition format, version 0.0.4
+    std::string render(const std::vector<Gauge> &gauges) const;
+    // one line per figure, for STATS
+    std::vector<std::string> summary(const std::vector<Gauge> &gauges) const;
+
+private:
+    std::map<std::string, Histogram> _commands;
+};
+
+Metrics &metrics();
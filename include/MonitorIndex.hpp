@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Client;
+class ClientIndex;
+class ImageWriter;
+class ImageReader;
+
+// MONITOR watch lists, indexed both ways: casemapped nick -> watchers for the presence
+// notifications ClientIndex triggers, and watcher -> nicks for MONITOR L/C and cleanup
+class MonitorIndex
+{
+public:
+    // false when the watcher's list is already at MONITOR_LIMIT
+    bool add(Client &watcher, const std::string &nick);
+    void remove(Client &watcher, const std::string &nick);
+    void clear(Client &watcher);
+    const std::vector<std::string> &getList(Client &watcher) const;
+
+    // the nick's watchers get RPL_MONONLINE / RPL_MONOFFLINE
+    void notifyOnline(Client &target);
+    void notifyOffline(const std::string &nick);
+
+    // hot upgrade, watchers are written by nick and looked up in clients again on load
+    void save(ImageWriter &image) const;
+    void load(ImageReader &image, const ClientIndex &clients);
+
+private:
+    // keys casemapped, values as the watcher typed them
+    std::unordered_map<std::string, std::vector<Client *>> _watchers;
+    std::unordered_map<Client *, std::vector<std::string>> _lists;
+};
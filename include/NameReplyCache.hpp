@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+class Client;
+
+// Pre-serialised RPL_NAMREPLY payloads of one channel, kept up to date member by member
+// so a join only has to copy the chunks instead of rebuilding the list
+class NameReplyCache
+{
+public:
+    explicit NameReplyCache(size_t chunkLimit);
+
+    void add(Client *client, const std::string &entry);
+    void remove(Client *client);
+    void update(Client *client, const std::string &entry);
+    bool contains(Client *client) const;
+    size_t size() const;
+    const std::vector<std::string> &getChunks() const;
+
+private:
+    size_t _chunkLimit;
+    std::vector<std::string> _chunks;
+    // chunks that lost an entry and may have room again, _isSpare marks the indices in _spare
+    // so a chunk is never listed twice
+    std::vector<size_t> _spare;
+    std::vector<bool> _isSpare;
+    std::unordered_map<Client *, std::pair<size_t, std::string>> _entries;
+
+    size_t findRoom(size_t length);
+    void forgetDropped();
+    void eraseEntry(std::string &chunk, const std::string &entry);
+};
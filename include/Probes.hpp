@@ -0,0 +1,62 @@
+#pragma once
+
+#include <type_traits>
+
+// USDT probes for perf, bpftrace and SystemTap, e.g.
+//     bpftrace -e 'usdt:./ft_irc:ft_irc:dispatch { @[str(arg1)] = count(); }'
+// Each probe is a single nop plus an ELF note in the same format <sys/sdt.h> writes, so the
+// server has no runtime dependency and an unattached probe costs the nop. A tracer that attaches
+// turns the nop into a breakpoint and reads the arguments from the registers or stack slots the
+// note names. Builds with FT_IRC_PROBES off (cmake -DFT_IRC_PROBES=OFF), or for targets the
+// note format is not written for, compile PROBE1() to PROBE3() to nothing.
+#if defined(FT_IRC_PROBES) && defined(__linux__) && (defined(__x86_64__) || defined(__aarch64__))
+
+// argument sizes in the note are negative for signed types
+template <typename T>
+struct ProbeArg
+{
+    using Type = std::decay_t<T>;
+    static constexpr int size = (std::is_signed<Type>::value ? 1 : -1) * int(sizeof(Type));
+};
+
+#define PROBE_ARG(n, x) [s##n] "n"(ProbeArg<decltype(x)>::size), [a##n] "nor"(x)
+
+// the note points at the nop; .stapsdt.base lets tools correct for prelinking
+#define PROBE_ASM(name, args, ...)                                                                 \
+    __asm__ __volatile__("990: nop\n"                                                              \
+                         ".pushsection .note.stapsdt,\"?\",\"note\"\n"                             \
+                         ".balign 4\n"                                                             \
+                         ".4byte 992f-991f, 994f-993f, 3\n"                                        \
+                         "991: .asciz \"stapsdt\"\n"                                               \
+                         "992: .balign 4\n"                                                        \
+                         "993: .8byte 990b\n"                                                      \
+                         ".8byte _.stapsdt.base\n"                                                 \
+                         ".8byte 0\n"                                                              \
+                         ".asciz \"ft_irc\"\n"                                                     \
+                         ".asciz \"" #name "\"\n"                                                  \
+                         ".asciz \"" args "\"\n"                                                   \
+                         "994: .balign 4\n"                                                        \
+                         ".popsection\n"                                                           \
+                         ".ifndef _.stapsdt.base\n"                                                \
+                         ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n"   \
+                         ".weak _.stapsdt.base\n"                                                  \
+                         ".hidden _.stapsdt.base\n"                                                \
+                         "_.stapsdt.base: .space 1\n"                                              \
+                         ".size _.stapsdt.base, 1\n"                                               \
+                         ".popsection\n"                                                           \
+                         ".endif\n"                                                                \
+                         :                                                                         \
+                         : __VA_ARGS__)
+
+#define PROBE1(name, a1) PROBE_ASM(name, "%n[s1]@%[a1]", PROBE_ARG(1, a1))
+#define PROBE2(name, a1, a2)                                                                       \
+    PROBE_ASM(name, "%n[s1]@%[a1] %n[s2]@%[a2]", PROBE_ARG(1, a1), PROBE_ARG(2, a2))
+#define PROBE3(name, a1, a2, a3)                                                                   \
+    PROBE_ASM(name, "%n[s1]@%[a1] %n[s2]@%[a2] %n[s3]@%[a3]", PROBE_ARG(1, a1), PROBE_ARG(2, a2), \
+              PROBE_ARG(3, a3))
+
+#else
+#define PROBE1(name, a1) ((void)0)
+#define PROBE2(name, a1, a2) ((void)0)
+#define PROBE3(name, a1, a2, a3) ((void)0)
+#endif
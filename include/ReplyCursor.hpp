@@ -0,0 +1,78 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <MessageHistory.hpp>
+
+class Client;
+class ClientIndex;
+class ChannelManager;
+
+// A long reply (LIST, WHO, NAMES) that is emitted in bounded batches, one batch per loop
+// iteration once the client's send queue has drained, so one query can't stall the server
+class ReplyCursor
+{
+public:
+    virtual ~ReplyCursor() = default;
+    // sends at most maxLines replies, returns true once the whole reply has been sent
+    virtual bool emit(Client &client, size_t maxLines) = 0;
+};
+
+class ListCursor : public ReplyCursor
+{
+public:
+    ListCursor(ChannelManager &channels, std::vector<std::string> names);
+    bool emit(Client &client, size_t maxLines);
+
+private:
+    ChannelManager &_channels;
+    std::vector<std::string> _names;
+    size_t _next;
+    bool _started;
+};
+
+class WhoCursor : public ReplyCursor
+{
+public:
+    WhoCursor(ClientIndex &clients, ChannelManager &channels, const std::string &mask,
+              std::vector<std::string> nicks);
+    bool emit(Client &client, size_t maxLines);
+
+private:
+    ClientIndex &_clients;
+    ChannelManager &_channels;
+    std::string _mask;
+    std::vector<std::string> _nicks;
+    size_t _next;
+};
+
+class NamesCursor : public ReplyCursor
+{
+public:
+    // listAll: NAMES without parameters, a single RPL_ENDOFNAMES for "*" at the end
+    NamesCursor(ChannelManager &channels, std::vector<std::string> names, bool listAll);
+    bool emit(Client &client, size_t maxLines);
+
+private:
+    ChannelManager &_channels;
+    std::vector<std::string> _names;
+    bool _listAll;
+    size_t _next;
+    size_t _nextChunk;
+};
+
+// a CHATHISTORY batch, the entries share their line buffers with the channel history
+class HistoryCursor : public ReplyCursor
+{
+public:
+    HistoryCursor(const std::string &target, const std::string &batchRef,
+                  std::vector<MessageHistory::Entry> entries);
+    bool emit(Client &client, size_t maxLines);
+
+private:
+    std::string _target;
+    std::string _batchRef;
+    std::vector<MessageHistory::Entry> _entries;
+    size_t _next;
+    bool _started;
+};
@@ -6,25 +6,36 @@
 #include <csignal>
 #include <memory>
 #include <chrono>
+#include <vector>
+#include <Metrics.hpp>
 
 class SocketManager;
 class EventLoop;
 class ConnectionManager;
 class ClientIndex;
 class ChannelManager;
+class ChannelRegistry;
 class PongManager;
+class AdminSocket;
+class LoopProfiler;
+struct UpgradeInheritance;
 
 class Server
 {
 public:
     Server(int port, std::string password, bool startBlocking = true);
+    // takes over from the process that started us with --upgrade
+    Server(UpgradeInheritance &inherited, bool startBlocking = true);
     ~Server() noexcept;
     void loop();
+    void iterate();
     void shutdown();
 
     // getters
     static Server &getInstance();
+    static bool hasInstance();
     int getServerFD() const;
+    int getPort() const;
     SocketManager &getSocketManager();
     EventLoop &getEventLoop();
     ClientIndex &getClients();
@@ -33,12 +44,18 @@ public:
     const std::string &getPassword();
     const std::string &getCreatedTime();
     PongManager &getPongManager();
+    // current figures for the metrics, sampled when they are rendered
+    std::vector<Gauge> gauges();
+    // nullptr unless built with FT_IRC_PROFILE
+    LoopProfiler *getLoopProfiler();
 
     void pause();
     void resume();
 
     volatile sig_atomic_t _running;
     volatile sig_atomic_t _paused;
+    volatile sig_atomic_t _reloadBans;
+    volatile sig_atomic_t _upgrade;
 
 private:
     int _serverFd;
@@ -46,15 +63,28 @@ private:
     std::string _password;
     static Server *_instance;
     std::unique_ptr<ClientIndex> _clients;
+    // outlives _channels, which keeps a pointer to it
+    std::unique_ptr<ChannelRegistry> _registry;
     std::unique_ptr<ChannelManager> _channels;
     std::unique_ptr<SocketManager> _socketManager;
     std::unique_ptr<EventLoop> _eventLoop;
     std::unique_ptr<PongManager> _PongManager;
     std::unique_ptr<ConnectionManager> _connectionManager;
+    std::unique_ptr<AdminSocket> _admin;
+    std::unique_ptr<LoopProfiler> _profiler;
 
     static void signalHandler(int signum);
+    void installSignalHandlers();
+    void startProfiler();
+    void openRegistry();
+    void openAdminSocket();
+    void openCapture();
+    void openTracer();
+    void upgrade();
     void pingSchedule(int64_t &last_ping);
     // void sendPingToInactivityClients(int timeoutMs, const int pingTimeout);
     // server info
     const std::string _createdTime;
+    int64_t _lastPing;
+    int64_t _lastPingCheck;
 };
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <sys/socket.h>
+#include <BanTrie.hpp>
+
+// Server-wide address bans read from a file. A reload parses the file on a worker thread and
+// the loop swaps the finished trie in, so a large list never stalls message routing.
+class ServerBans
+{
+public:
+    explicit ServerBans(const std::string &path);
+    ~ServerBans();
+
+    // blocking load, used at startup; a missing file just means no bans
+    void load();
+    // starts a background reload unless one is already running
+    void reload();
+    // called by the loop, swaps in a reload that has finished
+    void collectReload();
+    const std::string *match(const sockaddr *addr) const;
+    size_t size() const;
+
+private:
+    std::string _path;
+    std::unique_ptr<BanTrie> _active;
+    std::thread _worker;
+    std::atomic<bool> _reloading;
+    std::atomic<bool> _reloadDone;
+    std::mutex _resultMutex;
+    std::unique_ptr<BanTrie> _reloaded;
+    std::vector<std::string> _reloadWarnings;
+    std::string _reloadError;
+
+    static void logWarnings(const std::vector<std::string> &warnings);
+};
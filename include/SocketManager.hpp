@@ -14,6 +14,8 @@ public:
     ~SocketManager();
 
     int initialize();
+    // takes over a socket that is already bound and listening, handed over by a hot upgrade
+    int adopt(int serverFd);
     void closeServerSocket();
     int acceptConnection(sockaddr_in *clientAddr);
     void closeConnection(int fd);
@@ -21,5 +23,4 @@ public:
 private:
     int _serverFd;
     int _port;
-    sockaddr_in _serverAddress;
 };
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <stdint.h>
+
+// Flat little-endian encoding of server state, written by the running process and read back by
+// the one taking over from it. Strings are length prefixed, nothing is aligned.
+class ImageWriter
+{
+public:
+    void u8(uint8_t value);
+    void u32(uint32_t value);
+    void u64(uint64_t value);
+    void i64(int64_t value);
+    void str(const std::string &value);
+    const std::string &data() const;
+    void clear();
+
+private:
+    std::string _data;
+};
+
+// reads an ImageWriter's output in the same order, throws ServerError past the end. The bytes
+// are not copied, they must outlive the reader
+class ImageReader
+{
+public:
+    explicit ImageReader(const std::string &data);
+    ImageReader(const char *data, size_t size);
+
+    uint8_t u8();
+    uint32_t u32();
+    uint64_t u64();
+    int64_t i64();
+    std::string str();
+    bool atEnd() const;
+
+private:
+    const char *_data;
+    size_t _size;
+    size_t _offset;
+
+    const char *take(size_t length);
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <chrono>
+
+// Classic token bucket: holds up to capacity tokens and refills ratePerSec of them per second
+class TokenBucket
+{
+public:
+    TokenBucket(double capacity, double ratePerSec);
+
+    void configure(double capacity, double ratePerSec);
+    // takes cost tokens if the bucket holds that many
+    bool take(double cost);
+    // milliseconds until cost tokens will be available, 0 if they are already
+    int msUntilAvailable(double cost);
+
+private:
+    double _capacity;
+    double _ratePerSec;
+    double _tokens;
+    std::chrono::steady_clock::time_point _lastRefill;
+
+    void refill();
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+// One sampled line on its way through the server, in Clock::now() nanoseconds. Fixed size so
+// the ring can copy it without allocating.
+struct Trace
+{
+    uint64_t id;
+    int fd;
+    char command[16];
+    // the recv() that completed the line, the line taken off the input buffer, the command
+    // starting (0 when none ran) and the line done
+    int64_t receivedNs;
+    int64_t takenNs;
+    int64_t executingNs;
+    int64_t doneNs;
+    // first and last shared delivery, recipients whose socket took it at once and the others
+    int64_t fanoutStartNs;
+    int64_t fanoutEndNs;
+    uint32_t recipients;
+    uint32_t queued;
+};
+
+// Samples inbound lines at recv time and follows each sampled line through dispatch, the
+// command and its fan-out. Everything but the export runs on the event loop thread; finished
+// traces go through a single-producer ring to a thread that appends them to a Chrome
+// trace-event JSON file (chrome://tracing, Perfetto).
+class Tracer
+{
+public:
+    Tracer(const std::string &path, double rate);
+    ~Tracer();
+    Tracer(const Tracer &) = delete;
+    Tracer &operator=(const Tracer &) = delete;
+
+    // the last length bytes of buffer just arrived on fd
+    void received(int fd, const std::string &buffer, size_t length);
+    // the next complete line of fd is being run, true when it is sampled and now traced
+    bool takeLine(int fd);
+    void executing(const std::string &command);
+    // a line went to a recipient, still in its send queue when queued
+    void delivered(bool queued);
+    void finishLine();
+    void forget(int fd);
+
+    uint64_t dropped() const;
+
+private:
+    struct Sample
+    {
+        uint64_t line;
+        int64_t receivedNs;
+    };
+
+    struct LineCounter
+    {
+        uint64_t received = 0;
+        uint64_t taken = 0;
+        std::deque<Sample> sampled;
+    };
+
+    double _rate;
+    std::mt19937_64 _random;
+    std::uniform_real_distribution<double> _uniform;
+    std::unordered_map<int, LineCounter> _lines;
+    uint64_t _nextId;
+    bool _active;
+    Trace _current;
+
+    // single producer (event loop), single consumer (exporter)
+    std::vector<Trace> _ring;
+    alignas(64) std::atomic<uint64_t> _head;
+    alignas(64) std::atomic<uint64_t> _tail;
+    std::atomic<uint64_t> _dropped;
+
+    int _fd;
+    bool _firstEvent;
+    std::mutex _wakeMutex;
+    std::condition_variable _wake;
+    bool _stopping;
+    std::thread _exporter;
+
+    static int64_t now();
+    void push(const Trace &trace);
+    void exportLoop();
+    void drain();
+    void appendEvents(std::string &out, const Trace &trace);
+    void appendEvent(std::string &out, const char *name, const Trace &trace, int64_t startNs,
+                     int64_t endNs, const std::string &args);
+    void write(const std::string &data);
+};
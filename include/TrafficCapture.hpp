@@ -0,0 +1,71 @@
+#pragma once
+
+#include <Clock.hpp>
+#include <MappedFile.hpp>
+#include <StateImage.hpp>
+#include <string>
+#include <unordered_map>
+#include <stdint.h>
+
+// One event of a capture. Connections are numbered in accept order since fds get reused, the
+// time is microseconds since the capture started and data is exactly what one recv returned.
+struct CaptureRecord
+{
+    enum Kind : uint8_t
+    {
+        OPEN,
+        DATA,
+        CLOSE
+    };
+
+    Kind kind;
+    uint32_t connection;
+    uint64_t atUs;
+    // the peer's address for OPEN, the bytes for DATA
+    std::string data;
+};
+
+// Inbound traffic as the server saw it, appended to a file for ft_irc_replay. Records are
+// ImageWriter encoded behind a magic string and written in batches, a failed write ends the
+// capture but never the server.
+class TrafficCapture
+{
+public:
+    explicit TrafficCapture(const std::string &path);
+    ~TrafficCapture();
+    TrafficCapture(const TrafficCapture &) = delete;
+    TrafficCapture &operator=(const TrafficCapture &) = delete;
+
+    void opened(int fd, const std::string &ip);
+    void received(int fd, const char *data, size_t length);
+    void closed(int fd);
+    void flush();
+    // writes the buffered records once the oldest is CAPTURE_FLUSH_MS old, an idle server's
+    // loop calls it so the tail is not left in memory
+    void flushIfStale(Clock::TimePoint now);
+
+private:
+    std::string _path;
+    int _fd;
+    Clock::TimePoint _start;
+    // when the first record still in _buffer was taken
+    Clock::TimePoint _oldest;
+    uint32_t _nextConnection;
+    std::unordered_map<int, uint32_t> _connections;
+    ImageWriter _buffer;
+
+    void record(CaptureRecord::Kind kind, uint32_t connection, const std::string &data);
+};
+
+// reads a capture back in order. A capture cut short by a crash ends at its last whole record
+class CaptureReader
+{
+public:
+    explicit CaptureReader(const std::string &path);
+
+    bool next(CaptureRecord &record);
+
+private:
+    MappedFile _file;
+    ImageReader _reader;
+};
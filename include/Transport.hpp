@@ -0,0 +1,43 @@
+#pragma once
+
+#include <memory>
+#include <sys/types.h>
+#include <netinet/in.h>
+#include <EventLoop.hpp>
+
+// Everything the server does with client sockets and their readiness. SocketTransport is the
+// kernel; simulation tests install an in-memory one and drive Server::iterate() themselves.
+// Calls follow the system calls they stand for: -1 with errno set on failure.
+class Transport
+{
+public:
+    virtual ~Transport() = default;
+
+    // a non-blocking listening socket on every interface
+    virtual int listen(int port) = 0;
+    // the connection comes back non-blocking, EAGAIN when none is waiting
+    virtual int accept(int listenFd, sockaddr_in *address) = 0;
+    // never blocks or raises SIGPIPE
+    virtual ssize_t send(int fd, const void *data, size_t length) = 0;
+    virtual ssize_t recv(int fd, void *buffer, size_t length) = 0;
+    virtual void close(int fd) = 0;
+    virtual std::unique_ptr<EventLoop> createEventLoop() = 0;
+
+    static Transport &current();
+    // nullptr goes back to the sockets
+    static void install(Transport *transport);
+
+private:
+    static Transport *_installed;
+};
+
+class SocketTransport : public Transport
+{
+public:
+    int listen(int port) override;
+    int accept(int listenFd, sockaddr_in *address) override;
+    ssize_t send(int fd, const void *data, size_t length) override;
+    ssize_t recv(int fd, void *buffer, size_t length) override;
+    void close(int fd) override;
+    std::unique_ptr<EventLoop> createEventLoop() override;
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstdint>
+
+// Maps every case-folded 3 character substring of a text to the keys whose text contains it.
+// A glob mask can only match texts that contain all trigrams of its literal runs, so the
+// smallest of those posting lists is a complete candidate set for the mask.
+class TrigramIndex
+{
+public:
+    using Keys = std::unordered_set<std::string>;
+
+    void add(const std::string &key, const std::string &text);
+    void remove(const std::string &key, const std::string &text);
+    // nullptr when the mask has no literal run of 3 characters and can't be narrowed down
+    const Keys *candidates(const std::string &mask) const;
+
+private:
+    std::unordered_map<uint32_t, Keys> _postings;
+
+    static uint32_t trigram(const std::string &text, size_t pos);
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdint.h>
+
+class ImageReader;
+
+// Append-only log kept in numbered segments, <directory>/<name>.<generation>. Records are
+// queued by the caller and written by a background thread that fdatasyncs once per batch
+// (group commit), so the event loop never waits for the disk. Each record is framed with its
+// length and a checksum; replay stops at the first torn one, which a crash mid-write leaves.
+class WriteAheadLog
+{
+public:
+    WriteAheadLog(const std::string &directory, const std::string &name);
+    ~WriteAheadLog();
+    WriteAheadLog(const WriteAheadLog &) = delete;
+    WriteAheadLog &operator=(const WriteAheadLog &) = delete;
+
+    // replays the segments from generation from on, oldest first, drops the older ones and
+    // starts the writer. Appends always go to a new segment, never behind a torn tail
+    void open(uint64_t from, const std::function<void(ImageReader &)> &apply);
+    void append(const std::string &record);
+    // appends from now on land in a new segment, whose generation is returned
+    uint64_t rotate();
+    void discardBefore(uint64_t generation);
+    // blocks until every record appended so far is on disk
+    void sync();
+
+private:
+    struct Chunk
+    {
+        uint64_t generation;
+        std::string data;
+    };
+
+    std::string _directory;
+    std::string _name;
+    // where appends go, only touched by the caller's thread
+    uint64_t _generation;
+
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _committedChanged;
+    std::deque<Chunk> _pending;
+    uint64_t _appended;
+    uint64_t _committed;
+    bool _stopping;
+    std::thread _writer;
+
+    // writer thread only
+    int _fd;
+    uint64_t _fdGeneration;
+
+    std::string segmentPath(uint64_t generation) const;
+    std::vector<uint64_t> segments() const;
+    void writerLoop();
+    void writeChunk(const Chunk &chunk);
+    static uint32_t checksum(const char *data, size_t length);
+    static void replaySegment(const std::string &path,
+                              const std::function<void(ImageReader &)> &apply);
+};
@@ -1,20 +1,35 @@
 #pragma once
 #include <string>
 #include <limits>
+#include <cstdint>
 
 // Common constants for the IRC server
 const int MSG_BUFFER_SIZE = 512; // Buffer size for message handling
 
 const int PING_INTERVAL_SEC = 120;
 const int PING_TIMEOUT_SEC = 60;
+// timeouts are checked this often rather than every iteration, each check walks every client
+const int PING_CHECK_INTERVAL_MS = 1000;
 // ISUPPORT
 const std::string CASEMAPPING = "ascii";
 const int CHANNELLEN = 50;
 const std::string CHANLIMIT = "#&:50";
+const std::string ELIST = "CMNTU";
+const std::string MAXLIST = "beI:100";
+const size_t MAX_LIST_ENTRIES = 100; // +b, +e and +I entries per channel, together
+const size_t ISUPPORT_TOKENS_PER_LINE = 13;
+// channel history: lines and bytes kept per channel, bytes kept by all channels together,
+// and the most lines one CHATHISTORY request returns
+const size_t HISTORY_LINES = 1024;
+const size_t HISTORY_CHANNEL_BYTES = 256 * 1024;
+const size_t HISTORY_TOTAL_BYTES = 32 * 1024 * 1024;
+const size_t CHATHISTORY_MAX = 100;
+const size_t MONITOR_LIMIT = 100; // nicks one client may MONITOR
+const int RESUME_GRACE_SEC = 60;   // how long a lost resumable session keeps its nick and channels
 const int LOCCHANLMAX = 50;
 const int REGCHANLMAX = 50;
 const std::string CHANTYPES = "#&";
-const std::string CHANMODES = ",,kl,it";
+const std::string CHANMODES = "beI,,kl,itD";
 const std::string PREFIX = "o(@)";
 const int MODES = 3;
 const int NICKLEN = 30;
@@ -22,6 +37,47 @@ const int TOPICLEN = 307;
 const int USERLEN = 32;
 const int REALLEN = 128;
 const int EPOLL_MAX_EVENTS = 128;
+const size_t REPLY_BATCH_LINES = 64;          // LIST/WHO/NAMES lines per loop iteration
+const size_t MAX_SENDQ = 4 * 1024 * 1024;     // queued output bytes before a client is dropped
+// flood control: tokens a client may burst, tokens regained per second, and how much deferred
+// input may pile up before the client is dropped for Excess Flood
+const double FLOOD_BURST = 10;
+const double FLOOD_RATE = 2;
+const size_t MAX_RECVQ = 8192;
+// K/D-line file, overridden by the FT_IRC_BANS environment variable, reloaded on SIGHUP
+const std::string BANS_FILE = "ircd.bans";
+// accept time limits per source host, loopback is exempt
+const size_t MAX_CONNECTIONS_PER_HOST = 10;
+const double CONNECT_BURST = 5;
+const double CONNECT_RATE = 1;
+// channel registry, kept in $FT_IRC_STATE_DIR when that is set: a snapshot is forked this
+// often while channels change, or sooner once this many changes went to the WAL
+const int SNAPSHOT_INTERVAL_SEC = 300;
+const size_t SNAPSHOT_CHANGES = 10000;
+// hot upgrade (SIGUSR2): how long the new process gets to take over, and descriptors per
+// SCM_RIGHTS message, the kernel takes at most 253
+const int UPGRADE_TIMEOUT_MS = 10000;
+const size_t UPGRADE_FDS_PER_MESSAGE = 250;
+const size_t UPGRADE_MAX_IMAGE = 1024 * 1024 * 1024;
+// metrics scrapes on the admin socket (FT_IRC_ADMIN_SOCKET), a request longer than this is
+// dropped before it is answered
+const int ADMIN_BACKLOG = 8;
+const size_t ADMIN_REQUEST_MAX = 8192;
+// loop profiler (FT_IRC_PROFILE builds): iterations kept for the rolling figures, busy time
+// that counts as a slow iteration, and how long the TSC rate is measured at startup
+const size_t LOOP_PROFILE_WINDOW = 1024;
+const uint64_t LOOP_SLOW_ITERATION_US = 20000;
+const int LOOP_PROFILE_CALIBRATION_MS = 5;
+// traffic capture ($FT_IRC_CAPTURE): records are buffered until there are this many bytes or
+// the oldest is this old
+const size_t CAPTURE_BUFFER_BYTES = 64 * 1024;
+const int CAPTURE_FLUSH_MS = 1000;
+// fan-out tracing ($FT_IRC_TRACE): share of lines sampled unless $FT_IRC_TRACE_RATE says
+// otherwise, finished traces the ring holds, and how often the exporter drains it
+const double TRACE_DEFAULT_RATE = 0.01;
+const size_t TRACE_RING_SIZE = 4096;
+const int TRACE_EXPORT_MS = 200;
+const size_t INPUT_LINES_PER_ROUND = 4; // lines one client may run before the next gets a turn
 const int MAX_PARAMS = 4;
 const int MIN_PASS = 2;
 const int MAX_PASS = 32;
@@ -34,7 +90,7 @@ const std::string SERVER_NAME = "JAS.42";
 const std::string NETWORK_NAME = "J-A-S";
 const std::string SERVER_VERSION = "0210";
 const std::string USER_MODES = "";
-const std::string CHANNEL_MODES = "itklo";
+const std::string CHANNEL_MODES = "beIitklDo";
 
 // MOTD array with funny messages
 const std::string MOTD_LINES[] = {
@@ -6,7 +6,10 @@
 #include <chrono>
 #include <ctime>
 #include <sstream>
+#include <vector>
+#include <memory>
 #include <common.hpp>
+#include <Log.hpp>
 
 // Time utilities
 inline std::string getCurrentTime()
@@ -30,16 +33,25 @@ inline std::string getLogTimestamp()
 // Logging function
 inline void logMessage(int fd, const std::string &msg, bool outgoing = true)
 {
+    // a quiet log (simulation tests) skips the formatting too
+    if (!Log::isEnabled())
+        return;
     std::string direction = outgoing ? "to" : "from";
-    std::cout << getLogTimestamp() << " " << direction << " " << fd << ": " << msg << std::endl;
+    Log::out() << getLogTimestamp() << " " << direction << " " << fd << ": " << msg << std::endl;
 }
 
 // Client communication
+// sends an already \r\n terminated line, lets fan-out build the line once for all recipients.
+// Defined with ConnectionManager, which queues what the socket can't take right away
+void sendSerialized(int fd, const std::string &line);
+// queues the same buffer for every recipient, tags (without '@') are sent in front of it
+void sendShared(int fd, const std::shared_ptr<const std::string> &line,
+                const std::string &tags = "");
+
 inline void sendToClient(int fd, std::string msg)
 {
     msg.append("\r\n");
-    send(fd, msg.c_str(), msg.length(), 0);
-    logMessage(fd, msg);
+    sendSerialized(fd, msg);
 }
 
 /* WELCOME MESSAGES (001-005) */
@@ -66,26 +78,77 @@ inline std::string RPL_MYINFO(const std::string &nickname)
            USER_MODES + " " + CHANNEL_MODES;
 }
 
-inline std::string RPL_ISUPPORT(const std::string &nickname)
+inline std::vector<std::string> ISUPPORT_TOKENS()
+{
+    return {"CASEMAPPING=" + CASEMAPPING,
+            "CHANNELLEN=" + std::to_string(CHANNELLEN),
+            "CHANLIMIT=" + CHANLIMIT,
+            "CHANTYPES=" + CHANTYPES,
+            "CHANMODES=" + CHANMODES,
+            "PREFIX=" + PREFIX,
+            "MODES=" + std::to_string(MODES),
+            "NICKLEN=" + std::to_string(NICKLEN),
+            "TOPICLEN=" + std::to_string(TOPICLEN),
+            "USERLEN=" + std::to_string(USERLEN),
+            "MAXTARGETS=" + std::to_string(MAXTARGETS),
+            "SAFELIST",
+            "ELIST=" + ELIST,
+            "EXCEPTS",
+            "INVEX",
+            "MAXLIST=" + MAXLIST,
+            "CHATHISTORY=" + std::to_string(CHATHISTORY_MAX),
+            "MSGREFTYPES=msgid,timestamp",
+            "MONITOR=" + std::to_string(MONITOR_LIMIT)};
+}
+
+// one 005 line carries at most ISUPPORT_TOKENS_PER_LINE tokens
+inline std::string RPL_ISUPPORT(const std::string &nickname,
+                                const std::vector<std::string> &tokens)
 {
     std::ostringstream oss;
     oss << ":" << SERVER_NAME << " 005 " << nickname << " ";
-    oss << "CASEMAPPING=" << CASEMAPPING << " ";
-    oss << "CHANNELLEN=" << CHANNELLEN << " ";
-    oss << "CHANLIMIT=" << CHANLIMIT << " ";
-    oss << "CHANTYPES=" << CHANTYPES << " ";
-    oss << "CHANMODES=" << CHANMODES << " ";
-    oss << "PREFIX=" << PREFIX << " ";
-    oss << "MODES=" << MODES << " ";
-    oss << "NICKLEN=" << NICKLEN << " ";
-    oss << "TOPICLEN=" << TOPICLEN << " ";
-    oss << "USERLEN=" << USERLEN << " ";
-    oss << "MAXTARGETS=" << MAXTARGETS << " ";
+    for (const std::string &token : tokens)
+        oss << token << " ";
     oss << ":are supported by this server";
     return oss.str();
 }
 
 /* COMMAND RESPONSES */
+inline std::string CAP(const std::string &client, const std::string &subcommand,
+                       const std::string &caps)
+{
+    return "CAP " + client + " " + subcommand + " :" + caps;
+}
+
+inline std::string BATCH_START(const std::string &ref, const std::string &type,
+                               const std::string &target)
+{
+    return ":" + SERVER_NAME + " BATCH +" + ref + " " + type + " " + target;
+}
+
+inline std::string BATCH_END(const std::string &ref)
+{
+    return ":" + SERVER_NAME + " BATCH -" + ref;
+}
+
+inline std::string RESUME_TOKEN(const std::string &token)
+{
+    return ":" + SERVER_NAME + " RESUME TOKEN " + token;
+}
+
+inline std::string RESUME_SUCCESS(const std::string &nickname)
+{
+    return ":" + SERVER_NAME + " RESUME SUCCESS " + nickname;
+}
+
+// IRCv3 standard replies
+inline std::string STANDARD_FAIL(const std::string &command, const std::string &code,
+                                 const std::string &context, const std::string &description)
+{
+    return ":" + SERVER_NAME + " FAIL " + command + " " + code +
+           (context.empty() ? "" : " " + context) + " :" + description;
+}
+
 inline std::string JOIN(const std::string &userHost, const std::string &channel)
 {
     return ":" + userHost + " JOIN " + channel;
@@ -166,6 +229,100 @@ inline std::string RPL_TOPICWHOTIME(const std::string &client, const std::string
     return "333 " + client + " " + channel + " " + who + " " + time;
 }
 
+inline std::string RPL_LISTSTART(const std::string &client)
+{
+    return "321 " + client + " Channel :Users  Name";
+}
+
+inline std::string RPL_LIST(const std::string &client, const std::string &channel, size_t count,
+                            const std::string &topic)
+{
+    return "322 " + client + " " + channel + " " + std::to_string(count) + " :" + topic;
+}
+
+inline std::string RPL_LISTEND(const std::string &client)
+{
+    return "323 " + client + " :End of /LIST";
+}
+
+inline std::string RPL_WHOREPLY(const std::string &client, const std::string &channel,
+                                const std::string &username, const std::string &host,
+                                const std::string &nickname, const std::string &flags,
+                                const std::string &realname)
+{
+    return "352 " + client + " " + channel + " " + username + " " + host + " " + SERVER_NAME +
+           " " + nickname + " " + flags + " :0 " + realname;
+}
+
+inline std::string RPL_ENDOFWHO(const std::string &client, const std::string &mask)
+{
+    return "315 " + client + " " + mask + " :End of /WHO list";
+}
+
+inline std::string RPL_WHOISUSER(const std::string &client, const std::string &nickname,
+                                 const std::string &username, const std::string &host,
+                                 const std::string &realname)
+{
+    return "311 " + client + " " + nickname + " " + username + " " + host + " * :" + realname;
+}
+
+inline std::string RPL_WHOISSERVER(const std::string &client, const std::string &nickname)
+{
+    return "312 " + client + " " + nickname + " " + SERVER_NAME + " :" + NETWORK_NAME;
+}
+
+inline std::string RPL_WHOISOPERATOR(const std::string &client, const std::string &nickname)
+{
+    return "313 " + client + " " + nickname + " :is an IRC operator";
+}
+
+inline std::string RPL_WHOISCHANNELS(const std::string &client, const std::string &nickname,
+                                     const std::string &channels)
+{
+    return "319 " + client + " " + nickname + " :" + channels;
+}
+
+inline std::string RPL_ENDOFWHOIS(const std::string &client, const std::string &nickname)
+{
+    return "318 " + client + " " + nickname + " :End of /WHOIS list";
+}
+
+inline std::string RPL_BANLIST(const std::string &client, const std::string &channel,
+                               const std::string &mask, const std::string &setBy,
+                               const std::string &setAt)
+{
+    return "367 " + client + " " + channel + " " + mask + " " + setBy + " " + setAt;
+}
+
+inline std::string RPL_ENDOFBANLIST(const std::string &client, const std::string &channel)
+{
+    return "368 " + client + " " + channel + " :End of channel ban list";
+}
+
+inline std::string RPL_EXCEPTLIST(const std::string &client, const std::string &channel,
+                                  const std::string &mask, const std::string &setBy,
+                                  const std::string &setAt)
+{
+    return "348 " + client + " " + channel + " " + mask + " " + setBy + " " + setAt;
+}
+
+inline std::string RPL_ENDOFEXCEPTLIST(const std::string &client, const std::string &channel)
+{
+    return "349 " + client + " " + channel + " :End of channel exception list";
+}
+
+inline std::string RPL_INVITELIST(const std::string &client, const std::string &channel,
+                                  const std::string &mask, const std::string &setBy,
+                                  const std::string &setAt)
+{
+    return "346 " + client + " " + channel + " " + mask + " " + setBy + " " + setAt;
+}
+
+inline std::string RPL_ENDOFINVITELIST(const std::string &client, const std::string &channel)
+{
+    return "347 " + client + " " + channel + " :End of channel invite exception list";
+}
+
 inline std::string RPL_INVITING(const std::string &client, const std::string &nickname,
                                 const std::string &channel)
 {
@@ -225,6 +382,28 @@ inline std::string RPL_ENDOFMOTD(const std::string &client)
     return "376 " + client + " :End of /MOTD command";
 }
 
+inline std::string RPL_STATSCOMMANDS(const std::string &client, const std::string &command,
+                                     uint64_t count)
+{
+    return "212 " + client + " " + command + " " + std::to_string(count) + " 0 0";
+}
+
+inline std::string RPL_ENDOFSTATS(const std::string &client, const std::string &query)
+{
+    return "219 " + client + " " + query + " :End of /STATS report";
+}
+
+inline std::string RPL_STATSDEBUG(const std::string &client, const std::string &query,
+                                  const std::string &line)
+{
+    return "249 " + client + " " + query + " :" + line;
+}
+
+inline std::string RPL_YOUREOPER(const std::string &client)
+{
+    return "381 " + client + " :You are now an IRC operator";
+}
+
 /* ERROR RESPONSES */
 inline std::string ERR_NOORIGIN(const std::string &client)
 {
@@ -236,6 +415,37 @@ inline std::string ERR_NOTEXTTOSEND(const std::string &client)
     return "412 " + client + " :No text to send";
 }
 
+inline std::string RPL_MONONLINE(const std::string &client, const std::string &targets)
+{
+    return "730 " + client + " :" + targets;
+}
+
+inline std::string RPL_MONOFFLINE(const std::string &client, const std::string &targets)
+{
+    return "731 " + client + " :" + targets;
+}
+
+inline std::string RPL_MONLIST(const std::string &client, const std::string &targets)
+{
+    return "732 " + client + " :" + targets;
+}
+
+inline std::string RPL_ENDOFMONLIST(const std::string &client)
+{
+    return "733 " + client + " :End of MONITOR list";
+}
+
+inline std::string ERR_MONLISTFULL(const std::string &client, const std::string &targets)
+{
+    return "734 " + client + " " + std::to_string(MONITOR_LIMIT) + " " + targets +
+           " :Monitor list is full";
+}
+
+inline std::string ERR_INVALIDCAPCMD(const std::string &client, const std::string &subcommand)
+{
+    return "410 " + client + " " + subcommand + " :Invalid CAP command";
+}
+
 inline std::string ERR_UNKNOWNCOMMAND(const std::string &client, const std::string &command)
 {
     return "421 " + client + " " + command + " :Unknown command";
@@ -288,7 +498,7 @@ inline std::string ERR_ALREADYREGISTERED(const std::string &client)
 
 inline std::string ERR_PASSWDMISMATCH(const std::string &client)
 {
-    return "464" + client + " :Password incorrect";
+    return "464 " + client + " :Password incorrect";
 }
 
 inline std::string ERR_INVALIDUSERNAME(const std::string &client, const std::string &username)
@@ -316,6 +526,22 @@ inline std::string ERR_INVITEONLYCHAN(const std::string &client, const std::stri
     return "473 " + client + " " + channel + " :Cannot join channel (+i) - invite only";
 }
 
+inline std::string ERR_BANNEDFROMCHAN(const std::string &client, const std::string &channel)
+{
+    return "474 " + client + " " + channel + " :Cannot join channel (+b) - you are banned";
+}
+
+inline std::string ERR_BANLISTFULL(const std::string &client, const std::string &channel,
+                                   char mode)
+{
+    return "478 " + client + " " + channel + " " + mode + " :Channel list is full";
+}
+
+inline std::string ERR_CANNOTSENDTOCHAN(const std::string &client, const std::string &channel)
+{
+    return "404 " + client + " " + channel + " :Cannot send to channel";
+}
+
 inline std::string ERR_INVALIDTEXT(const std::string &client, const std::string &text)
 {
     return "479 " + client + " " + text + " :Invalid  "; // selfmade
@@ -326,6 +552,16 @@ inline std::string ERR_CHANOPRIVSNEEDED(const std::string &client, const std::st
     return "482 " + client + " " + channel + " :You're not channel operator";
 }
 
+inline std::string ERR_NOPRIVILEGES(const std::string &client)
+{
+    return "481 " + client + " :Permission Denied- You're not an IRC operator";
+}
+
+inline std::string ERR_NOOPERHOST(const std::string &client)
+{
+    return "491 " + client + " :No O-lines for your host";
+}
+
 inline std::string ERR_INVALIDREALNAME(const std::string &client, const std::string &realname)
 {
     return "513 " + client + " " + realname + " :Invalid characters in realname";
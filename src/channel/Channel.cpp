@@ -1,8 +1,24 @@
 #include <Channel.hpp>
+#include <Log.hpp>
 #include <Client.hpp>
+#include <ClientIndex.hpp>
+#include <StateImage.hpp>
+#include <ChannelRegistry.hpp>
 #include <responses.hpp>
+#include <MessageVariants.hpp>
+#include <Metrics.hpp>
+#include <Probes.hpp>
+#include <algorithm>
 
-Channel::Channel(const std::string &name, Client &creator)
+// room left for the names once "353 <nick> = <channel> :" and \r\n are around them
+static const size_t NAMES_CHUNK_LIMIT = MSG_BUFFER_SIZE - (NICKLEN + CHANNELLEN + 16);
+
+// per member flags in a state image
+static const uint8_t MEMBER_OP = 1 << 0;
+static const uint8_t MEMBER_HIDDEN = 1 << 1;
+
+Channel::Channel(const std::string &name, Client &creator, const ChannelRecord *record,
+                 const std::string &key)
     : _channelName(name)
     , _topic("")
     , _topicAuthor("")
@@ -11,15 +27,140 @@ Channel::Channel(const std::string &name, Client &creator)
     , _key("")
     , _userLimit(0)
     , _createdTime(std::to_string(time(0)))
+    , _names(NAMES_CHUNK_LIMIT)
+    , _visibleNames(NAMES_CHUNK_LIMIT)
+    , _banListVersion(0)
 {
+    if (record != nullptr) {
+        restore(*record);
+        if (!isJoinable(creator, key))
+            return;
+    }
     _ops.insert_or_assign(creator.getNickname(), &creator);
     setMode(creator, true, ChannelMode::OP, creator.getNickname());
-    join(creator);
+    join(creator, key);
+}
+
+Channel::Channel(ImageReader &image, const ClientIndex &clients)
+    : _channelName(image.str())
+    , _topic(image.str())
+    , _topicAuthor(image.str())
+    , _topicTime(image.str())
+    , _modes(image.str())
+    , _key(image.str())
+    , _userLimit(image.u64())
+    , _createdTime(image.str())
+    , _names(NAMES_CHUNK_LIMIT)
+    , _visibleNames(NAMES_CHUNK_LIMIT)
+    , _banListVersion(0)
+{
+    for (uint32_t count = image.u32(); count > 0; --count) {
+        Client *client = clients.findByNick(image.str());
+        uint8_t flags = image.u8();
+        if (client == nullptr)
+            continue;
+        _connectedClients[client->getNickname()] = client;
+        if (flags & MEMBER_OP)
+            _ops[client->getNickname()] = client;
+        _names.add(client, prefixNick(*client));
+        if (flags & MEMBER_HIDDEN)
+            _hidden.insert(client);
+        else
+            _visibleNames.add(client, prefixNick(*client));
+        client->trackChannel(this);
+    }
+    for (uint32_t count = image.u32(); count > 0; --count) {
+        if (Client *client = clients.findByNick(image.str()))
+            _invites[client->getNickname()] = client;
+    }
+    _bans.load(image);
+    _exceptions.load(image);
+    _inviteExceptions.load(image);
+    for (uint32_t count = image.u32(); count > 0; --count) {
+        std::string line = image.str();
+        uint64_t id = image.u64();
+        int64_t timeMs = image.i64();
+        _history.add({std::make_shared<const std::string>(std::move(line)), id, timeMs});
+    }
+}
+
+void Channel::restore(const ChannelRecord &record)
+{
+    _channelName = record.name;
+    _topic = record.topic;
+    _topicAuthor = record.topicAuthor;
+    _topicTime = record.topicTime;
+    _modes = record.modes;
+    _key = record.key;
+    _userLimit = record.userLimit;
+    _createdTime = record.createdTime;
+    for (const ChannelRecord::Mask &mask : record.masks) {
+        getMaskList(mask.mode).add(mask.mask, mask.setBy, mask.setAt);
+    }
+}
+
+ChannelRecord Channel::getRecord() const
+{
+    ChannelRecord record;
+    record.name = _channelName;
+    record.topic = _topic;
+    record.topicAuthor = _topicAuthor;
+    record.topicTime = _topicTime;
+    record.modes = _modes;
+    record.key = _key;
+    record.userLimit = _userLimit;
+    record.createdTime = _createdTime;
+    const std::pair<char, const MaskList *> lists[] = {{ChannelMode::BAN, &_bans},
+                                                       {ChannelMode::EXCEPTION, &_exceptions},
+                                                       {ChannelMode::INVITE_EXCEPTION,
+                                                        &_inviteExceptions}};
+    for (const auto &[mode, list] : lists) {
+        for (const MaskList::Entry &entry : list->getEntries()) {
+            record.masks.push_back({mode, entry.mask.getMask(), entry.setBy, entry.setAt});
+        }
+    }
+    return record;
+}
+
+void Channel::setMetadataHook(std::function<void(Channel &)> onMetadataChange)
+{
+    _onMetadataChange = std::move(onMetadataChange);
+}
+
+void Channel::save(ImageWriter &image) const
+{
+    image.str(_channelName);
+    image.str(_topic);
+    image.str(_topicAuthor);
+    image.str(_topicTime);
+    image.str(_modes);
+    image.str(_key);
+    image.u64(_userLimit);
+    image.str(_createdTime);
+    image.u32(static_cast<uint32_t>(_connectedClients.size()));
+    for (const auto &[nick, client] : _connectedClients) {
+        image.str(nick);
+        image.u8((_ops.count(nick) ? MEMBER_OP : 0) | (_hidden.count(client) ? MEMBER_HIDDEN : 0));
+    }
+    image.u32(static_cast<uint32_t>(_invites.size()));
+    for (const auto &[nick, _] : _invites) {
+        image.str(nick);
+    }
+    _bans.save(image);
+    _exceptions.save(image);
+    _inviteExceptions.save(image);
+    std::vector<MessageHistory::Entry> history = _history.latest(nullptr, _history.size());
+    image.u32(static_cast<uint32_t>(history.size()));
+    for (const MessageHistory::Entry &entry : history) {
+        image.str(*entry.line);
+        image.u64(entry.id);
+        image.i64(entry.timeMs);
+    }
 }
 
 Channel::~Channel()
 {
-    std::cout << "Channel " << _channelName << " destroyed." << std::endl;
+    Log::out() << "Channel " << _channelName << " destroyed." << std::endl;
 }
 
 void Channel::join(Client &client, const std::string &key)
@@ -28,12 +169,24 @@ void Channel::join(Client &client, const std::string &key)
         return;
     std::string joinMessage = JOIN(client.getUserHost(), _channelName);
 
+    size_t oldCount = _connectedClients.size();
     _connectedClients.insert_or_assign(client.getNickname(), &client);
+    if (_onMemberCountChange)
+        _onMemberCountChange(*this, oldCount);
+    _names.add(&client, prefixNick(client));
     client.trackChannel(this);
     removeFromInvites(client);
 
     // required server reply on join success
-    broadcastMessage(joinMessage);
+    if (hasMode(ChannelMode::DELAYED_JOIN)) {
+        // the others only hear about the join once the client speaks or is opped
+        _hidden.insert(&client);
+        sendToClient(client.getFd(), joinMessage);
+    }
+    else {
+        _visibleNames.add(&client, prefixNick(client));
+        broadcastMessage(joinMessage);
+    }
     sendTopic(client);
     sendNameReply(client);
 }
@@ -46,10 +199,11 @@ void Channel::part(Client &client, const std::string &reason)
     }
     std::string partMessage = PART(client.getUserHost(), _channelName, reason);
 
-    std::string nick = client.getNickname();
-    broadcastMessage(partMessage);
-    _connectedClients.erase(nick);
-    removeOp(nick);
+    if (isHidden(client))
+        sendToClient(client.getFd(), partMessage);
+    else
+        broadcastMessage(partMessage);
+    removeMember(client);
     client.untrackChannel(this);
 }
 
@@ -58,11 +212,34 @@ void Channel::quit(Client &client, const std::string &reason)
     if (!isOnChannel(client))
         return;
     std::string quitMessage = QUIT(client.getUserHost(), reason);
+    bool hidden = isHidden(client);
+
+    removeMember(client);
+    if (!hidden)
+        broadcastToOthers(client, quitMessage);
+}
 
+// drops the membership without telling anyone, callers handle the notification
+void Channel::removeMember(Client &client)
+{
     std::string nick = client.getNickname();
-    _connectedClients.erase(nick);
+    if (_connectedClients.erase(nick) && _onMemberCountChange)
+        _onMemberCountChange(*this, _connectedClients.size() + 1);
+    _names.remove(&client);
+    _visibleNames.remove(&client);
+    _hidden.erase(&client);
+    _banStatus.erase(&client);
     removeOp(nick);
-    broadcastToOthers(client, quitMessage);
+}
+
+bool Channel::isHidden(Client &client) const
+{
+    return _hidden.find(&client) != _hidden.end();
+}
+
+const std::unordered_map<std::string, Client *> &Channel::getMembers() const
+{
+    return _connectedClients;
 }
 
 void Channel::invite(Client &inviter, Client &target)
@@ -108,9 +285,13 @@ void Channel::kick(Client &kicker, Client &target, std::string const &reason)
         return;
     }
     std::string kickMessage = KICK(kicker.getUserHost(), targetName, _channelName, reason);
-    broadcastMessage(kickMessage);
-    _connectedClients.erase(targetName);
-    removeOp(targetName);
+    if (isHidden(target)) {
+        sendToClient(kickerFd, kickMessage);
+        sendToClient(target.getFd(), kickMessage);
+    }
+    else
+        broadcastMessage(kickMessage);
+    removeMember(target);
     target.untrackChannel(this);
 }
 
@@ -124,9 +305,16 @@ void Channel::changeTopic(Client &client, std::string &newTopic)
         sendToClient(client.getFd(), ERR_CHANOPRIVSNEEDED(client.getNickname(), _channelName));
         return;
     }
+    std::string oldTopic = _topic;
     _topic = newTopic;
+    if (_onTopicChange)
+        _onTopicChange(*this, oldTopic);
     _topicAuthor = client.getNickname();
     _topicTime = std::to_string(time(0));
+    if (_onMetadataChange)
+        _onMetadataChange(*this);
+    // a hidden +D member is shown joining before the members see it set the topic
+    reveal(client);
     broadcastMessage(TOPIC(client.getUserHost(), _channelName, _topic));
 }
 
@@ -144,6 +332,46 @@ const std::string &Channel::getName() const
     return _channelName;
 }
 
+time_t Channel::getCreatedAt() const
+{
+    return std::stoll(_createdTime);
+}
+
+time_t Channel::getTopicSetAt() const
+{
+    return _topicTime.empty() ? 0 : std::stoll(_topicTime);
+}
+
+void Channel::setIndexHooks(std::function<void(Channel &, size_t)> onMemberCountChange,
+                            std::function<void(Channel &, const std::string &)> onTopicChange)
+{
+    _onMemberCountChange = std::move(onMemberCountChange);
+    _onTopicChange = std::move(onTopicChange);
+}
+
+const std::string &Channel::getTopic() const
+{
+    return _topic;
+}
+
+size_t Channel::getMemberCount() const
+{
+    return _connectedClients.size();
+}
+
+// on +D non-ops only get to see the members that already showed up
+const NameReplyCache &Channel::getNames(Client &requester)
+{
+    if (hasMode(ChannelMode::DELAYED_JOIN) && !hasOp(requester))
+        return _visibleNames;
+    return _names;
+}
+
+bool Channel::missesOwnName(Client &requester)
+{
+    return hasMode(ChannelMode::DELAYED_JOIN) && !hasOp(requester) && isHidden(requester);
+}
+
 const std::string &Channel::getCreatedTime()
 {
     return _createdTime;
@@ -161,63 +389,198 @@ bool Channel::hasMode(const char mode) const
 
 void Channel::setMode(Client &client, bool enable, ChannelMode mode, std::string param)
 {
+    applyModes(client, {{enable, static_cast<char>(mode), param}});
+}
+
+void Channel::setMode(Client &client, bool enable, const char mode, std::string param)
+{
+    ChannelMode channelMode = static_cast<ChannelMode>(mode);
+    setMode(client, enable, channelMode, param);
+}
+
+// applies every change of one MODE command, then tells the channel in as few lines as possible
+void Channel::applyModes(Client &client, const std::vector<ModeChange> &changes)
+{
+    if (changes.empty())
+        return;
     if (!hasOp(client)) {
         sendToClient(client.getFd(), ERR_CHANOPRIVSNEEDED(client.getNickname(), _channelName));
         return;
     }
-    // For basic modes (i, t), keep the check
-    if (mode == ChannelMode::INVITE_ONLY || mode == ChannelMode::PROTECTED_TOPIC) {
-        if (hasMode(mode) == enable)
-            return;
+    std::vector<ModeChange> applied;
+    bool metadataChanged = false;
+    for (ModeChange change : changes) {
+        if (applyMode(client, change)) {
+            applied.push_back(change);
+            // ops belong to the members present, not to the channel's record
+            metadataChanged = metadataChanged || change.mode != ChannelMode::OP;
+        }
     }
-    // For parametrized modes with same values, skip
-    if (mode == ChannelMode::KEY && enable && hasMode(mode) && this->_key == param)
-        return;
-    if (mode == ChannelMode::LIMIT && enable && hasMode(mode) &&
-        this->_userLimit == std::stoul(param))
-        return;
-
-    std::string operation = enable ? "+" : "-";
-    std::string modeStr = operation + static_cast<char>(mode);
-    std::string modeMsg = MODE(client.getUserHost(), _channelName, modeStr, param);
-
-    if (enable) {
-        enableMode(mode);
-        // Handle mode-specific parameters
-        switch (mode) {
-        case ChannelMode::KEY:
-            this->_key = param;
-            break;
-        case ChannelMode::LIMIT:
-            if (!param.empty())
-                this->_userLimit = std::stoi(param);
-            break;
-        case ChannelMode::OP:
-            addOp(param, modeMsg);
-            return;
-        case ChannelMode::INVITE_ONLY:
+    if (metadataChanged && _onMetadataChange)
+        _onMetadataChange(*this);
+    broadcastModeChanges(client, applied);
+}
+
+// returns false when the change would not alter the channel, so it is not broadcast
+bool Channel::applyMode(Client &client, ModeChange &change)
+{
+    ChannelMode mode = static_cast<ChannelMode>(change.mode);
+
+    switch (mode) {
+    case ChannelMode::BAN:
+    case ChannelMode::EXCEPTION:
+    case ChannelMode::INVITE_EXCEPTION:
+        return applyListMode(client, change);
+    case ChannelMode::INVITE_ONLY:
+    case ChannelMode::PROTECTED_TOPIC:
+    case ChannelMode::DELAYED_JOIN:
+        change.param.clear();
+        if (hasMode(mode) == change.enable)
+            return false;
+        if (change.enable && mode == ChannelMode::INVITE_ONLY)
             _invites.clear();
-        default:
+        if (!change.enable && mode == ChannelMode::DELAYED_JOIN)
+            revealAll();
+        break;
+    case ChannelMode::KEY:
+        if (!change.enable) {
+            change.param.clear();
+            if (!hasMode(mode))
+                return false;
+            _key.clear();
             break;
         }
+        if (hasMode(mode) && _key == change.param)
+            return false;
+        _key = change.param;
+        break;
+    case ChannelMode::LIMIT:
+        if (!change.enable) {
+            change.param.clear();
+            if (!hasMode(mode))
+                return false;
+            _userLimit = 0;
+            break;
+        }
+        if (hasMode(mode) && _userLimit == std::stoul(change.param))
+            return false;
+        _userLimit = std::stoul(change.param);
+        break;
+    case ChannelMode::OP:
+        return change.enable ? addOp(change.param) : removeOp(change.param);
+    default:
+        return false;
     }
-    else {
+    if (change.enable)
+        enableMode(mode);
+    else
         disableMode(mode);
-        switch (mode) {
-        case ChannelMode::OP:
-            removeOp(param, modeMsg);
-            return;
-        default:
-            break;
+    return true;
+}
+
+// folds the applied changes into MODE lines of at most MODES flags each
+void Channel::broadcastModeChanges(Client &client, const std::vector<ModeChange> &changes)
+{
+    for (size_t start = 0; start < changes.size(); start += MODES) {
+        std::string modeStr;
+        std::string args;
+        char sign = 0;
+        size_t end = std::min(changes.size(), start + MODES);
+
+        for (size_t i = start; i < end; i++) {
+            char nextSign = changes[i].enable ? '+' : '-';
+            if (nextSign != sign) {
+                modeStr.push_back(nextSign);
+                sign = nextSign;
+            }
+            modeStr.push_back(changes[i].mode);
+            if (changes[i].param.empty())
+                continue;
+            if (!args.empty())
+                args.push_back(' ');
+            args.append(changes[i].param);
         }
+        broadcastMessage(MODE(client.getUserHost(), _channelName, modeStr, args));
     }
-    broadcastMessage(modeMsg);
 }
 
-void Channel::setMode(Client &client, bool enable, const char mode, std::string param)
+MaskList &Channel::getMaskList(char mode)
 {
-    ChannelMode channelMode = static_cast<ChannelMode>(mode);
-    setMode(client, enable, channelMode, param);
+    if (mode == ChannelMode::BAN)
+        return _bans;
+    if (mode == ChannelMode::EXCEPTION)
+        return _exceptions;
+    return _inviteExceptions;
+}
+
+// list modes are not flags in _modes, the masks themselves are the state
+bool Channel::applyListMode(Client &client, ModeChange &change)
+{
+    MaskList &list = getMaskList(change.mode);
+    change.param = CompiledMask::normalize(change.param);
+    if (change.enable) {
+        if (_bans.size() + _exceptions.size() + _inviteExceptions.size() >= MAX_LIST_ENTRIES) {
+            sendToClient(client.getFd(),
+                         ERR_BANLISTFULL(client.getNickname(), _channelName, change.mode));
+            return false;
+        }
+        if (!list.add(change.param, client.getUserHost()))
+            return false;
+    }
+    else if (!list.remove(change.param)) {
+        return false;
+    }
+    if (change.mode != ChannelMode::INVITE_EXCEPTION)
+        _banListVersion++;
+    return true;
+}
+
+void Channel::sendMaskList(Client &client, char mode)
+{
+    const std::string &nick = client.getNickname();
+    for (const MaskList::Entry &entry : getMaskList(mode).getEntries()) {
+        const std::string &mask = entry.mask.getMask();
+        std::string setAt = std::to_string(entry.setAt);
+        if (mode == ChannelMode::BAN)
+            sendToClient(client.getFd(), RPL_BANLIST(nick, _channelName, mask, entry.setBy, setAt));
+        else if (mode == ChannelMode::EXCEPTION)
+            sendToClient(client.getFd(),
+                         RPL_EXCEPTLIST(nick, _channelName, mask, entry.setBy, setAt));
+        else
+            sendToClient(client.getFd(),
+                         RPL_INVITELIST(nick, _channelName, mask, entry.setBy, setAt));
+    }
+    if (mode == ChannelMode::BAN)
+        sendToClient(client.getFd(), RPL_ENDOFBANLIST(nick, _channelName));
+    else if (mode == ChannelMode::EXCEPTION)
+        sendToClient(client.getFd(), RPL_ENDOFEXCEPTLIST(nick, _channelName));
+    else
+        sendToClient(client.getFd(), RPL_ENDOFINVITELIST(nick, _channelName));
+}
+
+bool Channel::computeBanned(const std::string &subject) const
+{
+    return _bans.matches(subject) && !_exceptions.matches(subject);
+}
+
+// members are checked on every message, so their result is kept until the lists change
+bool Channel::isBanned(Client &client)
+{
+    if (_bans.size() == 0)
+        return false;
+    if (!isOnChannel(client))
+        return computeBanned(CompiledMask::casemap(client.getUserHost()));
+    auto it = _banStatus.find(&client);
+    if (it != _banStatus.end() && it->second.first == _banListVersion)
+        return it->second.second;
+    bool banned = computeBanned(CompiledMask::casemap(client.getUserHost()));
+    _banStatus[&client] = {_banListVersion, banned};
+    return banned;
+}
+
+bool Channel::canSend(Client &client)
+{
+    return hasOp(client) || !isBanned(client);
 }
 
 void Channel::printModes(Client &client)
@@ -245,20 +608,53 @@ void Channel::broadcastMessage(const std::string &message)
 {
     if (message.empty())
         return;
+    MessageVariants variants(message);
     for (auto &[_, client] : _connectedClients) {
-        sendToClient(client->getFd(), message);
+        sendShared(client->getFd(), variants.forClient(*client));
     }
+    metrics().fanout.record(_connectedClients.size());
+    PROBE3(broadcast, _channelName.c_str(), _connectedClients.size(), message.size());
 }
 
 void Channel::broadcastToOthers(Client &client, const std::string &message)
 {
     if (message.empty())
         return;
+    MessageVariants variants(message);
+    uint64_t recipients = 0;
     for (auto &[_, connected] : _connectedClients) {
         if (connected == &client)
             continue;
-        sendToClient(connected->getFd(), message);
+        sendShared(connected->getFd(), variants.forClient(*connected));
+        recipients++;
+    }
+    metrics().fanout.record(recipients);
+    PROBE3(broadcast, _channelName.c_str(), recipients, message.size());
+}
+
+// channel chatter, a hidden +D member becomes visible when it first speaks
+void Channel::relayMessage(Client &sender, const std::string &message)
+{
+    reveal(sender);
+    // serialised once per wire form, the untagged form is also what the history keeps
+    MessageHistory::Entry entry =
+        _history.stamp(std::make_shared<const std::string>(message + "\r\n"));
+    MessageVariants variants(entry);
+    uint64_t recipients = 0;
+    for (auto &[_, member] : _connectedClients) {
+        if (member != &sender || sender.hasCap(CAP_ECHO_MESSAGE)) {
+            sendShared(member->getFd(), variants.forClient(*member));
+            recipients++;
+        }
     }
+    metrics().fanout.record(recipients);
+    PROBE3(broadcast, _channelName.c_str(), recipients, message.size());
+    _history.add(entry);
+}
+
+const MessageHistory &Channel::getHistory() const
+{
+    return _history;
 }
 
 void Channel::enableMode(ChannelMode mode)
@@ -287,28 +683,36 @@ std::string Channel::prefixNick(Client &client)
     return nick;
 }
 
+// the chunks are kept serialised, only the requesting nick is filled in
 void Channel::sendNameReply(Client &client)
 {
-    std::string nameReply;
-    std::string nextNick;
-
-    for (auto &[_, memberClient] : _connectedClients) {
-        nextNick = prefixNick(*memberClient);
-        // + 3 to account for <space>\r\n
-        if (nameReply.size() + nextNick.size() + 3 > MSG_BUFFER_SIZE) {
-            sendToClient(client.getFd(), nameReply);
-            nameReply.erase();
-        }
-        if (nameReply.empty()) {
-            nameReply = RPL_NAMREPLY(client.getNickname(), _channelName, nextNick);
+    for (const std::string &chunk : getNames(client).getChunks()) {
+        if (chunk.empty())
             continue;
-        }
-        nameReply.append(" " + nextNick);
+        sendToClient(client.getFd(), RPL_NAMREPLY(client.getNickname(), _channelName, chunk));
     }
-    sendToClient(client.getFd(), nameReply);
+    if (missesOwnName(client))
+        sendToClient(client.getFd(),
+                     RPL_NAMREPLY(client.getNickname(), _channelName, client.getNickname()));
     sendToClient(client.getFd(), RPL_ENDOFNAMES(client.getNickname(), _channelName));
 }
 
+// shows a delayed JOIN to the rest of the channel
+void Channel::reveal(Client &client)
+{
+    if (_hidden.erase(&client) == 0)
+        return;
+    _visibleNames.add(&client, prefixNick(client));
+    broadcastToOthers(client, JOIN(client.getUserHost(), _channelName));
+}
+
+void Channel::revealAll()
+{
+    std::vector<Client *> hidden(_hidden.begin(), _hidden.end());
+    for (Client *client : hidden)
+        reveal(*client);
+}
+
 void Channel::sendTopic(Client &client)
 {
     int fd = client.getFd();
@@ -336,8 +740,10 @@ void Channel::eraseNickHistory(const std::string &nick)
 void Channel::updateNick(Client &client, const std::string &newNick)
 {
     std::string oldNick = client.getNickname();
+    bool isOp = hasOp(client);
+    _banStatus.erase(&client);
 
-    if (hasOp(client)) {
+    if (isOp) {
         auto opNode = _ops.extract(oldNick);
         if (!opNode.empty()) {
             opNode.key() = newNick;
@@ -348,6 +754,8 @@ void Channel::updateNick(Client &client, const std::string &newNick)
     if (!clientNode.empty()) {
         clientNode.key() = newNick;
         _connectedClients.insert(std::move(clientNode));
+        _names.update(&client, isOp ? "@" + newNick : newNick);
+        _visibleNames.update(&client, isOp ? "@" + newNick : newNick);
     }
 }
 
@@ -360,10 +768,15 @@ bool Channel::isJoinable(Client &client, std::string key)
 {
     int fd = client.getFd();
 
-    if (hasMode(ChannelMode::INVITE_ONLY) && !isInvited(client)) {
+    if (hasMode(ChannelMode::INVITE_ONLY) && !isInvited(client) &&
+        !_inviteExceptions.matches(CompiledMask::casemap(client.getUserHost()))) {
         sendToClient(fd, ERR_INVITEONLYCHAN(client.getNickname(), _channelName));
         return false;
     }
+    if (!isInvited(client) && isBanned(client)) {
+        sendToClient(fd, ERR_BANNEDFROMCHAN(client.getNickname(), _channelName));
+        return false;
+    }
     if (hasMode(ChannelMode::KEY) && key != _key) {
         sendToClient(fd, ERR_BADCHANNELKEY(client.getNickname(), _channelName));
         return false;
@@ -389,19 +802,26 @@ void Channel::removeFromInvites(Client &client)
         _invites.erase(client.getNickname());
 }
 
-void Channel::addOp(std::string &nick, const std::string &modeMsg)
+bool Channel::addOp(const std::string &nick)
 {
     auto it = _connectedClients.find(nick);
-    if (it != _connectedClients.end() && !hasOp(*it->second)) {
-        _ops.insert_or_assign(nick, it->second);
-        broadcastMessage(modeMsg);
-    }
+    if (it == _connectedClients.end() || hasOp(*it->second))
+        return false;
+    _ops.insert_or_assign(nick, it->second);
+    reveal(*it->second);
+    _names.update(it->second, "@" + nick);
+    _visibleNames.update(it->second, "@" + nick);
+    return true;
 }
 
-void Channel::removeOp(const std::string &nick, const std::string &modeMsg)
+bool Channel::removeOp(const std::string &nick)
 {
-    if (_ops.find(nick) != _ops.end()) {
-        _ops.erase(nick);
-        broadcastMessage(modeMsg);
+    if (_ops.erase(nick) == 0)
+        return false;
+    auto it = _connectedClients.find(nick);
+    if (it != _connectedClients.end()) {
+        _names.update(it->second, nick);
+        _visibleNames.update(it->second, nick);
     }
+    return true;
 }
@@ -0,0 +1,265 @@
+#include <ChannelRegistry.hpp>
+#include <Log.hpp>
+#include <StateImage.hpp>
+#include <MappedFile.hpp>
+#include <Descriptors.hpp>
+#include <Error.hpp>
+#include <common.hpp>
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+static const std::string SNAPSHOT_MAGIC = "ft_irc-channels-1";
+
+enum RecordType
+{
+    RECORD_PUT = 1,
+    RECORD_ERASE = 2
+};
+
+bool ChannelRecord::isDefault() const
+{
+    return topic.empty() && modes.empty() && masks.empty();
+}
+
+void ChannelRecord::save(ImageWriter &image) const
+{
+    image.str(name);
+    image.str(topic);
+    image.str(topicAuthor);
+    image.str(topicTime);
+    image.str(modes);
+    image.str(key);
+    image.u64(userLimit);
+    image.str(createdTime);
+    image.u32(static_cast<uint32_t>(masks.size()));
+    for (const Mask &mask : masks) {
+        image.u8(mask.mode);
+        image.str(mask.mask);
+        image.str(mask.setBy);
+        image.i64(mask.setAt);
+    }
+}
+
+void ChannelRecord::load(ImageReader &image)
+{
+    name = image.str();
+    topic = image.str();
+    topicAuthor = image.str();
+    topicTime = image.str();
+    modes = image.str();
+    key = image.str();
+    userLimit = image.u64();
+    createdTime = image.str();
+    masks.clear();
+    for (uint32_t count = image.u32(); count > 0; --count) {
+        Mask mask;
+        mask.mode = static_cast<char>(image.u8());
+        mask.mask = image.str();
+        mask.setBy = image.str();
+        mask.setAt = static_cast<time_t>(image.i64());
+        masks.push_back(mask);
+    }
+}
+
+ChannelRegistry::ChannelRegistry(const std::string &directory)
+    : _directory(directory)
+    , _wal(directory, "channels.wal")
+    , _snapshotPid(-1)
+    , _snapshotGeneration(0)
+    , _changesSinceSnapshot(0)
+    , _lastSnapshot(Clock::now())
+{
+    if (mkdir(_directory.c_str(), 0755) < 0 && errno != EEXIST)
+        throw ServerError("Cannot create " + _directory + ": " + strerror(errno));
+    uint64_t generation = loadSnapshot();
+    _wal.open(generation, [this](ImageReader &record) { replay(record); });
+    Log::out() << "Channel registry: " << _records.size() << " channels from " << _directory
+               << std::endl;
+}
+
+ChannelRegistry::~ChannelRegistry()
+{
+    sync();
+}
+
+std::string ChannelRegistry::snapshotPath() const
+{
+    return _directory + "/channels.snapshot";
+}
+
+// the snapshot covers every WAL segment before the generation it names
+uint64_t ChannelRegistry::loadSnapshot()
+{
+    MappedFile file(snapshotPath());
+    if (file.size() == 0)
+        return 0;
+    ImageReader image(file.data(), file.size());
+    if (image.str() != SNAPSHOT_MAGIC)
+        throw ServerError(snapshotPath() + " is not a channel snapshot");
+    uint64_t generation = image.u64();
+    for (uint32_t count = image.u32(); count > 0; --count) {
+        std::string key = image.str();
+        _records[key].load(image);
+    }
+    return generation;
+}
+
+void ChannelRegistry::replay(ImageReader &record)
+{
+    uint8_t type = record.u8();
+    std::string key = record.str();
+    if (type == RECORD_PUT)
+        _records[key].load(record);
+    else if (type == RECORD_ERASE)
+        _records.erase(key);
+    _changesSinceSnapshot++;
+}
+
+const ChannelRecord *ChannelRegistry::find(const std::string &key) const
+{
+    auto it = _records.find(key);
+    return it == _records.end() ? nullptr : &it->second;
+}
+
+void ChannelRegistry::put(const std::string &key, const ChannelRecord &record)
+{
+    ImageWriter entry;
+    entry.u8(RECORD_PUT);
+    entry.str(key);
+    record.save(entry);
+    _wal.append(entry.data());
+    _records[key] = record;
+    _changesSinceSnapshot++;
+}
+
+void ChannelRegistry::erase(const std::string &key)
+{
+    if (_records.erase(key) == 0)
+        return;
+    ImageWriter entry;
+    entry.u8(RECORD_ERASE);
+    entry.str(key);
+    _wal.append(entry.data());
+    _changesSinceSnapshot++;
+}
+
+size_t ChannelRegistry::size() const
+{
+    return _records.size();
+}
+
+void ChannelRegistry::maintain()
+{
+    if (_snapshotPid > 0) {
+        int status;
+        if (waitpid(_snapshotPid, &status, WNOHANG) == _snapshotPid)
+            finishSnapshot(status);
+        return;
+    }
+    if (_changesSinceSnapshot == 0)
+        return;
+    if (_changesSinceSnapshot >= SNAPSHOT_CHANGES ||
+        Clock::now() - _lastSnapshot >=
+            std::chrono::seconds(SNAPSHOT_INTERVAL_SEC))
+        snapshot();
+}
+
+// changes made after the rotation go to a fresh segment, the image holds exactly what came
+// before. The child only writes it out: the WAL writer or ban reload thread may hold the heap
+// lock at the fork, so nothing after it allocates
+bool ChannelRegistry::snapshot()
+{
+    if (_snapshotPid > 0)
+        return false;
+    uint64_t generation = _wal.rotate();
+    ImageWriter image;
+    serialise(image, generation);
+    std::string path = snapshotPath();
+    std::string temporary = path + ".tmp";
+    pid_t pid = fork();
+    if (pid < 0) {
+        std::cerr << "Snapshot fork failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+    if (pid == 0) {
+        closeDescriptorsFrom(STDERR_FILENO + 1);
+        _exit(writeSnapshot(image.data(), temporary.c_str(), path.c_str(), _directory.c_str())
+                  ? 0
+                  : 1);
+    }
+    _snapshotPid = pid;
+    _snapshotGeneration = generation;
+    _changesSinceSnapshot = 0;
+    _lastSnapshot = Clock::now();
+    return true;
+}
+
+void ChannelRegistry::finishSnapshot(int status)
+{
+    _snapshotPid = -1;
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+        _wal.discardBefore(_snapshotGeneration);
+        return;
+    }
+    // the segments stay, the next snapshot covers them too
+    std::cerr << "Channel snapshot failed" << std::endl;
+}
+
+void ChannelRegistry::serialise(ImageWriter &image, uint64_t generation) const
+{
+    image.str(SNAPSHOT_MAGIC);
+    image.u64(generation);
+    image.u32(static_cast<uint32_t>(_records.size()));
+    for (const auto &[key, record] : _records) {
+        image.str(key);
+        record.save(image);
+    }
+}
+
+// runs in the forked child, async-signal-safe calls only. Written beside the old snapshot and
+// renamed over it
+bool ChannelRegistry::writeSnapshot(const std::string &data, const char *temporary,
+                                    const char *path, const char *directory)
+{
+    int fd = open(temporary, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return false;
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t result = write(fd, data.data() + written, data.size() - written);
+        if (result < 0 && errno == EINTR)
+            continue;
+        if (result < 0) {
+            close(fd);
+            return false;
+        }
+        written += result;
+    }
+    bool durable = fsync(fd) == 0;
+    close(fd);
+    if (!durable || rename(temporary, path) < 0)
+        return false;
+    int directoryFd = open(directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (directoryFd >= 0) {
+        fsync(directoryFd);
+        close(directoryFd);
+    }
+    return true;
+}
+
+void ChannelRegistry::sync()
+{
+    _wal.sync();
+    if (_snapshotPid > 0) {
+        int status;
+        if (waitpid(_snapshotPid, &status, 0) == _snapshotPid)
+            finishSnapshot(status);
+        else
+            _snapshotPid = -1;
+    }
+}
@@ -0,0 +1,238 @@
+#include <MessageHistory.hpp>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+
+// bytes held by every channel's history together
+static size_t g_historyBytes = 0;
+
+// ids are unique across restarts as long as fewer than 2^20 messages are sent per second
+uint64_t MessageHistory::newMessageId()
+{
+    static uint64_t next =
+        static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(
+                                  std::chrono::system_clock::now().time_since_epoch())
+                                  .count())
+        << 20;
+    return next++;
+}
+
+int64_t MessageHistory::nowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+static bool entryBefore(const MessageHistory::Entry &entry, const MessageHistory::Ref &ref)
+{
+    return ref.isId ? entry.id < ref.id : entry.timeMs < ref.timeMs;
+}
+
+static bool entryAfter(const MessageHistory::Entry &entry, const MessageHistory::Ref &ref)
+{
+    return ref.isId ? entry.id > ref.id : entry.timeMs > ref.timeMs;
+}
+
+MessageHistory::MessageHistory(size_t maxLines, size_t maxBytes)
+    : _ring(maxLines)
+    , _head(0)
+    , _count(0)
+    , _maxBytes(maxBytes)
+    , _bytes(0)
+{}
+
+MessageHistory::~MessageHistory()
+{
+    g_historyBytes -= _bytes;
+}
+
+MessageHistory::Entry MessageHistory::stamp(const std::shared_ptr<const std::string> &line) const
+{
+    int64_t timeMs = nowMs();
+    if (_count > 0 && timeMs < at(_count - 1).timeMs)
+        timeMs = at(_count - 1).timeMs;
+    return {line, newMessageId(), timeMs};
+}
+
+bool MessageHistory::add(const std::shared_ptr<const std::string> &line)
+{
+    return add(stamp(line));
+}
+
+bool MessageHistory::add(const Entry &entry)
+{
+    size_t length = entry.line->size();
+    if (_ring.empty() || length > _maxBytes || length > HISTORY_TOTAL_BYTES)
+        return false;
+    while (_count > 0 && (_count == _ring.size() || _bytes + length > _maxBytes ||
+                          g_historyBytes + length > HISTORY_TOTAL_BYTES))
+        dropOldest();
+    // other channels hold the whole shared budget
+    if (g_historyBytes + length > HISTORY_TOTAL_BYTES)
+        return false;
+
+    _ring[(_head + _count) % _ring.size()] = entry;
+    _count++;
+    _bytes += length;
+    g_historyBytes += length;
+    return true;
+}
+
+const MessageHistory::Entry &MessageHistory::at(size_t index) const
+{
+    return _ring[(_head + index) % _ring.size()];
+}
+
+void MessageHistory::dropOldest()
+{
+    Entry &oldest = _ring[_head];
+    _bytes -= oldest.line->size();
+    g_historyBytes -= oldest.line->size();
+    oldest.line.reset();
+    _head = (_head + 1) % _ring.size();
+    _count--;
+}
+
+// first entry not before ref
+size_t MessageHistory::lowerBound(const Ref &ref) const
+{
+    size_t low = 0;
+    size_t high = _count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (entryBefore(at(mid), ref))
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+// first entry after ref
+size_t MessageHistory::upperBound(const Ref &ref) const
+{
+    size_t low = 0;
+    size_t high = _count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (entryAfter(at(mid), ref))
+            high = mid;
+        else
+            low = mid + 1;
+    }
+    return low;
+}
+
+std::vector<MessageHistory::Entry> MessageHistory::range(size_t begin, size_t end) const
+{
+    std::vector<Entry> entries;
+    if (begin < end)
+        entries.reserve(end - begin);
+    for (size_t i = begin; i < end; i++) {
+        entries.push_back(at(i));
+    }
+    return entries;
+}
+
+std::vector<MessageHistory::Entry> MessageHistory::latest(const Ref *after, size_t limit) const
+{
+    size_t begin = after ? upperBound(*after) : 0;
+    if (_count - begin > limit)
+        begin = _count - limit;
+    return range(begin, _count);
+}
+
+std::vector<MessageHistory::Entry> MessageHistory::before(const Ref &ref, size_t limit) const
+{
+    size_t end = lowerBound(ref);
+    return range(end > limit ? end - limit : 0, end);
+}
+
+std::vector<MessageHistory::Entry> MessageHistory::after(const Ref &ref, size_t limit) const
+{
+    size_t begin = upperBound(ref);
+    return range(begin, std::min(_count, begin + limit));
+}
+
+std::vector<MessageHistory::Entry> MessageHistory::around(const Ref &ref, size_t limit) const
+{
+    size_t center = lowerBound(ref);
+    size_t begin = center > limit / 2 ? center - limit / 2 : 0;
+    return range(begin, std::min(_count, begin + limit));
+}
+
+// from may be the later reference, then the entries closest to it are the ones kept
+std::vector<MessageHistory::Entry> MessageHistory::between(const Ref &from, const Ref &to,
+                                                           size_t limit) const
+{
+    if (lowerBound(from) <= lowerBound(to)) {
+        size_t begin = upperBound(from);
+        size_t end = lowerBound(to);
+        return range(begin, begin < end ? std::min(end, begin + limit) : begin);
+    }
+    size_t begin = upperBound(to);
+    size_t end = lowerBound(from);
+    if (begin < end && end - begin > limit)
+        begin = end - limit;
+    return range(begin, end);
+}
+
+size_t MessageHistory::size() const
+{
+    return _count;
+}
+
+size_t MessageHistory::getBytes() const
+{
+    return _bytes;
+}
+
+size_t MessageHistory::getTotalBytes()
+{
+    return g_historyBytes;
+}
+
+std::string MessageHistory::formatMsgId(uint64_t id)
+{
+    char buffer[17];
+    snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(id));
+    return buffer;
+}
+
+std::string MessageHistory::formatTime(int64_t timeMs)
+{
+    time_t seconds = timeMs / 1000;
+    struct tm utc;
+    gmtime_r(&seconds, &utc);
+    char buffer[32];
+    size_t length = strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &utc);
+    snprintf(buffer + length, sizeof(buffer) - length, ".%03dZ", static_cast<int>(timeMs % 1000));
+    return buffer;
+}
+
+bool MessageHistory::parseRef(const std::string &text, Ref &ref)
+{
+    if (text.compare(0, 6, "msgid=") == 0) {
+        std::string id = text.substr(6);
+        if (id.empty() || id.size() > 16 ||
+            id.find_first_not_of("0123456789abcdef") != std::string::npos)
+            return false;
+        ref = {true, std::stoull(id, nullptr, 16), 0};
+        return true;
+    }
+    if (text.compare(0, 10, "timestamp=") != 0)
+        return false;
+    struct tm utc = {};
+    int millis = 0;
+    int consumed = 0;
+    if (sscanf(text.c_str() + 10, "%4d-%2d-%2dT%2d:%2d:%2d.%3dZ%n", &utc.tm_year, &utc.tm_mon,
+               &utc.tm_mday, &utc.tm_hour, &utc.tm_min, &utc.tm_sec, &millis, &consumed) != 7 ||
+        text.size() != static_cast<size_t>(10 + consumed))
+        return false;
+    utc.tm_year -= 1900;
+    utc.tm_mon -= 1;
+    ref = {false, 0, static_cast<int64_t>(timegm(&utc)) * 1000 + millis};
+    return true;
+}
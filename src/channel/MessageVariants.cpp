@@ -0,0 +1,40 @@
+#include <MessageVariants.hpp>
+#include <Capabilities.hpp>
+#include <Client.hpp>
+
+// index bits into _variants
+static const unsigned TIME_TAG = 1;
+static const unsigned MSGID_TAG = 2;
+
+MessageVariants::MessageVariants(const std::string &message)
+    : _time(MessageHistory::formatTime(MessageHistory::nowMs()))
+{
+    _variants[0] = std::make_shared<const std::string>(message + "\r\n");
+}
+
+MessageVariants::MessageVariants(const MessageHistory::Entry &entry)
+    : _time(MessageHistory::formatTime(entry.timeMs))
+    , _msgid(MessageHistory::formatMsgId(entry.id))
+{
+    _variants[0] = entry.line;
+}
+
+const std::shared_ptr<const std::string> &MessageVariants::forClient(const Client &client)
+{
+    unsigned index = 0;
+    if (client.hasCap(CAP_SERVER_TIME))
+        index |= TIME_TAG;
+    if (client.hasCap(CAP_MESSAGE_TAGS) && !_msgid.empty())
+        index |= MSGID_TAG;
+
+    std::shared_ptr<const std::string> &variant = _variants[index];
+    if (!variant) {
+        std::string tags;
+        if (index & TIME_TAG)
+            tags = "time=" + _time;
+        if (index & MSGID_TAG)
+            tags += (tags.empty() ? "msgid=" : ";msgid=") + _msgid;
+        variant = std::make_shared<const std::string>("@" + tags + " " + *_variants[0]);
+    }
+    return variant;
+}
@@ -0,0 +1,123 @@
+#include <NameReplyCache.hpp>
+#include <algorithm>
+
+NameReplyCache::NameReplyCache(size_t chunkLimit)
+    : _chunkLimit(chunkLimit)
+{}
+
+void NameReplyCache::add(Client *client, const std::string &entry)
+{
+    if (contains(client))
+        remove(client);
+    size_t index = findRoom(entry.size());
+    std::string &chunk = _chunks[index];
+
+    if (!chunk.empty())
+        chunk.push_back(' ');
+    chunk.append(entry);
+    _entries[client] = {index, entry};
+}
+
+void NameReplyCache::remove(Client *client)
+{
+    auto it = _entries.find(client);
+    if (it == _entries.end())
+        return;
+    size_t index = it->second.first;
+
+    eraseEntry(_chunks[index], it->second.second);
+    _entries.erase(it);
+    // trailing empty chunks are dropped, the rest is remembered for reuse
+    size_t count = _chunks.size();
+    while (!_chunks.empty() && _chunks.back().empty())
+        _chunks.pop_back();
+    if (_chunks.size() < count)
+        forgetDropped();
+    if (index < _chunks.size() && !_isSpare[index]) {
+        _isSpare[index] = true;
+        _spare.push_back(index);
+    }
+}
+
+// replaces the entry in place when it still fits, otherwise moves it to another chunk
+void NameReplyCache::update(Client *client, const std::string &entry)
+{
+    auto it = _entries.find(client);
+    if (it == _entries.end())
+        return;
+    size_t index = it->second.first;
+    std::string &old = it->second.second;
+    std::string &chunk = _chunks[index];
+
+    if (chunk.size() - old.size() + entry.size() > _chunkLimit) {
+        add(client, entry);
+        return;
+    }
+    eraseEntry(chunk, old);
+    if (!chunk.empty())
+        chunk.push_back(' ');
+    chunk.append(entry);
+    old = entry;
+}
+
+bool NameReplyCache::contains(Client *client) const
+{
+    return _entries.find(client) != _entries.end();
+}
+
+size_t NameReplyCache::size() const
+{
+    return _entries.size();
+}
+
+const std::vector<std::string> &NameReplyCache::getChunks() const
+{
+    return _chunks;
+}
+
+// + 1 for the separating space
+size_t NameReplyCache::findRoom(size_t length)
+{
+    while (!_spare.empty()) {
+        size_t index = _spare.back();
+        if (_chunks[index].size() + length + 1 <= _chunkLimit)
+            return index;
+        _isSpare[index] = false;
+        _spare.pop_back();
+    }
+    if (_chunks.empty() || _chunks.back().size() + length + 1 > _chunkLimit) {
+        _chunks.emplace_back();
+        _isSpare.push_back(false);
+    }
+    return _chunks.size() - 1;
+}
+
+// dropped chunks leave the spare list with them, a chunk created again at the same index
+// starts out unmarked
+void NameReplyCache::forgetDropped()
+{
+    size_t count = _chunks.size();
+    _spare.erase(std::remove_if(_spare.begin(), _spare.end(),
+                                [count](size_t index) { return index >= count; }),
+                 _spare.end());
+    _isSpare.resize(count);
+}
+
+// removes a whole space separated entry, never a substring of a longer one
+void NameReplyCache::eraseEntry(std::string &chunk, const std::string &entry)
+{
+    size_t pos = 0;
+    while ((pos = chunk.find(entry, pos)) != std::string::npos) {
+        size_t end = pos + entry.size();
+        bool startsToken = pos == 0 || chunk[pos - 1] == ' ';
+        bool endsToken = end == chunk.size() || chunk[end] == ' ';
+        if (startsToken && endsToken) {
+            if (end < chunk.size())
+                chunk.erase(pos, entry.size() + 1);
+            else
+                chunk.erase(pos == 0 ? 0 : pos - 1);
+            return;
+        }
+        pos = end;
+    }
+}
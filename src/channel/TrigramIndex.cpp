@@ -0,0 +1,52 @@
+#include <TrigramIndex.hpp>
+#include <cctype>
+
+uint32_t TrigramIndex::trigram(const std::string &text, size_t pos)
+{
+    uint32_t gram = 0;
+    for (size_t i = pos; i < pos + 3; i++) {
+        gram = (gram << 8) | static_cast<uint8_t>(tolower(static_cast<unsigned char>(text[i])));
+    }
+    return gram;
+}
+
+void TrigramIndex::add(const std::string &key, const std::string &text)
+{
+    for (size_t i = 0; i + 3 <= text.size(); i++) {
+        _postings[trigram(text, i)].insert(key);
+    }
+}
+
+void TrigramIndex::remove(const std::string &key, const std::string &text)
+{
+    for (size_t i = 0; i + 3 <= text.size(); i++) {
+        auto it = _postings.find(trigram(text, i));
+        if (it == _postings.end())
+            continue;
+        it->second.erase(key);
+        if (it->second.empty())
+            _postings.erase(it);
+    }
+}
+
+const TrigramIndex::Keys *TrigramIndex::candidates(const std::string &mask) const
+{
+    static const Keys none;
+    const Keys *best = nullptr;
+    size_t runStart = 0;
+
+    for (size_t i = 0; i <= mask.size(); i++) {
+        if (i < mask.size() && mask[i] != '*' && mask[i] != '?')
+            continue;
+        // literal run mask[runStart, i)
+        for (size_t pos = runStart; pos + 3 <= i; pos++) {
+            auto it = _postings.find(trigram(mask, pos));
+            if (it == _postings.end())
+                return &none;
+            if (best == nullptr || it->second.size() < best->size())
+                best = &it->second;
+        }
+        runStart = i + 1;
+    }
+    return best;
+}
@@ -1,9 +1,54 @@
 #include <CommandRunner.hpp>
 
+// CAP LS [302] | LIST | REQ :<caps> | END
+// LS or REQ before registration holds registration back until CAP END
 void CommandRunner::cap()
 {
-    if (_params.empty() || _params[0] != "LS")
+    if (_params.empty()) {
+        sendToClient(_clientFd, ERR_NEEDMOREPARAMS(_nickname, "CAP"));
         return;
+    }
+    std::string subcommand = _params[0];
+    std::transform(subcommand.begin(), subcommand.end(), subcommand.begin(), ::toupper);
 
-    sendToClient(_clientFd, "CAP * LS :");
+    if (subcommand == "LS" || subcommand == "LIST") {
+        if (subcommand == "LS" && !_client.getIsRegistered())
+            _client.setNegotiatingCaps(true);
+        uint32_t caps = subcommand == "LS" ? CAP_ALL : _client.getCaps();
+        sendToClient(_clientFd, CAP(_nickname, subcommand, capabilityNames(caps)));
+    }
+    else if (subcommand == "REQ") {
+        if (!_client.getIsRegistered())
+            _client.setNegotiatingCaps(true);
+        std::string requested = _params.size() > 1 ? _params[1] : "";
+        uint32_t caps = _client.getCaps();
+        std::istringstream iss(requested);
+        std::string name;
+        // all or nothing, one unknown name rejects the whole request
+        while (iss >> name) {
+            bool disable = name[0] == '-';
+            Capability cap = capabilityFromName(disable ? name.substr(1) : name);
+            if (cap == CAP_NONE) {
+                sendToClient(_clientFd, CAP(_nickname, "NAK", requested));
+                return;
+            }
+            caps = disable ? caps & ~cap : caps | cap;
+        }
+        bool resumable = !_client.hasCap(CAP_RESUME) && (caps & CAP_RESUME);
+        _client.setCaps(caps);
+        sendToClient(_clientFd, CAP(_nickname, "ACK", requested));
+        if (!(caps & CAP_RESUME))
+            _client.setResumeToken("");
+        else if (resumable && _client.getIsRegistered())
+            sendToClient(_clientFd, RESUME_TOKEN(_clients.issueResumeToken(_client)));
+    }
+    else if (subcommand == "END") {
+        if (!_client.isNegotiatingCaps())
+            return;
+        _client.setNegotiatingCaps(false);
+        tryRegisterClient();
+    }
+    else {
+        sendToClient(_clientFd, ERR_INVALIDCAPCMD(_nickname, _params[0]));
+    }
 }
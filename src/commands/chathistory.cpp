@@ -0,0 +1,78 @@
+#include <CommandRunner.hpp>
+#include <ReplyCursor.hpp>
+
+static uint64_t g_batchCounter = 0;
+
+static bool parseLimit(const std::string &text, size_t &limit)
+{
+    if (text.empty() || text.size() > 9 || text.find_first_not_of("0123456789") != std::string::npos)
+        return false;
+    limit = std::min(static_cast<size_t>(std::stoul(text)), CHATHISTORY_MAX);
+    return limit > 0;
+}
+
+// CHATHISTORY LATEST <target> <*|ref> <limit>
+// CHATHISTORY BEFORE|AFTER|AROUND <target> <ref> <limit>
+// CHATHISTORY BETWEEN <target> <ref> <ref> <limit>
+// only channels keep history, and only their members may read it
+void CommandRunner::chathistory()
+{
+    if (_params.empty()) {
+        sendToClient(_clientFd, STANDARD_FAIL("CHATHISTORY", "NEED_MORE_PARAMS", "",
+                                              "Missing parameters"));
+        return;
+    }
+    std::string subcommand = _params[0];
+    std::transform(subcommand.begin(), subcommand.end(), subcommand.begin(), ::toupper);
+    bool between = subcommand == "BETWEEN";
+    if (!between && subcommand != "LATEST" && subcommand != "BEFORE" && subcommand != "AFTER" &&
+        subcommand != "AROUND") {
+        sendToClient(_clientFd, STANDARD_FAIL("CHATHISTORY", "INVALID_PARAMS", subcommand,
+                                              "Unknown subcommand"));
+        return;
+    }
+    if (_params.size() < (between ? 5u : 4u)) {
+        sendToClient(_clientFd, STANDARD_FAIL("CHATHISTORY", "NEED_MORE_PARAMS", subcommand,
+                                              "Missing parameters"));
+        return;
+    }
+
+    const std::string &target = _params[1];
+    Channel *channel = _channels.findChannel(target);
+    if (channel == nullptr || !channel->isOnChannel(_client)) {
+        sendToClient(_clientFd,
+                     STANDARD_FAIL("CHATHISTORY", "INVALID_TARGET", subcommand + " " + target,
+                                   "Messages could not be retrieved"));
+        return;
+    }
+
+    MessageHistory::Ref first;
+    MessageHistory::Ref second;
+    size_t limit;
+    bool latestAll = subcommand == "LATEST" && _params[2] == "*";
+    if ((!latestAll && !MessageHistory::parseRef(_params[2], first)) ||
+        (between && !MessageHistory::parseRef(_params[3], second)) ||
+        !parseLimit(_params[between ? 4 : 3], limit)) {
+        sendToClient(_clientFd, STANDARD_FAIL("CHATHISTORY", "INVALID_PARAMS", subcommand,
+                                              "Invalid message reference or limit"));
+        return;
+    }
+
+    const MessageHistory &history = channel->getHistory();
+    std::vector<MessageHistory::Entry> entries;
+    if (subcommand == "LATEST")
+        entries = history.latest(latestAll ? nullptr : &first, limit);
+    else if (subcommand == "BEFORE")
+        entries = history.before(first, limit);
+    else if (subcommand == "AFTER")
+        entries = history.after(first, limit);
+    else if (subcommand == "AROUND")
+        entries = history.around(first, limit);
+    else
+        entries = history.between(first, second, limit);
+
+    _server.getConnectionManager().startReply(
+        _client, std::make_unique<HistoryCursor>(channel->getName(),
+                                                 "ch" + std::to_string(++g_batchCounter),
+                                                 std::move(entries)));
+}
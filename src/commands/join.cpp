@@ -61,6 +61,6 @@ void CommandRunner::handleJoinChannel(const std::string &channelName, const std:
         channel.join(_client, key);
     }
     else {
-        _channels.createChannel(channelName, _client);
+        _channels.createChannel(channelName, _client, key);
     }
 }
\ No newline at end of file
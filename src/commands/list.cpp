@@ -0,0 +1,75 @@
+#include <CommandRunner.hpp>
+#include <ReplyCursor.hpp>
+#include <Mask.hpp>
+
+// parses "<n", ">n", "C<n", "C>n", "T<n" and "T>n", the C/T forms are in minutes
+static bool parseListCondition(const std::string &token, ListFilter &filter)
+{
+    size_t pos = (token[0] == 'C' || token[0] == 'T') ? 1 : 0;
+    if (token.size() < pos + 2 || (token[pos] != '<' && token[pos] != '>'))
+        return false;
+    std::string digits = token.substr(pos + 1);
+    if (digits.find_first_not_of("0123456789") != std::string::npos || digits.size() > 9)
+        return false;
+    int64_t value = std::stoll(digits);
+    bool below = token[pos] == '<';
+
+    if (pos == 0) {
+        if (below)
+            filter.maxUsers = value > 0 ? value - 1 : 0;
+        else
+            filter.minUsers = value + 1;
+    }
+    else {
+        int64_t &min = token[0] == 'C' ? filter.minCreatedAge : filter.minTopicAge;
+        int64_t &max = token[0] == 'C' ? filter.maxCreatedAge : filter.maxTopicAge;
+        if (below)
+            max = value * 60;
+        else
+            min = value * 60;
+    }
+    return true;
+}
+
+// LIST [<channel>|<mask>|!<mask>|T:<topic mask>|<n|>n|C<n|C>n|T<n|T>n{,...}]
+void CommandRunner::list()
+{
+    std::array<ParamType, MAX_PARAMS> pattern = {VAL_NONE};
+    if (!validateParams(0, 1, pattern))
+        return;
+
+    ListFilter filter;
+    std::vector<std::string> channelNames;
+    if (!_params.empty()) {
+        std::istringstream tokenList(_params[0]);
+        std::string token;
+        while (std::getline(tokenList, token, ',')) {
+            if (token.empty() || parseListCondition(token, filter))
+                continue;
+            if (token[0] == '!')
+                filter.excludedNameMask = token.substr(1);
+            else if (token.compare(0, 2, "T:") == 0)
+                filter.topicMask = token.substr(2);
+            else if (isMask(token))
+                filter.nameMask = token;
+            else
+                channelNames.push_back(token);
+        }
+    }
+
+    if (channelNames.empty()) {
+        channelNames = _channels.findChannels(filter);
+    }
+    else {
+        // named channels still have to pass the filters
+        std::vector<std::string> matching;
+        for (const std::string &name : channelNames) {
+            Channel *channel = _channels.findChannel(name);
+            if (channel != nullptr && _channels.matchesFilter(*channel, filter))
+                matching.push_back(name);
+        }
+        channelNames.swap(matching);
+    }
+    _server.getConnectionManager().startReply(
+        _client, std::make_unique<ListCursor>(_channels, std::move(channelNames)));
+}
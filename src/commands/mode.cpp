@@ -26,17 +26,19 @@ void CommandRunner::mode()
 
 bool CommandRunner::needsParameter(char mode, bool adding)
 {
-    if (mode == 'o')
-        return true; // Both +o and -o need parameters
+    if (mode == 'o' || mode == 'b' || mode == 'e' || mode == 'I')
+        return true; // Both + and - need parameters, a bare list mode lists instead
     if (adding && (mode == 'k' || mode == 'l'))
         return true; // +k and +l need parameters
 
     return false;
 }
 
+// validates the whole mode string first so the channel can apply and announce it in one go
 void CommandRunner::processModeString(Channel &channel, const std::string &modeString,
                                       const std::vector<std::string> &params)
 {
+    std::vector<ModeChange> changes;
     bool adding = true;
     size_t paramIndex = 0;
     for (char mode : modeString) {
@@ -49,30 +51,37 @@ void CommandRunner::processModeString(Channel &channel, const std::string &modeS
             continue;
         }
 
-        if (std::string("iklot").find(mode) == std::string::npos) {
+        if (std::string("iklotDbeI").find(mode) == std::string::npos) {
             continue; // Skip this mode character
         }
 
+        bool listMode = (mode == 'b' || mode == 'e' || mode == 'I');
+        if (listMode && paramIndex >= params.size()) {
+            channel.sendMaskList(_client, mode);
+            continue;
+        }
         if (needsParameter(mode, adding)) {
             if (paramIndex >= params.size()) {
                 sendToClient(_clientFd, ERR_NEEDMOREPARAMS(_client.getNickname(), "MODE"));
-                return;
+                break;
             }
             std::string param = params[paramIndex++];
             if (mode == 'k' &&
                 (param.empty() || !IRCValidator::isValidChannelKey(_clientFd, _nickname, param))) {
-                return;
+                break;
             }
             if (mode == 'o' && (nickNotFound(param) || nickNotInChannel(channel, param))) {
-                return;
+                break;
             }
             if (mode == 'l' && !IRCValidator::isValidChannelLimit(param)) {
-                return;
+                break;
             }
-            channel.setMode(_client, adding, mode, param);
+            changes.push_back({adding, mode, param});
         }
         else {
-            channel.setMode(_client, adding, mode);
+            changes.push_back({adding, mode, ""});
         }
     }
-}
\ No newline at end of file
+    // changes validated before an error still go through, as they always have
+    channel.applyModes(_client, changes);
+}
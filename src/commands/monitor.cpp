@@ -0,0 +1,90 @@
+#include <CommandRunner.hpp>
+
+// room for the comma separated targets once "73x <nick> :" and \r\n are around them
+static const size_t MONITOR_LINE_LIMIT = MSG_BUFFER_SIZE - (NICKLEN + 16);
+
+static void sendTargetLines(int fd, const std::string &nick,
+                            const std::vector<std::string> &targets,
+                            std::string (*reply)(const std::string &, const std::string &))
+{
+    std::string line;
+    for (const std::string &target : targets) {
+        if (!line.empty() && line.size() + 1 + target.size() > MONITOR_LINE_LIMIT) {
+            sendToClient(fd, reply(nick, line));
+            line.clear();
+        }
+        line += (line.empty() ? "" : ",") + target;
+    }
+    if (!line.empty())
+        sendToClient(fd, reply(nick, line));
+}
+
+// MONITOR +/- <target>{,<target>} | C | L | S
+void CommandRunner::monitor()
+{
+    std::array<ParamType, MAX_PARAMS> pattern = {VAL_NONE, VAL_NONE};
+    if (!validateParams(1, 2, pattern))
+        return;
+
+    MonitorIndex &index = _clients.getMonitor();
+    char action = _params[0].size() == 1 ? toupper(_params[0][0]) : '\0';
+    if ((action == '+' || action == '-') && _params.size() < 2) {
+        sendToClient(_clientFd, ERR_NEEDMOREPARAMS(_nickname, "MONITOR"));
+        return;
+    }
+
+    if (action == '+' || action == '-') {
+        std::vector<std::string> targets;
+        std::istringstream iss(_params[1]);
+        std::string target;
+        while (std::getline(iss, target, ',')) {
+            if (!target.empty() && target.size() <= static_cast<size_t>(NICKLEN))
+                targets.push_back(target);
+        }
+        if (action == '-') {
+            for (const std::string &nick : targets) {
+                index.remove(_client, nick);
+            }
+            return;
+        }
+        std::vector<std::string> online;
+        std::vector<std::string> offline;
+        for (size_t i = 0; i < targets.size(); i++) {
+            if (!index.add(_client, targets[i])) {
+                std::string rest;
+                for (size_t j = i; j < targets.size(); j++) {
+                    rest += (rest.empty() ? "" : ",") + targets[j];
+                }
+                sendToClient(_clientFd, ERR_MONLISTFULL(_nickname, rest));
+                break;
+            }
+            Client *watched = _clients.findByNick(targets[i]);
+            if (watched != nullptr)
+                online.push_back(watched->getUserHost());
+            else
+                offline.push_back(targets[i]);
+        }
+        sendTargetLines(_clientFd, _nickname, online, RPL_MONONLINE);
+        sendTargetLines(_clientFd, _nickname, offline, RPL_MONOFFLINE);
+    }
+    else if (action == 'C') {
+        index.clear(_client);
+    }
+    else if (action == 'L') {
+        sendTargetLines(_clientFd, _nickname, index.getList(_client), RPL_MONLIST);
+        sendToClient(_clientFd, RPL_ENDOFMONLIST(_nickname));
+    }
+    else if (action == 'S') {
+        std::vector<std::string> online;
+        std::vector<std::string> offline;
+        for (const std::string &nick : index.getList(_client)) {
+            Client *watched = _clients.findByNick(nick);
+            if (watched != nullptr)
+                online.push_back(watched->getUserHost());
+            else
+                offline.push_back(nick);
+        }
+        sendTargetLines(_clientFd, _nickname, online, RPL_MONONLINE);
+        sendTargetLines(_clientFd, _nickname, offline, RPL_MONOFFLINE);
+    }
+}
@@ -0,0 +1,24 @@
+#include <CommandRunner.hpp>
+#include <ReplyCursor.hpp>
+
+void CommandRunner::names()
+{
+    std::array<ParamType, MAX_PARAMS> pattern = {VAL_NONE};
+    if (!validateParams(0, 1, pattern))
+        return;
+
+    std::vector<std::string> channelNames;
+    bool listAll = _params.empty();
+    if (listAll) {
+        channelNames = _channels.getChannelNames();
+    }
+    else {
+        std::istringstream channelList(_params[0]);
+        std::string channelName;
+        while (std::getline(channelList, channelName, ',')) {
+            channelNames.push_back(channelName);
+        }
+    }
+    _server.getConnectionManager().startReply(
+        _client, std::make_unique<NamesCursor>(_channels, std::move(channelNames), listAll));
+}
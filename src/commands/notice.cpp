@@ -14,15 +14,17 @@ void CommandRunner::notice()
             if (!_channels.channelExists(target))
                 continue;
             Channel &channel = _channels.getChannel(target);
-            channel.broadcastToOthers(_client,
-                                      NOTICE(_client.getUserHost(), channel.getName(), _message));
+            if (!channel.canSend(_client))
+                continue;
+            channel.relayMessage(_client,
+                                 NOTICE(_client.getUserHost(), channel.getName(), _message));
         }
         else if (type == NICKNAME) {
             if (!_clients.nickExists(target))
                 continue;
             Client &targetClient = _clients.getByNick(target);
-            sendToClient(targetClient.getFd(),
-                         NOTICE(_client.getUserHost(), targetClient.getNickname(), _message));
+            deliverDirect(targetClient,
+                          NOTICE(_client.getUserHost(), targetClient.getNickname(), _message));
         }
     }
 }
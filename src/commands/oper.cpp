@@ -0,0 +1,24 @@
+#include <CommandRunner.hpp>
+#include <cstdlib>
+
+// OPER <name> <password>, the single operator block comes from FT_IRC_OPER="name:password"
+void CommandRunner::oper()
+{
+    std::array<ParamType, MAX_PARAMS> pattern = {VAL_NONE, VAL_NONE};
+    if (!validateParams(2, 2, pattern))
+        return;
+
+    const char *block = std::getenv("FT_IRC_OPER");
+    std::string credentials = block ? block : "";
+    size_t colon = credentials.find(':');
+    if (colon == std::string::npos || colon == 0 || credentials.substr(0, colon) != _params[0]) {
+        sendToClient(_clientFd, ERR_NOOPERHOST(_nickname));
+        return;
+    }
+    if (credentials.substr(colon + 1) != _params[1]) {
+        sendToClient(_clientFd, ERR_PASSWDMISMATCH(_nickname));
+        return;
+    }
+    _client.setOper(true);
+    sendToClient(_clientFd, RPL_YOUREOPER(_nickname));
+}
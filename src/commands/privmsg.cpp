@@ -1,5 +1,6 @@
 #include <CommandRunner.hpp>
 #include <Error.hpp>
+#include <MessageVariants.hpp>
 
 void CommandRunner::privmsg()
 {
@@ -14,8 +15,12 @@ void CommandRunner::privmsg()
                 continue;
             }
             Channel &channel = _channels.getChannel(target);
-            channel.broadcastToOthers(_client,
-                                      PRIVMSG(_client.getUserHost(), channel.getName(), _message));
+            if (!channel.canSend(_client)) {
+                sendToClient(_clientFd, ERR_CANNOTSENDTOCHAN(_nickname, channel.getName()));
+                continue;
+            }
+            channel.relayMessage(_client,
+                                 PRIVMSG(_client.getUserHost(), channel.getName(), _message));
         }
         else if (type == NICKNAME) {
             if (!_clients.nickExists(target)) {
@@ -23,8 +28,18 @@ void CommandRunner::privmsg()
                 continue;
             }
             Client &targetClient = _clients.getByNick(target);
-            sendToClient(targetClient.getFd(),
-                         PRIVMSG(_client.getUserHost(), targetClient.getNickname(), _message));
+            deliverDirect(targetClient,
+                          PRIVMSG(_client.getUserHost(), targetClient.getNickname(), _message));
         }
     }
 }
+
+// user to user PRIVMSG/NOTICE, tagged like channel messages and echoed back for echo-message
+void CommandRunner::deliverDirect(Client &target, const std::string &message)
+{
+    MessageVariants variants({std::make_shared<const std::string>(message + "\r\n"),
+                              MessageHistory::newMessageId(), MessageHistory::nowMs()});
+    sendShared(target.getFd(), variants.forClient(target));
+    if (&target != &_client && _client.hasCap(CAP_ECHO_MESSAGE))
+        sendShared(_clientFd, variants.forClient(_client));
+}
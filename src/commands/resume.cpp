@@ -0,0 +1,23 @@
+#include <CommandRunner.hpp>
+
+// RESUME <token> [<timestamp>], before registration on a new connection. The timestamp is
+// accepted and ignored, CHATHISTORY covers what was missed while detached
+void CommandRunner::resume()
+{
+    if (_params.empty()) {
+        sendToClient(_clientFd, STANDARD_FAIL("RESUME", "NEED_MORE_PARAMS", "",
+                                              "Missing resume token"));
+        return;
+    }
+    if (_client.getIsRegistered()) {
+        sendToClient(_clientFd, STANDARD_FAIL("RESUME", "REGISTRATION_IS_COMPLETED", "",
+                                              "Cannot resume after registration"));
+        return;
+    }
+    if (_clients.findDetached(_params[0]) == nullptr) {
+        sendToClient(_clientFd, STANDARD_FAIL("RESUME", "INVALID_TOKEN", "",
+                                              "Cannot resume connection, token is not valid"));
+        return;
+    }
+    _server.getConnectionManager().requestResume(_client, _params[0]);
+}
@@ -0,0 +1,46 @@
+#include <CommandRunner.hpp>
+#include <LoopProfiler.hpp>
+#include <CostAccounting.hpp>
+
+// STATS <query>, operators only: m commands handled so far, z counters, gauges and latencies,
+// l where the event loop spends its time, a allocations and syscalls per command
+void CommandRunner::stats()
+{
+    std::array<ParamType, MAX_PARAMS> pattern = {VAL_NONE, VAL_NONE};
+    if (!validateParams(1, 2, pattern))
+        return;
+    if (!_client.isOper()) {
+        sendToClient(_clientFd, ERR_NOPRIVILEGES(_nickname));
+        return;
+    }
+
+    std::string query = _params[0].substr(0, 1);
+    if (query == "m") {
+        for (const auto &[command, latency] : metrics().commands()) {
+            if (latency.count > 0)
+                sendToClient(_clientFd, RPL_STATSCOMMANDS(_nickname, command, latency.count));
+        }
+    }
+    else if (query == "z") {
+        for (const std::string &line : metrics().summary(_server.gauges()))
+            sendToClient(_clientFd, RPL_STATSDEBUG(_nickname, query, line));
+    }
+    else if (query == "l") {
+        LoopProfiler *profiler = _server.getLoopProfiler();
+        if (profiler == nullptr)
+            sendToClient(_clientFd, RPL_STATSDEBUG(_nickname, query, "loop profiling not built"));
+        else {
+            for (const std::string &line : profiler->report())
+                sendToClient(_clientFd, RPL_STATSDEBUG(_nickname, query, line));
+        }
+    }
+    else if (query == "a") {
+        if (!CostAccounting::enabled())
+            sendToClient(_clientFd, RPL_STATSDEBUG(_nickname, query, "cost accounting not built"));
+        else {
+            for (const std::string &line : CostAccounting::report())
+                sendToClient(_clientFd, RPL_STATSDEBUG(_nickname, query, line));
+        }
+    }
+    sendToClient(_clientFd, RPL_ENDOFSTATS(_nickname, query));
+}
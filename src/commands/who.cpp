@@ -0,0 +1,27 @@
+#include <CommandRunner.hpp>
+#include <ReplyCursor.hpp>
+
+// WHO <channel> lists its members, WHO <nick> that user, no mask or "*" everyone
+void CommandRunner::who()
+{
+    std::array<ParamType, MAX_PARAMS> pattern = {VAL_NONE, VAL_NONE};
+    if (!validateParams(0, 2, pattern))
+        return;
+
+    std::string mask = _params.empty() ? "*" : _params[0];
+    std::vector<std::string> nicks;
+    if (Channel *channel = _channels.findChannel(mask)) {
+        nicks.reserve(channel->getMemberCount());
+        for (const auto &[_, member] : channel->getMembers()) {
+            nicks.push_back(member->getNickname());
+        }
+    }
+    else if (mask == "*") {
+        nicks = _clients.getNicks();
+    }
+    else if (_clients.nickExists(mask)) {
+        nicks.push_back(mask);
+    }
+    _server.getConnectionManager().startReply(
+        _client, std::make_unique<WhoCursor>(_clients, _channels, mask, std::move(nicks)));
+}
@@ -0,0 +1,44 @@
+#include <CommandRunner.hpp>
+
+// room for the channel list of one RPL_WHOISCHANNELS line
+static const size_t WHOIS_CHANNELS_LIMIT = MSG_BUFFER_SIZE - (2 * NICKLEN + 16);
+
+// WHOIS [<server>] <nick>. One nick in at most CHANLIMIT channels is a short reply, unlike
+// LIST/WHO/NAMES it goes out directly instead of through a ReplyCursor
+void CommandRunner::whois()
+{
+    std::array<ParamType, MAX_PARAMS> pattern = {VAL_NONE, VAL_NONE};
+    if (!validateParams(1, 2, pattern))
+        return;
+
+    const std::string &nick = _params.back();
+    Client *target = _clients.findByNick(nick);
+    if (target == nullptr || !target->getIsRegistered()) {
+        sendToClient(_clientFd, ERR_NOSUCHNICK(_nickname, nick));
+        sendToClient(_clientFd, RPL_ENDOFWHOIS(_nickname, nick));
+        return;
+    }
+    const std::string &targetNick = target->getNickname();
+    sendToClient(_clientFd, RPL_WHOISUSER(_nickname, targetNick, target->getUsername(),
+                                          target->getIP(), target->getRealname()));
+    std::string channels;
+    for (const auto &[_, channel] : target->getMyChannels()) {
+        // delayed joins stay hidden from non-ops, as in WHO
+        if (channel->isHidden(*target) && target != &_client && !channel->hasOp(_client))
+            continue;
+        std::string entry = (channel->hasOp(*target) ? "@" : "") + channel->getName();
+        if (!channels.empty() && channels.size() + entry.size() + 1 > WHOIS_CHANNELS_LIMIT) {
+            sendToClient(_clientFd, RPL_WHOISCHANNELS(_nickname, targetNick, channels));
+            channels.clear();
+        }
+        if (!channels.empty())
+            channels.push_back(' ');
+        channels.append(entry);
+    }
+    if (!channels.empty())
+        sendToClient(_clientFd, RPL_WHOISCHANNELS(_nickname, targetNick, channels));
+    sendToClient(_clientFd, RPL_WHOISSERVER(_nickname, targetNick));
+    if (target->isOper())
+        sendToClient(_clientFd, RPL_WHOISOPERATOR(_nickname, targetNick));
+    sendToClient(_clientFd, RPL_ENDOFWHOIS(_nickname, targetNick));
+}
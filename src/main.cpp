@@ -5,11 +5,24 @@
 #include <unistd.h>
 #include <IRCValidator.hpp>
 #include <Error.hpp>
+#include <HotUpgrade.hpp>
 
 int main(int argc, char *argv[])
 {
     std::string portStr;
     std::string password;
+    // started by a running server on SIGUSR2, which waits for us to take over
+    if (argc == 3 && std::string(argv[1]) == "--upgrade") {
+        try {
+            UpgradeInheritance inherited = HotUpgrade::receive(std::stoi(argv[2]));
+            Server myserver(inherited, true);
+        }
+        catch (const std::exception &e) {
+            std::cerr << "Upgrade error: " << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
     if (argc == 1) {
         std::cerr << "running with defaults, port: 6667 and password 42" << std::endl;
         portStr = "6667";
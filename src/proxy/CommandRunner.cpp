@@ -1,6 +1,11 @@
 #include <CommandRunner.hpp>
+#include <CostAccounting.hpp>
+#include <Probes.hpp>
+#include <ConnectionManager.hpp>
 #include <unordered_set>
 #include <array>
+#include <algorithm>
+#include <chrono>
 
 std::unordered_map<std::string, void (CommandRunner::*)()> CommandRunner::_commandRunners;
 
@@ -24,7 +29,8 @@ bool CommandRunner::validateCommandAccess()
 {
     static const std::unordered_set<std::string> duplicateRegistration = {"PASS", "USER"};
     static const std::unordered_set<std::string> alwaysAllowedCommands = {"PASS", "QUIT", "CAP"};
-    static const std::unordered_set<std::string> preRegistrationCommands = {"NICK", "USER", "PONG"};
+    static const std::unordered_set<std::string> preRegistrationCommands = {"NICK", "USER", "PONG",
+                                                                            "RESUME"};
 
     if (duplicateRegistration.find(_command) != duplicateRegistration.end()) {
         if (_client.getIsRegistered()) {
@@ -60,7 +66,14 @@ void CommandRunner::execute()
     if (commandIterator != _commandRunners.end()) {
         // Extract the command function pointer from the map
         auto commandFunction = commandIterator->second;
+        COST_ACCOUNT(_command);
+        PROBE2(dispatch, _clientFd, _command.c_str());
+        if (Tracer *tracer = _server.getConnectionManager().getTracer())
+            tracer->executing(_command);
+        auto started = std::chrono::steady_clock::now();
         (this->*commandFunction)();
+        metrics().recordCommand(_command, std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - started).count());
     }
     else {
         sendToClient(_clientFd, ERR_UNKNOWNCOMMAND(_nickname, _command));
@@ -93,7 +106,7 @@ bool CommandRunner::validateParams(size_t min, size_t max,
                                    std::array<ParamType, MAX_PARAMS> pattern)
 {
     if (_params.size() < min) {
-        if (_command == "NICK")
+        if (_command == "NICK" || _command == "WHOIS")
             sendToClient(_clientFd, ERR_NONICKNAMEGIVEN(_nickname));
         else
             sendToClient(_clientFd, ERR_NEEDMOREPARAMS(_nickname, _command));
@@ -235,20 +248,32 @@ void CommandRunner::initCommandMap()
     _commandRunners["KICK"] = &CommandRunner::kick;
     _commandRunners["PRIVMSG"] = &CommandRunner::privmsg;
     _commandRunners["NOTICE"] = &CommandRunner::notice;
-    _commandRunners["WHO"] = &CommandRunner::silentIgnore;
-    // _commandRunners["WHOIS"] = &CommandRunner::whois;}
+    _commandRunners["LIST"] = &CommandRunner::list;
+    _commandRunners["WHO"] = &CommandRunner::who;
+    _commandRunners["NAMES"] = &CommandRunner::names;
+    _commandRunners["CHATHISTORY"] = &CommandRunner::chathistory;
+    _commandRunners["MONITOR"] = &CommandRunner::monitor;
+    _commandRunners["RESUME"] = &CommandRunner::resume;
+    _commandRunners["OPER"] = &CommandRunner::oper;
+    _commandRunners["STATS"] = &CommandRunner::stats;
+    _commandRunners["WHOIS"] = &CommandRunner::whois;
+    for (const auto &command : _commandRunners)
+        metrics().registerCommand(command.first);
 }
 
 bool CommandRunner::canCompleteRegistration()
 {
-    return !_client.getIsRegistered() && _client.getNickname() != "*" &&
-           !_client.getUsername().empty();
+    return !_client.getIsRegistered() && !_client.isNegotiatingCaps() &&
+           _client.getNickname() != "*" && !_client.getUsername().empty();
 }
 
 void CommandRunner::completeRegistration()
 {
     _client.setIsRegistered(true);
+    metrics().registrations.add();
     sendWelcome();
+    if (_client.hasCap(CAP_RESUME))
+        sendToClient(_clientFd, RESUME_TOKEN(_clients.issueResumeToken(_client)));
 }
 
 bool CommandRunner::tryRegisterClient()
@@ -272,6 +297,12 @@ void CommandRunner::sendWelcome()
     sendToClient(_clientFd, RPL_YOURHOST(_nickname));
     sendToClient(_clientFd, RPL_CREATED(_nickname, Server::getInstance().getCreatedTime()));
     sendToClient(_clientFd, RPL_MYINFO(_nickname));
-    sendToClient(_clientFd, RPL_ISUPPORT(_nickname));
+    std::vector<std::string> tokens = ISUPPORT_TOKENS();
+    for (size_t i = 0; i < tokens.size(); i += ISUPPORT_TOKENS_PER_LINE) {
+        size_t end = std::min(tokens.size(), i + ISUPPORT_TOKENS_PER_LINE);
+        sendToClient(_clientFd, RPL_ISUPPORT(_nickname, std::vector<std::string>(
+                                                            tokens.begin() + i,
+                                                            tokens.begin() + end)));
+    }
     motd();
 }
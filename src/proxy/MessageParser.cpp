@@ -3,6 +3,7 @@
 #include <responses.hpp>
 #include <Client.hpp>
 #include <Error.hpp>
+#include <Probes.hpp>
 
 MessageParser::MessageParser(int clientFd, const std::string &rawString)
     : _context({})
@@ -40,6 +41,7 @@ void MessageParser::parseCommand(bool test)
     checkSource(iss);
     storeCommand(iss);
     param(iss);
+    PROBE3(parse, _clientFd, _context.command.c_str(), _rawString.size());
 
     if (!test)
         executeCommand();
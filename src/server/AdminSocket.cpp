@@ -0,0 +1,156 @@
+#include <AdminSocket.hpp>
+#include <Error.hpp>
+#include <common.hpp>
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+AdminSocket::AdminSocket(const std::string &path, EventLoop &eventLoop)
+    : _fd(-1)
+    , _path(path)
+    , _eventLoop(eventLoop)
+{
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+        throw SocketError("Admin socket path too long: " + path);
+    memcpy(address.sun_path, path.c_str(), path.size());
+
+    _fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (_fd < 0)
+        throw SocketError("Failed to create admin socket");
+    // a socket left behind by a crash would make bind fail
+    unlink(path.c_str());
+    if (bind(_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 ||
+        chmod(path.c_str(), 0600) < 0 || listen(_fd, ADMIN_BACKLOG) < 0) {
+        std::string error = strerror(errno);
+        close(_fd);
+        throw SocketError("Failed to open admin socket " + path + ": " + error);
+    }
+}
+
+// closing a descriptor also takes it out of the event loop
+AdminSocket::~AdminSocket()
+{
+    for (const auto &connection : _connections)
+        close(connection.first);
+    close(_fd);
+    unlink(_path.c_str());
+}
+
+int AdminSocket::getFd() const
+{
+    return _fd;
+}
+
+bool AdminSocket::owns(int fd) const
+{
+    return fd == _fd || _connections.count(fd) != 0;
+}
+
+void AdminSocket::handle(const Event &event, const std::function<std::string()> &render)
+{
+    if (event.fd == _fd) {
+        accept();
+        return;
+    }
+    Connection &connection = _connections.at(event.fd);
+    bool open = true;
+    if (event.events & (EVENT_READ | EVENT_CLOSE))
+        open = receive(event.fd, connection, render);
+    if (open && (event.events & EVENT_WRITE))
+        open = flush(event.fd, connection);
+    if (!open)
+        drop(event.fd);
+}
+
+void AdminSocket::accept()
+{
+    int fd = accept4(_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0)
+        return;
+    try {
+        _eventLoop.addToWatch(fd);
+    }
+    catch (const EventError &) {
+        close(fd);
+        throw;
+    }
+    _connections[fd];
+}
+
+// the request is read up to the end of its headers, closing on unread data would reset the
+// connection under the scraper before it has the response
+bool AdminSocket::receive(int fd, Connection &connection,
+                          const std::function<std::string()> &render)
+{
+    char buffer[1024];
+    ssize_t got = recv(fd, buffer, sizeof(buffer), 0);
+    if (got < 0)
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    // anything after the request is ignored, a scraper that hangs up mid-response is dropped
+    if (!connection.response.empty())
+        return got > 0;
+    connection.request.append(buffer, got);
+    size_t lineEnd = connection.request.find('\n');
+    bool complete = connection.request.find("\r\n\r\n") != std::string::npos ||
+                    connection.request.find("\n\n") != std::string::npos ||
+                    (got == 0 && lineEnd != std::string::npos);
+    if (!complete)
+        return got > 0 && connection.request.size() <= ADMIN_REQUEST_MAX;
+
+    std::string requestLine = connection.request.substr(0, lineEnd);
+    if (requestLine.rfind("GET ", 0) == 0) {
+        std::string body = render();
+        connection.response = "HTTP/1.0 200 OK\r\n"
+                              "Content-Type: text/plain; version=0.0.4\r\n"
+                              "Content-Length: " +
+                              std::to_string(body.size()) + "\r\n\r\n" + body;
+    }
+    else {
+        connection.response = "HTTP/1.0 405 Method Not Allowed\r\n"
+                              "Allow: GET\r\n"
+                              "Content-Length: 0\r\n\r\n";
+    }
+    connection.request.clear();
+    return flush(fd, connection);
+}
+
+// what the socket takes right away goes out now, the rest once the loop reports it writable
+bool AdminSocket::flush(int fd, Connection &connection)
+{
+    while (connection.sent < connection.response.size()) {
+        ssize_t sent = send(fd, connection.response.c_str() + connection.sent,
+                            connection.response.size() - connection.sent, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+            continue;
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            try {
+                _eventLoop.watchWritable(fd, true);
+            }
+            catch (const EventError &) {
+                return false;
+            }
+            return true;
+        }
+        if (sent <= 0)
+            return false;
+        connection.sent += sent;
+    }
+    return false;
+}
+
+void AdminSocket::drop(int fd)
+{
+    _connections.erase(fd);
+    try {
+        _eventLoop.removeFromWatch(fd);
+    }
+    catch (const EventError &) {
+        Error::catchError();
+    }
+    close(fd);
+}
@@ -0,0 +1,134 @@
+#include <BanTrie.hpp>
+#include <Error.hpp>
+#include <fstream>
+#include <sstream>
+
+static const unsigned ADDRESS_BITS = 128;
+
+BanTrie::BanTrie()
+    : _bans(0)
+{
+    newNode(IpAddress(), 0);
+}
+
+int32_t BanTrie::newNode(const IpAddress &prefix, unsigned length)
+{
+    Node node;
+    node.prefix = prefix.masked(length);
+    node.length = length;
+    node.banned = false;
+    node.reason = 0;
+    node.child[0] = -1;
+    node.child[1] = -1;
+    _nodes.push_back(node);
+    return _nodes.size() - 1;
+}
+
+void BanTrie::markBanned(int32_t node, const std::string &reason)
+{
+    if (!_nodes[node].banned)
+        _bans++;
+    // bulk lists repeat a handful of reasons, each is stored once
+    auto it = _reasonIds.find(reason);
+    if (it == _reasonIds.end()) {
+        it = _reasonIds.emplace(reason, _reasons.size()).first;
+        _reasons.push_back(reason);
+    }
+    _nodes[node].banned = true;
+    _nodes[node].reason = it->second;
+}
+
+bool BanTrie::add(const std::string &cidr, const std::string &reason)
+{
+    IpAddress prefix;
+    unsigned length;
+    if (!IpAddress::parseCidr(cidr, prefix, length))
+        return false;
+    add(prefix, length, reason);
+    return true;
+}
+
+// indices rather than references, _nodes may reallocate while inserting
+void BanTrie::add(const IpAddress &prefix, unsigned length, const std::string &reason)
+{
+    int32_t current = 0;
+    while (true) {
+        if (_nodes[current].length == length) {
+            markBanned(current, reason);
+            return;
+        }
+        bool bit = prefix.bit(_nodes[current].length);
+        int32_t next = _nodes[current].child[bit];
+        if (next == -1) {
+            int32_t leaf = newNode(prefix, length);
+            _nodes[current].child[bit] = leaf;
+            markBanned(leaf, reason);
+            return;
+        }
+        unsigned nextLength = _nodes[next].length;
+        unsigned common = prefix.commonPrefix(_nodes[next].prefix, std::min(length, nextLength));
+        if (common == nextLength) {
+            current = next;
+            continue;
+        }
+        // the new prefix branches off inside the edge to next, split it
+        int32_t split = newNode(prefix, common);
+        _nodes[split].child[_nodes[next].prefix.bit(common)] = next;
+        _nodes[current].child[bit] = split;
+        if (common == length) {
+            markBanned(split, reason);
+            return;
+        }
+        int32_t leaf = newNode(prefix, length);
+        _nodes[split].child[prefix.bit(common)] = leaf;
+        markBanned(leaf, reason);
+        return;
+    }
+}
+
+const std::string *BanTrie::match(const IpAddress &address) const
+{
+    int32_t current = 0;
+    while (current != -1) {
+        const Node &node = _nodes[current];
+        if (address.commonPrefix(node.prefix, node.length) < node.length)
+            return nullptr;
+        if (node.banned)
+            return &_reasons[node.reason];
+        if (node.length == ADDRESS_BITS)
+            return nullptr;
+        current = node.child[address.bit(node.length)];
+    }
+    return nullptr;
+}
+
+size_t BanTrie::size() const
+{
+    return _bans;
+}
+
+BanTrie BanTrie::loadFile(const std::string &path, std::vector<std::string> &warnings)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+        throw ServerError("Cannot open ban file " + path);
+
+    BanTrie bans;
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+        std::istringstream iss(line);
+        std::string cidr;
+        if (!(iss >> cidr))
+            continue;
+        std::string reason;
+        std::getline(iss >> std::ws, reason);
+        if (!reason.empty() && reason.back() == '\r')
+            reason.pop_back();
+        if (!bans.add(cidr, reason.empty() ? "Banned" : reason))
+            warnings.push_back(path + ":" + std::to_string(lineNumber) + ": invalid ban " + cidr);
+    }
+    return bans;
+}
@@ -1,15 +1,20 @@
 #include <ChannelManager.hpp>
+#include <Log.hpp>
 #include <responses.hpp>
 #include <Client.hpp>
 #include <Channel.hpp>
 #include <Error.hpp>
+#include <Mask.hpp>
+#include <StateImage.hpp>
+#include <ChannelRegistry.hpp>
 
 ChannelManager::ChannelManager()
+    : _registry(nullptr)
 {}
 
 ChannelManager::~ChannelManager()
 {
-    std::cout << "channels cleared" << std::endl;
+    Log::out() << "channels cleared" << std::endl;
 }
 
 bool ChannelManager::channelExists(const std::string &name) const
@@ -17,21 +22,43 @@ bool ChannelManager::channelExists(const std::string &name) const
     return _channels.find(caseMapped(name)) != _channels.end();
 }
 
-void ChannelManager::createChannel(const std::string &name, Client &creator)
+void ChannelManager::createChannel(const std::string &name, Client &creator, const std::string &key)
 {
-    auto inserted = _channels.emplace(caseMapped(name), std::make_unique<Channel>(name, creator));
+    const ChannelRecord *record = _registry ? _registry->find(caseMapped(name)) : nullptr;
+    auto inserted =
+        _channels.emplace(caseMapped(name), std::make_unique<Channel>(name, creator, record, key));
     bool successful = inserted.second;
     if (!successful) 
     {
         throw ChannelNotCreated("Channel creation failed");
     }
+    // the creator joined inside the constructor, index what is there and follow from now on
+    track(inserted.first->first, *inserted.first->second);
+}
+
+void ChannelManager::track(const std::string &key, Channel &channel)
+{
+    _byMemberCount.emplace(channel.getMemberCount(), key);
+    _nameIndex.add(key, channel.getName());
+    _topicIndex.add(key, channel.getTopic());
+    channel.setIndexHooks(
+        [this](Channel &changed, size_t oldCount) { memberCountChanged(changed, oldCount); },
+        [this](Channel &changed, const std::string &oldTopic) {
+            topicChanged(changed, oldTopic);
+        });
+    if (_registry)
+        channel.setMetadataHook([this](Channel &changed) { metadataChanged(changed); });
 }
 
 void ChannelManager::removeChannel(const std::string &name)
 {
-    if (channelExists(caseMapped(name))) {
-        _channels.erase(caseMapped(name));
-        std::cout << "removed channel " << name << std::endl;
+    auto it = _channels.find(caseMapped(name));
+    if (it != _channels.end()) {
+        _byMemberCount.erase({it->second->getMemberCount(), it->first});
+        _nameIndex.remove(it->first, it->second->getName());
+        _topicIndex.remove(it->first, it->second->getTopic());
+        _channels.erase(it);
+        Log::out() << "removed channel " << name << std::endl;
     }
 }
 
@@ -53,6 +80,110 @@ Channel &ChannelManager::getChannel(const std::string &name) const
     return *it->second;
 }
 
+Channel *ChannelManager::findChannel(const std::string &name) const
+{
+    auto it = _channels.find(caseMapped(name));
+    if (it == _channels.end())
+        return nullptr;
+    return it->second.get();
+}
+
+std::vector<std::string> ChannelManager::getChannelNames() const
+{
+    std::vector<std::string> names;
+    names.reserve(_channels.size());
+    for (const auto &[_, channel] : _channels) {
+        names.push_back(channel->getName());
+    }
+    return names;
+}
+
+void ChannelManager::memberCountChanged(Channel &channel, size_t oldCount)
+{
+    std::string key = caseMapped(channel.getName());
+    _byMemberCount.erase({oldCount, key});
+    _byMemberCount.emplace(channel.getMemberCount(), key);
+}
+
+void ChannelManager::topicChanged(Channel &channel, const std::string &oldTopic)
+{
+    std::string key = caseMapped(channel.getName());
+    _topicIndex.remove(key, oldTopic);
+    _topicIndex.add(key, channel.getTopic());
+}
+
+void ChannelManager::setRegistry(ChannelRegistry *registry)
+{
+    _registry = registry;
+}
+
+// a channel back at the defaults leaves the registry, there is nothing to restore
+void ChannelManager::metadataChanged(Channel &channel)
+{
+    std::string key = caseMapped(channel.getName());
+    ChannelRecord record = channel.getRecord();
+    if (record.isDefault())
+        _registry->erase(key);
+    else
+        _registry->put(key, record);
+}
+
+bool ChannelManager::matchesFilter(const Channel &channel, const ListFilter &filter) const
+{
+    int64_t now = time(0);
+    int64_t createdAge = now - channel.getCreatedAt();
+    int64_t topicAge = now - channel.getTopicSetAt();
+
+    if (channel.getMemberCount() < filter.minUsers || channel.getMemberCount() > filter.maxUsers)
+        return false;
+    if (createdAge < filter.minCreatedAge || createdAge > filter.maxCreatedAge)
+        return false;
+    // topic age filters only make sense for channels that have a topic
+    if ((filter.minTopicAge > 0 || filter.maxTopicAge < INT64_MAX) &&
+        (channel.getTopic().empty() || topicAge < filter.minTopicAge ||
+         topicAge > filter.maxTopicAge))
+        return false;
+    if (!filter.nameMask.empty() && !matchMask(filter.nameMask, channel.getName()))
+        return false;
+    if (!filter.excludedNameMask.empty() && matchMask(filter.excludedNameMask, channel.getName()))
+        return false;
+    if (!filter.topicMask.empty() && !matchMask(filter.topicMask, channel.getTopic()))
+        return false;
+    return true;
+}
+
+// starts from the narrowest index that applies, every candidate is then checked in full
+std::vector<std::string> ChannelManager::findChannels(const ListFilter &filter) const
+{
+    std::vector<std::string> names;
+    const TrigramIndex::Keys *candidates = nullptr;
+
+    if (!filter.nameMask.empty())
+        candidates = _nameIndex.candidates(filter.nameMask);
+    if (!filter.topicMask.empty()) {
+        const TrigramIndex::Keys *topicCandidates = _topicIndex.candidates(filter.topicMask);
+        if (candidates == nullptr ||
+            (topicCandidates != nullptr && topicCandidates->size() < candidates->size()))
+            candidates = topicCandidates;
+    }
+
+    if (candidates != nullptr) {
+        for (const std::string &key : *candidates) {
+            const Channel &channel = *_channels.at(key);
+            if (matchesFilter(channel, filter))
+                names.push_back(channel.getName());
+        }
+        return names;
+    }
+    for (auto it = _byMemberCount.lower_bound({filter.minUsers, ""});
+         it != _byMemberCount.end() && it->first <= filter.maxUsers; ++it) {
+        const Channel &channel = *_channels.at(it->second);
+        if (matchesFilter(channel, filter))
+            names.push_back(channel.getName());
+    }
+    return names;
+}
+
 void ChannelManager::rmEmptyChannels()
 {
     std::vector<std::string> channelsToRemove;
@@ -89,3 +220,22 @@ void ChannelManager::forEachChannel(std::function<void(Channel &)> callback)
         }
     }
 }
+
+void ChannelManager::save(ImageWriter &image) const
+{
+    image.u32(static_cast<uint32_t>(_channels.size()));
+    for (const auto &[_, channel] : _channels) {
+        channel->save(image);
+    }
+}
+
+void ChannelManager::load(ImageReader &image, const ClientIndex &clients)
+{
+    for (uint32_t count = image.u32(); count > 0; --count) {
+        auto channel = std::make_unique<Channel>(image, clients);
+        std::string key = caseMapped(channel->getName());
+        auto inserted = _channels.emplace(key, std::move(channel));
+        if (inserted.second)
+            track(key, *inserted.first->second);
+    }
+}
@@ -1,5 +1,16 @@
 #include <Client.hpp>
+#include <Log.hpp>
 #include <Channel.hpp>
+#include <ReplyCursor.hpp>
+#include <MessageVariants.hpp>
+#include <StateImage.hpp>
+#include <Metrics.hpp>
+#include <Transport.hpp>
+#include <Clock.hpp>
+#include <cerrno>
+
+// bumped for every de-duplicated fan-out, recipients are stamped with it
+static uint64_t g_fanoutEpoch = 0;
 
 Client::Client(int fd)
     : _fd(fd)
@@ -8,18 +19,31 @@ Client::Client(int fd)
     , _realname("")
     , _passwordVerified(false)
     , _isRegistered(false)
+    , _isOper(false)
     , _nickname("*")
     , _ip("")
     , _userHost(_nickname + "!" + _username + "@" + _ip)
-    , _lastactivityTime(std::chrono::steady_clock::now())
-    , _lastPingSentTime(std::chrono::steady_clock::now())
+    , _lastactivityTime(Clock::now())
+    , _lastPingSentTime(Clock::now())
     , _waitingForPong(false)
     , _lastPingToken("")
+    , _fanoutEpoch(0)
+    , _floodBucket(FLOOD_BURST, FLOOD_RATE)
+    , _caps(CAP_NONE)
+    , _negotiatingCaps(false)
+    , _inputScheduled(false)
+    , _inputDeferred(false)
+    , _disconnecting(false)
+    , _detaching(false)
+    , _resumePending(false)
+    , _slow(false)
+    , _sendOffset(0)
+    , _sendQueueSize(0)
 {}
 
 Client::~Client()
 {
-    std::cout << "Client " << _userHost << " destroyed" << std::endl;
+    Log::out() << "Client " << _userHost << " destroyed" << std::endl;
 }
 
 int Client::getFd() const
@@ -115,6 +139,16 @@ void Client::setPasswordVerified(bool verified)
     _passwordVerified = verified;
 }
 
+bool Client::isOper() const
+{
+    return _isOper;
+}
+
+void Client::setOper(bool oper)
+{
+    _isOper = oper;
+}
+
 void Client::untrackChannel(Channel *channel)
 {
     if (channel == nullptr)
@@ -148,7 +182,7 @@ size_t Client::countChannelTypes(char type)
 }
 void Client::updateActivityTime()
 {
-    _lastactivityTime = std::chrono::steady_clock::now();
+    _lastactivityTime = Clock::now();
 }
 
 std::chrono::steady_clock::time_point Client::getLastActivityTime() const
@@ -165,23 +199,50 @@ void Client::updateMyChannelsNick(const std::string &newNick)
 
 void Client::forceQuit(const std::string &reason)
 {
+    broadcastMyChannels(QUIT(_userHost, reason));
     for (auto &[_, channel] : _myChannels) {
-        channel->quit(*this, reason);
+        channel->removeMember(*this);
     }
     _myChannels.clear();
-    sendToClient(_fd, ERROR(reason));
+    if (_fd >= 0)
+        sendToClient(_fd, ERROR(reason));
 }
 
+// sends msg once to every client sharing at least one channel with us, never to ourselves
 void Client::broadcastMyChannels(const std::string &msg)
 {
+    if (msg.empty() || _myChannels.empty())
+        return;
+    uint64_t epoch = ++g_fanoutEpoch;
+    MessageVariants variants(msg);
+
+    markFanout(epoch);
+    uint64_t recipients = 0;
     for (auto &[_, channel] : _myChannels) {
-        channel->broadcastToOthers(*this, msg);
+        // +D channels never saw us join
+        if (channel->isHidden(*this))
+            continue;
+        for (auto &[_, member] : channel->getMembers()) {
+            if (member->markFanout(epoch)) {
+                sendShared(member->getFd(), variants.forClient(*member));
+                recipients++;
+            }
+        }
     }
+    metrics().fanout.record(recipients);
+}
+
+bool Client::markFanout(uint64_t epoch)
+{
+    if (_fanoutEpoch == epoch)
+        return false;
+    _fanoutEpoch = epoch;
+    return true;
 }
 
 void Client::markPingSent(const std::string &token)
 {
-    _lastPingSentTime = std::chrono::steady_clock::now();
+    _lastPingSentTime = Clock::now();
     _waitingForPong = true;
     _lastPingToken = token;
 }
@@ -203,10 +264,265 @@ const std::string &Client::getLastPingToken() const
 
 int Client::getTimeSinceLastPing() const
 {
-    auto now = std::chrono::steady_clock::now();
+    auto now = Clock::now();
     return std::chrono::duration_cast<std::chrono::milliseconds>(now - _lastPingSentTime).count();
 }
 
+// sends right away while nothing is queued and keeps what the socket did not take,
+// returns true when the queue just became non-empty and needs a writable watch
+bool Client::deliver(const std::string &line)
+{
+    size_t offset = 0;
+    bool wasEmpty = _sendQueue.empty();
+
+    if (wasEmpty) {
+        ssize_t sent = Transport::current().send(_fd, line.c_str(), line.length());
+        if (sent > 0)
+            metrics().bytesOut.add(sent);
+        if (sent == static_cast<ssize_t>(line.length()))
+            return false;
+        // a broken connection is noticed and handled by the next recv
+        if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+            return false;
+        if (sent > 0)
+            offset = sent;
+    }
+    _sendQueue.push_back(std::make_shared<const std::string>(line, offset));
+    _sendQueueSize += line.length() - offset;
+    return wasEmpty;
+}
+
+// queues a buffer shared with other recipients, a partial write only moves _sendOffset
+bool Client::deliver(const std::shared_ptr<const std::string> &line)
+{
+    bool wasEmpty = _sendQueue.empty();
+
+    if (wasEmpty) {
+        ssize_t sent = Transport::current().send(_fd, line->c_str(), line->length());
+        if (sent > 0)
+            metrics().bytesOut.add(sent);
+        if (sent == static_cast<ssize_t>(line->length()))
+            return false;
+        if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+            return false;
+        _sendOffset = sent > 0 ? sent : 0;
+    }
+    _sendQueue.push_back(line);
+    _sendQueueSize += line->length() - (wasEmpty ? _sendOffset : 0);
+    return wasEmpty;
+}
+
+// writes as much of the queue as the socket takes, false on a hard error
+bool Client::flushOutput()
+{
+    while (!_sendQueue.empty()) {
+        const std::string &front = *_sendQueue.front();
+        ssize_t sent = Transport::current().send(_fd, front.c_str() + _sendOffset,
+                                                 front.length() - _sendOffset);
+        if (sent < 0)
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        metrics().bytesOut.add(sent);
+        _sendOffset += sent;
+        _sendQueueSize -= sent;
+        if (_sendOffset == front.length()) {
+            _sendQueue.pop_front();
+            _sendOffset = 0;
+        }
+    }
+    return true;
+}
+
+bool Client::hasPendingOutput() const
+{
+    return !_sendQueue.empty();
+}
+
+size_t Client::getSendQueueSize() const
+{
+    return _sendQueueSize;
+}
+
+void Client::clearOutput()
+{
+    _sendQueue.clear();
+    _sendOffset = 0;
+    _sendQueueSize = 0;
+}
+
+bool Client::hasPendingReplies() const
+{
+    return !_replies.empty();
+}
+
+void Client::addReply(std::unique_ptr<ReplyCursor> cursor)
+{
+    _replies.push_back(std::move(cursor));
+}
+
+void Client::clearReplies()
+{
+    _replies.clear();
+}
+
+// emits the next batch of the oldest streamed reply, false once none are left
+bool Client::continueReply(size_t maxLines)
+{
+    if (_replies.empty())
+        return false;
+    if (_replies.front()->emit(*this, maxLines))
+        _replies.pop_front();
+    return !_replies.empty();
+}
+
+TokenBucket &Client::getFloodBucket()
+{
+    return _floodBucket;
+}
+
+uint32_t Client::getCaps() const
+{
+    return _caps;
+}
+
+bool Client::hasCap(Capability cap) const
+{
+    return (_caps & cap) != 0;
+}
+
+void Client::setCaps(uint32_t caps)
+{
+    _caps = caps;
+}
+
+bool Client::isNegotiatingCaps() const
+{
+    return _negotiatingCaps;
+}
+
+void Client::setNegotiatingCaps(bool negotiating)
+{
+    _negotiatingCaps = negotiating;
+}
+
+const std::string &Client::getResumeToken() const
+{
+    return _resumeToken;
+}
+
+void Client::setResumeToken(const std::string &token)
+{
+    _resumeToken = token;
+}
+
+void Client::rebind(int fd)
+{
+    _fd = fd;
+}
+
+bool Client::isInputScheduled() const
+{
+    return _inputScheduled;
+}
+
+void Client::setInputScheduled(bool scheduled)
+{
+    _inputScheduled = scheduled;
+}
+
+bool Client::isInputDeferred() const
+{
+    return _inputDeferred;
+}
+
+void Client::setInputDeferred(bool deferred)
+{
+    _inputDeferred = deferred;
+}
+
+bool Client::isDisconnecting() const
+{
+    return _disconnecting;
+}
+
+void Client::setDisconnecting(bool disconnecting)
+{
+    _disconnecting = disconnecting;
+}
+
+bool Client::isDetaching() const
+{
+    return _detaching;
+}
+
+void Client::setDetaching(bool detaching)
+{
+    _detaching = detaching;
+}
+
+bool Client::isResumePending() const
+{
+    return _resumePending;
+}
+
+void Client::setResumePending(bool pending)
+{
+    _resumePending = pending;
+}
+
+bool Client::isSlow() const
+{
+    return _slow;
+}
+
+void Client::setSlow(bool slow)
+{
+    _slow = slow;
+}
+
+void Client::save(ImageWriter &image) const
+{
+    image.str(_nickname);
+    image.str(_username);
+    image.str(_realname);
+    image.str(_ip);
+    image.u8(_passwordVerified);
+    image.u8(_isRegistered);
+    image.u8(_isOper);
+    image.u32(_caps);
+    image.u8(_negotiatingCaps);
+    image.str(_resumeToken);
+    image.str(_messageBuf);
+    // what the socket has not taken yet, flattened
+    std::string pending;
+    pending.reserve(_sendQueueSize);
+    for (size_t i = 0; i < _sendQueue.size(); ++i) {
+        pending.append(*_sendQueue[i], i == 0 ? _sendOffset : 0, std::string::npos);
+    }
+    image.str(pending);
+}
+
+void Client::load(ImageReader &image)
+{
+    _nickname = image.str();
+    _username = image.str();
+    _realname = image.str();
+    _ip = image.str();
+    _passwordVerified = image.u8();
+    _isRegistered = image.u8();
+    _isOper = image.u8();
+    _caps = image.u32();
+    _negotiatingCaps = image.u8();
+    _resumeToken = image.str();
+    _messageBuf = image.str();
+    std::string pending = image.str();
+    updateUserHost();
+    clearOutput();
+    if (!pending.empty()) {
+        _sendQueueSize = pending.size();
+        _sendQueue.push_back(std::make_shared<const std::string>(std::move(pending)));
+    }
+}
+
 std::string Client::getPrefixPrivmsg()
 {
     return ":" + _nickname + "!" + _username + "@" + _ip;
@@ -1,11 +1,18 @@
 #include <ClientIndex.hpp>
+#include <Log.hpp>
+#include <Clock.hpp>
 #include <Client.hpp>
+#include <StateImage.hpp>
+#include <Error.hpp>
+#include <random>
+#include <cstdio>
 
 ClientIndex::~ClientIndex()
 {
     _byNick.clear();
+    _detached.clear();
     _byFd.clear();
-    std::cout << "clientIndex cleared" << std::endl;
+    Log::out() << "clientIndex cleared" << std::endl;
 }
 
 void ClientIndex::add(int clientFd)
@@ -19,14 +26,24 @@ void ClientIndex::addNick(int clientFd)
 {
     Client &client = getByFd(clientFd);
     std::string clientNick = client.getNickname();
-    if (client.getIsRegistered())
+    if (client.getIsRegistered()) {
         _byNick[caseMapped(clientNick)] = &client;
+        _monitor.notifyOnline(client);
+    }
 }
 
 void ClientIndex::remove(Client &client)
 {
-    _byNick.erase(caseMapped(client.getNickname()));
-    _byFd.erase(client.getFd());
+    _monitor.clear(client);
+    auto it = _byNick.find(caseMapped(client.getNickname()));
+    if (it != _byNick.end() && it->second == &client) {
+        _byNick.erase(it);
+        _monitor.notifyOffline(client.getNickname());
+    }
+    if (client.getFd() < 0)
+        _detached.erase(client.getResumeToken());
+    else
+        _byFd.erase(client.getFd());
 }
 
 void ClientIndex::updateNick(const std::string &oldNick, const std::string &newNick)
@@ -38,6 +55,11 @@ void ClientIndex::updateNick(const std::string &oldNick, const std::string &newN
     Client *client = it->second;
     _byNick.erase(caseMapped(oldNick));
     _byNick.insert_or_assign(caseMapped(newNick), client);
+    // a change of case only is the same nick to watchers
+    if (caseMapped(oldNick) != caseMapped(newNick)) {
+        _monitor.notifyOffline(oldNick);
+        _monitor.notifyOnline(*client);
+    }
 }
 
 Client &ClientIndex::getByFd(int fd) const
@@ -60,6 +82,32 @@ Client &ClientIndex::getByNick(const std::string &nick) const
     return *it->second;
 }
 
+Client *ClientIndex::findByFd(int fd) const
+{
+    auto it = _byFd.find(fd);
+    if (it == _byFd.end())
+        return nullptr;
+    return it->second.get();
+}
+
+Client *ClientIndex::findByNick(const std::string &nick) const
+{
+    auto it = _byNick.find(caseMapped(nick));
+    if (it == _byNick.end())
+        return nullptr;
+    return it->second;
+}
+
+std::vector<std::string> ClientIndex::getNicks() const
+{
+    std::vector<std::string> nicks;
+    nicks.reserve(_byNick.size());
+    for (const auto &[_, client] : _byNick) {
+        nicks.push_back(client->getNickname());
+    }
+    return nicks;
+}
+
 void ClientIndex::forEachClient(std::function<void(Client &)> callback)
 {
     // Copy all file descriptors first
@@ -88,7 +136,122 @@ size_t ClientIndex::size() const
     return _byFd.size();
 }
 
-std::string ClientIndex::caseMapped(const std::string &name) const
+std::string ClientIndex::issueResumeToken(Client &client)
+{
+    static std::random_device device;
+    static std::mt19937_64 generator(device());
+    std::string token;
+    do {
+        char buffer[33];
+        snprintf(buffer, sizeof(buffer), "%016llx%016llx",
+                 static_cast<unsigned long long>(generator()),
+                 static_cast<unsigned long long>(generator()));
+        token = buffer;
+    } while (_detached.find(token) != _detached.end());
+    client.setResumeToken(token);
+    return token;
+}
+
+void ClientIndex::detach(Client &client, const std::string &reason,
+                         std::chrono::steady_clock::time_point expires)
+{
+    auto it = _byFd.find(client.getFd());
+    if (it == _byFd.end())
+        return;
+    DetachedSession &session = _detached[client.getResumeToken()];
+    session.client = std::move(it->second);
+    session.reason = reason;
+    session.expires = expires;
+    _byFd.erase(it);
+    client.rebind(-1);
+}
+
+Client *ClientIndex::findDetached(const std::string &token) const
+{
+    auto it = _detached.find(token);
+    return it == _detached.end() ? nullptr : it->second.client.get();
+}
+
+Client &ClientIndex::resume(const std::string &token, int fd)
+{
+    auto it = _detached.find(token);
+    if (it == _detached.end())
+        throw std::out_of_range("No detached session for token " + token);
+    std::unique_ptr<Client> client = std::move(it->second.client);
+    _detached.erase(it);
+    client->rebind(fd);
+    _byFd[fd] = std::move(client);
+    return *_byFd[fd];
+}
+
+std::vector<std::pair<Client *, std::string>>
+ClientIndex::expiredDetached(std::chrono::steady_clock::time_point now) const
+{
+    std::vector<std::pair<Client *, std::string>> expired;
+    for (const auto &[_, session] : _detached) {
+        if (session.expires <= now)
+            expired.emplace_back(session.client.get(), session.reason);
+    }
+    return expired;
+}
+
+size_t ClientIndex::detachedCount() const
+{
+    return _detached.size();
+}
+
+void ClientIndex::save(ImageWriter &image) const
+{
+    image.u32(static_cast<uint32_t>(_byFd.size()));
+    for (const auto &[fd, client] : _byFd) {
+        image.u32(static_cast<uint32_t>(fd));
+        client->save(image);
+    }
+    auto now = Clock::now();
+    image.u32(static_cast<uint32_t>(_detached.size()));
+    for (const auto &[_, session] : _detached) {
+        image.i64(std::chrono::duration_cast<std::chrono::milliseconds>(session.expires - now)
+                      .count());
+        image.str(session.reason);
+        session.client->save(image);
+    }
+    _monitor.save(image);
+}
+
+void ClientIndex::load(ImageReader &image, const std::unordered_map<int, int> &fds)
+{
+    for (uint32_t count = image.u32(); count > 0; --count) {
+        int oldFd = static_cast<int>(image.u32());
+        auto fd = fds.find(oldFd);
+        if (fd == fds.end())
+            throw ServerError("No descriptor handed over for client fd " + std::to_string(oldFd));
+        auto client = std::make_unique<Client>(fd->second);
+        client->load(image);
+        if (client->getIsRegistered())
+            _byNick[caseMapped(client->getNickname())] = client.get();
+        _byFd[fd->second] = std::move(client);
+    }
+    auto now = Clock::now();
+    for (uint32_t count = image.u32(); count > 0; --count) {
+        std::chrono::milliseconds left(image.i64());
+        std::string reason = image.str();
+        auto client = std::make_unique<Client>(-1);
+        client->load(image);
+        _byNick[caseMapped(client->getNickname())] = client.get();
+        DetachedSession &session = _detached[client->getResumeToken()];
+        session.client = std::move(client);
+        session.reason = reason;
+        session.expires = now + left;
+    }
+    _monitor.load(image, *this);
+}
+
+MonitorIndex &ClientIndex::getMonitor()
+{
+    return _monitor;
+}
+
+std::string ClientIndex::caseMapped(const std::string &name)
 {
     std::string casemapped = name;
     for (char &c : casemapped) {
@@ -1,8 +1,48 @@
 #include <ConnectionManager.hpp>
+#include <Log.hpp>
 #include <common.hpp>
 #include <responses.hpp>
 #include <Error.hpp>
 #include <CommandRunner.hpp>
+#include <Server.hpp>
+#include <Metrics.hpp>
+#include <Probes.hpp>
+#include <Transport.hpp>
+#include <Clock.hpp>
+#include <algorithm>
+#include <cstdlib>
+
+void sendSerialized(int fd, const std::string &line)
+{
+    logMessage(fd, line);
+    metrics().linesOut.add();
+    PROBE2(send, fd, line.length());
+    if (Server::hasInstance()) {
+        Server::getInstance().getConnectionManager().deliver(fd, line);
+        return;
+    }
+    Transport::current().send(fd, line.c_str(), line.length());
+}
+
+void sendShared(int fd, const std::shared_ptr<const std::string> &line, const std::string &tags)
+{
+    if (!tags.empty())
+        logMessage(fd, "@" + tags + " " + *line);
+    else
+        logMessage(fd, *line);
+    metrics().linesOut.add();
+    PROBE2(send, fd, line->length() + (tags.empty() ? 0 : tags.length() + 2));
+    if (!Server::hasInstance()) {
+        if (!tags.empty())
+            Transport::current().send(fd, ("@" + tags + " ").c_str(), tags.length() + 2);
+        Transport::current().send(fd, line->c_str(), line->length());
+        return;
+    }
+    ConnectionManager &connections = Server::getInstance().getConnectionManager();
+    if (!tags.empty())
+        connections.deliver(fd, "@" + tags + " ");
+    connections.deliver(fd, line);
+}
 
 ConnectionManager::ConnectionManager(SocketManager &socketManager, EventLoop &EventLoop,
                                      ClientIndex &clients, ChannelManager &channels)
@@ -10,7 +50,9 @@ ConnectionManager::ConnectionManager(SocketManager &socketManager, EventLoop &Ev
     , _socketManager(socketManager)
     , _EventLoop(EventLoop)
     , _channels(channels)
+    , _bans(std::getenv("FT_IRC_BANS") ? std::getenv("FT_IRC_BANS") : BANS_FILE)
 {
+    _bans.load();
     CommandRunner::initCommandMap();
 }
 
@@ -24,15 +66,57 @@ void ConnectionManager::handleNewClient()
     sockaddr_in clientAddr;
     int clientFd = _socketManager.acceptConnection(&clientAddr);
     std::string ip = inet_ntoa(clientAddr.sin_addr);
+    const sockaddr *addr = reinterpret_cast<const sockaddr *>(&clientAddr);
+    if (const std::string *banReason = _bans.match(addr)) {
+        rejectConnection(clientFd, ip, "Banned: " + *banReason);
+        return;
+    }
+    ConnectionThrottle::Verdict verdict = _throttle.admit(addr);
+    if (verdict != ConnectionThrottle::ADMIT) {
+        rejectConnection(clientFd, ip,
+                         verdict == ConnectionThrottle::TOO_MANY_CONNECTIONS
+                             ? "Too many connections from your host"
+                             : "Connecting too fast, try again later");
+        return;
+    }
+    metrics().connectionsAccepted.add();
+    PROBE1(accept, clientFd);
     // add new client into ClientIndex
     _clients.add(clientFd);
     Client &client = _clients.getByFd(clientFd);
     client.setIp(ip);
+    client.getFloodBucket().configure(_floodPolicy.burst, _floodPolicy.ratePerSec);
     // add new client to epoll list
     _EventLoop.addToWatch(clientFd);
-    std::cout << "New client" << std::endl;
-    std::cout << "  Socket: " << clientFd << std::endl;
-    std::cout << "  IP:     " << ip << std::endl;
+    if (_capture)
+        _capture->opened(clientFd, ip);
+    Log::out() << "New client" << std::endl;
+    Log::out() << "  Socket: " << clientFd << std::endl;
+    Log::out() << "  IP:     " << ip << std::endl;
+}
+
+void ConnectionManager::adoptClients()
+{
+    _clients.forEachClient([this](Client &client) {
+        int fd = client.getFd();
+        client.getFloodBucket().configure(_floodPolicy.burst, _floodPolicy.ratePerSec);
+        _throttle.restore(client.getIP());
+        _EventLoop.addToWatch(fd);
+        if (client.hasPendingOutput())
+            _EventLoop.watchWritable(fd, true);
+        if (!client.getMessageBuf().empty())
+            scheduleInput(client);
+    });
+}
+
+// rejected before any Client exists, one non-blocking write and the socket is gone
+void ConnectionManager::rejectConnection(int fd, const std::string &ip, const std::string &reason)
+{
+    std::string line = ERROR(reason) + "\r\n";
+    Transport::current().send(fd, line.c_str(), line.length());
+    _socketManager.closeConnection(fd);
+    metrics().connectionsRejected.add();
+    Log::out() << "Rejected connection from " << ip << ": " << reason << std::endl;
 }
 
 void ConnectionManager::disconnectClient(Client &client, const std::string &reason)
@@ -42,51 +126,200 @@ void ConnectionManager::disconnectClient(Client &client, const std::string &reas
     _channels.clearNickHistory(client.getNickname());
 }
 
+void ConnectionManager::connectionLost(Client &client, const std::string &reason)
+{
+    if (!client.getIsRegistered() || client.getResumeToken().empty()) {
+        disconnectClient(client, reason);
+        return;
+    }
+    if (client.isDetaching())
+        return;
+    client.setDetaching(true);
+    _clientsToDetach.emplace_back(&client, reason);
+}
+
+void ConnectionManager::requestResume(Client &client, const std::string &token)
+{
+    client.setResumePending(true);
+    _pendingResumes.emplace_back(client.getFd(), token);
+}
+
+// the new connection takes over the detached client, which never left its channels
+void ConnectionManager::completeResumes()
+{
+    std::vector<std::pair<int, std::string>> resumes;
+    resumes.swap(_pendingResumes);
+    for (const auto &[fd, token] : resumes) {
+        Client *connection = _clients.findByFd(fd);
+        if (connection == nullptr || isMarkedForDisconnection(*connection))
+            continue;
+        connection->setResumePending(false);
+        if (_clients.findDetached(token) == nullptr) {
+            sendToClient(fd, STANDARD_FAIL("RESUME", "INVALID_TOKEN", "",
+                                           "Cannot resume connection, token is not valid"));
+            continue;
+        }
+        std::string pending = connection->getMessageBuf();
+        std::string ip = connection->getIP();
+        uint32_t caps = connection->getCaps();
+        // the fd stays wherever the connection was queued, the session takes its place
+        bool scheduled = connection->isInputScheduled();
+        bool deferred = connection->isInputDeferred();
+        Client &client = _clients.resume(token, fd);
+        client.setInputScheduled(scheduled);
+        client.setInputDeferred(deferred);
+        client.setIp(ip);
+        client.setCaps(caps | CAP_RESUME);
+        client.getMessageBuf() = pending;
+        client.noPongWait();
+        client.updateActivityTime();
+        sendToClient(fd, RESUME_SUCCESS(client.getNickname()));
+        sendToClient(fd, RESUME_TOKEN(_clients.issueResumeToken(client)));
+        Log::out() << "Client " << client.getNickname() << " resumed on socket " << fd << std::endl;
+        if (pending.find('\n') != std::string::npos)
+            scheduleInput(client);
+    }
+}
+
+// detached sessions nobody came back for quit now, with the reason the socket died for
+void ConnectionManager::expireDetachedClients()
+{
+    if (_clients.detachedCount() == 0)
+        return;
+    for (auto &[client, reason] : _clients.expiredDetached(Clock::now())) {
+        Log::out() << "Detached client " << client->getNickname() << " expired" << std::endl;
+        client->forceQuit(reason);
+        _channels.clearNickHistory(client->getNickname());
+        _clients.remove(*client);
+    }
+}
+
 void ConnectionManager::receiveData(int clientFd)
 {
     Client &client = _clients.getByFd(clientFd);
 
     char buffer[MSG_BUFFER_SIZE];
     std::string &messageBuf = client.getMessageBuf();
-    int bytesRead = recv(clientFd, buffer, sizeof(buffer), 0);
+    int bytesRead = Transport::current().recv(clientFd, buffer, sizeof(buffer));
 
     if (bytesRead < 0) {
-        disconnectClient(client, "Connection error: " + std::string(strerror(errno)));
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return;
+        connectionLost(client, "Connection error: " + std::string(strerror(errno)));
         return;
     }
-    // Client disconnected
+    // Client disconnected, what it sent before closing still gets run
     else if (bytesRead == 0) {
-        disconnectClient(client, "Connection closed");
+        dispatchLines(client, SIZE_MAX);
+        connectionLost(client, "Connection closed");
         return;
     }
+    metrics().bytesIn.add(bytesRead);
+    PROBE2(receive, clientFd, bytesRead);
+    if (_capture)
+        _capture->received(clientFd, buffer, bytesRead);
     messageBuf.append(buffer, bytesRead);
-    extractFullMessages(client, messageBuf);
+    if (_tracer)
+        _tracer->received(clientFd, messageBuf, bytesRead);
+    if (_floodPolicy.enabled && messageBuf.size() > _floodPolicy.maxDeferredBytes) {
+        messageBuf.clear();
+        disconnectClient(client, "Excess Flood");
+        return;
+    }
+    // lines are run by processInputRound(), oversized partial lines right away
+    if (messageBuf.find('\n') != std::string::npos)
+        scheduleInput(client);
+    else if (messageBuf.size() > MSG_BUFFER_SIZE)
+        dispatchLines(client, 0);
+}
+
+void ConnectionManager::scheduleInput(Client &client)
+{
+    if (client.isInputScheduled() || client.isInputDeferred())
+        return;
+    client.setInputScheduled(true);
+    _readyInput.push_back(client.getFd());
+}
+
+void ConnectionManager::processInputRound()
+{
+    std::vector<int> round;
+    round.swap(_readyInput);
+    for (int fd : round) {
+        Client *client = _clients.findByFd(fd);
+        if (client == nullptr)
+            continue;
+        client->setInputScheduled(false);
+        if (dispatchLines(*client, INPUT_LINES_PER_ROUND) == INPUT_READY)
+            scheduleInput(*client);
+    }
+}
+
+// the client is looked at again once its bucket holds what the next line costs
+void ConnectionManager::deferInput(Client &client, double cost)
+{
+    if (client.isInputDeferred())
+        return;
+    // a bucket that never refills is retried every millisecond rather than in a busy loop
+    int waitMs = std::max(1, client.getFloodBucket().msUntilAvailable(cost));
+    client.setInputDeferred(true);
+    _deferredInput.emplace(Clock::now() + std::chrono::milliseconds(waitMs), client.getFd());
 }
 
-// extract a valid IRC message with /r/n ending, send the message as std::string to MessageParser
-// MessageParser will get the message WIHTOUT /r/n
-void ConnectionManager::extractFullMessages(Client &client, std::string &messageBuffer)
+bool ConnectionManager::hasReadyInput() const
 {
+    return !_readyInput.empty();
+}
+
+bool ConnectionManager::isMarkedForDisconnection(Client &client) const
+{
+    return client.isDisconnecting() || client.isDetaching();
+}
+
+// runs up to maxLines complete lines from the client's buffer, each WITHOUT /r/n
+// lines the client can't afford under flood control stay in the buffer until the bucket refills
+ConnectionManager::InputState ConnectionManager::dispatchLines(Client &client, size_t maxLines)
+{
+    std::string &messageBuffer = client.getMessageBuf();
+    size_t lines = 0;
     size_t pos;
     while ((pos = messageBuffer.find("\n")) != std::string::npos) {
+        // whatever a quitting client sent after QUIT is not run, nor what follows a RESUME yet
+        if (isMarkedForDisconnection(client) || client.isResumePending())
+            return INPUT_IDLE;
+        if (lines == maxLines)
+            return INPUT_READY;
         size_t end = pos;
         if (end > 0 && messageBuffer[end - 1] == '\r') {
             end--;
         }
 
         std::string completedMessage = messageBuffer.substr(0, end);
+        if (_floodPolicy.enabled) {
+            double cost = lineCost(completedMessage);
+            if (!client.getFloodBucket().take(cost)) {
+                deferInput(client, cost);
+                return INPUT_DEFERRED;
+            }
+        }
         messageBuffer.erase(0, pos + 1);
+        lines++;
+        metrics().linesIn.add();
 
         // Handle message with possible truncation
+        bool traced = _tracer && _tracer->takeLine(client.getFd());
         truncateAndProcessMessage(client, completedMessage);
+        if (traced)
+            _tracer->finishLine();
     }
 
-    // Check for oversized incomplete messages in buffer
+    // Check for oversized incomplete messages in buffer, only the trailing partial line is left
     if (messageBuffer.size() > MSG_BUFFER_SIZE) {
         std::string oversizedBuffer = messageBuffer;
         messageBuffer.clear();
         truncateAndProcessMessage(client, oversizedBuffer);
     }
+    return INPUT_IDLE;
 }
 
 void ConnectionManager::truncateAndProcessMessage(Client &client, std::string &message)
@@ -101,6 +334,92 @@ void ConnectionManager::truncateAndProcessMessage(Client &client, std::string &m
     parser.parseCommand();
 }
 
+// skips IRCv3 tags and the source prefix, the command word decides the cost
+double ConnectionManager::lineCost(const std::string &line) const
+{
+    size_t start = 0;
+    for (char skipped : {'@', ':'}) {
+        if (start < line.size() && line[start] == skipped) {
+            start = line.find(' ', start);
+            if (start == std::string::npos)
+                return _floodPolicy.defaultCost;
+            start = line.find_first_not_of(' ', start);
+            if (start == std::string::npos)
+                return _floodPolicy.defaultCost;
+        }
+    }
+    std::string command = line.substr(start, line.find(' ', start) - start);
+    auto it = _floodPolicy.commandCosts.find(command);
+    if (it == _floodPolicy.commandCosts.end())
+        return _floodPolicy.defaultCost;
+    return it->second;
+}
+
+void ConnectionManager::setFloodPolicy(const FloodPolicy &policy)
+{
+    _floodPolicy = policy;
+    _clients.forEachClient([this](Client &client) {
+        client.getFloodBucket().configure(_floodPolicy.burst, _floodPolicy.ratePerSec);
+    });
+}
+
+void ConnectionManager::setThrottlePolicy(const ThrottlePolicy &policy)
+{
+    _throttle.setPolicy(policy);
+}
+
+ServerBans &ConnectionManager::getServerBans()
+{
+    return _bans;
+}
+
+void ConnectionManager::startCapture(const std::string &path)
+{
+    _capture = std::make_unique<TrafficCapture>(path);
+    Log::out() << "Capturing inbound traffic to " << path << std::endl;
+}
+
+void ConnectionManager::flushStaleCapture()
+{
+    if (_capture)
+        _capture->flushIfStale(Clock::now());
+}
+
+void ConnectionManager::startTracing(const std::string &path, double rate)
+{
+    _tracer = std::make_unique<Tracer>(path, rate);
+    Log::out() << "Tracing " << rate * 100 << "% of inbound lines to " << path << std::endl;
+}
+
+Tracer *ConnectionManager::getTracer()
+{
+    return _tracer.get();
+}
+
+// only clients whose wake time has come are touched, the next line's take() decides the rest
+void ConnectionManager::releaseDeferredInput()
+{
+    Clock::TimePoint now = Clock::now();
+    while (!_deferredInput.empty() && _deferredInput.begin()->first <= now) {
+        int fd = _deferredInput.begin()->second;
+        _deferredInput.erase(_deferredInput.begin());
+        Client *client = _clients.findByFd(fd);
+        if (client == nullptr)
+            continue;
+        client->setInputDeferred(false);
+        scheduleInput(*client);
+    }
+}
+
+int ConnectionManager::msUntilDeferredInput(int limit) const
+{
+    if (_deferredInput.empty())
+        return limit;
+    auto wait = std::chrono::ceil<std::chrono::milliseconds>(_deferredInput.begin()->first -
+                                                              Clock::now());
+    return static_cast<int>(std::clamp<int64_t>(wait.count(), 0, limit));
+}
+
 std::vector<Client *> &ConnectionManager::getDisconnectedClients()
 {
     return (_clientsToDisconnect);
@@ -108,12 +427,30 @@ std::vector<Client *> &ConnectionManager::getDisconnectedClients()
 
 void ConnectionManager::markClientForDisconnection(Client &client)
 {
+    if (isMarkedForDisconnection(client))
+        return;
+    client.setDisconnecting(true);
     _clientsToDisconnect.push_back(&client);
-    std::cout << "Client " << client.getNickname() << " marked for disconnection" << std::endl;
+    Log::out() << "Client " << client.getNickname() << " marked for disconnection" << std::endl;
 }
 
 void ConnectionManager::rmDisconnectedClients()
 {
+    // dropped here rather than in deliver(), which may run in the middle of a fan-out
+    std::vector<std::pair<int, std::string>> slowClients;
+    slowClients.swap(_slowClients);
+    for (const auto &[fd, reason] : slowClients) {
+        Client *client = _clients.findByFd(fd);
+        if (client != nullptr && client->isSlow())
+            disconnectClient(*client, reason);
+    }
+    std::vector<std::pair<Client *, std::string>> detaching;
+    detaching.swap(_clientsToDetach);
+    for (auto &[client, reason] : detaching) {
+        // a QUIT or an error in the same round wins
+        if (!client->isDisconnecting())
+            detachClient(*client, reason);
+    }
     for (Client *client : _clientsToDisconnect) {
         if (client == nullptr)
             continue;
@@ -126,15 +463,171 @@ void ConnectionManager::rmDisconnectedClients()
 
 void ConnectionManager::deleteClient(Client &client)
 {
+    // best effort, gets the ERROR line out if the socket still takes it
+    client.flushOutput();
+    forgetFd(client);
+    _throttle.release(client.getIP());
+    Log::out() << "Client " << client.getNickname() << " data deleted" << std::endl;
+    _clients.remove(client);
+}
+
+// the fd may be reused by the next client, it must not inherit scheduled input. Every
+// accepted socket is closed here, the disconnect probe pairs with accept
+void ConnectionManager::forgetFd(Client &client)
+{
+    int fd = client.getFd();
+    PROBE1(disconnect, fd);
+    if (client.isInputScheduled())
+        _readyInput.erase(std::remove(_readyInput.begin(), _readyInput.end(), fd),
+                          _readyInput.end());
+    if (client.isInputDeferred()) {
+        for (auto it = _deferredInput.begin(); it != _deferredInput.end(); ++it) {
+            if (it->second == fd) {
+                _deferredInput.erase(it);
+                break;
+            }
+        }
+    }
+    if (_capture)
+        _capture->closed(fd);
+    if (_tracer)
+        _tracer->forget(fd);
     try {
-        _EventLoop.removeFromWatch(client.getFd());
+        _EventLoop.removeFromWatch(fd);
     }
     catch (const EventError &e) {
         std::cerr << e.what() << std::endl;
     }
-    _socketManager.closeConnection(client.getFd());
-    std::cout << "Client " << client.getNickname() << " data deleted" << std::endl;
-    _clients.remove(client);
+    _socketManager.closeConnection(fd);
+}
+
+// keeps the client in its channels with no socket, nobody is told it went away
+void ConnectionManager::detachClient(Client &client, const std::string &reason)
+{
+    forgetFd(client);
+    client.setInputScheduled(false);
+    client.setInputDeferred(false);
+    client.setDetaching(false);
+    _streaming.erase(std::remove(_streaming.begin(), _streaming.end(), client.getFd()),
+                     _streaming.end());
+    client.setSlow(false);
+    _throttle.release(client.getIP());
+    client.clearOutput();
+    client.clearReplies();
+    client.getMessageBuf().clear();
+    Log::out() << "Client " << client.getNickname() << " detached: " << reason << std::endl;
+    _clients.detach(client, reason,
+                    Clock::now() + std::chrono::seconds(RESUME_GRACE_SEC));
+}
+
+void ConnectionManager::deliver(int fd, const std::string &line)
+{
+    if (fd < 0)
+        return;
+    Client *client = _clients.findByFd(fd);
+    if (client == nullptr) {
+        Transport::current().send(fd, line.c_str(), line.length());
+        return;
+    }
+    if (client->isSlow())
+        return;
+    checkSendQueue(*client, client->deliver(line));
+}
+
+void ConnectionManager::deliver(int fd, const std::shared_ptr<const std::string> &line)
+{
+    if (fd < 0)
+        return;
+    Client *client = _clients.findByFd(fd);
+    if (client == nullptr) {
+        Transport::current().send(fd, line->c_str(), line->length());
+        return;
+    }
+    if (client->isSlow())
+        return;
+    bool queueStarted = client->deliver(line);
+    if (_tracer)
+        _tracer->delivered(client->hasPendingOutput());
+    checkSendQueue(*client, queueStarted);
+}
+
+// queueStarted: the line is the first one the socket could not take
+void ConnectionManager::checkSendQueue(Client &client, bool queueStarted)
+{
+    int fd = client.getFd();
+    if (queueStarted) {
+        try {
+            _EventLoop.watchWritable(fd, true);
+        }
+        catch (const EventError &e) {
+            // the rest of the fan-out still goes out
+            std::cerr << e.what() << std::endl;
+            dropOutput(client, "Connection error");
+            return;
+        }
+    }
+    if (client.getSendQueueSize() > MAX_SENDQ) {
+        std::cerr << "SendQ exceeded for client: " << fd << std::endl;
+        dropOutput(client, "SendQ exceeded");
+    }
+}
+
+// deliver() may run in the middle of a fan-out, the client is disconnected at the end of the round
+void ConnectionManager::dropOutput(Client &client, const std::string &reason)
+{
+    client.clearOutput();
+    if (client.isSlow())
+        return;
+    client.setSlow(true);
+    _slowClients.emplace_back(client.getFd(), reason);
+}
+
+void ConnectionManager::flushClient(int fd)
+{
+    Client *client = _clients.findByFd(fd);
+    if (client == nullptr)
+        return;
+    if (!client->flushOutput()) {
+        client->clearOutput();
+        connectionLost(*client, "Connection error: " + std::string(strerror(errno)));
+    }
+    if (!client->hasPendingOutput())
+        _EventLoop.watchWritable(fd, false);
+}
+
+// the first batch goes out right away, the rest once the send queue has drained
+void ConnectionManager::startReply(Client &client, std::unique_ptr<ReplyCursor> cursor)
+{
+    bool streaming = client.hasPendingReplies();
+    client.addReply(std::move(cursor));
+    if (streaming)
+        return;
+    if (client.continueReply(REPLY_BATCH_LINES))
+        _streaming.push_back(client.getFd());
+}
+
+void ConnectionManager::continueReplies()
+{
+    std::vector<int> streaming;
+    streaming.swap(_streaming);
+    for (int fd : streaming) {
+        Client *client = _clients.findByFd(fd);
+        if (client == nullptr || !client->hasPendingReplies())
+            continue;
+        if (client->hasPendingOutput() || client->continueReply(REPLY_BATCH_LINES))
+            _streaming.push_back(fd);
+    }
+}
+
+// true when some reply can make progress without waiting for a socket
+bool ConnectionManager::hasPendingReplies() const
+{
+    for (int fd : _streaming) {
+        Client *client = _clients.findByFd(fd);
+        if (client != nullptr && !client->hasPendingOutput())
+            return true;
+    }
+    return false;
 }
 
 // destructor, no need to broadcast anything
@@ -0,0 +1,154 @@
+#include <ConnectionThrottle.hpp>
+#include <Clock.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+static const size_t INITIAL_SLOTS = 64;
+
+static int64_t nowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               Clock::now().time_since_epoch())
+        .count();
+}
+
+ConnectionThrottle::ConnectionThrottle()
+    : _table(INITIAL_SLOTS)
+    , _used(0)
+{}
+
+void ConnectionThrottle::setPolicy(const ThrottlePolicy &policy)
+{
+    _policy = policy;
+}
+
+// IPv4 hosts are their full address, IPv6 hosts their /64
+IpAddress ConnectionThrottle::hostKey(const IpAddress &address)
+{
+    return address.isIPv4() ? address : address.masked(64);
+}
+
+size_t ConnectionThrottle::slot(const IpAddress &key) const
+{
+    // splitmix64 finaliser, spreads neighbouring addresses over the table
+    uint64_t hash = key.high * 0x9e3779b97f4a7c15ULL ^ key.low;
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+    hash ^= hash >> 31;
+    return hash & (_table.size() - 1);
+}
+
+ConnectionThrottle::Entry *ConnectionThrottle::find(const IpAddress &key)
+{
+    for (size_t i = slot(key);; i = (i + 1) & (_table.size() - 1)) {
+        Entry &entry = _table[i];
+        if (!entry.used)
+            return nullptr;
+        if (entry.key == key)
+            return &entry;
+    }
+}
+
+ConnectionThrottle::Entry &ConnectionThrottle::insert(const IpAddress &key)
+{
+    // keep the load under a half so probe runs stay short
+    if ((_used + 1) * 2 > _table.size())
+        sweep();
+    size_t i = slot(key);
+    while (_table[i].used) {
+        i = (i + 1) & (_table.size() - 1);
+    }
+    Entry &entry = _table[i];
+    entry.key = key;
+    entry.connections = 0;
+    entry.used = true;
+    entry.tokens = static_cast<float>(_policy.connectBurst);
+    entry.lastRefillUs = nowUs();
+    _used++;
+    return entry;
+}
+
+void ConnectionThrottle::refill(Entry &entry, int64_t now) const
+{
+    double elapsed = (now - entry.lastRefillUs) / 1e6;
+    entry.tokens = static_cast<float>(
+        std::min(_policy.connectBurst, entry.tokens + elapsed * _policy.connectRatePerSec));
+    entry.lastRefillUs = now;
+}
+
+// rebuilds the table without hosts that have no connections and a full bucket, they carry
+// no state worth keeping; grows it if that did not free enough room
+void ConnectionThrottle::sweep()
+{
+    int64_t now = nowUs();
+    std::vector<Entry> live;
+    for (Entry &entry : _table) {
+        if (!entry.used)
+            continue;
+        refill(entry, now);
+        if (entry.connections > 0 || entry.tokens < _policy.connectBurst)
+            live.push_back(entry);
+    }
+    size_t slots = _table.size();
+    while ((live.size() + 1) * 2 > slots) {
+        slots *= 2;
+    }
+    _table.assign(slots, Entry());
+    _used = live.size();
+    for (const Entry &entry : live) {
+        size_t i = slot(entry.key);
+        while (_table[i].used) {
+            i = (i + 1) & (_table.size() - 1);
+        }
+        _table[i] = entry;
+    }
+}
+
+ConnectionThrottle::Verdict ConnectionThrottle::admit(const sockaddr *addr)
+{
+    IpAddress address;
+    if (!IpAddress::fromSockaddr(addr, address) || (_policy.exemptLoopback && address.isLoopback()))
+        return ADMIT;
+    IpAddress key = hostKey(address);
+    Entry *entry = find(key);
+    if (entry == nullptr)
+        entry = &insert(key);
+    else
+        refill(*entry, nowUs());
+
+    if (entry->connections >= _policy.maxPerHost)
+        return TOO_MANY_CONNECTIONS;
+    if (entry->tokens < 1)
+        return TOO_FAST;
+    entry->tokens -= 1;
+    entry->connections++;
+    return ADMIT;
+}
+
+void ConnectionThrottle::release(const std::string &ip)
+{
+    IpAddress address;
+    if (!IpAddress::fromString(ip, address))
+        return;
+    Entry *entry = find(hostKey(address));
+    if (entry != nullptr && entry->connections > 0)
+        entry->connections--;
+}
+
+void ConnectionThrottle::restore(const std::string &ip)
+{
+    IpAddress address;
+    if (!IpAddress::fromString(ip, address) || (_policy.exemptLoopback && address.isLoopback()))
+        return;
+    IpAddress key = hostKey(address);
+    Entry *entry = find(key);
+    if (entry == nullptr)
+        entry = &insert(key);
+    entry->connections++;
+}
+
+size_t ConnectionThrottle::trackedHosts() const
+{
+    return _used;
+}
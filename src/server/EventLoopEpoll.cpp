@@ -2,6 +2,7 @@
 #include <EventLoopEpoll.hpp>
 #include <common.hpp>
 #include <Error.hpp>
+#include <CostAccounting.hpp>
 
 EventLoopEpoll::EventLoopEpoll()
     : _epollFd(epoll_create1(0))
@@ -22,6 +23,7 @@ void EventLoopEpoll::addToWatch(int fd)
     epoll_event ev;
     ev.data.fd = fd;
     ev.events = _eventsToTrack;
+    COUNT_SYSCALL();
     if (epoll_ctl(_epollFd, EPOLL_CTL_ADD, fd, &ev) == -1) {
         throw EventError("Failed to add fd to epoll: " + std::string(strerror(errno)));
     }
@@ -29,15 +31,28 @@ void EventLoopEpoll::addToWatch(int fd)
 
 void EventLoopEpoll::removeFromWatch(int fd)
 {
+    COUNT_SYSCALL();
     if (epoll_ctl(_epollFd, EPOLL_CTL_DEL, fd, NULL) == -1) {
         throw EventError("Failed to remove fd from epoll: " + std::string(strerror(errno)));
     }
 }
 
+void EventLoopEpoll::watchWritable(int fd, bool enable)
+{
+    epoll_event ev;
+    ev.data.fd = fd;
+    ev.events = enable ? _eventsToTrack | EPOLLOUT : _eventsToTrack;
+    COUNT_SYSCALL();
+    if (epoll_ctl(_epollFd, EPOLL_CTL_MOD, fd, &ev) == -1) {
+        throw EventError("Failed to modify fd in epoll: " + std::string(strerror(errno)));
+    }
+}
+
 std::vector<Event> EventLoopEpoll::waitForEvents(int timeoutMs)
 {
     epoll_event epollEvents[EPOLL_MAX_EVENTS] = {};
     std::vector<Event> results;
+    COUNT_SYSCALL();
     int nfds = epoll_wait(_epollFd, epollEvents, EPOLL_MAX_EVENTS, timeoutMs);
     if (nfds < 0) {
         throw EventError("epoll failed: " + std::string(strerror(errno)));
@@ -45,7 +60,13 @@ std::vector<Event> EventLoopEpoll::waitForEvents(int timeoutMs)
     for (int i = 0; i < nfds; i++) {
         Event event;
         event.fd = epollEvents[i].data.fd;
-        event.events = epollEvents[i].events;
+        event.events = 0;
+        if (epollEvents[i].events & EPOLLIN)
+            event.events |= EVENT_READ;
+        if (epollEvents[i].events & EPOLLOUT)
+            event.events |= EVENT_WRITE;
+        if (epollEvents[i].events & (EPOLLHUP | EPOLLERR))
+            event.events |= EVENT_CLOSE;
         results.push_back(event);
     }
     return results;
@@ -1,5 +1,6 @@
 #if !defined(__linux__)
 #include <EventLoopPoll.hpp>
+#include <CostAccounting.hpp>
 
 EventLoopPoll::EventLoopPoll()
     : _eventsToTrack(POLLIN)
@@ -30,11 +31,22 @@ void EventLoopPoll::removeFromWatch(int fd)
     }
 }
 
+void EventLoopPoll::watchWritable(int fd, bool enable)
+{
+    for (pollfd &pfd : _pollFds) {
+        if (pfd.fd == fd) {
+            pfd.events = enable ? _eventsToTrack | POLLOUT : _eventsToTrack;
+            break;
+        }
+    }
+}
+
 std::vector<Event> EventLoopPoll::waitForEvents(int timeoutMs)
 {
     std::vector<Event> events;
     if (_pollFds.empty())
         return events;
+    COUNT_SYSCALL();
     int nfds = poll(_pollFds.data(), _pollFds.size(), timeoutMs);
     if (nfds < 0) {
         if (errno != EINTR) {
@@ -47,7 +59,13 @@ std::vector<Event> EventLoopPoll::waitForEvents(int timeoutMs)
             if (pfd.revents != 0) {
                 Event event;
                 event.fd = pfd.fd;
-                event.events = pfd.revents;
+                event.events = 0;
+                if (pfd.revents & POLLIN)
+                    event.events |= EVENT_READ;
+                if (pfd.revents & POLLOUT)
+                    event.events |= EVENT_WRITE;
+                if (pfd.revents & (POLLHUP | POLLERR | POLLNVAL))
+                    event.events |= EVENT_CLOSE;
                 events.push_back(event);
                 pfd.revents = 0;
             }
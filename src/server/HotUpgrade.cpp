@@ -0,0 +1,234 @@
+#include <HotUpgrade.hpp>
+#include <Server.hpp>
+#include <ClientIndex.hpp>
+#include <ChannelManager.hpp>
+#include <Client.hpp>
+#include <StateImage.hpp>
+#include <Error.hpp>
+#include <common.hpp>
+#include <Descriptors.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+static const std::string UPGRADE_MAGIC = "ft_irc-upgrade-2";
+// where the new process finds the upgrade socket, right after stdin/stdout/stderr
+static const int UPGRADE_CHANNEL_FD = 3;
+static const char UPGRADE_ACK = 'R';
+
+bool HotUpgrade::handOff(Server &server)
+{
+    std::string binary = currentBinary();
+    std::string channelArg = std::to_string(UPGRADE_CHANNEL_FD);
+    int pair[2];
+    if (binary.empty() || socketpair(AF_UNIX, SOCK_STREAM, 0, pair) < 0)
+        return false;
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(pair[0]);
+        close(pair[1]);
+        return false;
+    }
+    if (pid == 0) {
+        // only async-signal-safe calls from here, the ban reload thread may hold the heap lock
+        if (dup2(pair[1], UPGRADE_CHANNEL_FD) < 0)
+            _exit(127);
+        closeDescriptorsFrom(UPGRADE_CHANNEL_FD + 1);
+        execl(binary.c_str(), binary.c_str(), "--upgrade", channelArg.c_str(),
+              static_cast<char *>(nullptr));
+        _exit(127);
+    }
+    close(pair[1]);
+
+    std::vector<int> fds;
+    ImageWriter length;
+    std::string image = snapshot(server, fds);
+    length.u64(image.size());
+    bool handedOver = writeAll(pair[0], length.data()) && writeAll(pair[0], image) &&
+                      sendFds(pair[0], fds) && waitForAcknowledge(pair[0]);
+    close(pair[0]);
+    if (!handedOver) {
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+    }
+    return handedOver;
+}
+
+// header, then the state as one string; fds gets the listening socket first, then every client
+std::string HotUpgrade::snapshot(Server &server, std::vector<int> &fds)
+{
+    ImageWriter state;
+    server.getClients().save(state);
+    server.getChannels().save(state);
+
+    fds.push_back(server.getServerFD());
+    server.getClients().forEachClient([&fds](Client &client) { fds.push_back(client.getFd()); });
+
+    ImageWriter image;
+    image.str(UPGRADE_MAGIC);
+    image.u32(static_cast<uint32_t>(server.getPort()));
+    image.str(server.getPassword());
+    image.str(server.getCreatedTime());
+    image.u32(static_cast<uint32_t>(fds.size()));
+    for (int fd : fds) {
+        image.u32(static_cast<uint32_t>(fd));
+    }
+    image.str(state.data());
+    return image.data();
+}
+
+UpgradeInheritance HotUpgrade::receive(int channel)
+{
+    std::string length;
+    std::string image;
+    if (!readAll(channel, 8, length))
+        throw ServerError("Upgrade image missing");
+    uint64_t size = ImageReader(length).u64();
+    if (size > UPGRADE_MAX_IMAGE || !readAll(channel, size, image))
+        throw ServerError("Upgrade image truncated");
+
+    ImageReader reader(image);
+    if (reader.str() != UPGRADE_MAGIC)
+        throw ServerError("Not an upgrade image");
+    UpgradeInheritance inherited;
+    inherited.channel = channel;
+    inherited.port = static_cast<int>(reader.u32());
+    inherited.password = reader.str();
+    inherited.createdTime = reader.str();
+    std::vector<int> oldFds(reader.u32());
+    for (int &fd : oldFds) {
+        fd = static_cast<int>(reader.u32());
+    }
+    inherited.state = reader.str();
+
+    std::vector<int> fds;
+    if (oldFds.empty() || !receiveFds(channel, oldFds.size(), fds))
+        throw ServerError("Upgrade descriptors missing");
+    inherited.serverFd = fds[0];
+    for (size_t i = 1; i < fds.size(); i++) {
+        inherited.fds[oldFds[i]] = fds[i];
+    }
+    return inherited;
+}
+
+void HotUpgrade::acknowledge(int channel)
+{
+    writeAll(channel, std::string(1, UPGRADE_ACK));
+    close(channel);
+}
+
+bool HotUpgrade::waitForAcknowledge(int channel)
+{
+    pollfd watched = {channel, POLLIN, 0};
+    char reply = 0;
+    if (poll(&watched, 1, UPGRADE_TIMEOUT_MS) != 1)
+        return false;
+    return read(channel, &reply, 1) == 1 && reply == UPGRADE_ACK;
+}
+
+bool HotUpgrade::sendFds(int socket, const std::vector<int> &fds)
+{
+    for (size_t first = 0; first < fds.size(); first += UPGRADE_FDS_PER_MESSAGE) {
+        size_t count = std::min(UPGRADE_FDS_PER_MESSAGE, fds.size() - first);
+        // every batch rides on one byte of payload
+        char byte = 0;
+        iovec payload = {&byte, 1};
+        std::vector<char> control(CMSG_SPACE(count * sizeof(int)));
+        msghdr message = {};
+        message.msg_iov = &payload;
+        message.msg_iovlen = 1;
+        message.msg_control = control.data();
+        message.msg_controllen = control.size();
+        cmsghdr *header = CMSG_FIRSTHDR(&message);
+        header->cmsg_level = SOL_SOCKET;
+        header->cmsg_type = SCM_RIGHTS;
+        header->cmsg_len = CMSG_LEN(count * sizeof(int));
+        std::copy(fds.begin() + first, fds.begin() + first + count,
+                  reinterpret_cast<int *>(CMSG_DATA(header)));
+        ssize_t sent;
+        do {
+            sent = sendmsg(socket, &message, MSG_NOSIGNAL);
+        } while (sent < 0 && errno == EINTR);
+        if (sent != 1)
+            return false;
+    }
+    return true;
+}
+
+bool HotUpgrade::receiveFds(int socket, size_t count, std::vector<int> &fds)
+{
+    while (fds.size() < count) {
+        char byte;
+        iovec payload = {&byte, 1};
+        std::vector<char> control(CMSG_SPACE(UPGRADE_FDS_PER_MESSAGE * sizeof(int)));
+        msghdr message = {};
+        message.msg_iov = &payload;
+        message.msg_iovlen = 1;
+        message.msg_control = control.data();
+        message.msg_controllen = control.size();
+        ssize_t received;
+        do {
+            received = recvmsg(socket, &message, 0);
+        } while (received < 0 && errno == EINTR);
+        if (received != 1 || (message.msg_flags & MSG_CTRUNC))
+            return false;
+        for (cmsghdr *header = CMSG_FIRSTHDR(&message); header != nullptr;
+             header = CMSG_NXTHDR(&message, header)) {
+            if (header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS)
+                continue;
+            const int *data = reinterpret_cast<const int *>(CMSG_DATA(header));
+            fds.insert(fds.end(), data, data + (header->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+        }
+    }
+    return fds.size() == count;
+}
+
+bool HotUpgrade::writeAll(int fd, const std::string &data)
+{
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t sent = send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+            continue;
+        if (sent <= 0)
+            return false;
+        written += sent;
+    }
+    return true;
+}
+
+bool HotUpgrade::readAll(int fd, size_t length, std::string &data)
+{
+    data.resize(length);
+    size_t done = 0;
+    while (done < length) {
+        ssize_t received = read(fd, &data[done], length - done);
+        if (received < 0 && errno == EINTR)
+            continue;
+        if (received <= 0)
+            return false;
+        done += received;
+    }
+    return true;
+}
+
+// the binary as installed now, a rebuilt one shows up as "(deleted)" behind /proc/self/exe
+std::string HotUpgrade::currentBinary()
+{
+    char path[PATH_MAX];
+    ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    if (length <= 0)
+        return "";
+    std::string binary(path, length);
+    const std::string deleted = " (deleted)";
+    if (binary.size() > deleted.size() &&
+        binary.compare(binary.size() - deleted.size(), deleted.size(), deleted) == 0)
+        binary.erase(binary.size() - deleted.size());
+    return binary;
+}
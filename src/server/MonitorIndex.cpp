@@ -0,0 +1,109 @@
+#include <MonitorIndex.hpp>
+#include <ClientIndex.hpp>
+#include <Client.hpp>
+#include <StateImage.hpp>
+#include <algorithm>
+
+bool MonitorIndex::add(Client &watcher, const std::string &nick)
+{
+    std::string key = ClientIndex::caseMapped(nick);
+    std::vector<std::string> &list = _lists[&watcher];
+    for (const std::string &watched : list) {
+        if (ClientIndex::caseMapped(watched) == key)
+            return true;
+    }
+    if (list.size() >= MONITOR_LIMIT)
+        return false;
+    list.push_back(nick);
+    _watchers[key].push_back(&watcher);
+    return true;
+}
+
+void MonitorIndex::remove(Client &watcher, const std::string &nick)
+{
+    std::string key = ClientIndex::caseMapped(nick);
+    auto list = _lists.find(&watcher);
+    if (list == _lists.end())
+        return;
+    auto watched = std::find_if(list->second.begin(), list->second.end(),
+                                [&key](const std::string &entry) {
+                                    return ClientIndex::caseMapped(entry) == key;
+                                });
+    if (watched == list->second.end())
+        return;
+    list->second.erase(watched);
+    if (list->second.empty())
+        _lists.erase(list);
+
+    std::vector<Client *> &watchers = _watchers[key];
+    watchers.erase(std::remove(watchers.begin(), watchers.end(), &watcher), watchers.end());
+    if (watchers.empty())
+        _watchers.erase(key);
+}
+
+void MonitorIndex::clear(Client &watcher)
+{
+    auto list = _lists.find(&watcher);
+    if (list == _lists.end())
+        return;
+    std::vector<std::string> nicks;
+    nicks.swap(list->second);
+    for (const std::string &nick : nicks) {
+        std::vector<Client *> &watchers = _watchers[ClientIndex::caseMapped(nick)];
+        watchers.erase(std::remove(watchers.begin(), watchers.end(), &watcher), watchers.end());
+        if (watchers.empty())
+            _watchers.erase(ClientIndex::caseMapped(nick));
+    }
+    _lists.erase(&watcher);
+}
+
+const std::vector<std::string> &MonitorIndex::getList(Client &watcher) const
+{
+    static const std::vector<std::string> empty;
+    auto list = _lists.find(&watcher);
+    return list == _lists.end() ? empty : list->second;
+}
+
+void MonitorIndex::notifyOnline(Client &target)
+{
+    auto it = _watchers.find(ClientIndex::caseMapped(target.getNickname()));
+    if (it == _watchers.end())
+        return;
+    for (Client *watcher : it->second) {
+        sendToClient(watcher->getFd(), RPL_MONONLINE(watcher->getNickname(), target.getUserHost()));
+    }
+}
+
+void MonitorIndex::notifyOffline(const std::string &nick)
+{
+    auto it = _watchers.find(ClientIndex::caseMapped(nick));
+    if (it == _watchers.end())
+        return;
+    for (Client *watcher : it->second) {
+        sendToClient(watcher->getFd(), RPL_MONOFFLINE(watcher->getNickname(), nick));
+    }
+}
+
+void MonitorIndex::save(ImageWriter &image) const
+{
+    image.u32(static_cast<uint32_t>(_lists.size()));
+    for (const auto &[watcher, list] : _lists) {
+        image.str(watcher->getNickname());
+        image.u32(static_cast<uint32_t>(list.size()));
+        for (const std::string &nick : list) {
+            image.str(nick);
+        }
+    }
+}
+
+void MonitorIndex::load(ImageReader &image, const ClientIndex &clients)
+{
+    for (uint32_t watchers = image.u32(); watchers > 0; --watchers) {
+        Client *watcher = clients.findByNick(image.str());
+        for (uint32_t nicks = image.u32(); nicks > 0; --nicks) {
+            std::string nick = image.str();
+            if (watcher != nullptr)
+                add(*watcher, nick);
+        }
+    }
+}
@@ -1,4 +1,5 @@
 #include <ConnectionManager.hpp>
+#include <Log.hpp>
 #include <PongManager.hpp>
 
 
@@ -10,7 +11,7 @@ void PongManager::handlePongFromClient(const std::string &token, Client &client)
     if (client.getLastPingToken() == token) {
         client.noPongWait();
         client.updateActivityTime();
-        std::cout << "PONG received from " << client.getNickname() << ": " << token << std::endl;
+        Log::out() << "PONG received from " << client.getNickname() << ": " << token << std::endl;
     }
 }
 
@@ -26,7 +27,7 @@ void PongManager::sendPingToClient(Client &client)
     std::string token = "PING_" + std::to_string(client.getFd()) + "_" + std::to_string(time(NULL));
     client.markPingSent(token);
     sendToClient(client.getFd(), "PING " + token);
-    std::cout << "Sending PING to " << client.getNickname() << ": " << token << std::endl;
+    Log::out() << "Sending PING to " << client.getNickname() << ": " << token << std::endl;
 }
 
 void PongManager::sendPingToAllClients(ClientIndex &clients)
@@ -46,13 +47,13 @@ void PongManager::checkAllPingTimeouts(int timeoutMs, ClientIndex &clients,
     std::vector<Client *> clientsToDisconnect;
     clients.forEachClient([this, &clientsToDisconnect, timeoutMs](Client &client) {
         if (checkPingTimeouts(timeoutMs, client)) {
-            std::cout << "Client " << client.getNickname() << " has no PONG response after "
-                      << timeoutMs / 1000 << " seconds" << std::endl;
+            Log::out() << "Client " << client.getNickname() << " has no PONG response after "
+                       << timeoutMs / 1000 << " seconds" << std::endl;
             clientsToDisconnect.push_back(&client);
         }
     });
     for (Client *client : clientsToDisconnect) {
-        connManager.disconnectClient(*client, "Ping timeout: " + std::to_string(timeoutMs / 1000) +
-                                                  " seconds");
+        connManager.connectionLost(*client, "Ping timeout: " + std::to_string(timeoutMs / 1000) +
+                                                " seconds");
     }
 }
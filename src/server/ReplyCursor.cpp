@@ -0,0 +1,159 @@
+#include <ReplyCursor.hpp>
+#include <ChannelManager.hpp>
+#include <ClientIndex.hpp>
+#include <Channel.hpp>
+#include <Client.hpp>
+#include <responses.hpp>
+#include <Capabilities.hpp>
+
+ListCursor::ListCursor(ChannelManager &channels, std::vector<std::string> names)
+    : _channels(channels)
+    , _names(std::move(names))
+    , _next(0)
+    , _started(false)
+{}
+
+// channels are looked up again per line, they may be gone since the LIST was issued
+bool ListCursor::emit(Client &client, size_t maxLines)
+{
+    const std::string &nick = client.getNickname();
+    size_t lines = 0;
+
+    if (!_started) {
+        sendToClient(client.getFd(), RPL_LISTSTART(nick));
+        _started = true;
+    }
+    while (_next < _names.size() && lines < maxLines) {
+        Channel *channel = _channels.findChannel(_names[_next++]);
+        if (channel == nullptr)
+            continue;
+        sendToClient(client.getFd(), RPL_LIST(nick, channel->getName(),
+                                              channel->getMemberCount(), channel->getTopic()));
+        lines++;
+    }
+    if (_next < _names.size())
+        return false;
+    sendToClient(client.getFd(), RPL_LISTEND(nick));
+    return true;
+}
+
+WhoCursor::WhoCursor(ClientIndex &clients, ChannelManager &channels, const std::string &mask,
+                     std::vector<std::string> nicks)
+    : _clients(clients)
+    , _channels(channels)
+    , _mask(mask)
+    , _nicks(std::move(nicks))
+    , _next(0)
+{}
+
+// a channel mask lists its members, anything else lists the given nicks
+bool WhoCursor::emit(Client &client, size_t maxLines)
+{
+    const std::string &nick = client.getNickname();
+    Channel *channel = _channels.findChannel(_mask);
+    size_t lines = 0;
+
+    while (_next < _nicks.size() && lines < maxLines) {
+        Client *target = _clients.findByNick(_nicks[_next++]);
+        if (target == nullptr)
+            continue;
+        std::string flags = "H";
+        std::string channelName = "*";
+        if (channel != nullptr) {
+            if (!channel->isOnChannel(*target))
+                continue;
+            // delayed joins stay hidden from non-ops
+            if (channel->isHidden(*target) && target != &client && !channel->hasOp(client))
+                continue;
+            if (channel->hasOp(*target))
+                flags += "@";
+            channelName = channel->getName();
+        }
+        sendToClient(client.getFd(),
+                     RPL_WHOREPLY(nick, channelName, target->getUsername(), target->getIP(),
+                                  target->getNickname(), flags, target->getRealname()));
+        lines++;
+    }
+    if (_next < _nicks.size())
+        return false;
+    sendToClient(client.getFd(), RPL_ENDOFWHO(nick, _mask));
+    return true;
+}
+
+NamesCursor::NamesCursor(ChannelManager &channels, std::vector<std::string> names, bool listAll)
+    : _channels(channels)
+    , _names(std::move(names))
+    , _listAll(listAll)
+    , _next(0)
+    , _nextChunk(0)
+{}
+
+// sends the cached chunks, resuming inside a channel when it does not fit in one batch
+bool NamesCursor::emit(Client &client, size_t maxLines)
+{
+    const std::string &nick = client.getNickname();
+    size_t lines = 0;
+
+    while (_next < _names.size() && lines < maxLines) {
+        Channel *channel = _channels.findChannel(_names[_next]);
+        if (channel != nullptr) {
+            const std::vector<std::string> &chunks = channel->getNames(client).getChunks();
+            while (_nextChunk < chunks.size() && lines < maxLines) {
+                const std::string &chunk = chunks[_nextChunk++];
+                if (chunk.empty())
+                    continue;
+                sendToClient(client.getFd(), RPL_NAMREPLY(nick, channel->getName(), chunk));
+                lines++;
+            }
+            if (_nextChunk < chunks.size())
+                return false;
+            if (channel->missesOwnName(client))
+                sendToClient(client.getFd(), RPL_NAMREPLY(nick, channel->getName(), nick));
+        }
+        if (!_listAll)
+            sendToClient(client.getFd(), RPL_ENDOFNAMES(nick, _names[_next]));
+        _next++;
+        _nextChunk = 0;
+    }
+    if (_next < _names.size())
+        return false;
+    if (_listAll)
+        sendToClient(client.getFd(), RPL_ENDOFNAMES(nick, "*"));
+    return true;
+}
+
+HistoryCursor::HistoryCursor(const std::string &target, const std::string &batchRef,
+                             std::vector<MessageHistory::Entry> entries)
+    : _target(target)
+    , _batchRef(batchRef)
+    , _entries(std::move(entries))
+    , _next(0)
+    , _started(false)
+{}
+
+// the batch and each tag only go to clients that negotiated them, plain clients get the lines
+bool HistoryCursor::emit(Client &client, size_t maxLines)
+{
+    bool batched = client.hasCap(CAP_BATCH);
+    if (!_started) {
+        if (batched)
+            sendToClient(client.getFd(), BATCH_START(_batchRef, "chathistory", _target));
+        _started = true;
+    }
+    for (size_t lines = 0; _next < _entries.size() && lines < maxLines; lines++) {
+        const MessageHistory::Entry &entry = _entries[_next++];
+        std::string tags;
+        if (batched)
+            tags = "batch=" + _batchRef;
+        if (client.hasCap(CAP_SERVER_TIME))
+            tags += (tags.empty() ? "time=" : ";time=") + MessageHistory::formatTime(entry.timeMs);
+        if (client.hasCap(CAP_MESSAGE_TAGS))
+            tags += (tags.empty() ? "msgid=" : ";msgid=") + MessageHistory::formatMsgId(entry.id);
+        sendShared(client.getFd(), entry.line, tags);
+    }
+    if (_next < _entries.size())
+        return false;
+    if (batched)
+        sendToClient(client.getFd(), BATCH_END(_batchRef));
+    return true;
+}
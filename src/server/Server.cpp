@@ -1,49 +1,193 @@
 #include <Server.hpp>
+#include <Log.hpp>
 #include <common.hpp>
 #include <SocketManager.hpp>
 #include <EventLoop.hpp>
 #include <ClientIndex.hpp>
 #include <ChannelManager.hpp>
+#include <ChannelRegistry.hpp>
 #include <ConnectionManager.hpp>
 #include <responses.hpp>
 #include <PongManager.hpp>
 #include <Error.hpp>
+#include <HotUpgrade.hpp>
+#include <StateImage.hpp>
+#include <AdminSocket.hpp>
+#include <LoopProfiler.hpp>
+#include <Transport.hpp>
+#include <Clock.hpp>
+#include <MessageHistory.hpp>
+#include <algorithm>
+#include <unistd.h>
 
 Server *Server::_instance = nullptr;
 
+static int64_t clockMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               Clock::now().time_since_epoch())
+        .count();
+}
+
 Server::Server(int port, std::string password, bool startBlocking)
     : _running(false)
     , _paused(false)
+    , _reloadBans(false)
+    , _upgrade(false)
     , _serverFd(-1)
     , _port(port)
     , _password(password)
     , _clients(std::make_unique<ClientIndex>())
     , _channels(std::make_unique<ChannelManager>())
     , _socketManager(std::make_unique<SocketManager>(_port))
-    , _eventLoop(createEventLoop())
+    , _eventLoop(Transport::current().createEventLoop())
     , _PongManager(std::make_unique<PongManager>())
     , _connectionManager(
           std::make_unique<ConnectionManager>(*_socketManager, *_eventLoop, *_clients, *_channels))
     , _createdTime(getCurrentTime())
+    , _lastPing(clockMs())
+    , _lastPingCheck(_lastPing)
 {
-    // setup signalshandlers
-    _instance = this;
-    signal(SIGINT, signalHandler);  // Handle Ctrl+C
-    signal(SIGTERM, signalHandler); // Handle termination request
-    signal(SIGTSTP, signalHandler); // handle server pause
-    signal(SIGPIPE, SIG_IGN);       // Ignore SIGPIPE (broken pipe)
-
+    installSignalHandlers();
+    startProfiler();
+    openRegistry();
     _serverFd = getSocketManager().initialize();
     if (_serverFd < 0) {
         throw ServerError("Server failed to start");
         return;
     }
     getEventLoop().addToWatch(_serverFd);
+    openAdminSocket();
+    openCapture();
+    openTracer();
+    if (startBlocking) {
+        loop();
+    }
+}
+
+Server::Server(UpgradeInheritance &inherited, bool startBlocking)
+    : _running(false)
+    , _paused(false)
+    , _reloadBans(false)
+    , _upgrade(false)
+    , _serverFd(-1)
+    , _port(inherited.port)
+    , _password(inherited.password)
+    , _clients(std::make_unique<ClientIndex>())
+    , _channels(std::make_unique<ChannelManager>())
+    , _socketManager(std::make_unique<SocketManager>(_port))
+    , _eventLoop(Transport::current().createEventLoop())
+    , _PongManager(std::make_unique<PongManager>())
+    , _connectionManager(
+          std::make_unique<ConnectionManager>(*_socketManager, *_eventLoop, *_clients, *_channels))
+    , _createdTime(inherited.createdTime)
+    , _lastPing(clockMs())
+    , _lastPingCheck(_lastPing)
+{
+    installSignalHandlers();
+    startProfiler();
+    openRegistry();
+    _serverFd = getSocketManager().adopt(inherited.serverFd);
+    getEventLoop().addToWatch(_serverFd);
+    ImageReader state(inherited.state);
+    _clients->load(state, inherited.fds);
+    _channels->load(state, *_clients);
+    getConnectionManager().adoptClients();
+    openAdminSocket();
+    HotUpgrade::acknowledge(inherited.channel);
+    Log::out() << "Took over " << _clients->size() << " clients and "
+               << _channels->getChannelNames().size() << " channels" << std::endl;
     if (startBlocking) {
         loop();
     }
 }
 
+void Server::installSignalHandlers()
+{
+    _instance = this;
+    signal(SIGINT, signalHandler);  // Handle Ctrl+C
+    signal(SIGTERM, signalHandler); // Handle termination request
+    signal(SIGTSTP, signalHandler); // handle server pause
+    signal(SIGPIPE, SIG_IGN);       // Ignore SIGPIPE (broken pipe)
+    signal(SIGHUP, signalHandler);  // reload the ban list
+    signal(SIGUSR2, signalHandler); // hot upgrade
+}
+
+void Server::startProfiler()
+{
+#ifdef FT_IRC_PROFILE
+    _profiler = std::make_unique<LoopProfiler>(LOOP_SLOW_ITERATION_US);
+#endif
+}
+
+// channel metadata is only persisted when FT_IRC_STATE_DIR names a directory for it
+void Server::openRegistry()
+{
+    const char *directory = getenv("FT_IRC_STATE_DIR");
+    if (directory == nullptr || *directory == '\0')
+        return;
+    _registry = std::make_unique<ChannelRegistry>(directory);
+    _channels->setRegistry(_registry.get());
+}
+
+// the metrics are only served on a socket when FT_IRC_ADMIN_SOCKET names its path
+void Server::openAdminSocket()
+{
+    const char *path = getenv("FT_IRC_ADMIN_SOCKET");
+    if (path == nullptr || *path == '\0')
+        return;
+    _admin = std::make_unique<AdminSocket>(path, getEventLoop());
+    getEventLoop().addToWatch(_admin->getFd());
+}
+
+// inbound traffic is only recorded when FT_IRC_CAPTURE names a file, an upgrade ends the capture
+void Server::openCapture()
+{
+    const char *path = getenv("FT_IRC_CAPTURE");
+    if (path == nullptr || *path == '\0')
+        return;
+    getConnectionManager().startCapture(path);
+}
+
+// fan-out tracing is only on when FT_IRC_TRACE names the JSON file, FT_IRC_TRACE_RATE is the
+// share of lines sampled
+void Server::openTracer()
+{
+    const char *path = getenv("FT_IRC_TRACE");
+    if (path == nullptr || *path == '\0')
+        return;
+    double rate = TRACE_DEFAULT_RATE;
+    if (const char *value = getenv("FT_IRC_TRACE_RATE"))
+        rate = std::clamp(std::atof(value), 0.0, 1.0);
+    getConnectionManager().startTracing(path, rate);
+}
+
+LoopProfiler *Server::getLoopProfiler()
+{
+    return _profiler.get();
+}
+
+std::vector<Gauge> Server::gauges()
+{
+    size_t queued = 0;
+    size_t deepest = 0;
+    _clients->forEachClient([&](Client &client) {
+        queued += client.getSendQueueSize();
+        deepest = std::max(deepest, client.getSendQueueSize());
+    });
+    return {
+        {"clients", "Connected clients.", static_cast<double>(_clients->size())},
+        {"detached_clients", "Lost sessions waiting for RESUME.",
+         static_cast<double>(_clients->detachedCount())},
+        {"channels", "Channels.", static_cast<double>(_channels->getChannelNames().size())},
+        {"send_queue_bytes", "Bytes queued for all clients.", static_cast<double>(queued)},
+        {"send_queue_max_bytes", "Largest queue of a single client.",
+         static_cast<double>(deepest)},
+        {"history_bytes", "Bytes held by channel history.",
+         static_cast<double>(MessageHistory::getTotalBytes())},
+    };
+}
+
 Server::~Server() noexcept
 {
     _connectionManager->cleanUp();
@@ -54,59 +198,122 @@ Server::~Server() noexcept
         Error::catchError();
     }
     _socketManager->closeServerSocket();
-    std::cout << "Server shutdown complete" << std::endl;
+    Log::out() << "Server shutdown complete" << std::endl;
+    _instance = nullptr;
 }
 
 void Server::loop()
 {
     _running = true;
-    int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
-                      std::chrono::steady_clock::now().time_since_epoch())
-                      .count();
     while (_running) {
-        try{
-            std::vector<Event> events = getEventLoop().waitForEvents(100);
-            for (const Event &event : events) {
-                if (event.fd == _serverFd) {
-                    getConnectionManager().handleNewClient();
-                }
-                else {
-                    getConnectionManager().receiveData(event.fd);
-                }
+        iterate();
+    }
+}
+
+// one pass of the event loop, simulation tests call it directly instead of loop()
+void Server::iterate()
+{
+    try{
+        int timeoutMs = getConnectionManager().hasReadyInput() ||
+                                getConnectionManager().hasPendingReplies()
+                            ? 0
+                            : getConnectionManager().msUntilDeferredInput(100);
+        LOOP_PROFILE(beginIteration());
+        std::vector<Event> events = getEventLoop().waitForEvents(timeoutMs);
+        LOOP_PROFILE(mark(PHASE_WAIT));
+        for (const Event &event : events) {
+            if (event.fd == _serverFd) {
+                getConnectionManager().handleNewClient();
+                LOOP_PROFILE(mark(PHASE_ACCEPT));
+                continue;
+            }
+            if (_admin && _admin->owns(event.fd)) {
+                _admin->handle(event, [this] { return metrics().render(gauges()); });
+                LOOP_PROFILE(mark(PHASE_HOUSEKEEPING));
+                continue;
             }
-            pingSchedule(now);
-            getConnectionManager().rmDisconnectedClients();
-            getChannels().rmEmptyChannels();
-            if (_paused) {
-                std::cout << "Server paused. Waiting for SIGTSTP to resume..." << std::endl;
-                while (_paused && _running) {
-                    sleep(1);
-                }
-                std::cout << "Server resumed!" << std::endl;
+            if (event.events & EVENT_WRITE) {
+                getConnectionManager().flushClient(event.fd);
             }
+            if (event.events & (EVENT_READ | EVENT_CLOSE)) {
+                getConnectionManager().receiveData(event.fd);
+            }
+            LOOP_PROFILE(mark(PHASE_RECEIVE));
+        }
+        getConnectionManager().releaseDeferredInput();
+        getConnectionManager().processInputRound();
+        LOOP_PROFILE(mark(PHASE_DISPATCH));
+        getConnectionManager().completeResumes();
+        getConnectionManager().continueReplies();
+        LOOP_PROFILE(mark(PHASE_REPLIES));
+        if (_reloadBans) {
+            _reloadBans = false;
+            getConnectionManager().getServerBans().reload();
         }
-        catch(const std::exception& e)
-        {
-            Error::catchError();
+        getConnectionManager().getServerBans().collectReload();
+        getConnectionManager().flushStaleCapture();
+        if (_registry)
+            _registry->maintain();
+        LOOP_PROFILE(mark(PHASE_HOUSEKEEPING));
+        pingSchedule(_lastPing);
+        LOOP_PROFILE(mark(PHASE_PING));
+        getConnectionManager().expireDetachedClients();
+        getConnectionManager().rmDisconnectedClients();
+        LOOP_PROFILE(mark(PHASE_DISCONNECT));
+        getChannels().rmEmptyChannels();
+        LOOP_PROFILE(mark(PHASE_CHANNELS));
+        LOOP_PROFILE(endIteration());
+        // nothing is half done at this point, the state image is consistent
+        if (_upgrade) {
+            _upgrade = false;
+            upgrade();
         }
-        catch(...)
-        {
-            std::cerr << "Unknown error : " << std::endl;
+        if (_paused) {
+            Log::out() << "Server paused. Waiting for SIGTSTP to resume..." << std::endl;
+            while (_paused && _running) {
+                sleep(1);
+            }
+            Log::out() << "Server resumed!" << std::endl;
         }
     }
+    catch(const std::exception& e)
+    {
+        Error::catchError();
+    }
+    catch(...)
+    {
+        std::cerr << "Unknown error : " << std::endl;
+    }
+}
+
+// on success the new process owns every socket, leaving through _exit keeps the destructors
+// from closing them or telling MONITOR watchers everyone went offline
+void Server::upgrade()
+{
+    Log::out() << "Upgrading, handing over " << _clients->size() << " clients" << std::endl;
+    // the new process replays the registry from disk, all of it has to be there
+    if (_registry)
+        _registry->sync();
+    if (!HotUpgrade::handOff(*this)) {
+        std::cerr << "Upgrade failed, still serving" << std::endl;
+        return;
+    }
+    Log::out() << "Handed over to the upgraded server" << std::endl;
+    _exit(0);
 }
 
 void Server::pingSchedule(int64_t &last_ping)
 {
-    int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
-                      std::chrono::steady_clock::now().time_since_epoch())
-                      .count();
+    int64_t now = clockMs();
     const int pingCheckInterval = PING_INTERVAL_SEC * 1000;
     const int pingTimeout = PING_TIMEOUT_SEC * 1000;
     if (now - last_ping > pingCheckInterval) {
         getPongManager().sendPingToAllClients(*_clients);
         last_ping = now;
     }
+    if (now - _lastPingCheck < PING_CHECK_INTERVAL_MS)
+        return;
+    _lastPingCheck = now;
     getPongManager().checkAllPingTimeouts(pingTimeout, *_clients, *_connectionManager);
 }
 
@@ -115,11 +322,21 @@ Server &Server::getInstance()
     return *_instance;
 }
 
+bool Server::hasInstance()
+{
+    return _instance != nullptr;
+}
+
 int Server::getServerFD() const
 {
     return this->_serverFd;
 }
 
+int Server::getPort() const
+{
+    return _port;
+}
+
 ClientIndex &Server::getClients()
 {
     return *_clients;
@@ -163,30 +380,36 @@ const std::string &Server::getCreatedTime()
 void Server::pause()
 {
     _paused = true;
-    std::cout << "Server pausing..." << std::endl;
+    Log::out() << "Server pausing..." << std::endl;
 }
 
 void Server::resume()
 {
     _paused = false;
-    std::cout << "Server resuming..." << std::endl;
+    Log::out() << "Server resuming..." << std::endl;
 }
 
 void Server::signalHandler(int signum)
 {
     if (_instance) {
-        if (signum == SIGTSTP) {
+        if (signum == SIGHUP) {
+            _instance->_reloadBans = true;
+        }
+        else if (signum == SIGUSR2) {
+            _instance->_upgrade = true;
+        }
+        else if (signum == SIGTSTP) {
             if (_instance->_paused) {
                 _instance->_paused = false;
-                std::cout << "Server resuming..." << std::endl;
+                Log::out() << "Server resuming..." << std::endl;
             }
             else {
                 _instance->_paused = true;
-                std::cout << "Server pausing..." << std::endl;
+                Log::out() << "Server pausing..." << std::endl;
             }
         }
         else {
-            std::cout << "\nCaught signal " << signum << std::endl;
+            Log::out() << "\nCaught signal " << signum << std::endl;
             _instance->_running = false;
         }
     }
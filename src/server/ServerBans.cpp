@@ -0,0 +1,97 @@
+#include <ServerBans.hpp>
+#include <Log.hpp>
+#include <Error.hpp>
+#include <iostream>
+
+ServerBans::ServerBans(const std::string &path)
+    : _path(path)
+    , _active(std::make_unique<BanTrie>())
+    , _reloading(false)
+    , _reloadDone(false)
+{}
+
+ServerBans::~ServerBans()
+{
+    if (_worker.joinable())
+        _worker.join();
+}
+
+void ServerBans::load()
+{
+    try {
+        std::vector<std::string> warnings;
+        _active = std::make_unique<BanTrie>(BanTrie::loadFile(_path, warnings));
+        logWarnings(warnings);
+        Log::out() << "Loaded " << _active->size() << " bans from " << _path << std::endl;
+    }
+    catch (const ServerError &e) {
+        Log::out() << e.what() << ", running without bans" << std::endl;
+    }
+}
+
+void ServerBans::reload()
+{
+    if (_reloading) {
+        Log::out() << "Ban reload already in progress" << std::endl;
+        return;
+    }
+    if (_worker.joinable())
+        _worker.join();
+    _reloading = true;
+    // the worker only touches its own trie and the result slot, no logging from there
+    _worker = std::thread([this]() {
+        std::unique_ptr<BanTrie> loaded;
+        std::vector<std::string> warnings;
+        std::string error;
+        try {
+            loaded = std::make_unique<BanTrie>(BanTrie::loadFile(_path, warnings));
+        }
+        catch (const std::exception &e) {
+            error = e.what();
+        }
+        std::lock_guard<std::mutex> lock(_resultMutex);
+        _reloaded = std::move(loaded);
+        _reloadWarnings = std::move(warnings);
+        _reloadError = error;
+        _reloadDone = true;
+    });
+}
+
+void ServerBans::collectReload()
+{
+    if (!_reloadDone)
+        return;
+    _worker.join();
+    std::lock_guard<std::mutex> lock(_resultMutex);
+    logWarnings(_reloadWarnings);
+    _reloadWarnings.clear();
+    if (_reloaded) {
+        _active = std::move(_reloaded);
+        Log::out() << "Reloaded " << _active->size() << " bans from " << _path << std::endl;
+    }
+    else {
+        Log::out() << "Ban reload failed: " << _reloadError << ", keeping the old list"
+                   << std::endl;
+    }
+    _reloadDone = false;
+    _reloading = false;
+}
+
+void ServerBans::logWarnings(const std::vector<std::string> &warnings)
+{
+    for (const std::string &warning : warnings)
+        std::cerr << warning << std::endl;
+}
+
+const std::string *ServerBans::match(const sockaddr *addr) const
+{
+    IpAddress address;
+    if (!IpAddress::fromSockaddr(addr, address))
+        return nullptr;
+    return _active->match(address);
+}
+
+size_t ServerBans::size() const
+{
+    return _active->size();
+}
@@ -0,0 +1,89 @@
+#include <Transport.hpp>
+#include <Error.hpp>
+#include <CostAccounting.hpp>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+Transport *Transport::_installed = nullptr;
+
+Transport &Transport::current()
+{
+    static SocketTransport sockets;
+    if (_installed != nullptr)
+        return *_installed;
+    return sockets;
+}
+
+void Transport::install(Transport *transport)
+{
+    _installed = transport;
+}
+
+int SocketTransport::listen(int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw SocketError("Failed to create socket");
+    }
+
+    // Set socket options to reuse address (prevents "Address already in use" errors)
+    int opt = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+        ::close(fd);
+        throw SocketError("Failed to set socket options");
+    }
+
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+
+    sockaddr_in address = {};
+    address.sin_port = htons(port);
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    if (bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+        ::close(fd);
+        throw SocketError("Failed to bind socket");
+    }
+
+    if (::listen(fd, SOMAXCONN) < 0) {
+        ::close(fd);
+        throw SocketError("Failed to listen on socket");
+    }
+    return fd;
+}
+
+int SocketTransport::accept(int listenFd, sockaddr_in *address)
+{
+    socklen_t length = sizeof(*address);
+    COUNT_SYSCALL();
+    int fd = ::accept(listenFd, reinterpret_cast<sockaddr *>(address), &length);
+    if (fd >= 0) {
+        COUNT_SYSCALL();
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+    }
+    return fd;
+}
+
+ssize_t SocketTransport::send(int fd, const void *data, size_t length)
+{
+    COUNT_SYSCALL();
+    return ::send(fd, data, length, MSG_DONTWAIT | MSG_NOSIGNAL);
+}
+
+ssize_t SocketTransport::recv(int fd, void *buffer, size_t length)
+{
+    COUNT_SYSCALL();
+    return ::recv(fd, buffer, length, 0);
+}
+
+void SocketTransport::close(int fd)
+{
+    COUNT_SYSCALL();
+    ::close(fd);
+}
+
+std::unique_ptr<EventLoop> SocketTransport::createEventLoop()
+{
+    return ::createEventLoop();
+}
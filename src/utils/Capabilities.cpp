@@ -0,0 +1,34 @@
+#include <Capabilities.hpp>
+
+static const struct
+{
+    Capability cap;
+    const char *name;
+} CAPABILITIES[] = {
+    {CAP_ACCOUNT_TAG, "account-tag"},   {CAP_BATCH, "batch"},
+    {CAP_RESUME, "draft/resume-0.5"},   {CAP_ECHO_MESSAGE, "echo-message"},
+    {CAP_MESSAGE_TAGS, "message-tags"}, {CAP_MULTI_PREFIX, "multi-prefix"},
+    {CAP_SERVER_TIME, "server-time"},
+};
+
+Capability capabilityFromName(const std::string &name)
+{
+    for (const auto &entry : CAPABILITIES) {
+        if (name == entry.name)
+            return entry.cap;
+    }
+    return CAP_NONE;
+}
+
+std::string capabilityNames(uint32_t caps)
+{
+    std::string names;
+    for (const auto &entry : CAPABILITIES) {
+        if (!(caps & entry.cap))
+            continue;
+        if (!names.empty())
+            names += " ";
+        names += entry.name;
+    }
+    return names;
+}
@@ -0,0 +1,30 @@
+#include <Clock.hpp>
+
+Clock *Clock::_installed = nullptr;
+
+Clock::TimePoint Clock::now()
+{
+    if (_installed != nullptr)
+        return _installed->current();
+    return std::chrono::steady_clock::now();
+}
+
+void Clock::install(Clock *clock)
+{
+    _installed = clock;
+}
+
+// starts where steady_clock is so nothing computed before the install sees time jump back
+VirtualClock::VirtualClock()
+    : _now(std::chrono::steady_clock::now())
+{}
+
+Clock::TimePoint VirtualClock::current() const
+{
+    return _now;
+}
+
+void VirtualClock::advance(std::chrono::nanoseconds by)
+{
+    _now += by;
+}
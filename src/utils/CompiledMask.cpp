@@ -0,0 +1,105 @@
+#include <CompiledMask.hpp>
+#include <Mask.hpp>
+#include <cctype>
+#include <cstring>
+
+CompiledMask::CompiledMask(const std::string &mask)
+    : _mask(mask)
+    , _pattern(casemap(mask))
+    , _hasWildcard(mask.find('*') != std::string::npos)
+    , _hasSingle(mask.find('?') != std::string::npos)
+{
+    size_t first = _pattern.find_first_of("*?");
+    size_t last = _pattern.find_last_of("*?");
+    if (first == std::string::npos) {
+        _prefix = _pattern;
+    }
+    else {
+        _prefix = _pattern.substr(0, first);
+        _suffix = _pattern.substr(last + 1);
+        // literal pieces between the first and the last '*', only used without '?'
+        size_t start = first + 1;
+        while (start < last + 1) {
+            size_t star = _pattern.find('*', start);
+            if (star > last)
+                star = last;
+            if (star > start)
+                _segments.push_back(_pattern.substr(start, star - start));
+            start = star + 1;
+        }
+    }
+    std::string tail = first == std::string::npos ? _pattern : _suffix;
+    size_t at = tail.rfind('@');
+    _hostSuffix = at == std::string::npos ? tail : tail.substr(at + 1);
+}
+
+std::string CompiledMask::normalize(const std::string &mask)
+{
+    size_t bang = mask.find('!');
+    size_t at = mask.find('@');
+    if (bang != std::string::npos && at != std::string::npos)
+        return mask;
+    if (bang != std::string::npos)
+        return mask + "@*";
+    if (at != std::string::npos)
+        return "*!" + mask;
+    return mask + "!*@*";
+}
+
+std::string CompiledMask::casemap(const std::string &text)
+{
+    std::string mapped = text;
+    for (char &c : mapped) {
+        c = tolower(static_cast<unsigned char>(c));
+    }
+    return mapped;
+}
+
+bool CompiledMask::findSegment(const std::string &subject, size_t &from, size_t end,
+                               const std::string &segment)
+{
+    const char *data = subject.data();
+    while (from + segment.size() <= end) {
+        const void *hit = memchr(data + from, segment[0], end - from - segment.size() + 1);
+        if (hit == nullptr)
+            return false;
+        size_t pos = static_cast<const char *>(hit) - data;
+        if (memcmp(data + pos, segment.data(), segment.size()) == 0) {
+            from = pos + segment.size();
+            return true;
+        }
+        from = pos + 1;
+    }
+    return false;
+}
+
+bool CompiledMask::matches(const std::string &subject) const
+{
+    if (!_hasWildcard && !_hasSingle)
+        return subject == _pattern;
+    if (subject.size() < _prefix.size() + _suffix.size())
+        return false;
+    if (subject.compare(0, _prefix.size(), _prefix) != 0 ||
+        subject.compare(subject.size() - _suffix.size(), _suffix.size(), _suffix) != 0)
+        return false;
+    if (_hasSingle)
+        return matchMask(_pattern, subject);
+    // greedy leftmost placement of each piece is enough when '*' is the only wildcard
+    size_t from = _prefix.size();
+    size_t end = subject.size() - _suffix.size();
+    for (const std::string &segment : _segments) {
+        if (!findSegment(subject, from, end, segment))
+            return false;
+    }
+    return true;
+}
+
+const std::string &CompiledMask::getMask() const
+{
+    return _mask;
+}
+
+const std::string &CompiledMask::getHostSuffix() const
+{
+    return _hostSuffix;
+}
@@ -0,0 +1,193 @@
+#include <CostAccounting.hpp>
+#include <cstdlib>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <new>
+#include <sstream>
+
+namespace
+{
+// running totals of the calling thread, plain data so operator new can touch them safely
+struct ThreadCounts
+{
+    uint64_t allocations;
+    uint64_t allocatedBytes;
+    uint64_t syscalls;
+};
+
+thread_local ThreadCounts counts = {0, 0, 0};
+
+std::mutex &costsMutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+std::map<std::string, CommandCost> &costs()
+{
+    static std::map<std::string, CommandCost> costs;
+    return costs;
+}
+} // namespace
+
+#ifdef FT_IRC_ACCOUNTING
+// the nothrow forms end up in these in libstdc++, over-aligned types (Tracer, the Metrics
+// shards) come through the align_val_t overloads below
+void *operator new(size_t size)
+{
+    CostAccounting::allocation(size);
+    if (void *memory = std::malloc(size == 0 ? 1 : size))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+    return ::operator new(size);
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory, size_t) noexcept
+{
+    std::free(memory);
+}
+
+// aligned_alloc wants the size rounded up to the alignment
+void *operator new(size_t size, std::align_val_t alignment)
+{
+    CostAccounting::allocation(size);
+    size_t align = static_cast<size_t>(alignment);
+    size_t rounded = (size + align - 1) / align * align;
+    if (void *memory = std::aligned_alloc(align, rounded == 0 ? align : rounded))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size, std::align_val_t alignment)
+{
+    return ::operator new(size, alignment);
+}
+
+void operator delete(void *memory, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, size_t, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory, size_t, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+#endif
+
+static double perCall(uint64_t total, uint64_t invocations)
+{
+    return invocations == 0 ? 0 : static_cast<double>(total) / invocations;
+}
+
+double CommandCost::allocationsPerCall() const
+{
+    return perCall(allocations, invocations);
+}
+
+double CommandCost::bytesPerCall() const
+{
+    return perCall(allocatedBytes, invocations);
+}
+
+double CommandCost::syscallsPerCall() const
+{
+    return perCall(syscalls, invocations);
+}
+
+CostAccounting::Scope::Scope(const std::string &command)
+    : _command(command)
+    , _allocations(counts.allocations)
+    , _allocatedBytes(counts.allocatedBytes)
+    , _syscalls(counts.syscalls)
+{}
+
+// the deltas are taken before the map is touched, its own allocations are not charged
+CostAccounting::Scope::~Scope()
+{
+    uint64_t allocations = counts.allocations - _allocations;
+    uint64_t allocatedBytes = counts.allocatedBytes - _allocatedBytes;
+    uint64_t syscalls = counts.syscalls - _syscalls;
+    std::lock_guard<std::mutex> lock(costsMutex());
+    CommandCost &cost = costs()[_command];
+    cost.invocations++;
+    cost.allocations += allocations;
+    cost.allocatedBytes += allocatedBytes;
+    cost.syscalls += syscalls;
+}
+
+bool CostAccounting::enabled()
+{
+#ifdef FT_IRC_ACCOUNTING
+    return true;
+#else
+    return false;
+#endif
+}
+
+void CostAccounting::allocation(size_t bytes)
+{
+    counts.allocations++;
+    counts.allocatedBytes += bytes;
+}
+
+void CostAccounting::syscall()
+{
+    counts.syscalls++;
+}
+
+CommandCost CostAccounting::costOf(const std::string &command)
+{
+    std::lock_guard<std::mutex> lock(costsMutex());
+    auto it = costs().find(command);
+    return it == costs().end() ? CommandCost() : it->second;
+}
+
+std::vector<std::string> CostAccounting::report()
+{
+    std::lock_guard<std::mutex> lock(costsMutex());
+    std::vector<std::string> lines;
+    for (const auto &[command, cost] : costs()) {
+        std::ostringstream line;
+        line << command << " calls " << cost.invocations << std::fixed << std::setprecision(1)
+             << " allocs/call " << cost.allocationsPerCall() << " bytes/call "
+             << cost.bytesPerCall() << " syscalls/call " << cost.syscallsPerCall();
+        lines.push_back(line.str());
+    }
+    return lines;
+}
+
+void CostAccounting::reset()
+{
+    std::lock_guard<std::mutex> lock(costsMutex());
+    costs().clear();
+}
@@ -0,0 +1,14 @@
+#include <Descriptors.hpp>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+void closeDescriptorsFrom(int lowest)
+{
+#ifdef SYS_close_range
+    if (syscall(SYS_close_range, lowest, ~0U, 0) == 0)
+        return;
+#endif
+    for (long fd = lowest; fd < sysconf(_SC_OPEN_MAX); fd++) {
+        close(fd);
+    }
+}
@@ -10,7 +10,7 @@
 bool IRCValidator::isValidNickname(int clientFd, const std::string &oldNickname,
                                    const std::string &newNickname)
 {
-    std::regex nicknamePattern(R"(^[a-zA-Z\[\]\\`_^{|}][a-zA-Z0-9\[\]\\`_^{|}-]*$)");
+    static const std::regex nicknamePattern(R"(^[a-zA-Z\[\]\\`_^{|}][a-zA-Z0-9\[\]\\`_^{|}-]*$)");
     if (newNickname.length() > NICKLEN || !std::regex_match(newNickname, nicknamePattern)) {
         sendToClient(clientFd, ERR_ERRONEUSNICKNAME(oldNickname, newNickname));
         return false;
@@ -24,7 +24,7 @@ bool IRCValidator::isValidNickname(int clientFd, const std::string &oldNickname,
 
 bool IRCValidator::isValidChannelName(int clientFd, const std::string &channelName)
 {
-    std::regex channelNamePattern(R"(^[#&][^\x00\x07\x0A\x0D ,:]{1,49}$)");
+    static const std::regex channelNamePattern(R"(^[#&][^\x00\x07\x0A\x0D ,:]{1,49}$)");
     if (!std::regex_match(channelName, channelNamePattern)) {
         sendToClient(clientFd, ERR_BADCHANMASK(channelName));
         return false;
@@ -34,7 +34,7 @@ bool IRCValidator::isValidChannelName(int clientFd, const std::string &channelNa
 
 bool IRCValidator::isValidTopic(int clientFd, const std::string &nickname, std::string &text)
 {
-    std::regex printablePattern("[[:print:]]*");
+    static const std::regex printablePattern("[[:print:]]*");
     if (text.length() > TOPICLEN)
         text = text.substr(0, TOPICLEN);
     if (!std::regex_match(text, printablePattern)) {
@@ -49,7 +49,7 @@ bool IRCValidator::isValidUsername(int clientFd, const std::string &nickname, st
     if (username.length() > USERLEN) {
         username = username.substr(0, USERLEN);
     }
-    std::regex usernamePattern(R"(^[a-zA-Z0-9_-]+$)");
+    static const std::regex usernamePattern(R"(^[a-zA-Z0-9_-]+$)");
     if (!std::regex_match(username, usernamePattern)) {
         sendToClient(clientFd, ERR_INVALIDUSERNAME(nickname, username));
         return false;
@@ -60,7 +60,7 @@ bool IRCValidator::isValidUsername(int clientFd, const std::string &nickname, st
 bool IRCValidator::isValidRealname(int clientFd, const std::string &nickname,
                                    const std::string &realname)
 {
-    std::regex realnamePattern(R"(^[^\r\n\0]+$)");
+    static const std::regex realnamePattern(R"(^[^\r\n\0]+$)");
     if (realname.length() > REALLEN || !std::regex_match(realname, realnamePattern)) {
         sendToClient(clientFd, ERR_INVALIDREALNAME(nickname, realname));
         return false;
@@ -90,7 +90,7 @@ bool IRCValidator::isValidServerPassword(const std::string &password)
     if (password.length() < MIN_PASS || password.length() > MAX_PASS) {
         return false;
     }
-    std::regex passwordPattern(R"(^[a-zA-Z0-9!@#$%^&*()\-_=+\[\]{}|;:'",.<>?/]+$)");
+    static const std::regex passwordPattern(R"(^[a-zA-Z0-9!@#$%^&*()\-_=+\[\]{}|;:'",.<>?/]+$)");
     if (!std::regex_match(password, passwordPattern)) {
         return false;
     }
@@ -100,7 +100,7 @@ bool IRCValidator::isValidServerPassword(const std::string &password)
 bool IRCValidator::isValidChannelKey(int clientFd, const std::string &nickname,
                                      const std::string &key)
 {
-    std::regex keyPattern(R"(^[a-zA-Z0-9!@#$%^&*()\-_=+\[\]{}|;:'",.<>?/]+$)");
+    static const std::regex keyPattern(R"(^[a-zA-Z0-9!@#$%^&*()\-_=+\[\]{}|;:'",.<>?/]+$)");
     if (!std::regex_match(key, keyPattern)) {
         sendToClient(clientFd, ERR_INVALIDKEY(nickname, key));
         return false;
@@ -110,7 +110,7 @@ bool IRCValidator::isValidChannelKey(int clientFd, const std::string &nickname,
 
 bool IRCValidator::isValidChannelLimit(const std::string &limit)
 {
-    std::regex digitPattern(R"(^\d+$)");
+    static const std::regex digitPattern(R"(^\d+$)");
     if (!std::regex_match(limit, digitPattern)) {
         return false;
     }
@@ -146,7 +146,7 @@ bool IRCValidator::isValidTarget(const std::unordered_multimap<WhichType, std::s
 bool IRCValidator::isValidText(int clientFd, const std::string &nickname,
                                const std::string &message)
 {
-    std::regex printablePattern("([^\007\r]*)");
+    static const std::regex printablePattern("([^\007\r]*)");
     if (message.empty()) {
         sendToClient(clientFd, ERR_NOTEXTTOSEND(nickname));
         return false;
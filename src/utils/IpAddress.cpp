@@ -0,0 +1,129 @@
+#include <IpAddress.hpp>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <algorithm>
+
+static const uint64_t IPV4_MAPPED = 0xffff00000000ULL;
+static const unsigned IPV4_MAPPED_BITS = 96;
+
+static uint64_t readBigEndian64(const uint8_t *bytes)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+bool IpAddress::fromSockaddr(const sockaddr *addr, IpAddress &out)
+{
+    if (addr->sa_family == AF_INET) {
+        const sockaddr_in *v4 = reinterpret_cast<const sockaddr_in *>(addr);
+        out.high = 0;
+        out.low = IPV4_MAPPED | ntohl(v4->sin_addr.s_addr);
+        return true;
+    }
+    if (addr->sa_family == AF_INET6) {
+        const sockaddr_in6 *v6 = reinterpret_cast<const sockaddr_in6 *>(addr);
+        out.high = readBigEndian64(v6->sin6_addr.s6_addr);
+        out.low = readBigEndian64(v6->sin6_addr.s6_addr + 8);
+        return true;
+    }
+    return false;
+}
+
+bool IpAddress::fromString(const std::string &text, IpAddress &out)
+{
+    sockaddr_in v4 = {};
+    if (inet_pton(AF_INET, text.c_str(), &v4.sin_addr) == 1) {
+        v4.sin_family = AF_INET;
+        return fromSockaddr(reinterpret_cast<const sockaddr *>(&v4), out);
+    }
+    sockaddr_in6 v6 = {};
+    if (inet_pton(AF_INET6, text.c_str(), &v6.sin6_addr) == 1) {
+        v6.sin6_family = AF_INET6;
+        return fromSockaddr(reinterpret_cast<const sockaddr *>(&v6), out);
+    }
+    return false;
+}
+
+bool IpAddress::parseCidr(const std::string &text, IpAddress &out, unsigned &prefixLength)
+{
+    size_t slash = text.find('/');
+    if (!fromString(text.substr(0, slash), out))
+        return false;
+    bool v4 = text.find(':') == std::string::npos;
+    unsigned maxLength = v4 ? 32 : 128;
+    prefixLength = maxLength;
+    if (slash != std::string::npos) {
+        std::string digits = text.substr(slash + 1);
+        if (digits.empty() || digits.size() > 3 ||
+            digits.find_first_not_of("0123456789") != std::string::npos)
+            return false;
+        prefixLength = std::stoul(digits);
+        if (prefixLength > maxLength)
+            return false;
+    }
+    if (v4)
+        prefixLength += IPV4_MAPPED_BITS;
+    out = out.masked(prefixLength);
+    return true;
+}
+
+bool IpAddress::isIPv4() const
+{
+    return high == 0 && (low >> 32) == (IPV4_MAPPED >> 32);
+}
+
+bool IpAddress::isLoopback() const
+{
+    if (isIPv4())
+        return ((low >> 24) & 0xff) == 127;
+    return high == 0 && low == 1;
+}
+
+bool IpAddress::bit(unsigned index) const
+{
+    if (index < 64)
+        return (high >> (63 - index)) & 1;
+    return (low >> (127 - index)) & 1;
+}
+
+IpAddress IpAddress::masked(unsigned length) const
+{
+    IpAddress result = *this;
+    if (length == 0) {
+        result.high = 0;
+        result.low = 0;
+    }
+    else if (length < 64) {
+        result.high &= ~0ULL << (64 - length);
+        result.low = 0;
+    }
+    else if (length == 64) {
+        result.low = 0;
+    }
+    else if (length < 128) {
+        result.low &= ~0ULL << (128 - length);
+    }
+    return result;
+}
+
+unsigned IpAddress::commonPrefix(const IpAddress &other, unsigned limit) const
+{
+    unsigned common;
+    uint64_t diff = high ^ other.high;
+    if (diff != 0) {
+        common = __builtin_clzll(diff);
+    }
+    else {
+        diff = low ^ other.low;
+        common = diff != 0 ? 64 + __builtin_clzll(diff) : 128;
+    }
+    return std::min(common, limit);
+}
+
+bool IpAddress::operator==(const IpAddress &other) const
+{
+    return high == other.high && low == other.low;
+}
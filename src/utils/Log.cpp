@@ -0,0 +1,35 @@
+#include <Log.hpp>
+#include <iostream>
+
+Log *Log::_installed = nullptr;
+
+std::ostream &Log::out()
+{
+    if (_installed != nullptr)
+        return _installed->stream();
+    return std::cout;
+}
+
+bool Log::isEnabled()
+{
+    return _installed == nullptr || _installed->enabled();
+}
+
+void Log::install(Log *log)
+{
+    _installed = log;
+}
+
+QuietLog::QuietLog()
+    : _discard(nullptr)
+{}
+
+std::ostream &QuietLog::stream()
+{
+    return _discard;
+}
+
+bool QuietLog::enabled() const
+{
+    return false;
+}
@@ -0,0 +1,151 @@
+#include <LoopProfiler.hpp>
+#include <common.hpp>
+#include <chrono>
+#include <thread>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+static const char *PHASE_NAMES[PHASE_COUNT] = {
+    "wait", "accept", "receive", "dispatch", "replies", "housekeeping", "ping", "disconnect",
+    "channels"
+};
+
+static uint64_t steadyNanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+uint64_t LoopProfiler::now()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return steadyNanoseconds();
+#endif
+}
+
+// the TSC rate is measured once against steady_clock, a few ms are enough for a profile
+LoopProfiler::LoopProfiler(uint64_t slowIterationUs)
+    : _ticksPerUs(1)
+    , _slowTicks(0)
+    , _last(0)
+    , _lastWarning(0)
+    , _current{}
+    , _window(LOOP_PROFILE_WINDOW)
+    , _next(0)
+    , _iterations(0)
+    , _slowIterations(0)
+{
+    uint64_t startTicks = now();
+    uint64_t startNs = steadyNanoseconds();
+    std::this_thread::sleep_for(std::chrono::milliseconds(LOOP_PROFILE_CALIBRATION_MS));
+    uint64_t elapsedNs = steadyNanoseconds() - startNs;
+    if (elapsedNs > 0)
+        _ticksPerUs = (now() - startTicks) * 1000.0 / elapsedNs;
+    _slowTicks = slowIterationUs * _ticksPerUs;
+    _last = now();
+}
+
+void LoopProfiler::beginIteration()
+{
+    _current.fill(0);
+    _last = now();
+}
+
+void LoopProfiler::mark(LoopPhase phase)
+{
+    uint64_t ticks = now();
+    _current[phase] += ticks - _last;
+    _last = ticks;
+}
+
+bool LoopProfiler::endIteration()
+{
+    _window[_next] = _current;
+    _next = (_next + 1) % _window.size();
+    _iterations++;
+    uint64_t busy = 0;
+    for (size_t phase = PHASE_ACCEPT; phase < PHASE_COUNT; phase++)
+        busy += _current[phase];
+    if (busy <= _slowTicks)
+        return false;
+    _slowIterations++;
+    warn(_current, busy);
+    return true;
+}
+
+// at most one warning a second, the rest only show in the counters
+void LoopProfiler::warn(const Sample &sample, uint64_t busy)
+{
+    if (_lastWarning != 0 && _last - _lastWarning < _ticksPerUs * 1000000)
+        return;
+    _lastWarning = _last;
+    std::ostringstream line;
+    line << "Slow loop iteration: " << micros(busy) << " busy (";
+    const char *separator = "";
+    for (size_t phase = PHASE_ACCEPT; phase < PHASE_COUNT; phase++) {
+        if (sample[phase] == 0)
+            continue;
+        line << separator << PHASE_NAMES[phase] << " " << micros(sample[phase]);
+        separator = ", ";
+    }
+    line << ")";
+    std::cerr << line.str() << std::endl;
+}
+
+uint64_t LoopProfiler::getIterations() const
+{
+    return _iterations;
+}
+
+uint64_t LoopProfiler::getSlowIterations() const
+{
+    return _slowIterations;
+}
+
+std::vector<std::string> LoopProfiler::report() const
+{
+    size_t samples = std::min<uint64_t>(_iterations, _window.size());
+    Sample total{};
+    Sample max{};
+    for (size_t i = 0; i < samples; i++) {
+        for (size_t phase = 0; phase < PHASE_COUNT; phase++) {
+            total[phase] += _window[i][phase];
+            max[phase] = std::max(max[phase], _window[i][phase]);
+        }
+    }
+    uint64_t all = 0;
+    for (uint64_t ticks : total)
+        all += ticks;
+
+    std::vector<std::string> lines;
+    lines.push_back("iterations " + std::to_string(_iterations) + " slow "
+        + std::to_string(_slowIterations) + ", last " + std::to_string(samples));
+    for (size_t phase = 0; phase < PHASE_COUNT; phase++) {
+        std::ostringstream line;
+        line << PHASE_NAMES[phase] << " mean " << micros(samples ? total[phase] / samples : 0)
+             << " max " << micros(max[phase]) << " share " << std::fixed
+             << std::setprecision(1) << (all ? 100.0 * total[phase] / all : 0) << "%";
+        lines.push_back(line.str());
+    }
+    return lines;
+}
+
+const char *LoopProfiler::phaseName(LoopPhase phase)
+{
+    return PHASE_NAMES[phase];
+}
+
+std::string LoopProfiler::micros(uint64_t ticks) const
+{
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1) << ticks / _ticksPerUs << "us";
+    return out.str();
+}
@@ -0,0 +1,50 @@
+#include <MappedFile.hpp>
+#include <Error.hpp>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+MappedFile::MappedFile(const std::string &path)
+    : _address(nullptr)
+    , _size(0)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT)
+            return;
+        throw ServerError("Cannot open " + path + ": " + strerror(errno));
+    }
+    struct stat info;
+    void *address = nullptr;
+    if (fstat(fd, &info) == 0 && info.st_size > 0)
+        address = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    int error = errno;
+    close(fd);
+    if (address == MAP_FAILED)
+        throw ServerError("Cannot map " + path + ": " + strerror(error));
+    if (address != nullptr) {
+        _address = address;
+        _size = info.st_size;
+        // replay reads it front to back once
+        madvise(_address, _size, MADV_SEQUENTIAL);
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (_address != nullptr)
+        munmap(_address, _size);
+}
+
+const char *MappedFile::data() const
+{
+    return static_cast<const char *>(_address);
+}
+
+size_t MappedFile::size() const
+{
+    return _size;
+}
@@ -0,0 +1,41 @@
+#include <Mask.hpp>
+#include <cctype>
+
+// iterative matcher, backtracks only to the last '*' so it stays linear on typical masks.
+// Wildcards are only read from the mask, a '*' or '?' in the text is an ordinary character
+bool matchMask(const std::string &mask, const std::string &text)
+{
+    size_t m = 0;
+    size_t t = 0;
+    size_t star = std::string::npos;
+    size_t resume = 0;
+
+    while (t < text.size()) {
+        if (m < mask.size() && mask[m] == '*') {
+            star = m++;
+            resume = t;
+        }
+        else if (m < mask.size() &&
+                 (mask[m] == '?' || tolower(static_cast<unsigned char>(mask[m])) ==
+                                        tolower(static_cast<unsigned char>(text[t])))) {
+            m++;
+            t++;
+        }
+        else if (star != std::string::npos) {
+            m = star + 1;
+            t = ++resume;
+        }
+        else {
+            return false;
+        }
+    }
+    while (m < mask.size() && mask[m] == '*') {
+        m++;
+    }
+    return m == mask.size();
+}
+
+bool isMask(const std::string &text)
+{
+    return text.find_first_of("*?") != std::string::npos;
+}
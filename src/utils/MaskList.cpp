@@ -0,0 +1,88 @@
+#include <MaskList.hpp>
+#include <StateImage.hpp>
+
+// bucket key length, longer keys split the buckets finer but cost a lookup each
+static const size_t SUFFIX_KEY_LENGTH = 4;
+
+std::string MaskList::suffixKey(const std::string &hostSuffix)
+{
+    if (hostSuffix.size() <= SUFFIX_KEY_LENGTH)
+        return hostSuffix;
+    return hostSuffix.substr(hostSuffix.size() - SUFFIX_KEY_LENGTH);
+}
+
+bool MaskList::add(const std::string &mask, const std::string &setBy, time_t setAt)
+{
+    std::string key = CompiledMask::casemap(mask);
+    if (_byMask.find(key) != _byMask.end())
+        return false;
+    _entries.push_back({CompiledMask(mask), setBy, setAt});
+    auto entry = std::prev(_entries.end());
+    _byMask.emplace(key, entry);
+    _byHostSuffix.emplace(suffixKey(entry->mask.getHostSuffix()), &*entry);
+    return true;
+}
+
+bool MaskList::remove(const std::string &mask)
+{
+    auto it = _byMask.find(CompiledMask::casemap(mask));
+    if (it == _byMask.end())
+        return false;
+    auto bucket = _byHostSuffix.equal_range(suffixKey(it->second->mask.getHostSuffix()));
+    for (auto entry = bucket.first; entry != bucket.second; ++entry) {
+        if (entry->second == &*it->second) {
+            _byHostSuffix.erase(entry);
+            break;
+        }
+    }
+    _entries.erase(it->second);
+    _byMask.erase(it);
+    return true;
+}
+
+// a matching mask's host suffix ends the subject's host, so its key is one of the host's
+// last 0..SUFFIX_KEY_LENGTH characters
+bool MaskList::matches(const std::string &subject) const
+{
+    if (_entries.empty())
+        return false;
+    size_t at = subject.rfind('@');
+    std::string host = at == std::string::npos ? subject : subject.substr(at + 1);
+    for (size_t length = 0; length <= SUFFIX_KEY_LENGTH && length <= host.size(); length++) {
+        auto bucket = _byHostSuffix.equal_range(host.substr(host.size() - length));
+        for (auto entry = bucket.first; entry != bucket.second; ++entry) {
+            if (entry->second->mask.matches(subject))
+                return true;
+        }
+    }
+    return false;
+}
+
+const std::list<MaskList::Entry> &MaskList::getEntries() const
+{
+    return _entries;
+}
+
+size_t MaskList::size() const
+{
+    return _entries.size();
+}
+
+void MaskList::save(ImageWriter &image) const
+{
+    image.u32(static_cast<uint32_t>(_entries.size()));
+    for (const Entry &entry : _entries) {
+        image.str(entry.mask.getMask());
+        image.str(entry.setBy);
+        image.i64(entry.setAt);
+    }
+}
+
+void MaskList::load(ImageReader &image)
+{
+    for (uint32_t count = image.u32(); count > 0; --count) {
+        std::string mask = image.str();
+        std::string setBy = image.str();
+        add(mask, setBy, static_cast<time_t>(image.i64()));
+    }
+}
@@ -0,0 +1,240 @@
+#include <Metrics.hpp>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <tuple>
+
+namespace
+{
+    std::atomic<size_t> nextShard{0};
+
+    // command latency buckets, in ns, exposed in seconds
+    const uint64_t LATENCY_BOUNDS[] = {10000, 50000, 100000, 500000, 1000000, 5000000,
+                                       10000000, 50000000, 100000000, 500000000, 1000000000};
+    const uint64_t FANOUT_BOUNDS[] = {1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000};
+
+    std::string number(double value)
+    {
+        std::ostringstream out;
+        out << std::setprecision(12) << value;
+        return out.str();
+    }
+
+    void header(std::ostringstream &out, const std::string &name, const std::string &help,
+                const std::string &type)
+    {
+        out << "# HELP " << name << " " << help << "\n";
+        out << "# TYPE " << name << " " << type << "\n";
+    }
+
+    void counter(std::ostringstream &out, const std::string &name, const std::string &help,
+                 const Counter &value)
+    {
+        header(out, name, help, "counter");
+        out << name << " " << value.value() << "\n";
+    }
+
+    template <size_t N>
+    void buckets(std::ostringstream &out, const std::string &name, const std::string &labels,
+                 const Histogram::Snapshot &snapshot, const uint64_t (&bounds)[N], double scale)
+    {
+        std::string prefix = labels.empty() ? "{" : "{" + labels + ",";
+        for (uint64_t bound : bounds) {
+            out << name << "_bucket" << prefix << "le=\"" << number(bound * scale) << "\"} "
+                << snapshot.countAtMost(bound) << "\n";
+        }
+        out << name << "_bucket" << prefix << "le=\"+Inf\"} " << snapshot.count << "\n";
+        std::string suffix = labels.empty() ? "" : "{" + labels + "}";
+        out << name << "_sum" << suffix << " " << number(snapshot.sum * scale) << "\n";
+        out << name << "_count" << suffix << " " << snapshot.count << "\n";
+    }
+
+    std::string micros(uint64_t nanoseconds)
+    {
+        return std::to_string((nanoseconds + 500) / 1000) + "us";
+    }
+}
+
+void Counter::add(uint64_t amount)
+{
+    _value.fetch_add(amount, std::memory_order_relaxed);
+}
+
+uint64_t Counter::value() const
+{
+    return _value.load(std::memory_order_relaxed);
+}
+
+size_t Histogram::bucketOf(uint64_t value)
+{
+    if (value < 16)
+        return value;
+    int shift = 63 - __builtin_clzll(value) - 3;
+    return 16 + (shift - 1) * 8 + ((value >> shift) - 8);
+}
+
+uint64_t Histogram::upperBound(size_t bucket)
+{
+    if (bucket < 16)
+        return bucket;
+    size_t shift = (bucket - 16) / 8 + 1;
+    uint64_t mantissa = (bucket - 16) % 8 + 8;
+    if (mantissa == 15 && shift == 60)
+        return UINT64_MAX;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+size_t Histogram::shardIndex()
+{
+    thread_local size_t index = nextShard.fetch_add(1, std::memory_order_relaxed) % SHARDS;
+    return index;
+}
+
+void Histogram::record(uint64_t value)
+{
+    Shard &shard = _shards[shardIndex()];
+    shard.counts[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(value, std::memory_order_relaxed);
+    uint64_t max = shard.max.load(std::memory_order_relaxed);
+    while (value > max &&
+           !shard.max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+}
+
+Histogram::Snapshot Histogram::snapshot() const
+{
+    Snapshot result;
+    for (const Shard &shard : _shards) {
+        for (size_t i = 0; i < BUCKETS; i++) {
+            uint64_t count = shard.counts[i].load(std::memory_order_relaxed);
+            result.counts[i] += count;
+            result.count += count;
+        }
+        result.sum += shard.sum.load(std::memory_order_relaxed);
+        result.max = std::max(result.max, shard.max.load(std::memory_order_relaxed));
+    }
+    return result;
+}
+
+uint64_t Histogram::Snapshot::percentile(double q) const
+{
+    if (count == 0)
+        return 0;
+    uint64_t rank = static_cast<uint64_t>(q * count);
+    if (rank >= count)
+        rank = count - 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; i++) {
+        seen += counts[i];
+        if (seen > rank)
+            return std::min(upperBound(i), max);
+    }
+    return max;
+}
+
+uint64_t Histogram::Snapshot::countAtMost(uint64_t limit) const
+{
+    uint64_t total = 0;
+    for (size_t i = 0; i < BUCKETS && upperBound(i) <= limit; i++) {
+        total += counts[i];
+    }
+    return total;
+}
+
+void Metrics::registerCommand(const std::string &command)
+{
+    _commands.emplace(std::piecewise_construct, std::forward_as_tuple(command),
+                      std::forward_as_tuple());
+}
+
+void Metrics::recordCommand(const std::string &command, uint64_t nanoseconds)
+{
+    auto it = _commands.find(command);
+    if (it != _commands.end())
+        it->second.record(nanoseconds);
+}
+
+uint64_t Metrics::commandCount(const std::string &command) const
+{
+    auto it = _commands.find(command);
+    return it == _commands.end() ? 0 : it->second.snapshot().count;
+}
+
+std::vector<std::pair<std::string, Histogram::Snapshot>> Metrics::commands() const
+{
+    std::vector<std::pair<std::string, Histogram::Snapshot>> result;
+    for (const auto &command : _commands) {
+        result.emplace_back(command.first, command.second.snapshot());
+    }
+    return result;
+}
+
+std::string Metrics::render(const std::vector<Gauge> &gauges) const
+{
+    std::ostringstream out;
+    counter(out, "ft_irc_connections_accepted_total", "Connections admitted.",
+            connectionsAccepted);
+    counter(out, "ft_irc_connections_rejected_total", "Connections refused by the throttle.",
+            connectionsRejected);
+    counter(out, "ft_irc_registrations_total", "Clients that completed registration.",
+            registrations);
+    counter(out, "ft_irc_received_bytes_total", "Bytes read from clients.", bytesIn);
+    counter(out, "ft_irc_sent_bytes_total", "Bytes written to clients.", bytesOut);
+    counter(out, "ft_irc_received_lines_total", "Lines received from clients.", linesIn);
+    counter(out, "ft_irc_sent_lines_total", "Lines queued to clients.", linesOut);
+    for (const Gauge &gauge : gauges) {
+        header(out, "ft_irc_" + gauge.name, gauge.help, "gauge");
+        out << "ft_irc_" << gauge.name << " " << number(gauge.value) << "\n";
+    }
+
+    std::vector<std::pair<std::string, Histogram::Snapshot>> snapshots = commands();
+    header(out, "ft_irc_commands_total", "Commands handled, by command.", "counter");
+    for (const auto &command : snapshots) {
+        out << "ft_irc_commands_total{command=\"" << command.first << "\"} "
+            << command.second.count << "\n";
+    }
+    header(out, "ft_irc_command_duration_seconds", "Time spent handling one command.",
+           "histogram");
+    for (const auto &command : snapshots) {
+        buckets(out, "ft_irc_command_duration_seconds", "command=\"" + command.first + "\"",
+                command.second, LATENCY_BOUNDS, 1e-9);
+    }
+
+    header(out, "ft_irc_broadcast_recipients", "Recipients of one broadcast.", "histogram");
+    buckets(out, "ft_irc_broadcast_recipients", "", fanout.snapshot(), FANOUT_BOUNDS, 1);
+    return out.str();
+}
+
+std::vector<std::string> Metrics::summary(const std::vector<Gauge> &gauges) const
+{
+    std::vector<std::string> lines;
+    lines.push_back("connections accepted " + std::to_string(connectionsAccepted.value()) +
+                    " rejected " + std::to_string(connectionsRejected.value()) +
+                    " registrations " + std::to_string(registrations.value()));
+    lines.push_back("received " + std::to_string(linesIn.value()) + " lines " +
+                    std::to_string(bytesIn.value()) + " bytes, sent " +
+                    std::to_string(linesOut.value()) + " lines " +
+                    std::to_string(bytesOut.value()) + " bytes");
+    for (const Gauge &gauge : gauges) {
+        lines.push_back(gauge.name + " " + number(gauge.value));
+    }
+    Histogram::Snapshot fan = fanout.snapshot();
+    lines.push_back("broadcasts " + std::to_string(fan.count) + " recipients p50 " +
+                    std::to_string(fan.percentile(0.5)) + " p99 " +
+                    std::to_string(fan.percentile(0.99)) + " max " + std::to_string(fan.max));
+    for (const auto &command : commands()) {
+        const Histogram::Snapshot &latency = command.second;
+        if (latency.count == 0)
+            continue;
+        lines.push_back(command.first + " " + std::to_string(latency.count) + " p50 " +
+                        micros(latency.percentile(0.5)) + " p99 " +
+                        micros(latency.percentile(0.99)) + " max " + micros(latency.max));
+    }
+    return lines;
+}
+
+Metrics &metrics()
+{
+    static Metrics instance;
+    return instance;
+}
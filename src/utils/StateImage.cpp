@@ -0,0 +1,102 @@
+#include <StateImage.hpp>
+#include <Error.hpp>
+
+void ImageWriter::u8(uint8_t value)
+{
+    _data.push_back(static_cast<char>(value));
+}
+
+void ImageWriter::u32(uint32_t value)
+{
+    for (int shift = 0; shift < 32; shift += 8) {
+        _data.push_back(static_cast<char>((value >> shift) & 0xff));
+    }
+}
+
+void ImageWriter::u64(uint64_t value)
+{
+    for (int shift = 0; shift < 64; shift += 8) {
+        _data.push_back(static_cast<char>((value >> shift) & 0xff));
+    }
+}
+
+void ImageWriter::i64(int64_t value)
+{
+    u64(static_cast<uint64_t>(value));
+}
+
+void ImageWriter::str(const std::string &value)
+{
+    u32(static_cast<uint32_t>(value.size()));
+    _data.append(value);
+}
+
+const std::string &ImageWriter::data() const
+{
+    return _data;
+}
+
+void ImageWriter::clear()
+{
+    _data.clear();
+}
+
+ImageReader::ImageReader(const std::string &data)
+    : ImageReader(data.data(), data.size())
+{}
+
+ImageReader::ImageReader(const char *data, size_t size)
+    : _data(data)
+    , _size(size)
+    , _offset(0)
+{}
+
+const char *ImageReader::take(size_t length)
+{
+    if (length > _size - _offset)
+        throw ServerError("State image truncated at byte " + std::to_string(_offset));
+    const char *bytes = _data + _offset;
+    _offset += length;
+    return bytes;
+}
+
+uint8_t ImageReader::u8()
+{
+    return static_cast<uint8_t>(*take(1));
+}
+
+uint32_t ImageReader::u32()
+{
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(take(4));
+    uint32_t value = 0;
+    for (int i = 3; i >= 0; --i) {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+uint64_t ImageReader::u64()
+{
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(take(8));
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; --i) {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+int64_t ImageReader::i64()
+{
+    return static_cast<int64_t>(u64());
+}
+
+std::string ImageReader::str()
+{
+    uint32_t length = u32();
+    return std::string(take(length), length);
+}
+
+bool ImageReader::atEnd() const
+{
+    return _offset == _size;
+}
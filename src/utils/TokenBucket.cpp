@@ -0,0 +1,43 @@
+#include <TokenBucket.hpp>
+#include <Clock.hpp>
+#include <algorithm>
+#include <cmath>
+
+TokenBucket::TokenBucket(double capacity, double ratePerSec)
+    : _capacity(capacity)
+    , _ratePerSec(ratePerSec)
+    , _tokens(capacity)
+    , _lastRefill(Clock::now())
+{}
+
+void TokenBucket::configure(double capacity, double ratePerSec)
+{
+    _capacity = capacity;
+    _ratePerSec = ratePerSec;
+    _tokens = std::min(_tokens, capacity);
+}
+
+void TokenBucket::refill()
+{
+    auto now = Clock::now();
+    double elapsed = std::chrono::duration<double>(now - _lastRefill).count();
+    _tokens = std::min(_capacity, _tokens + elapsed * _ratePerSec);
+    _lastRefill = now;
+}
+
+bool TokenBucket::take(double cost)
+{
+    refill();
+    if (_tokens < cost)
+        return false;
+    _tokens -= cost;
+    return true;
+}
+
+int TokenBucket::msUntilAvailable(double cost)
+{
+    refill();
+    if (_tokens >= cost || _ratePerSec <= 0)
+        return 0;
+    return static_cast<int>(std::ceil((cost - _tokens) / _ratePerSec * 1000));
+}
@@ -0,0 +1,222 @@
+#include <Tracer.hpp>
+#include <Clock.hpp>
+#include <Error.hpp>
+#include <common.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
+
+Tracer::Tracer(const std::string &path, double rate)
+    : _rate(rate)
+    , _random(std::random_device()())
+    , _uniform(0, 1)
+    , _nextId(0)
+    , _active(false)
+    , _current()
+    , _ring(TRACE_RING_SIZE)
+    , _head(0)
+    , _tail(0)
+    , _dropped(0)
+    , _fd(open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644))
+    , _firstEvent(true)
+    , _stopping(false)
+{
+    if (_fd < 0)
+        throw ServerError("Cannot open " + path + ": " + strerror(errno));
+    // the array format, viewers accept it without the closing bracket while the server runs
+    write("[\n");
+    _exporter = std::thread(&Tracer::exportLoop, this);
+}
+
+Tracer::~Tracer()
+{
+    {
+        std::lock_guard<std::mutex> lock(_wakeMutex);
+        _stopping = true;
+    }
+    _wake.notify_one();
+    _exporter.join();
+    drain();
+    write("\n]\n");
+    close(_fd);
+    if (_dropped > 0)
+        std::cerr << "Tracer dropped " << _dropped << " traces, the ring was full" << std::endl;
+}
+
+int64_t Tracer::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               Clock::now().time_since_epoch())
+        .count();
+}
+
+// lines are numbered per connection as they arrive, takeLine() counts them off the same way
+void Tracer::received(int fd, const std::string &buffer, size_t length)
+{
+    LineCounter &lines = _lines[fd];
+    int64_t at = 0;
+    for (size_t pos = buffer.size() - length; (pos = buffer.find('\n', pos)) != std::string::npos;
+         pos++) {
+        uint64_t line = lines.received++;
+        if (_rate <= 0 || _uniform(_random) >= _rate)
+            continue;
+        if (at == 0)
+            at = now();
+        lines.sampled.push_back({line, at});
+    }
+}
+
+bool Tracer::takeLine(int fd)
+{
+    auto it = _lines.find(fd);
+    if (it == _lines.end())
+        return false;
+    LineCounter &lines = it->second;
+    uint64_t line = lines.taken++;
+    if (lines.sampled.empty() || lines.sampled.front().line != line)
+        return false;
+    _current = Trace();
+    _current.id = _nextId++;
+    _current.fd = fd;
+    _current.receivedNs = lines.sampled.front().receivedNs;
+    _current.takenNs = now();
+    lines.sampled.pop_front();
+    _active = true;
+    return true;
+}
+
+void Tracer::executing(const std::string &command)
+{
+    if (!_active)
+        return;
+    _current.executingNs = now();
+    size_t length = std::min(command.size(), sizeof(_current.command) - 1);
+    memcpy(_current.command, command.data(), length);
+    _current.command[length] = '\0';
+}
+
+void Tracer::delivered(bool queued)
+{
+    if (!_active)
+        return;
+    int64_t at = now();
+    if (_current.recipients + _current.queued == 0)
+        _current.fanoutStartNs = at;
+    _current.fanoutEndNs = at;
+    if (queued)
+        _current.queued++;
+    else
+        _current.recipients++;
+}
+
+void Tracer::finishLine()
+{
+    if (!_active)
+        return;
+    _active = false;
+    _current.doneNs = now();
+    push(_current);
+}
+
+void Tracer::forget(int fd)
+{
+    _lines.erase(fd);
+}
+
+uint64_t Tracer::dropped() const
+{
+    return _dropped;
+}
+
+// never blocks the event loop, a full ring loses the trace
+void Tracer::push(const Trace &trace)
+{
+    uint64_t head = _head.load(std::memory_order_relaxed);
+    if (head - _tail.load(std::memory_order_acquire) == _ring.size()) {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    _ring[head % _ring.size()] = trace;
+    _head.store(head + 1, std::memory_order_release);
+}
+
+void Tracer::exportLoop()
+{
+    std::unique_lock<std::mutex> lock(_wakeMutex);
+    while (!_stopping) {
+        _wake.wait_for(lock, std::chrono::milliseconds(TRACE_EXPORT_MS));
+        lock.unlock();
+        drain();
+        lock.lock();
+    }
+}
+
+void Tracer::drain()
+{
+    std::string out;
+    uint64_t tail = _tail.load(std::memory_order_relaxed);
+    uint64_t head = _head.load(std::memory_order_acquire);
+    for (; tail != head; tail++) {
+        appendEvents(out, _ring[tail % _ring.size()]);
+        _tail.store(tail + 1, std::memory_order_release);
+    }
+    if (!out.empty())
+        write(out);
+}
+
+// one complete event for the whole line with its stages nested below, on the sender's row
+void Tracer::appendEvents(std::string &out, const Trace &trace)
+{
+    const char *name = trace.command[0] != '\0' ? trace.command : "line";
+    int64_t endNs = std::max(trace.doneNs, trace.fanoutEndNs);
+    std::ostringstream args;
+    args << "{\"id\":" << trace.id << ",\"recipients\":" << trace.recipients
+         << ",\"queued\":" << trace.queued;
+    if (trace.recipients + trace.queued > 0)
+        args << ",\"fanout_latency_us\":" << (trace.fanoutEndNs - trace.receivedNs) / 1000;
+    args << "}";
+    appendEvent(out, name, trace, trace.receivedNs, endNs, args.str());
+    appendEvent(out, "wait", trace, trace.receivedNs, trace.takenNs, "");
+    if (trace.executingNs == 0) {
+        appendEvent(out, "parse", trace, trace.takenNs, trace.doneNs, "");
+        return;
+    }
+    appendEvent(out, "parse", trace, trace.takenNs, trace.executingNs, "");
+    appendEvent(out, "execute", trace, trace.executingNs, trace.doneNs, "");
+    if (trace.recipients + trace.queued > 0)
+        appendEvent(out, "fanout", trace, trace.fanoutStartNs, trace.fanoutEndNs, "");
+}
+
+void Tracer::appendEvent(std::string &out, const char *name, const Trace &trace,
+                         int64_t startNs, int64_t endNs, const std::string &args)
+{
+    std::ostringstream event;
+    event << std::fixed << std::setprecision(3) << (_firstEvent ? "" : ",\n") << "{\"name\":\""
+          << name << "\",\"cat\":\"irc\",\"ph\":\"X\",\"ts\":" << startNs / 1000.0
+          << ",\"dur\":" << (endNs - startNs) / 1000.0 << ",\"pid\":1,\"tid\":" << trace.fd;
+    if (!args.empty())
+        event << ",\"args\":" << args;
+    event << "}";
+    out += event.str();
+    _firstEvent = false;
+}
+
+void Tracer::write(const std::string &data)
+{
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t result = ::write(_fd, data.data() + written, data.size() - written);
+        if (result < 0 && errno == EINTR)
+            continue;
+        if (result < 0) {
+            std::cerr << "Trace export failed: " << strerror(errno) << std::endl;
+            return;
+        }
+        written += result;
+    }
+}
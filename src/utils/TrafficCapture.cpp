@@ -0,0 +1,130 @@
+#include <TrafficCapture.hpp>
+#include <Error.hpp>
+#include <common.hpp>
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+static const std::string CAPTURE_MAGIC = "ft_irc-capture-1";
+
+TrafficCapture::TrafficCapture(const std::string &path)
+    : _path(path)
+    , _fd(open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600))
+    , _start(Clock::now())
+    , _oldest(_start)
+    , _nextConnection(0)
+{
+    if (_fd < 0)
+        throw ServerError("Cannot open " + path + ": " + strerror(errno));
+    _buffer.str(CAPTURE_MAGIC);
+    flush();
+}
+
+TrafficCapture::~TrafficCapture()
+{
+    flush();
+    if (_fd >= 0)
+        close(_fd);
+}
+
+void TrafficCapture::opened(int fd, const std::string &ip)
+{
+    uint32_t connection = _nextConnection++;
+    _connections[fd] = connection;
+    record(CaptureRecord::OPEN, connection, ip);
+}
+
+void TrafficCapture::received(int fd, const char *data, size_t length)
+{
+    auto it = _connections.find(fd);
+    if (it != _connections.end())
+        record(CaptureRecord::DATA, it->second, std::string(data, length));
+}
+
+// clients taken over from before the capture started were never opened, they are not closed
+void TrafficCapture::closed(int fd)
+{
+    auto it = _connections.find(fd);
+    if (it == _connections.end())
+        return;
+    record(CaptureRecord::CLOSE, it->second, "");
+    _connections.erase(it);
+}
+
+void TrafficCapture::record(CaptureRecord::Kind kind, uint32_t connection,
+                            const std::string &data)
+{
+    if (_fd < 0)
+        return;
+    Clock::TimePoint now = Clock::now();
+    if (_buffer.data().empty())
+        _oldest = now;
+    _buffer.u8(kind);
+    _buffer.u32(connection);
+    _buffer.u64(std::chrono::duration_cast<std::chrono::microseconds>(now - _start).count());
+    _buffer.str(data);
+    if (_buffer.data().size() >= CAPTURE_BUFFER_BYTES)
+        flush();
+    else
+        flushIfStale(now);
+}
+
+void TrafficCapture::flushIfStale(Clock::TimePoint now)
+{
+    if (!_buffer.data().empty() && now - _oldest >= std::chrono::milliseconds(CAPTURE_FLUSH_MS))
+        flush();
+}
+
+void TrafficCapture::flush()
+{
+    const std::string &data = _buffer.data();
+    size_t written = 0;
+    while (_fd >= 0 && written < data.size()) {
+        ssize_t result = write(_fd, data.data() + written, data.size() - written);
+        if (result < 0 && errno == EINTR)
+            continue;
+        if (result < 0) {
+            std::cerr << "Capture to " << _path << " stopped: " << strerror(errno) << std::endl;
+            close(_fd);
+            _fd = -1;
+            break;
+        }
+        written += result;
+    }
+    _buffer.clear();
+}
+
+CaptureReader::CaptureReader(const std::string &path)
+    : _file(path)
+    , _reader(_file.data(), _file.size())
+{
+    bool valid = false;
+    try {
+        valid = _reader.str() == CAPTURE_MAGIC;
+    }
+    catch (const ServerError &) {
+    }
+    if (!valid)
+        throw ServerError(path + " is missing or not an ft_irc capture");
+}
+
+bool CaptureReader::next(CaptureRecord &record)
+{
+    if (_reader.atEnd())
+        return false;
+    try {
+        uint8_t kind = _reader.u8();
+        if (kind > CaptureRecord::CLOSE)
+            return false;
+        record.kind = static_cast<CaptureRecord::Kind>(kind);
+        record.connection = _reader.u32();
+        record.atUs = _reader.u64();
+        record.data = _reader.str();
+    }
+    catch (const ServerError &) {
+        return false;
+    }
+    return true;
+}
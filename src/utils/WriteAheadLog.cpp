@@ -0,0 +1,206 @@
+#include <WriteAheadLog.hpp>
+#include <StateImage.hpp>
+#include <MappedFile.hpp>
+#include <Error.hpp>
+#include <algorithm>
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// length and checksum in front of every record
+static const size_t FRAME_HEADER = 8;
+
+// makes a newly created segment's directory entry durable
+static void syncDirectory(const std::string &directory)
+{
+    int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+    fsync(fd);
+    close(fd);
+}
+
+WriteAheadLog::WriteAheadLog(const std::string &directory, const std::string &name)
+    : _directory(directory)
+    , _name(name)
+    , _generation(0)
+    , _appended(0)
+    , _committed(0)
+    , _stopping(false)
+    , _fd(-1)
+    , _fdGeneration(0)
+{}
+
+WriteAheadLog::~WriteAheadLog()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _wake.notify_one();
+    if (_writer.joinable())
+        _writer.join();
+    if (_fd >= 0)
+        close(_fd);
+}
+
+std::string WriteAheadLog::segmentPath(uint64_t generation) const
+{
+    return _directory + "/" + _name + "." + std::to_string(generation);
+}
+
+std::vector<uint64_t> WriteAheadLog::segments() const
+{
+    std::vector<uint64_t> generations;
+    DIR *directory = opendir(_directory.c_str());
+    if (directory == nullptr)
+        throw ServerError("Cannot read " + _directory + ": " + strerror(errno));
+    std::string prefix = _name + ".";
+    while (dirent *entry = readdir(directory)) {
+        std::string file = entry->d_name;
+        if (file.size() <= prefix.size() || file.compare(0, prefix.size(), prefix) != 0)
+            continue;
+        std::string number = file.substr(prefix.size());
+        if (number.find_first_not_of("0123456789") == std::string::npos)
+            generations.push_back(std::stoull(number));
+    }
+    closedir(directory);
+    std::sort(generations.begin(), generations.end());
+    return generations;
+}
+
+// FNV-1a, enough to tell a torn or half-written record from a whole one
+uint32_t WriteAheadLog::checksum(const char *data, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ static_cast<unsigned char>(data[i])) * 16777619u;
+    }
+    return hash;
+}
+
+void WriteAheadLog::replaySegment(const std::string &path,
+                                  const std::function<void(ImageReader &)> &apply)
+{
+    MappedFile file(path);
+    size_t offset = 0;
+    while (file.size() - offset >= FRAME_HEADER) {
+        ImageReader header(file.data() + offset, FRAME_HEADER);
+        uint32_t length = header.u32();
+        uint32_t sum = header.u32();
+        const char *record = file.data() + offset + FRAME_HEADER;
+        if (length > file.size() - offset - FRAME_HEADER || checksum(record, length) != sum)
+            break;
+        ImageReader reader(record, length);
+        apply(reader);
+        offset += FRAME_HEADER + length;
+    }
+    if (offset != file.size())
+        std::cerr << "Ignoring torn tail of " << path << " at byte " << offset << std::endl;
+}
+
+void WriteAheadLog::open(uint64_t from, const std::function<void(ImageReader &)> &apply)
+{
+    _generation = from;
+    for (uint64_t generation : segments()) {
+        if (generation < from) {
+            unlink(segmentPath(generation).c_str());
+            continue;
+        }
+        replaySegment(segmentPath(generation), apply);
+        _generation = generation + 1;
+    }
+    _writer = std::thread(&WriteAheadLog::writerLoop, this);
+}
+
+void WriteAheadLog::append(const std::string &record)
+{
+    ImageWriter header;
+    header.u32(static_cast<uint32_t>(record.size()));
+    header.u32(checksum(record.data(), record.size()));
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_pending.empty() || _pending.back().generation != _generation)
+            _pending.push_back({_generation, ""});
+        _pending.back().data.append(header.data()).append(record);
+        _appended++;
+    }
+    _wake.notify_one();
+}
+
+uint64_t WriteAheadLog::rotate()
+{
+    return ++_generation;
+}
+
+void WriteAheadLog::discardBefore(uint64_t generation)
+{
+    for (uint64_t old : segments()) {
+        if (old < generation)
+            unlink(segmentPath(old).c_str());
+    }
+}
+
+void WriteAheadLog::sync()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    uint64_t target = _appended;
+    _committedChanged.wait(lock, [this, target] { return _committed >= target; });
+}
+
+// takes whatever piled up while the last batch was being written, one fdatasync for all of it
+void WriteAheadLog::writerLoop()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true) {
+        _wake.wait(lock, [this] { return _stopping || !_pending.empty(); });
+        if (_pending.empty())
+            break;
+        std::deque<Chunk> batch;
+        batch.swap(_pending);
+        uint64_t upTo = _appended;
+        lock.unlock();
+
+        for (const Chunk &chunk : batch) {
+            writeChunk(chunk);
+        }
+        if (_fd >= 0 && fdatasync(_fd) < 0)
+            std::cerr << "WAL sync failed: " << strerror(errno) << std::endl;
+
+        lock.lock();
+        _committed = upTo;
+        _committedChanged.notify_all();
+    }
+}
+
+void WriteAheadLog::writeChunk(const Chunk &chunk)
+{
+    if (_fd < 0 || chunk.generation != _fdGeneration) {
+        if (_fd >= 0) {
+            fdatasync(_fd);
+            close(_fd);
+        }
+        std::string path = segmentPath(chunk.generation);
+        _fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        _fdGeneration = chunk.generation;
+        if (_fd < 0) {
+            std::cerr << "Cannot open " << path << ": " << strerror(errno) << std::endl;
+            return;
+        }
+        syncDirectory(_directory);
+    }
+    size_t written = 0;
+    while (written < chunk.data.size()) {
+        ssize_t result = write(_fd, chunk.data.data() + written, chunk.data.size() - written);
+        if (result < 0 && errno == EINTR)
+            continue;
+        if (result < 0) {
+            std::cerr << "WAL write failed: " << strerror(errno) << std::endl;
+            return;
+        }
+        written += result;
+    }
+}
@@ -0,0 +1,125 @@
+#include "TestSetup.hpp"
+#include <BanTrie.hpp>
+#include <Error.hpp>
+#include <fstream>
+#include <csignal>
+
+static IpAddress address(const std::string &text)
+{
+    IpAddress result;
+    EXPECT_TRUE(IpAddress::fromString(text, result));
+    return result;
+}
+
+TEST(BanTrieTest, MatchesIPv4Ranges)
+{
+    BanTrie bans;
+    EXPECT_TRUE(bans.add("10.1.0.0/16", "abuse"));
+    EXPECT_TRUE(bans.add("192.0.2.7", "single host"));
+
+    ASSERT_NE(bans.match(address("10.1.200.3")), nullptr);
+    EXPECT_EQ(*bans.match(address("10.1.200.3")), "abuse");
+    EXPECT_EQ(bans.match(address("10.2.0.1")), nullptr);
+    EXPECT_EQ(*bans.match(address("192.0.2.7")), "single host");
+    EXPECT_EQ(bans.match(address("192.0.2.8")), nullptr);
+    // the same host seen through an IPv6 socket
+    EXPECT_NE(bans.match(address("::ffff:10.1.2.3")), nullptr);
+    EXPECT_EQ(bans.size(), 2u);
+}
+
+TEST(BanTrieTest, MatchesIPv6Ranges)
+{
+    BanTrie bans;
+    EXPECT_TRUE(bans.add("2001:db8::/32", "doc range"));
+    EXPECT_TRUE(bans.add("2001:db9:1:2::/64", "one subnet"));
+
+    EXPECT_NE(bans.match(address("2001:db8:ffff::1")), nullptr);
+    EXPECT_NE(bans.match(address("2001:db9:1:2:abcd::1")), nullptr);
+    EXPECT_EQ(bans.match(address("2001:db9:1:3::1")), nullptr);
+    EXPECT_EQ(bans.match(address("::1")), nullptr);
+}
+
+// prefixes added in any order split the compressed edges correctly
+TEST(BanTrieTest, NestedAndSiblingPrefixes)
+{
+    BanTrie bans;
+    EXPECT_TRUE(bans.add("10.1.2.0/24", "narrow"));
+    EXPECT_TRUE(bans.add("10.1.3.0/24", "sibling"));
+    EXPECT_EQ(bans.match(address("10.1.4.1")), nullptr);
+    EXPECT_TRUE(bans.add("10.0.0.0/8", "wide"));
+
+    EXPECT_EQ(*bans.match(address("10.1.2.1")), "wide");
+    EXPECT_EQ(*bans.match(address("10.200.0.1")), "wide");
+    EXPECT_EQ(bans.match(address("11.0.0.1")), nullptr);
+    EXPECT_EQ(bans.size(), 3u);
+
+    EXPECT_FALSE(bans.add("10.0.0.0/33", "bad"));
+    EXPECT_FALSE(bans.add("not.an.address", "bad"));
+    EXPECT_TRUE(bans.add("0.0.0.0/0", "everything"));
+    EXPECT_NE(bans.match(address("8.8.8.8")), nullptr);
+    EXPECT_EQ(bans.match(address("2001:db8::1")), nullptr);
+}
+
+TEST(BanTrieTest, LoadFile)
+{
+    std::string path = "/tmp/ft_irc_bantrie_test.bans";
+    {
+        std::ofstream file(path);
+        file << "# abuse feed\n"
+             << "198.51.100.0/24 open proxy\n"
+             << "\n"
+             << "2001:db8::/48\n"
+             << "garbage\n";
+    }
+    std::vector<std::string> warnings;
+    BanTrie bans = BanTrie::loadFile(path, warnings);
+    EXPECT_EQ(bans.size(), 2u);
+    EXPECT_EQ(warnings, (std::vector<std::string>{path + ":5: invalid ban garbage"}));
+    EXPECT_EQ(*bans.match(address("198.51.100.9")), "open proxy");
+    EXPECT_EQ(*bans.match(address("2001:db8::9")), "Banned");
+    std::remove(path.c_str());
+
+    EXPECT_THROW(BanTrie::loadFile("/nonexistent/ft_irc.bans", warnings), ServerError);
+}
+
+class ServerBanTests : public TestSetup
+{
+protected:
+    std::string path = "/tmp/ft_irc_server_ban_test.bans";
+
+    ServerBanTests()
+        : TestSetup(true)
+    {
+        std::ofstream file(path);
+        file << "# nothing banned yet\n";
+        setenv("FT_IRC_BANS", path.c_str(), 1);
+    }
+
+    ~ServerBanTests()
+    {
+        unsetenv("FT_IRC_BANS");
+        std::remove(path.c_str());
+    }
+};
+
+TEST_F(ServerBanTests, ReloadOnSighup)
+{
+    int before = connectClient();
+    ASSERT_GT(before, 0);
+    EXPECT_TRUE(waitForOutput("New client", 1000));
+
+    {
+        std::ofstream file(path);
+        file << "127.0.0.0/8 no loopback today\n";
+    }
+    clearServerOutput();
+    raise(SIGHUP);
+    ASSERT_TRUE(waitForOutput("Reloaded 1 bans", 2000));
+
+    int after = connectClient();
+    ASSERT_GT(after, 0);
+    EXPECT_TRUE(waitForOutput("Rejected connection from 127.0.0.1: Banned: no loopback today", 1000));
+    char buffer[256] = {};
+    ASSERT_GT(recv(after, buffer, sizeof(buffer) - 1, 0), 0);
+    EXPECT_NE(std::string(buffer).find("ERROR :Banned: no loopback today"), std::string::npos);
+}
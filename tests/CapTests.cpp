@@ -0,0 +1,71 @@
+#include "TestSetup.hpp"
+#include <MessageVariants.hpp>
+#include <Client.hpp>
+
+TEST(MessageVariantsTest, OneBufferPerWireForm)
+{
+    Client plain(-1);
+    Client timed(-1);
+    Client tagged(-1);
+    Client alsoTagged(-1);
+    timed.setCaps(CAP_SERVER_TIME);
+    tagged.setCaps(CAP_SERVER_TIME | CAP_MESSAGE_TAGS);
+    alsoTagged.setCaps(CAP_SERVER_TIME | CAP_MESSAGE_TAGS | CAP_ECHO_MESSAGE);
+
+    MessageVariants variants(
+        {std::make_shared<const std::string>(":a!b@c PRIVMSG #x :hi\r\n"), 0x2a, 1546612406123});
+    EXPECT_EQ(*variants.forClient(plain), ":a!b@c PRIVMSG #x :hi\r\n");
+    EXPECT_EQ(*variants.forClient(timed), "@time=2019-01-04T14:33:26.123Z :a!b@c PRIVMSG #x :hi\r\n");
+    EXPECT_EQ(*variants.forClient(tagged),
+              "@time=2019-01-04T14:33:26.123Z;msgid=000000000000002a :a!b@c PRIVMSG #x :hi\r\n");
+    // caps that don't change the bytes share the buffer
+    EXPECT_EQ(variants.forClient(tagged).get(), variants.forClient(alsoTagged).get());
+
+    // without a msgid, message-tags alone is the plain line
+    MessageVariants join(":a!b@c JOIN #x");
+    Client onlyTags(-1);
+    onlyTags.setCaps(CAP_MESSAGE_TAGS);
+    EXPECT_EQ(join.forClient(onlyTags).get(), join.forClient(plain).get());
+}
+
+TEST_F(TestSetup, CapNegotiationHoldsRegistration)
+{
+    int client = connectClient();
+    ASSERT_GT(client, 0);
+
+    sendCommand(client, "CAP LS 302");
+    EXPECT_TRUE(outputContains("CAP * LS :account-tag batch draft/resume-0.5 echo-message "
+                               "message-tags multi-prefix server-time"));
+    sendCommand(client, "PASS 42");
+    sendCommand(client, "NICK capuser");
+    sendCommand(client, "USER capuser 0 * :Cap User");
+    sendCommand(client, "CAP REQ :server-time echo-message");
+    EXPECT_TRUE(outputContains("CAP capuser ACK :server-time echo-message"));
+    EXPECT_FALSE(outputContains("001 capuser"));
+
+    sendCommand(client, "CAP REQ :server-time bogus");
+    EXPECT_TRUE(outputContains("CAP capuser NAK :server-time bogus"));
+    sendCommand(client, "CAP LIST");
+    EXPECT_TRUE(outputContains("CAP capuser LIST :echo-message server-time"));
+
+    sendCommand(client, "CAP END");
+    EXPECT_TRUE(outputContains("001 capuser"));
+}
+
+TEST_F(TestSetup, CapTaggedFanOut)
+{
+    std::vector<int> clients = basicSetupMultiple(3);
+    sendCommand(clients[1], "CAP REQ :server-time message-tags");
+    sendCommand(clients[0], "CAP REQ echo-message");
+    ASSERT_TRUE(waitForOutput("CAP basicUser0 ACK :echo-message", 1000));
+    clearServerOutput();
+
+    sendCommand(clients[0], "PRIVMSG #test :tagged hello");
+    ASSERT_TRUE(waitForOutput(";msgid=", 1000));
+    std::string output = getServerOutput();
+    // basicUser1 gets the tagged form, basicUser2 the plain one and the sender its echo
+    EXPECT_NE(output.find(" :basicUser0!testuser@127.0.0.1 PRIVMSG #test :tagged hello"),
+              std::string::npos);
+    EXPECT_TRUE(outputContains("@time="));
+    EXPECT_EQ(countInOutput(": :basicUser0!testuser@127.0.0.1 PRIVMSG #test :tagged hello"), 2);
+}
@@ -128,3 +128,58 @@ TEST_F(ChannelManagerTest, MultipleChannels)
 //     Channel &channel = channelManager.getChannel("#test");
 //     EXPECT_TRUE(creator->isOnChannel(&channel));
 // }
+
+// LIST filters, the member count index follows joins and parts
+TEST_F(ChannelManagerTest, FindChannelsByMemberCount)
+{
+    channelManager.createChannel("#small", *creator);
+    channelManager.createChannel("#big", *creator);
+    channelManager.getChannel("#big").join(*regularUser);
+
+    ListFilter filter;
+    filter.minUsers = 2;
+    std::vector<std::string> found = channelManager.findChannels(filter);
+    ASSERT_EQ(found.size(), 1u);
+    EXPECT_EQ(found[0], "#big");
+
+    channelManager.getChannel("#big").removeMember(*regularUser);
+    EXPECT_TRUE(channelManager.findChannels(filter).empty());
+
+    filter = ListFilter();
+    filter.maxUsers = 1;
+    EXPECT_EQ(channelManager.findChannels(filter).size(), 2u);
+}
+
+TEST_F(ChannelManagerTest, FindChannelsByMask)
+{
+    channelManager.createChannel("#rustlang", *creator);
+    channelManager.createChannel("#Trusty", *creator);
+    channelManager.createChannel("#golang", *creator);
+    std::string topic = "all about Gophers";
+    channelManager.getChannel("#golang").changeTopic(*creator, topic);
+
+    ListFilter filter;
+    filter.nameMask = "*RUST*";
+    EXPECT_EQ(channelManager.findChannels(filter).size(), 2u);
+
+    filter.excludedNameMask = "#t*";
+    std::vector<std::string> found = channelManager.findChannels(filter);
+    ASSERT_EQ(found.size(), 1u);
+    EXPECT_EQ(found[0], "#rustlang");
+
+    filter = ListFilter();
+    filter.topicMask = "*gopher*";
+    found = channelManager.findChannels(filter);
+    ASSERT_EQ(found.size(), 1u);
+    EXPECT_EQ(found[0], "#golang");
+
+    // no literal run long enough for the index, falls back to a scan
+    filter = ListFilter();
+    filter.nameMask = "#?o*";
+    EXPECT_EQ(channelManager.findChannels(filter).size(), 1u);
+
+    channelManager.removeChannel("#golang");
+    filter = ListFilter();
+    filter.topicMask = "*gopher*";
+    EXPECT_TRUE(channelManager.findChannels(filter).empty());
+}
@@ -0,0 +1,184 @@
+#include <gtest/gtest.h>
+#include <ChannelRegistry.hpp>
+#include <ChannelManager.hpp>
+#include <ClientIndex.hpp>
+#include <Channel.hpp>
+#include <Client.hpp>
+#include <Clock.hpp>
+#include <common.hpp>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdlib>
+
+class ChannelRegistryTest : public ::testing::Test
+{
+protected:
+    std::string directory;
+
+    void SetUp() override
+    {
+        char path[] = "/tmp/ft_irc_registry_XXXXXX";
+        ASSERT_NE(mkdtemp(path), nullptr);
+        directory = path;
+    }
+
+    void TearDown() override
+    {
+        for (const std::string &file : files()) {
+            unlink((directory + "/" + file).c_str());
+        }
+        rmdir(directory.c_str());
+    }
+
+    std::vector<std::string> files() const
+    {
+        std::vector<std::string> names;
+        DIR *dir = opendir(directory.c_str());
+        while (dirent *entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name != "." && name != "..")
+                names.push_back(name);
+        }
+        closedir(dir);
+        std::sort(names.begin(), names.end());
+        return names;
+    }
+
+    static ChannelRecord record(const std::string &name, const std::string &topic)
+    {
+        ChannelRecord record;
+        record.name = name;
+        record.topic = topic;
+        record.topicAuthor = "alice";
+        record.topicTime = "1700000000";
+        record.modes = "tk";
+        record.key = "secret";
+        record.createdTime = "1690000000";
+        record.masks.push_back({'b', "bad!*@*", "alice!alice@host", 1700000001});
+        return record;
+    }
+};
+
+TEST_F(ChannelRegistryTest, ReplaysTheLogOnStartup)
+{
+    {
+        ChannelRegistry registry(directory);
+        registry.put("#one", record("#One", "first"));
+        registry.put("#two", record("#Two", "second"));
+        registry.put("#one", record("#One", "first, edited"));
+        registry.erase("#two");
+    }
+    ChannelRegistry registry(directory);
+    EXPECT_EQ(registry.size(), 1u);
+    const ChannelRecord *one = registry.find("#one");
+    ASSERT_NE(one, nullptr);
+    EXPECT_EQ(one->name, "#One");
+    EXPECT_EQ(one->topic, "first, edited");
+    EXPECT_EQ(one->key, "secret");
+    ASSERT_EQ(one->masks.size(), 1u);
+    EXPECT_EQ(one->masks[0].mask, "bad!*@*");
+    EXPECT_EQ(one->masks[0].setAt, 1700000001);
+    EXPECT_EQ(registry.find("#two"), nullptr);
+}
+
+TEST_F(ChannelRegistryTest, SnapshotReplacesTheSegmentsItCovers)
+{
+    {
+        ChannelRegistry registry(directory);
+        registry.put("#one", record("#One", "before the snapshot"));
+        ASSERT_TRUE(registry.snapshot());
+        registry.put("#two", record("#Two", "after the snapshot"));
+        registry.sync();
+    }
+    EXPECT_EQ(files(), (std::vector<std::string>{"channels.snapshot", "channels.wal.1"}));
+
+    ChannelRegistry registry(directory);
+    EXPECT_EQ(registry.size(), 2u);
+    ASSERT_NE(registry.find("#one"), nullptr);
+    EXPECT_EQ(registry.find("#one")->topic, "before the snapshot");
+    ASSERT_NE(registry.find("#two"), nullptr);
+    EXPECT_EQ(registry.find("#two")->topic, "after the snapshot");
+}
+
+// the interval is measured on the installed clock, simulations decide when a snapshot is due
+TEST_F(ChannelRegistryTest, SnapshotIntervalFollowsTheClock)
+{
+    VirtualClock clock;
+    Clock::install(&clock);
+    {
+        ChannelRegistry registry(directory);
+        registry.put("#one", record("#One", "timed"));
+        clock.advance(std::chrono::seconds(SNAPSHOT_INTERVAL_SEC - 1));
+        registry.maintain();
+        registry.sync();
+        EXPECT_EQ(files(), (std::vector<std::string>{"channels.wal.0"}));
+
+        clock.advance(std::chrono::seconds(1));
+        registry.maintain();
+        registry.sync();
+        EXPECT_EQ(files(), (std::vector<std::string>{"channels.snapshot"}));
+    }
+    Clock::install(nullptr);
+}
+
+TEST_F(ChannelRegistryTest, TornTailIsIgnored)
+{
+    {
+        ChannelRegistry registry(directory);
+        registry.put("#one", record("#One", "intact"));
+    }
+    // a crash in the middle of the next record
+    int fd = open((directory + "/channels.wal.0").c_str(), O_WRONLY | O_APPEND);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(write(fd, "\x40\0\0\0\x12\x34", 6), 6);
+    close(fd);
+
+    {
+        ChannelRegistry registry(directory);
+        EXPECT_EQ(registry.size(), 1u);
+        registry.put("#two", record("#Two", "written after the torn one"));
+    }
+    ChannelRegistry registry(directory);
+    EXPECT_EQ(registry.size(), 2u);
+    ASSERT_NE(registry.find("#two"), nullptr);
+}
+
+TEST_F(ChannelRegistryTest, EmptiedChannelComesBackWithItsMetadata)
+{
+    ChannelRegistry registry(directory);
+    ChannelManager channels;
+    channels.setRegistry(&registry);
+    Client alice(900);
+    alice.setNickname("alice");
+    Client bob(901);
+    bob.setNickname("bob");
+
+    channels.createChannel("#Keep", alice);
+    std::string topic = "still here";
+    channels.getChannel("#keep").changeTopic(alice, topic);
+    channels.getChannel("#keep").applyModes(alice, {{true, 't', ""}, {true, 'k', "secret"}});
+    channels.getChannel("#keep").removeMember(alice);
+    channels.rmEmptyChannels();
+    ASSERT_FALSE(channels.channelExists("#keep"));
+    ASSERT_NE(registry.find("#keep"), nullptr);
+
+    // the key still applies to whoever recreates it
+    channels.createChannel("#KEEP", bob);
+    EXPECT_EQ(channels.getChannel("#keep").getMemberCount(), 0u);
+    channels.rmEmptyChannels();
+
+    channels.createChannel("#KEEP", bob, "secret");
+    Channel &channel = channels.getChannel("#keep");
+    EXPECT_EQ(channel.getName(), "#Keep");
+    EXPECT_EQ(channel.getTopic(), "still here");
+    EXPECT_TRUE(channel.hasMode('t'));
+    EXPECT_TRUE(channel.hasOp(bob));
+
+    // back at the defaults there is nothing left to keep
+    std::string cleared;
+    channel.changeTopic(bob, cleared);
+    channel.applyModes(bob, {{false, 't', ""}, {false, 'k', "secret"}});
+    EXPECT_EQ(registry.find("#keep"), nullptr);
+    channel.removeMember(bob);
+}
@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+#include <CompiledMask.hpp>
+#include <MaskList.hpp>
+#include <Mask.hpp>
+
+static bool maskMatches(const std::string &mask, const std::string &subject)
+{
+    return CompiledMask(mask).matches(CompiledMask::casemap(subject));
+}
+
+TEST(CompiledMaskTest, Normalize)
+{
+    EXPECT_EQ(CompiledMask::normalize("nick"), "nick!*@*");
+    EXPECT_EQ(CompiledMask::normalize("nick!user"), "nick!user@*");
+    EXPECT_EQ(CompiledMask::normalize("user@host"), "*!user@host");
+    EXPECT_EQ(CompiledMask::normalize("n!u@h"), "n!u@h");
+}
+
+TEST(CompiledMaskTest, MatchesGlobs)
+{
+    EXPECT_TRUE(maskMatches("*!*@*.example.com", "Bob!bob@irc.Example.COM"));
+    EXPECT_FALSE(maskMatches("*!*@*.example.com", "bob!bob@example.org"));
+    EXPECT_TRUE(maskMatches("bob!*@*", "BOB!x@y"));
+    EXPECT_FALSE(maskMatches("bob!*@*", "bobby!x@y"));
+    EXPECT_TRUE(maskMatches("*!*ev*l*@*", "n!devil@host"));
+    EXPECT_FALSE(maskMatches("*!*ev*l*@*", "n!deva@host"));
+    EXPECT_TRUE(maskMatches("b?b!*@*", "bob!u@h"));
+    EXPECT_FALSE(maskMatches("b?b!*@*", "bb!u@h"));
+    EXPECT_TRUE(maskMatches("exact!user@host", "Exact!User@Host"));
+    EXPECT_FALSE(maskMatches("exact!user@host", "exact!user@hostx"));
+    // prefix and suffix must not overlap
+    EXPECT_FALSE(maskMatches("ab*ba", "aba"));
+}
+
+TEST(CompiledMaskTest, WildcardsInTheSubjectAreLiteral)
+{
+    // a '*' in the mask still spans text that has its own '*'
+    EXPECT_TRUE(maskMatches("a?*b!*@*", "a**xb!u@h"));
+    EXPECT_TRUE(maskMatches("*!*@*", "*!*@*"));
+    EXPECT_TRUE(maskMatches("n!*x@h", "n!*yx@h"));
+    // but only matches a literal '*' where the mask has one
+    EXPECT_FALSE(maskMatches("a?b!*@*", "a*!u@h"));
+    EXPECT_FALSE(maskMatches("nick!u@h", "n*!u@h"));
+    EXPECT_FALSE(maskMatches("n??k!u@h", "n*k!u@h"));
+    EXPECT_TRUE(matchMask("#a*c", "#a*b*c"));
+    EXPECT_FALSE(matchMask("#a?c", "#a*"));
+}
+
+TEST(CompiledMaskTest, HostSuffix)
+{
+    EXPECT_EQ(CompiledMask("*!*@*.example.com").getHostSuffix(), ".example.com");
+    EXPECT_EQ(CompiledMask("nick!user@host").getHostSuffix(), "host");
+    EXPECT_EQ(CompiledMask("nick!*@*").getHostSuffix(), "");
+}
+
+TEST(MaskListTest, AddRemoveAndMatch)
+{
+    MaskList list;
+    EXPECT_TRUE(list.add("*!*@*.example.com", "op"));
+    EXPECT_TRUE(list.add("troll!*@*", "op"));
+    EXPECT_TRUE(list.add("*!*@10.0.0.?", "op"));
+    EXPECT_FALSE(list.add("TROLL!*@*", "op"));
+    EXPECT_EQ(list.size(), 3u);
+
+    EXPECT_TRUE(list.matches("a!b@irc.example.com"));
+    EXPECT_TRUE(list.matches("troll!b@anywhere"));
+    EXPECT_TRUE(list.matches("a!b@10.0.0.7"));
+    // shorter than the bucket key
+    EXPECT_FALSE(list.matches("a!b@om"));
+    EXPECT_FALSE(list.matches("a!b@10.0.0.77"));
+
+    EXPECT_TRUE(list.remove("*!*@*.EXAMPLE.com"));
+    EXPECT_FALSE(list.remove("*!*@*.example.com"));
+    EXPECT_FALSE(list.matches("a!b@irc.example.com"));
+    EXPECT_EQ(list.getEntries().front().mask.getMask(), "troll!*@*");
+    EXPECT_EQ(list.getEntries().front().setBy, "op");
+}
@@ -0,0 +1,126 @@
+#include "TestSetup.hpp"
+#include <ConnectionThrottle.hpp>
+
+class ConnectionThrottleTest : public ::testing::Test
+{
+protected:
+    ConnectionThrottle throttle;
+
+    void SetUp() override
+    {
+        ThrottlePolicy policy;
+        policy.maxPerHost = 2;
+        policy.connectBurst = 100;
+        policy.connectRatePerSec = 1;
+        throttle.setPolicy(policy);
+    }
+
+    ConnectionThrottle::Verdict admit(const std::string &ip)
+    {
+        sockaddr_storage addr = {};
+        if (inet_pton(AF_INET, ip.c_str(), &reinterpret_cast<sockaddr_in *>(&addr)->sin_addr) == 1)
+            addr.ss_family = AF_INET;
+        else if (inet_pton(AF_INET6, ip.c_str(),
+                           &reinterpret_cast<sockaddr_in6 *>(&addr)->sin6_addr) == 1)
+            addr.ss_family = AF_INET6;
+        return throttle.admit(reinterpret_cast<sockaddr *>(&addr));
+    }
+};
+
+TEST_F(ConnectionThrottleTest, LimitsConnectionsPerHost)
+{
+    EXPECT_EQ(admit("10.0.0.1"), ConnectionThrottle::ADMIT);
+    EXPECT_EQ(admit("10.0.0.1"), ConnectionThrottle::ADMIT);
+    EXPECT_EQ(admit("10.0.0.1"), ConnectionThrottle::TOO_MANY_CONNECTIONS);
+    EXPECT_EQ(admit("10.0.0.2"), ConnectionThrottle::ADMIT);
+
+    throttle.release("10.0.0.1");
+    EXPECT_EQ(admit("10.0.0.1"), ConnectionThrottle::ADMIT);
+}
+
+// IPv6 hosts share the limit of their /64, mapped IPv4 counts as the IPv4 address
+TEST_F(ConnectionThrottleTest, GroupsIPv6ByPrefix)
+{
+    EXPECT_EQ(admit("2001:db8::1"), ConnectionThrottle::ADMIT);
+    EXPECT_EQ(admit("2001:db8::ffff:2"), ConnectionThrottle::ADMIT);
+    EXPECT_EQ(admit("2001:db8::3"), ConnectionThrottle::TOO_MANY_CONNECTIONS);
+    EXPECT_EQ(admit("2001:db8:0:1::1"), ConnectionThrottle::ADMIT);
+
+    EXPECT_EQ(admit("10.0.0.9"), ConnectionThrottle::ADMIT);
+    EXPECT_EQ(admit("::ffff:10.0.0.9"), ConnectionThrottle::ADMIT);
+    EXPECT_EQ(admit("10.0.0.9"), ConnectionThrottle::TOO_MANY_CONNECTIONS);
+}
+
+TEST_F(ConnectionThrottleTest, ConnectRate)
+{
+    ThrottlePolicy policy;
+    policy.connectBurst = 2;
+    policy.connectRatePerSec = 0.001;
+    throttle.setPolicy(policy);
+
+    EXPECT_EQ(admit("10.0.0.1"), ConnectionThrottle::ADMIT);
+    throttle.release("10.0.0.1");
+    EXPECT_EQ(admit("10.0.0.1"), ConnectionThrottle::ADMIT);
+    throttle.release("10.0.0.1");
+    EXPECT_EQ(admit("10.0.0.1"), ConnectionThrottle::TOO_FAST);
+}
+
+// idle hosts are dropped when the table fills up instead of growing it forever
+TEST_F(ConnectionThrottleTest, ForgetsIdleHosts)
+{
+    ThrottlePolicy policy;
+    policy.connectRatePerSec = 1e9;
+    throttle.setPolicy(policy);
+
+    for (int i = 0; i < 1000; i++) {
+        std::string ip = "10.0." + std::to_string(i / 256) + "." + std::to_string(i % 256);
+        EXPECT_EQ(admit(ip), ConnectionThrottle::ADMIT);
+        throttle.release(ip);
+    }
+    EXPECT_LT(throttle.trackedHosts(), 64u);
+}
+
+TEST_F(ConnectionThrottleTest, LoopbackExempt)
+{
+    for (int i = 0; i < 10; i++) {
+        EXPECT_EQ(admit("127.0.0.1"), ConnectionThrottle::ADMIT);
+        EXPECT_EQ(admit("::1"), ConnectionThrottle::ADMIT);
+    }
+}
+
+class ThrottleTests : public TestSetup
+{
+protected:
+    ThrottleTests()
+        : TestSetup(true)
+    {
+        throttlePolicy.exemptLoopback = false;
+        throttlePolicy.maxPerHost = 2;
+    }
+};
+
+TEST_F(ThrottleTests, RejectedBeforeRegistration)
+{
+    int first = connectClient();
+    int second = connectClient();
+    ASSERT_GT(first, 0);
+    ASSERT_GT(second, 0);
+    int third = connectClient();
+    ASSERT_GT(third, 0);
+
+    EXPECT_TRUE(waitForOutput("Rejected connection from 127.0.0.1: Too many connections", 1000));
+    char buffer[256] = {};
+    ssize_t received = recv(third, buffer, sizeof(buffer) - 1, 0);
+    ASSERT_GT(received, 0);
+    EXPECT_NE(std::string(buffer).find("ERROR :Too many connections from your host"),
+              std::string::npos);
+
+    // a slot frees up when a client leaves
+    close(first);
+    EXPECT_TRUE(waitForOutput("data deleted", 1000));
+    clearServerOutput();
+    int fourth = connectClient();
+    ASSERT_GT(fourth, 0);
+    EXPECT_TRUE(waitForOutput("New client", 1000));
+    EXPECT_FALSE(outputContains("Rejected connection"));
+}
@@ -0,0 +1,144 @@
+#include "TestSetup.hpp"
+#include <CostAccounting.hpp>
+#include <memory>
+#include <thread>
+
+TEST(CostAccountingTest, ScopeChargesItsOwnThreadOnly)
+{
+    CostAccounting::reset();
+    const std::string command = "SCOPED";
+    {
+        CostAccounting::Scope scope(command);
+        CostAccounting::allocation(100);
+        CostAccounting::syscall();
+        CostAccounting::syscall();
+        std::thread([] {
+            CostAccounting::allocation(1000);
+            CostAccounting::syscall();
+        }).join();
+    }
+    CommandCost cost = CostAccounting::costOf(command);
+    EXPECT_EQ(cost.invocations, 1u);
+    EXPECT_EQ(cost.syscalls, 2u);
+    EXPECT_GE(cost.allocatedBytes, 100u);
+    EXPECT_LT(cost.allocatedBytes, 1000u);
+    if (!CostAccounting::enabled()) {
+        EXPECT_EQ(cost.allocations, 1u);
+        EXPECT_EQ(cost.allocatedBytes, 100u);
+    }
+
+    { CostAccounting::Scope scope(command); }
+    cost = CostAccounting::costOf(command);
+    EXPECT_EQ(cost.invocations, 2u);
+    EXPECT_DOUBLE_EQ(cost.syscallsPerCall(), 1.0);
+    ASSERT_EQ(CostAccounting::report().size(), 1u);
+    EXPECT_EQ(CostAccounting::report()[0].rfind("SCOPED calls 2 allocs/call ", 0), 0u);
+    EXPECT_EQ(CostAccounting::costOf("NEVER").invocations, 0u);
+}
+
+struct alignas(64) CacheLine
+{
+    char bytes[64];
+};
+
+TEST(CostAccountingTest, CountsOperatorNew)
+{
+    if (!CostAccounting::enabled())
+        GTEST_SKIP() << "built without FT_IRC_ACCOUNTING";
+    CostAccounting::reset();
+    const std::string command = "NEW";
+    {
+        CostAccounting::Scope scope(command);
+        std::unique_ptr<int> number(new int(42));
+        std::string text(100, 'x');
+        EXPECT_EQ(*number + text.size(), 142u);
+        // over-aligned types go through the align_val_t overloads
+        auto line = std::make_unique<CacheLine>();
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(line.get()) % 64, 0u);
+    }
+    CommandCost cost = CostAccounting::costOf(command);
+    EXPECT_EQ(cost.allocations, 3u);
+    EXPECT_GE(cost.allocatedBytes, sizeof(int) + 100 + sizeof(CacheLine));
+}
+
+// Budgets for the hot commands, measured on the server thread. A change that makes one of them
+// allocate noticeably more, or send one more time per recipient, has to update them on purpose.
+class CostBudgetTests : public TestSetup
+{
+protected:
+    void SetUp() override
+    {
+        if (!CostAccounting::enabled())
+            GTEST_SKIP() << "built without FT_IRC_ACCOUNTING";
+        CostAccounting::reset();
+        TestSetup::SetUp();
+    }
+
+    // the scope closes after the replies went out, the counts land a moment later
+    CommandCost waitForCalls(const std::string &command, uint64_t invocations)
+    {
+        CommandCost cost;
+        for (int wait = 0; wait < MAX_WAIT_OUTPUT / 10; wait++) {
+            cost = CostAccounting::costOf(command);
+            if (cost.invocations >= invocations)
+                break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return cost;
+    }
+
+    // first uses build function-local statics such as the validators' regexes, budgets are for
+    // the steady state
+    void warmUp(int client, const std::string &line)
+    {
+        std::string command = line.substr(0, line.find(' '));
+        uint64_t before = CostAccounting::costOf(command).invocations;
+        sendCommand(client, line);
+        waitForCalls(command, before + 1);
+        CostAccounting::reset();
+    }
+};
+
+TEST_F(CostBudgetTests, ChannelPrivmsg)
+{
+    std::vector<int> clients = basicSetupMultiple(3);
+    warmUp(clients[0], "PRIVMSG #test :warm up");
+    for (int i = 0; i < 10; i++)
+        sendCommand(clients[0], "PRIVMSG #test :budget " + std::to_string(i));
+
+    CommandCost cost = waitForCalls("PRIVMSG", 10);
+    EXPECT_EQ(cost.invocations, 10u);
+    // one send per other member
+    EXPECT_DOUBLE_EQ(cost.syscallsPerCall(), 2.0);
+    EXPECT_LE(cost.allocationsPerCall(), 20.0);
+}
+
+TEST_F(CostBudgetTests, PrivatePrivmsg)
+{
+    std::vector<int> clients = basicSetupMultiple(2);
+    warmUp(clients[0], "PRIVMSG basicUser1 :warm up");
+    for (int i = 0; i < 10; i++)
+        sendCommand(clients[0], "PRIVMSG basicUser1 :budget " + std::to_string(i));
+
+    CommandCost cost = waitForCalls("PRIVMSG", 10);
+    EXPECT_EQ(cost.invocations, 10u);
+    EXPECT_DOUBLE_EQ(cost.syscallsPerCall(), 1.0);
+    EXPECT_LE(cost.allocationsPerCall(), 20.0);
+}
+
+TEST_F(CostBudgetTests, Join)
+{
+    std::vector<int> clients = basicSetupMultiple(3);
+    // the setup's own JOINs must not land after the reset
+    waitForCalls("JOIN", 3);
+    warmUp(clients[0], "JOIN #warm");
+    sendCommand(clients[0], "JOIN #budget");
+    sendCommand(clients[1], "JOIN #budget");
+    sendCommand(clients[2], "JOIN #budget");
+
+    CommandCost cost = waitForCalls("JOIN", 3);
+    EXPECT_EQ(cost.invocations, 3u);
+    // the joiner's JOIN and names replies plus one JOIN per member already there
+    EXPECT_LE(cost.syscallsPerCall(), 5.0);
+    EXPECT_LE(cost.allocationsPerCall(), 42.0);
+}
@@ -0,0 +1,30 @@
+#include "TestSetup.hpp"
+
+class FairSchedulingTests : public TestSetup
+{
+protected:
+    FairSchedulingTests()
+        : TestSetup(true)
+    {}
+};
+
+// a quiet client's line is run while a flooding client still has a backlog
+TEST_F(FairSchedulingTests, QuietClientNotStuckBehindBurst)
+{
+    std::vector<int> clients = basicSetupMultiple(3);
+    clearServerOutput();
+
+    std::string burst;
+    for (int i = 0; i < 3000; i++) {
+        burst += "PRIVMSG basicUser2 :burst " + std::to_string(i) + "\r\n";
+    }
+    sendRawData(clients[0], burst);
+    sendCommand(clients[1], "PRIVMSG basicUser2 :quiet");
+
+    ASSERT_TRUE(waitForOutput("PRIVMSG basicUser2 :burst 2999", 5000));
+    std::string output = getServerOutput();
+    size_t quiet = output.find(":basicUser1!testuser@127.0.0.1 PRIVMSG basicUser2 :quiet");
+    size_t lastBurst = output.find("PRIVMSG basicUser2 :burst 2999");
+    ASSERT_NE(quiet, std::string::npos);
+    EXPECT_LT(quiet, lastBurst);
+}
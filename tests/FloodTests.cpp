@@ -0,0 +1,50 @@
+#include "TestSetup.hpp"
+
+class FloodTests : public TestSetup
+{
+protected:
+    FloodTests()
+        : TestSetup(true)
+    {
+        floodPolicy.enabled = true;
+        floodPolicy.burst = 5;
+        floodPolicy.ratePerSec = 10;
+        floodPolicy.maxDeferredBytes = 2048;
+    }
+
+    std::string pastedLines(int count, const std::string &text)
+    {
+        std::string lines;
+        for (int i = 0; i < count; i++) {
+            lines += "PRIVMSG #test :" + text + " " + std::to_string(i) + "\r\n";
+        }
+        return lines;
+    }
+};
+
+// a paste is held back and released at the refill rate, nothing is dropped
+TEST_F(FloodTests, FakeLag)
+{
+    std::vector<int> clients = basicSetupMultiple(2);
+    // let the bucket refill after registering and joining
+    std::this_thread::sleep_for(std::chrono::milliseconds(600));
+    clearServerOutput();
+
+    sendRawData(clients[1], pastedLines(20, "line"));
+    EXPECT_TRUE(waitForOutput("PRIVMSG #test :line 4", 500));
+    EXPECT_LT(countInOutput("from " + std::to_string(clients[1]) + ": PRIVMSG #test"), 20);
+
+    EXPECT_TRUE(waitForOutput("PRIVMSG #test :line 19", 3000));
+    EXPECT_EQ(countInOutput(":basicUser1!testuser@127.0.0.1 PRIVMSG #test :line"), 20);
+    EXPECT_FALSE(outputContains("Excess Flood"));
+}
+
+TEST_F(FloodTests, ExcessFlood)
+{
+    std::vector<int> clients = basicSetupMultiple(2);
+    clearServerOutput();
+
+    sendRawData(clients[1], pastedLines(100, "a long enough line to fill the input buffer"));
+    EXPECT_TRUE(waitForOutput("ERROR :Excess Flood", 1000));
+    EXPECT_TRUE(waitForOutput(":basicUser1!testuser@127.0.0.1 QUIT :Excess Flood", 1000));
+}
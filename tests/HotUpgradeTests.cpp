@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+#include <HotUpgrade.hpp>
+#include <StateImage.hpp>
+#include <ClientIndex.hpp>
+#include <ChannelManager.hpp>
+#include <Channel.hpp>
+#include <Client.hpp>
+#include <Error.hpp>
+#include <common.hpp>
+#include <unistd.h>
+#include <sys/socket.h>
+
+// the fds are never opened, whatever the channels send to them fails quietly
+static Client &addClient(ClientIndex &clients, int fd, const std::string &nick)
+{
+    clients.add(fd);
+    Client &client = clients.getByFd(fd);
+    client.setNickname(nick);
+    client.setUsername(nick);
+    client.setIp("10.0.0.1");
+    client.registerUser();
+    clients.addNick(fd);
+    return client;
+}
+
+TEST(StateImageTest, ReadsBackWhatWasWritten)
+{
+    ImageWriter writer;
+    writer.u8(7);
+    writer.u32(0xdeadbeef);
+    writer.u64(1ULL << 40);
+    writer.i64(-5);
+    writer.str(std::string("with\0nul", 8));
+    writer.str("");
+
+    ImageReader reader(writer.data());
+    EXPECT_EQ(reader.u8(), 7);
+    EXPECT_EQ(reader.u32(), 0xdeadbeef);
+    EXPECT_EQ(reader.u64(), 1ULL << 40);
+    EXPECT_EQ(reader.i64(), -5);
+    EXPECT_EQ(reader.str(), std::string("with\0nul", 8));
+    EXPECT_EQ(reader.str(), "");
+    EXPECT_TRUE(reader.atEnd());
+}
+
+TEST(StateImageTest, TruncatedImageThrows)
+{
+    ImageWriter writer;
+    writer.str("channel");
+    std::string truncated = writer.data().substr(0, writer.data().size() - 1);
+
+    ImageReader reader(truncated);
+    EXPECT_THROW(reader.str(), ServerError);
+}
+
+TEST(HotUpgradeTest, ClientsAndChannelsSurviveTheImage)
+{
+    ImageWriter image;
+    std::string token;
+    {
+        ClientIndex clients;
+        ChannelManager channels;
+        Client &alice = addClient(clients, 900, "alice");
+        Client &bob = addClient(clients, 901, "Bob");
+        Client &carol = addClient(clients, 902, "carol");
+        alice.setCaps(CAP_SERVER_TIME | CAP_ECHO_MESSAGE);
+        alice.getMessageBuf() = "PRIVMSG #Up :half a li";
+        clients.getMonitor().add(alice, "carol");
+        token = clients.issueResumeToken(carol);
+
+        channels.createChannel("#Up", alice);
+        Channel &channel = channels.getChannel("#up");
+        channel.join(bob);
+        channel.join(carol);
+        std::string topic = "kept across upgrades";
+        channel.changeTopic(alice, topic);
+        channel.applyModes(alice, {{true, 'k', "secret"}, {true, 'b', "bad!*@*"}});
+        channel.relayMessage(alice, ":alice!alice@10.0.0.1 PRIVMSG #Up :hi");
+        clients.detach(carol, "Connection reset by peer",
+                       std::chrono::steady_clock::now() + std::chrono::seconds(30));
+        clients.save(image);
+        channels.save(image);
+    }
+
+    ClientIndex clients;
+    ChannelManager channels;
+    ImageReader reader(image.data());
+    clients.load(reader, {{900, 910}, {901, 911}});
+    channels.load(reader, clients);
+    EXPECT_TRUE(reader.atEnd());
+
+    Client &alice = clients.getByNick("ALICE");
+    Client &bob = clients.getByNick("bob");
+    EXPECT_EQ(alice.getFd(), 910);
+    EXPECT_EQ(bob.getFd(), 911);
+    EXPECT_EQ(alice.getUserHost(), "alice!alice@10.0.0.1");
+    EXPECT_TRUE(alice.getIsRegistered());
+    EXPECT_TRUE(alice.hasCap(CAP_ECHO_MESSAGE));
+    EXPECT_EQ(alice.getMessageBuf(), "PRIVMSG #Up :half a li");
+    EXPECT_EQ(clients.getMonitor().getList(alice), std::vector<std::string>{"carol"});
+
+    Client *carol = clients.findDetached(token);
+    ASSERT_NE(carol, nullptr);
+    EXPECT_EQ(carol->getNickname(), "carol");
+    EXPECT_TRUE(clients.expiredDetached(std::chrono::steady_clock::now()).empty());
+
+    Channel &channel = channels.getChannel("#UP");
+    EXPECT_EQ(channel.getName(), "#Up");
+    EXPECT_EQ(channel.getTopic(), "kept across upgrades");
+    EXPECT_EQ(channel.getMemberCount(), 3u);
+    EXPECT_TRUE(channel.hasOp(alice));
+    EXPECT_FALSE(channel.hasOp(bob));
+    EXPECT_TRUE(channel.hasMode('k'));
+    EXPECT_TRUE(bob.isOnChannel(&channel));
+    EXPECT_TRUE(carol->isOnChannel(&channel));
+    EXPECT_EQ(channel.getHistory().size(), 1u);
+
+    // the LIST indexes were rebuilt as well
+    ListFilter filter;
+    filter.topicMask = "*across*";
+    EXPECT_EQ(channels.findChannels(filter), std::vector<std::string>{"#Up"});
+
+    Client &bad = addClient(clients, 912, "bad");
+    EXPECT_TRUE(channel.isBanned(bad));
+    EXPECT_FALSE(channel.isBanned(bob));
+}
+
+TEST(HotUpgradeTest, ClientWithoutDescriptorIsRejected)
+{
+    ImageWriter image;
+    {
+        ClientIndex clients;
+        addClient(clients, 900, "alice");
+        clients.save(image);
+    }
+    ClientIndex clients;
+    ImageReader reader(image.data());
+    EXPECT_THROW(clients.load(reader, {}), ServerError);
+}
+
+TEST(HotUpgradeTest, PassesDescriptorsInBatches)
+{
+    int pair[2];
+    int pipeFds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, pair), 0);
+    ASSERT_EQ(pipe(pipeFds), 0);
+
+    std::vector<int> sent(UPGRADE_FDS_PER_MESSAGE + 3, pipeFds[1]);
+    std::vector<int> received;
+    ASSERT_TRUE(HotUpgrade::sendFds(pair[0], sent));
+    ASSERT_TRUE(HotUpgrade::receiveFds(pair[1], sent.size(), received));
+    ASSERT_EQ(received.size(), sent.size());
+
+    // any of them is the pipe's write end
+    char byte = 0;
+    ASSERT_EQ(write(received.back(), "x", 1), 1);
+    ASSERT_EQ(read(pipeFds[0], &byte, 1), 1);
+    EXPECT_EQ(byte, 'x');
+
+    for (int fd : received) {
+        close(fd);
+    }
+    close(pipeFds[0]);
+    close(pipeFds[1]);
+    close(pair[0]);
+    close(pair[1]);
+}
@@ -0,0 +1,191 @@
+#include "TestSetup.hpp"
+#include <common.hpp>
+
+class ListWhoNamesTests : public TestSetup
+{
+protected:
+    ListWhoNamesTests()
+        : TestSetup(true)
+    {}
+};
+
+TEST_F(ListWhoNamesTests, ListChannels)
+{
+    std::vector<int> clients = basicSetupMultiple(2);
+    int client0 = clients[0];
+
+    sendCommand(client0, "TOPIC #test :hello there");
+    clearServerOutput();
+
+    sendCommand(client0, "LIST");
+    EXPECT_TRUE(outputContains("321 basicUser0 Channel :Users  Name"));
+    EXPECT_TRUE(outputContains("322 basicUser0 #test 2 :hello there"));
+    EXPECT_TRUE(outputContains("323 basicUser0 :End of /LIST"));
+    clearServerOutput();
+
+    // unknown channels are skipped
+    sendCommand(client0, "LIST #nope,#test");
+    EXPECT_TRUE(outputContains("322 basicUser0 #test 2 :hello there"));
+    EXPECT_FALSE(outputContains("322 basicUser0 #nope"));
+    EXPECT_TRUE(outputContains("323 basicUser0 :End of /LIST"));
+}
+
+TEST_F(ListWhoNamesTests, ListFilters)
+{
+    std::vector<int> clients = basicSetupMultiple(2);
+    int client0 = clients[0];
+
+    sendCommand(client0, "JOIN #rustaceans");
+    sendCommand(client0, "TOPIC #rustaceans :crabs welcome");
+    ASSERT_TRUE(waitForOutput("TOPIC #rustaceans", 1000));
+    clearServerOutput();
+
+    sendCommand(client0, "LIST >1");
+    EXPECT_TRUE(outputContains("322 basicUser0 #test 2 :"));
+    EXPECT_FALSE(outputContains("322 basicUser0 #rustaceans"));
+    EXPECT_TRUE(outputContains("323 basicUser0 :End of /LIST"));
+    clearServerOutput();
+
+    sendCommand(client0, "LIST *rust*");
+    EXPECT_TRUE(outputContains("322 basicUser0 #rustaceans 1 :crabs welcome"));
+    EXPECT_FALSE(outputContains("322 basicUser0 #test"));
+    clearServerOutput();
+
+    sendCommand(client0, "LIST T:*CRAB*,<2");
+    EXPECT_TRUE(outputContains("322 basicUser0 #rustaceans 1 :crabs welcome"));
+    EXPECT_FALSE(outputContains("322 basicUser0 #test"));
+    clearServerOutput();
+
+    sendCommand(client0, "LIST C<5,!#r*");
+    EXPECT_TRUE(outputContains("322 basicUser0 #test 2 :"));
+    EXPECT_FALSE(outputContains("322 basicUser0 #rustaceans"));
+}
+
+// more channels than one batch, the reply is finished over several loop iterations
+TEST_F(ListWhoNamesTests, ListStreamsInBatches)
+{
+    std::vector<int> clients = basicSetupMultiple(3);
+
+    // stays under the per-user channel limit of 50
+    const int perClient = 45;
+    for (int c = 0; c < 3; c++) {
+        for (int i = 0; i < perClient; i++) {
+            sendCommand(clients[c], "JOIN #chan" + std::to_string(c * perClient + i));
+        }
+    }
+    ASSERT_TRUE(waitForOutput("JOIN #chan" + std::to_string(3 * perClient - 1), 2000));
+    clearServerOutput();
+
+    sendCommand(clients[0], "LIST");
+    EXPECT_TRUE(waitForOutput("323 basicUser0 :End of /LIST", 2000));
+    EXPECT_EQ(countInOutput("322 basicUser0 #chan"), 3 * perClient);
+    EXPECT_GT(3 * perClient, static_cast<int>(REPLY_BATCH_LINES));
+}
+
+TEST_F(ListWhoNamesTests, WhoChannel)
+{
+    std::vector<int> clients = basicSetupMultiple(2);
+    int client1 = clients[1];
+
+    sendCommand(client1, "WHO #test");
+    EXPECT_TRUE(outputContains("352 basicUser1 #test testuser 127.0.0.1 " + SERVER_NAME +
+                               " basicUser0 H@ :0"));
+    EXPECT_TRUE(outputContains("352 basicUser1 #test testuser 127.0.0.1 " + SERVER_NAME +
+                               " basicUser1 H :0"));
+    EXPECT_TRUE(outputContains("315 basicUser1 #test :End of /WHO list"));
+    clearServerOutput();
+
+    sendCommand(client1, "WHO basicUser0");
+    EXPECT_TRUE(outputContains("352 basicUser1 * testuser 127.0.0.1"));
+    EXPECT_TRUE(outputContains("315 basicUser1 basicUser0 :End of /WHO list"));
+    clearServerOutput();
+
+    sendCommand(client1, "WHO nobody");
+    EXPECT_FALSE(outputContains("352 basicUser1"));
+    EXPECT_TRUE(outputContains("315 basicUser1 nobody :End of /WHO list"));
+}
+
+TEST_F(ListWhoNamesTests, WhoHidesDelayedJoin)
+{
+    std::vector<int> clients = basicSetupMultiple(2);
+    int client0 = clients[0];
+    int client1 = clients[1];
+
+    sendCommand(client0, "MODE #test +D");
+    int client2 = connectClient();
+    ASSERT_GT(client2, 0);
+    registerClient(client2, "lurker");
+    sendCommand(client2, "JOIN #test");
+    clearServerOutput();
+
+    sendCommand(client1, "WHO #test");
+    EXPECT_TRUE(outputContains("315 basicUser1 #test :End of /WHO list"));
+    EXPECT_FALSE(outputContains(" lurker H"));
+    clearServerOutput();
+
+    sendCommand(client0, "WHO #test");
+    EXPECT_TRUE(outputContains(" lurker H :0"));
+}
+
+TEST_F(ListWhoNamesTests, Whois)
+{
+    std::vector<int> clients = basicSetupMultiple(2);
+    int client0 = clients[0];
+    int client1 = clients[1];
+
+    sendCommand(client1, "WHOIS basicUser0");
+    EXPECT_TRUE(outputContains("311 basicUser1 basicUser0 testuser 127.0.0.1 * :"));
+    EXPECT_TRUE(outputContains("319 basicUser1 basicUser0 :@#test"));
+    EXPECT_TRUE(outputContains("312 basicUser1 basicUser0 " + SERVER_NAME));
+    EXPECT_TRUE(outputContains("318 basicUser1 basicUser0 :End of /WHOIS list"));
+    EXPECT_FALSE(outputContains("313 basicUser1"));
+    clearServerOutput();
+
+    // the server form names the nick last
+    sendCommand(client1, "WHOIS " + SERVER_NAME + " basicUser0");
+    EXPECT_TRUE(outputContains("318 basicUser1 basicUser0 :End of /WHOIS list"));
+    clearServerOutput();
+
+    sendCommand(client1, "WHOIS nobody");
+    EXPECT_TRUE(outputContains("401 basicUser1 nobody :No such nick/channel"));
+    EXPECT_TRUE(outputContains("318 basicUser1 nobody :End of /WHOIS list"));
+    clearServerOutput();
+
+    sendCommand(client1, "WHOIS");
+    EXPECT_TRUE(outputContains("431 basicUser1 :No nickname given"));
+    clearServerOutput();
+
+    // a delayed join stays out of the channel list for non-ops
+    sendCommand(client0, "MODE #test +D");
+    int client2 = connectClient();
+    ASSERT_GT(client2, 0);
+    registerClient(client2, "lurker");
+    sendCommand(client2, "JOIN #test");
+    EXPECT_TRUE(outputContains("366 lurker #test"));
+    clearServerOutput();
+    sendCommand(client1, "WHOIS lurker");
+    EXPECT_TRUE(outputContains("318 basicUser1 lurker :End of /WHOIS list"));
+    EXPECT_FALSE(outputContains("319 basicUser1 lurker"));
+    clearServerOutput();
+    sendCommand(client0, "WHOIS lurker");
+    EXPECT_TRUE(outputContains("319 basicUser0 lurker :#test"));
+}
+
+TEST_F(ListWhoNamesTests, NamesCommand)
+{
+    std::vector<int> clients = basicSetupMultiple(2);
+    int client1 = clients[1];
+
+    sendCommand(client1, "NAMES #test");
+    EXPECT_TRUE(outputContains("353 basicUser1 = #test :@basicUser0 basicUser1"));
+    EXPECT_TRUE(outputContains("366 basicUser1 #test :End of /NAMES list"));
+    clearServerOutput();
+
+    sendCommand(client1, "NAMES #nope");
+    EXPECT_TRUE(outputContains("366 basicUser1 #nope :End of /NAMES list"));
+    clearServerOutput();
+
+    sendCommand(client1, "NAMES");
+    EXPECT_TRUE(outputContains("353 basicUser1 = #test :@basicUser0 basicUser1"));
+    EXPECT_TRUE(outputContains("366 basicUser1 * :End of /NAMES list"));
+}
@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+#include <LoopProfiler.hpp>
+#include <thread>
+
+static double share(const std::string &line)
+{
+    return std::stod(line.substr(line.find("share ") + 6));
+}
+
+TEST(LoopProfilerTest, ChargesEachPhase)
+{
+    LoopProfiler profiler(1000000);
+    profiler.beginIteration();
+    std::this_thread::sleep_for(std::chrono::milliseconds(4));
+    profiler.mark(PHASE_WAIT);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    profiler.mark(PHASE_DISPATCH);
+    profiler.mark(PHASE_PING);
+    EXPECT_FALSE(profiler.endIteration());
+
+    std::vector<std::string> report = profiler.report();
+    ASSERT_EQ(report.size(), 1u + PHASE_COUNT);
+    EXPECT_EQ(report[0], "iterations 1 slow 0, last 1");
+    EXPECT_EQ(report[1 + PHASE_WAIT].rfind("wait mean ", 0), 0u);
+    // the two sleeps are ~2/3 and ~1/3 of the iteration
+    EXPECT_GT(share(report[1 + PHASE_WAIT]), 50.0);
+    EXPECT_GT(share(report[1 + PHASE_DISPATCH]), 20.0);
+    EXPECT_NE(report[1 + PHASE_ACCEPT].find("mean 0.0us max 0.0us share 0.0%"), std::string::npos);
+}
+
+TEST(LoopProfilerTest, WaitingIsNotSlow)
+{
+    LoopProfiler profiler(1000);
+    profiler.beginIteration();
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    profiler.mark(PHASE_WAIT);
+    EXPECT_FALSE(profiler.endIteration());
+
+    profiler.beginIteration();
+    profiler.mark(PHASE_WAIT);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    profiler.mark(PHASE_CHANNELS);
+    EXPECT_TRUE(profiler.endIteration());
+    EXPECT_EQ(profiler.getIterations(), 2u);
+    EXPECT_EQ(profiler.getSlowIterations(), 1u);
+}
@@ -0,0 +1,206 @@
+#include "MemoryTransport.hpp"
+#include <Error.hpp>
+#include <arpa/inet.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+// well clear of anything the test process opens for real
+static const int FIRST_FD = 100000;
+
+MemoryTransport::MemoryTransport(VirtualClock &clock)
+    : _clock(clock)
+    , _listenFd(-1)
+    , _nextFd(FIRST_FD)
+{}
+
+int MemoryTransport::listen(int)
+{
+    _listenFd = _nextFd++;
+    return _listenFd;
+}
+
+int MemoryTransport::accept(int, sockaddr_in *address)
+{
+    if (_backlog.empty()) {
+        errno = EAGAIN;
+        return -1;
+    }
+    int fd = _backlog.front();
+    _backlog.pop_front();
+    *address = _connections[fd].address;
+    return fd;
+}
+
+ssize_t MemoryTransport::send(int fd, const void *data, size_t length)
+{
+    auto it = _connections.find(fd);
+    if (it == _connections.end() || it->second.closed) {
+        errno = EBADF;
+        return -1;
+    }
+    Connection &connection = it->second;
+    if (connection.hungUp) {
+        errno = EPIPE;
+        return -1;
+    }
+    size_t room = connection.window - std::min(connection.window, connection.toClient.size());
+    if (room == 0) {
+        errno = EAGAIN;
+        return -1;
+    }
+    length = std::min(length, room);
+    connection.toClient.append(static_cast<const char *>(data), length);
+    return length;
+}
+
+ssize_t MemoryTransport::recv(int fd, void *buffer, size_t length)
+{
+    auto it = _connections.find(fd);
+    if (it == _connections.end() || it->second.closed) {
+        errno = EBADF;
+        return -1;
+    }
+    Connection &connection = it->second;
+    if (connection.toServer.empty()) {
+        if (connection.hungUp)
+            return 0;
+        errno = EAGAIN;
+        return -1;
+    }
+    length = std::min(length, connection.toServer.size());
+    memcpy(buffer, connection.toServer.data(), length);
+    connection.toServer.erase(0, length);
+    return length;
+}
+
+// fds are never reused, the test can still read what was sent before the close
+void MemoryTransport::close(int fd)
+{
+    auto it = _connections.find(fd);
+    if (it != _connections.end())
+        it->second.closed = true;
+}
+
+std::unique_ptr<EventLoop> MemoryTransport::createEventLoop()
+{
+    return std::make_unique<MemoryEventLoop>(*this);
+}
+
+int MemoryTransport::connect(const std::string &ip)
+{
+    int fd = _nextFd++;
+    Connection &connection = _connections[fd];
+    connection.address.sin_family = AF_INET;
+    inet_pton(AF_INET, ip.c_str(), &connection.address.sin_addr);
+    _backlog.push_back(fd);
+    _touched.insert(_listenFd);
+    return fd;
+}
+
+void MemoryTransport::write(int fd, const std::string &data)
+{
+    _connections[fd].toServer += data;
+    _touched.insert(fd);
+}
+
+std::string MemoryTransport::read(int fd)
+{
+    std::string data;
+    data.swap(_connections[fd].toClient);
+    _touched.insert(fd);
+    return data;
+}
+
+void MemoryTransport::hangUp(int fd)
+{
+    _connections[fd].hungUp = true;
+    _touched.insert(fd);
+}
+
+bool MemoryTransport::isClosed(int fd) const
+{
+    auto it = _connections.find(fd);
+    return it != _connections.end() && it->second.closed;
+}
+
+void MemoryTransport::setReceiveWindow(int fd, size_t bytes)
+{
+    _connections[fd].window = bytes;
+    _touched.insert(fd);
+}
+
+void MemoryTransport::failWatch(int fd)
+{
+    _connections[fd].watchFails = true;
+}
+
+MemoryEventLoop::MemoryEventLoop(MemoryTransport &transport)
+    : _transport(transport)
+{}
+
+void MemoryEventLoop::addToWatch(int fd)
+{
+    _watched.emplace(fd, false);
+    _transport._touched.insert(fd);
+}
+
+void MemoryEventLoop::removeFromWatch(int fd)
+{
+    _watched.erase(fd);
+}
+
+void MemoryEventLoop::watchWritable(int fd, bool enable)
+{
+    auto connection = _transport._connections.find(fd);
+    if (connection != _transport._connections.end() && connection->second.watchFails)
+        throw EventError("Failed to modify fd in epoll: Bad file descriptor");
+    auto it = _watched.find(fd);
+    if (it != _watched.end())
+        it->second = enable;
+    _transport._touched.insert(fd);
+}
+
+std::vector<Event> MemoryEventLoop::waitForEvents(int timeoutMs)
+{
+    std::vector<Event> events;
+    std::set<int> stillReady;
+    for (int fd : _transport._touched) {
+        auto watched = _watched.find(fd);
+        if (watched == _watched.end())
+            continue;
+        uint32_t flags = readiness(fd, watched->second);
+        if (flags == 0)
+            continue;
+        events.push_back({fd, flags});
+        stillReady.insert(fd);
+    }
+    // level triggered: whatever is reported now is looked at again on the next wait
+    _transport._touched.swap(stillReady);
+    if (events.empty() && timeoutMs > 0)
+        _transport._clock.advance(std::chrono::milliseconds(timeoutMs));
+    return events;
+}
+
+uint32_t MemoryEventLoop::readiness(int fd, bool writable) const
+{
+    if (fd == _transport._listenFd)
+        return _transport._backlog.empty() ? 0 : EVENT_READ;
+    auto it = _transport._connections.find(fd);
+    if (it == _transport._connections.end())
+        return 0;
+    const MemoryTransport::Connection &connection = it->second;
+    uint32_t flags = 0;
+    if (!connection.toServer.empty())
+        flags |= EVENT_READ;
+    if (connection.hungUp)
+        flags |= EVENT_READ | EVENT_CLOSE;
+    if (writable && connection.toClient.size() < connection.window)
+        flags |= EVENT_WRITE;
+    return flags;
+}
+
+void MemoryEventLoop::shutdown()
+{
+    _watched.clear();
+}
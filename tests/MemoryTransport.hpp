@@ -0,0 +1,80 @@
+#pragma once
+
+#include <Transport.hpp>
+#include <Clock.hpp>
+#include <EventLoop.hpp>
+#include <deque>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+// Sockets without the kernel. The server side goes through the Transport calls, the test plays
+// the clients with connect/write/read/hangUp. Readiness is worked out when the server waits, so
+// an iteration sees exactly what the test queued before it. Only fds touched since the last
+// wait, or still ready at it, are looked at, so a wait costs nothing for idle connections. An
+// iteration with nothing to do moves the virtual clock by its timeout instead of sleeping.
+class MemoryTransport : public Transport
+{
+public:
+    explicit MemoryTransport(VirtualClock &clock);
+
+    int listen(int port) override;
+    int accept(int listenFd, sockaddr_in *address) override;
+    ssize_t send(int fd, const void *data, size_t length) override;
+    ssize_t recv(int fd, void *buffer, size_t length) override;
+    void close(int fd) override;
+    std::unique_ptr<EventLoop> createEventLoop() override;
+
+    // the client side, a connection is known by the fd the server will accept it as
+    int connect(const std::string &ip = "127.0.0.1");
+    void write(int fd, const std::string &data);
+    // everything the server sent since the last read
+    std::string read(int fd);
+    void hangUp(int fd);
+    bool isClosed(int fd) const;
+    // how much unread output the client side buffers before the server gets EAGAIN
+    void setReceiveWindow(int fd, size_t bytes);
+    // watching fd for writes fails from now on, as epoll does for a socket gone under it
+    void failWatch(int fd);
+
+private:
+    friend class MemoryEventLoop;
+
+    struct Connection
+    {
+        std::string toServer;
+        std::string toClient;
+        size_t window = SIZE_MAX;
+        bool hungUp = false;
+        bool closed = false;
+        bool watchFails = false;
+        sockaddr_in address = {};
+    };
+
+    VirtualClock &_clock;
+    int _listenFd;
+    int _nextFd;
+    std::deque<int> _backlog;
+    std::unordered_map<int, Connection> _connections;
+    // fds whose readiness may have changed, ordered so every run sees events in the same order
+    std::set<int> _touched;
+};
+
+class MemoryEventLoop : public EventLoop
+{
+public:
+    explicit MemoryEventLoop(MemoryTransport &transport);
+
+    void addToWatch(int fd) override;
+    void removeFromWatch(int fd) override;
+    void watchWritable(int fd, bool enable) override;
+    std::vector<Event> waitForEvents(int timeoutMs) override;
+    void shutdown() override;
+
+private:
+    uint32_t readiness(int fd, bool writable) const;
+
+    MemoryTransport &_transport;
+    // fd -> also watched for writing
+    std::unordered_map<int, bool> _watched;
+};
@@ -0,0 +1,172 @@
+#include "TestSetup.hpp"
+#include "SimulationSetup.hpp"
+#include <MessageHistory.hpp>
+
+static std::shared_ptr<const std::string> line(const std::string &text)
+{
+    return std::make_shared<const std::string>(text + "\r\n");
+}
+
+static std::vector<std::string> texts(const std::vector<MessageHistory::Entry> &entries)
+{
+    std::vector<std::string> result;
+    for (const MessageHistory::Entry &entry : entries) {
+        result.push_back(entry.line->substr(0, entry.line->size() - 2));
+    }
+    return result;
+}
+
+static MessageHistory::Ref idRef(const MessageHistory::Entry &entry)
+{
+    return {true, entry.id, 0};
+}
+
+// a replayed line carries the batch tags in front of the original message
+static bool replayed(const std::string &output, const std::string &message)
+{
+    std::istringstream lines(output);
+    std::string entry;
+    while (std::getline(lines, entry)) {
+        if (entry.find("@batch=") != std::string::npos &&
+            entry.find(" :basicUser0!testuser@127.0.0.1 PRIVMSG #test :" + message) !=
+                std::string::npos)
+            return true;
+    }
+    return false;
+}
+
+TEST(MessageHistoryTest, RingKeepsNewestLines)
+{
+    MessageHistory history(4, 1024);
+    for (int i = 0; i < 6; i++) {
+        history.add(line("m" + std::to_string(i)));
+    }
+    EXPECT_EQ(history.size(), 4u);
+    EXPECT_EQ(texts(history.latest(nullptr, 10)),
+              (std::vector<std::string>{"m2", "m3", "m4", "m5"}));
+    EXPECT_EQ(texts(history.latest(nullptr, 2)), (std::vector<std::string>{"m4", "m5"}));
+}
+
+TEST(MessageHistoryTest, ByteCapsAndSharedBuffers)
+{
+    size_t totalBefore = MessageHistory::getTotalBytes();
+    {
+        MessageHistory history(100, 30);
+        std::shared_ptr<const std::string> first = line("0123456789");
+        EXPECT_TRUE(history.add(first));
+        EXPECT_EQ(history.latest(nullptr, 1)[0].line.get(), first.get());
+        history.add(line("abcdefghij"));
+        history.add(line("ABCDEFGHIJ"));
+        EXPECT_EQ(history.size(), 2u);
+        EXPECT_EQ(history.getBytes(), 24u);
+        EXPECT_FALSE(history.add(line(std::string(40, 'x'))));
+        EXPECT_EQ(MessageHistory::getTotalBytes(), totalBefore + 24);
+    }
+    EXPECT_EQ(MessageHistory::getTotalBytes(), totalBefore);
+}
+
+TEST(MessageHistoryTest, Queries)
+{
+    MessageHistory history(16, 1024);
+    for (int i = 0; i < 8; i++) {
+        history.add(line("m" + std::to_string(i)));
+    }
+    std::vector<MessageHistory::Entry> all = history.latest(nullptr, 16);
+    ASSERT_EQ(all.size(), 8u);
+
+    EXPECT_EQ(texts(history.before(idRef(all[4]), 2)), (std::vector<std::string>{"m2", "m3"}));
+    EXPECT_EQ(texts(history.after(idRef(all[4]), 2)), (std::vector<std::string>{"m5", "m6"}));
+    EXPECT_EQ(texts(history.around(idRef(all[4]), 3)),
+              (std::vector<std::string>{"m3", "m4", "m5"}));
+    MessageHistory::Ref after = idRef(all[5]);
+    EXPECT_EQ(texts(history.latest(&after, 10)), (std::vector<std::string>{"m6", "m7"}));
+    EXPECT_EQ(texts(history.between(idRef(all[1]), idRef(all[6]), 2)),
+              (std::vector<std::string>{"m2", "m3"}));
+    // descending references keep the entries closest to the first one
+    EXPECT_EQ(texts(history.between(idRef(all[6]), idRef(all[1]), 2)),
+              (std::vector<std::string>{"m4", "m5"}));
+}
+
+TEST(MessageHistoryTest, References)
+{
+    MessageHistory::Ref ref;
+    ASSERT_TRUE(MessageHistory::parseRef("timestamp=2019-01-04T14:33:26.123Z", ref));
+    EXPECT_FALSE(ref.isId);
+    EXPECT_EQ(ref.timeMs, 1546612406123);
+    EXPECT_EQ(MessageHistory::formatTime(ref.timeMs), "2019-01-04T14:33:26.123Z");
+
+    ASSERT_TRUE(MessageHistory::parseRef("msgid=" + MessageHistory::formatMsgId(0xabc), ref));
+    EXPECT_TRUE(ref.isId);
+    EXPECT_EQ(ref.id, 0xabcu);
+
+    EXPECT_FALSE(MessageHistory::parseRef("msgid=xyz", ref));
+    EXPECT_FALSE(MessageHistory::parseRef("timestamp=2019-01-04", ref));
+    EXPECT_FALSE(MessageHistory::parseRef("*", ref));
+}
+
+TEST_F(TestSetup, ChathistoryReplaysChannelMessages)
+{
+    std::vector<int> clients = basicSetupMultiple(2);
+    for (int i = 0; i < 3; i++) {
+        sendCommand(clients[0], "PRIVMSG #test :history " + std::to_string(i));
+    }
+    ASSERT_TRUE(waitForOutput("PRIVMSG #test :history 2", 1000));
+    sendCommand(clients[1], "CAP REQ :batch server-time message-tags");
+    ASSERT_TRUE(waitForOutput("CAP basicUser1 ACK :batch server-time message-tags", 1000));
+    clearServerOutput();
+
+    sendCommand(clients[1], "CHATHISTORY LATEST #test * 2");
+    EXPECT_TRUE(waitForOutput("BATCH -ch", 1000));
+    EXPECT_TRUE(outputContains("BATCH +ch"));
+    EXPECT_TRUE(outputContains(" chathistory #test"));
+    EXPECT_TRUE(outputContains(";msgid="));
+    EXPECT_FALSE(replayed(getServerOutput(), "history 0"));
+    EXPECT_TRUE(replayed(getServerOutput(), "history 2"));
+    clearServerOutput();
+
+    sendCommand(clients[1], "CHATHISTORY LATEST #test timestamp=2000-01-01T00:00:00.000Z 10");
+    EXPECT_TRUE(waitForOutput("BATCH -ch", 1000));
+    EXPECT_TRUE(replayed(getServerOutput(), "history 0"));
+    clearServerOutput();
+
+    int outsider = connectClient();
+    ASSERT_GT(outsider, 0);
+    registerClient(outsider, "outsider");
+    clearServerOutput();
+    sendCommand(outsider, "CHATHISTORY LATEST #test * 10");
+    EXPECT_TRUE(outputContains("FAIL CHATHISTORY INVALID_TARGET LATEST #test"));
+    sendCommand(outsider, "CHATHISTORY BEFORE #test");
+    EXPECT_TRUE(outputContains("FAIL CHATHISTORY NEED_MORE_PARAMS BEFORE"));
+}
+
+class ChathistoryCapsTests : public SimulationSetup
+{};
+
+// without batch, server-time or message-tags the replay is the plain lines
+TEST_F(ChathistoryCapsTests, PlainClientGetsUntaggedLines)
+{
+    int sender = registerClient("sender");
+    int reader = registerClient("reader");
+    send(sender, "JOIN #plain");
+    send(reader, "JOIN #plain");
+    send(sender, "PRIVMSG #plain :first");
+    send(sender, "PRIVMSG #plain :second");
+    settle();
+    network.read(reader);
+
+    send(reader, "CHATHISTORY LATEST #plain * 10");
+    settle();
+    std::string replay = network.read(reader);
+    EXPECT_EQ(replay, ":sender!testuser@127.0.0.1 PRIVMSG #plain :first\r\n"
+                      ":sender!testuser@127.0.0.1 PRIVMSG #plain :second\r\n");
+
+    send(reader, "CAP REQ :server-time");
+    settle();
+    network.read(reader);
+    send(reader, "CHATHISTORY LATEST #plain * 1");
+    settle();
+    replay = network.read(reader);
+    EXPECT_EQ(replay.rfind("@time=", 0), 0u) << replay;
+    EXPECT_EQ(replay.find("batch"), std::string::npos) << replay;
+    EXPECT_EQ(replay.find("msgid="), std::string::npos) << replay;
+}
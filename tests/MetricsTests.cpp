@@ -0,0 +1,195 @@
+#include "TestSetup.hpp"
+#include <Metrics.hpp>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+TEST(HistogramTest, BucketsBoundTheirValues)
+{
+    for (uint64_t value = 0; value < 16; value++)
+        EXPECT_EQ(Histogram::upperBound(Histogram::bucketOf(value)), value);
+    const uint64_t values[] = {16, 17, 100, 1000, 123456789, 1ull << 40, UINT64_MAX};
+    for (uint64_t value : values) {
+        size_t bucket = Histogram::bucketOf(value);
+        ASSERT_LT(bucket, Histogram::BUCKETS);
+        uint64_t bound = Histogram::upperBound(bucket);
+        EXPECT_GE(bound, value);
+        // at most one eighth above
+        EXPECT_LE(bound - value, value / 8);
+        EXPECT_LT(Histogram::upperBound(bucket - 1), value);
+    }
+}
+
+TEST(HistogramTest, Percentiles)
+{
+    Histogram histogram;
+    for (uint64_t value = 1; value <= 1000; value++)
+        histogram.record(value * 1000);
+    Histogram::Snapshot snapshot = histogram.snapshot();
+    EXPECT_EQ(snapshot.count, 1000u);
+    EXPECT_EQ(snapshot.max, 1000000u);
+    EXPECT_EQ(snapshot.sum, 500500000u);
+    EXPECT_NEAR(snapshot.percentile(0.5), 500000, 500000 / 8);
+    EXPECT_NEAR(snapshot.percentile(0.99), 990000, 990000 / 8);
+    EXPECT_EQ(snapshot.percentile(1.0), 1000000u);
+    EXPECT_EQ(snapshot.countAtMost(UINT64_MAX), 1000u);
+    EXPECT_EQ(Histogram().snapshot().percentile(0.5), 0u);
+}
+
+TEST(HistogramTest, RecordsFromManyThreads)
+{
+    Histogram histogram;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; t++)
+        threads.emplace_back([&histogram, t] {
+            for (int i = 0; i < 10000; i++)
+                histogram.record(t * 100 + i % 7);
+        });
+    for (std::thread &thread : threads)
+        thread.join();
+    Histogram::Snapshot snapshot = histogram.snapshot();
+    EXPECT_EQ(snapshot.count, 80000u);
+    EXPECT_EQ(snapshot.max, 706u);
+}
+
+TEST(MetricsTest, RendersPrometheusText)
+{
+    Metrics registry;
+    registry.registerCommand("PRIVMSG");
+    registry.recordCommand("PRIVMSG", 20000);
+    registry.recordCommand("UNKNOWN", 20000);
+    registry.bytesIn.add(42);
+    registry.fanout.record(3);
+    std::string text = registry.render({{"channels", "Channels.", 2}});
+
+    EXPECT_NE(text.find("# TYPE ft_irc_received_bytes_total counter\n"
+                        "ft_irc_received_bytes_total 42\n"), std::string::npos);
+    EXPECT_NE(text.find("ft_irc_channels 2\n"), std::string::npos);
+    EXPECT_NE(text.find("ft_irc_commands_total{command=\"PRIVMSG\"} 1\n"), std::string::npos);
+    EXPECT_NE(text.find("ft_irc_command_duration_seconds_bucket{command=\"PRIVMSG\","
+                        "le=\"1e-05\"} 0\n"), std::string::npos);
+    EXPECT_NE(text.find("ft_irc_command_duration_seconds_bucket{command=\"PRIVMSG\","
+                        "le=\"5e-05\"} 1\n"), std::string::npos);
+    EXPECT_NE(text.find("ft_irc_broadcast_recipients_bucket{le=\"2\"} 0\n"
+                        "ft_irc_broadcast_recipients_bucket{le=\"5\"} 1\n"), std::string::npos);
+    EXPECT_EQ(text.find("UNKNOWN"), std::string::npos);
+}
+
+class MetricsServerTests : public TestSetup
+{
+protected:
+    // per test and process, runs in parallel must not share the socket
+    std::string path = testing::TempDir() + "ft_irc_metrics_" +
+                       testing::UnitTest::GetInstance()->current_test_info()->name() + "_" +
+                       std::to_string(getpid()) + ".sock";
+
+    MetricsServerTests()
+        : TestSetup(true)
+    {
+        setenv("FT_IRC_OPER", "admin:secret", 1);
+        setenv("FT_IRC_ADMIN_SOCKET", path.c_str(), 1);
+    }
+
+    ~MetricsServerTests()
+    {
+        unsetenv("FT_IRC_OPER");
+        unsetenv("FT_IRC_ADMIN_SOCKET");
+    }
+
+    int connectAdmin()
+    {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+        if (connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    // sends request on a connection from connectAdmin and reads the response, closes fd
+    std::string exchange(int fd, const std::string &request)
+    {
+        std::string response;
+        if (fd >= 0 && send(fd, request.c_str(), request.size(), MSG_NOSIGNAL) ==
+                           static_cast<ssize_t>(request.size())) {
+            char buffer[4096];
+            ssize_t got;
+            while ((got = recv(fd, buffer, sizeof(buffer), 0)) > 0)
+                response.append(buffer, got);
+        }
+        close(fd);
+        return response;
+    }
+
+    std::string scrape()
+    {
+        return exchange(connectAdmin(), "GET /metrics HTTP/1.0\r\nHost: localhost\r\n\r\n");
+    }
+};
+
+TEST_F(MetricsServerTests, StatsNeedsOper)
+{
+    int client = connectClient();
+    ASSERT_GT(client, 0);
+    registerClient(client, "watcher");
+    clearServerOutput();
+
+    sendCommand(client, "STATS z");
+    EXPECT_TRUE(outputContains("481 watcher :Permission Denied"));
+    sendCommand(client, "OPER nobody secret");
+    EXPECT_TRUE(outputContains("491 watcher"));
+    sendCommand(client, "OPER admin wrong");
+    EXPECT_TRUE(outputContains("464 watcher :Password incorrect"));
+    sendCommand(client, "OPER admin secret");
+    EXPECT_TRUE(outputContains("381 watcher :You are now an IRC operator"));
+    clearServerOutput();
+
+    sendCommand(client, "STATS m");
+    EXPECT_TRUE(outputContains("212 watcher OPER 3 0 0"));
+    EXPECT_TRUE(outputContains("219 watcher m :End of /STATS report"));
+    sendCommand(client, "STATS z");
+    EXPECT_TRUE(outputContains("249 watcher z :clients 1"));
+    EXPECT_TRUE(outputContains("249 watcher z :OPER 3 p50 "));
+    EXPECT_TRUE(outputContains("219 watcher z :End of /STATS report"));
+}
+
+TEST_F(MetricsServerTests, AdminSocketServesMetrics)
+{
+    int client = connectClient();
+    ASSERT_GT(client, 0);
+    registerClient(client, "talker");
+    sendCommand(client, "JOIN #metrics");
+    // the scrape must not overtake the JOIN on the server thread
+    ASSERT_TRUE(outputContains("366 talker #metrics"));
+
+    std::string response = scrape();
+    EXPECT_EQ(response.rfind("HTTP/1.0 200 OK\r\n", 0), 0u);
+    EXPECT_NE(response.find("Content-Type: text/plain; version=0.0.4"), std::string::npos);
+    EXPECT_NE(response.find("\nft_irc_clients 1\n"), std::string::npos);
+    EXPECT_NE(response.find("\nft_irc_channels 1\n"), std::string::npos);
+    EXPECT_NE(response.find("ft_irc_commands_total{command=\"JOIN\"}"), std::string::npos);
+    EXPECT_NE(response.find("ft_irc_registrations_total"), std::string::npos);
+}
+
+TEST_F(MetricsServerTests, AdminSocketWaitsForTheRequest)
+{
+    // a scraper that has not sent its request yet must not hold up the clients
+    int idle = connectAdmin();
+    ASSERT_GE(idle, 0);
+    int client = connectClient();
+    ASSERT_GT(client, 0);
+    registerClient(client, "talker");
+    sendCommand(client, "PING idle");
+    EXPECT_TRUE(outputContains("PONG"));
+
+    std::string response = exchange(idle, "GET / HTTP/1.0\r\n\r\n");
+    EXPECT_EQ(response.rfind("HTTP/1.0 200 OK\r\n", 0), 0u);
+    EXPECT_NE(response.find("\nft_irc_clients 1\n"), std::string::npos);
+
+    response = exchange(connectAdmin(), "POST /metrics HTTP/1.0\r\n\r\n");
+    EXPECT_EQ(response.rfind("HTTP/1.0 405 Method Not Allowed\r\n", 0), 0u);
+    EXPECT_EQ(response.find("ft_irc_clients"), std::string::npos);
+}
@@ -152,9 +152,7 @@ TEST_F(ModeTests, MultipleModesAtOnce)
 
     // Set multiple modes at once
     sendCommand(client0, "MODE #test +i+t+k testkey");
-    EXPECT_TRUE(outputContains(":basicUser0!testuser@127.0.0.1 MODE #test +i"));
-    EXPECT_TRUE(outputContains(":basicUser0!testuser@127.0.0.1 MODE #test +t"));
-    EXPECT_TRUE(outputContains(":basicUser0!testuser@127.0.0.1 MODE #test +k testkey"));
+    EXPECT_TRUE(outputContains(":basicUser0!testuser@127.0.0.1 MODE #test +itk testkey"));
     clearServerOutput();
 
     // Check that all modes are set
@@ -164,9 +162,7 @@ TEST_F(ModeTests, MultipleModesAtOnce)
 
     // Remove multiple modes at once
     sendCommand(client0, "MODE #test -i-t-k");
-    EXPECT_TRUE(outputContains(":basicUser0!testuser@127.0.0.1 MODE #test -i"));
-    EXPECT_TRUE(outputContains(":basicUser0!testuser@127.0.0.1 MODE #test -t"));
-    EXPECT_TRUE(outputContains(":basicUser0!testuser@127.0.0.1 MODE #test -k"));
+    EXPECT_TRUE(outputContains(":basicUser0!testuser@127.0.0.1 MODE #test -itk"));
     clearServerOutput();
 
     // Check that modes are removed
@@ -177,6 +173,112 @@ TEST_F(ModeTests, MultipleModesAtOnce)
     clearServerOutput();
 }
 
+// Test a burst of mode changes is folded into MODES sized lines
+TEST_F(ModeTests, CoalescedBroadcast)
+{
+    std::vector<int> clients = basicSetupMultiple(4);
+    int client0 = clients[0]; // op
+
+    sendCommand(client0, "MODE #test +ooo-t+l basicUser1 basicUser2 basicUser3 10");
+    EXPECT_TRUE(outputContains(
+        ":basicUser0!testuser@127.0.0.1 MODE #test +ooo basicUser1 basicUser2 basicUser3"));
+    // -t is a no-op on a fresh channel, so only +l is left for the second line
+    EXPECT_TRUE(outputContains(":basicUser0!testuser@127.0.0.1 MODE #test +l 10"));
+    // one line per member for each of the two MODE lines
+    EXPECT_EQ(countInOutput(":basicUser0!testuser@127.0.0.1 MODE #test +"), 8);
+    clearServerOutput();
+
+    // repeating the same changes alters nothing and broadcasts nothing
+    sendCommand(client0, "MODE #test +oo basicUser1 basicUser2");
+    EXPECT_FALSE(outputContains(":basicUser0!testuser@127.0.0.1 MODE #test +o"));
+    clearServerOutput();
+}
+
+// Test +D hides joins until the member speaks
+TEST_F(ModeTests, DelayedJoin)
+{
+    std::vector<int> clients = basicSetupMultiple(2);
+    int client0 = clients[0]; // op
+    int client1 = clients[1]; // regular user
+
+    sendCommand(client0, "MODE #test +D");
+    EXPECT_TRUE(outputContains(":basicUser0!testuser@127.0.0.1 MODE #test +D"));
+    clearServerOutput();
+
+    int client2 = connectClient();
+    ASSERT_GT(client2, 0);
+    registerClient(client2, "lurker");
+    sendCommand(client2, "JOIN #test");
+    EXPECT_TRUE(outputContains("366 lurker #test"));
+    // only the joiner itself got the JOIN
+    EXPECT_EQ(countInOutput(":lurker!testuser@127.0.0.1 JOIN #test"), 1);
+    clearServerOutput();
+
+    // non-ops only see visible members
+    sendCommand(client1, "JOIN #test");
+    sendCommand(client1, "PART #test");
+    sendCommand(client1, "JOIN #test");
+    EXPECT_TRUE(outputContains("353 basicUser1 = #test :"));
+    EXPECT_FALSE(waitForOutput("lurker", 200));
+    clearServerOutput();
+
+    // first message reveals the join to everyone else
+    sendCommand(client2, "PRIVMSG #test :hello");
+    EXPECT_TRUE(outputContains(":lurker!testuser@127.0.0.1 PRIVMSG #test :hello"));
+    EXPECT_EQ(countInOutput(":lurker!testuser@127.0.0.1 JOIN #test"), 2);
+    clearServerOutput();
+}
+
+// Test a hidden member's NAMES query still lists itself, as the reply to its JOIN does
+TEST_F(ModeTests, DelayedJoinNamesShowsSelf)
+{
+    std::vector<int> clients = basicSetupMultiple(2);
+    int client0 = clients[0]; // op
+
+    sendCommand(client0, "MODE #test +D");
+    EXPECT_TRUE(outputContains(":basicUser0!testuser@127.0.0.1 MODE #test +D"));
+    int client2 = connectClient();
+    ASSERT_GT(client2, 0);
+    registerClient(client2, "lurker");
+    sendCommand(client2, "JOIN #test");
+    EXPECT_TRUE(outputContains("353 lurker = #test :lurker"));
+    EXPECT_TRUE(outputContains("366 lurker #test"));
+    clearServerOutput();
+
+    sendCommand(client2, "NAMES #test");
+    EXPECT_TRUE(outputContains("366 lurker #test"));
+    EXPECT_TRUE(outputContains("353 lurker = #test :lurker"));
+    // still hidden from everyone else
+    EXPECT_EQ(countInOutput(":lurker!testuser@127.0.0.1 JOIN #test"), 0);
+    clearServerOutput();
+}
+
+// Test a hidden member setting the topic is revealed first
+TEST_F(ModeTests, DelayedJoinTopicReveals)
+{
+    std::vector<int> clients = basicSetupMultiple(2);
+    int client0 = clients[0]; // op
+
+    sendCommand(client0, "MODE #test -t");
+    sendCommand(client0, "MODE #test +D");
+    EXPECT_TRUE(outputContains(":basicUser0!testuser@127.0.0.1 MODE #test +D"));
+    int client2 = connectClient();
+    ASSERT_GT(client2, 0);
+    registerClient(client2, "lurker");
+    sendCommand(client2, "JOIN #test");
+    EXPECT_TRUE(outputContains("366 lurker #test"));
+    clearServerOutput();
+
+    sendCommand(client2, "TOPIC #test :lurking");
+    EXPECT_TRUE(outputContains(":lurker!testuser@127.0.0.1 TOPIC #test :lurking"));
+    EXPECT_EQ(countInOutput(":lurker!testuser@127.0.0.1 JOIN #test"), 2);
+    // the JOIN goes out ahead of the TOPIC
+    std::string output = getServerOutput();
+    EXPECT_LT(output.find(":lurker!testuser@127.0.0.1 JOIN #test"),
+              output.find(":lurker!testuser@127.0.0.1 TOPIC #test"));
+    clearServerOutput();
+}
+
 // Test Nick change op permissions
 TEST_F(ModeTests, NickChangeOp)
 {
@@ -229,3 +331,64 @@ TEST_F(ModeTests, ErrorCases)
     EXPECT_TRUE(outputContains("441 basicUser0 outsider #test :They aren't on that channel"));
     clearServerOutput();
 }
+
+// +b keeps matching users out and quiet, +e overrides it, +I lets users past +i
+TEST_F(ModeTests, BanExceptionInvex)
+{
+    std::vector<int> clients = basicSetupMultiple(2);
+    int client0 = clients[0]; // op
+    int client1 = clients[1];
+
+    sendCommand(client0, "MODE #test +b basicUser1");
+    EXPECT_TRUE(outputContains(":basicUser0!testuser@127.0.0.1 MODE #test +b basicUser1!*@*"));
+    clearServerOutput();
+
+    sendCommand(client1, "PRIVMSG #test :hello");
+    EXPECT_TRUE(outputContains("404 basicUser1 #test :Cannot send to channel"));
+    clearServerOutput();
+
+    sendCommand(client0, "MODE #test b");
+    EXPECT_TRUE(outputContains("367 basicUser0 #test basicUser1!*@* basicUser0!testuser@127.0.0.1"));
+    EXPECT_TRUE(outputContains("368 basicUser0 #test :End of channel ban list"));
+    clearServerOutput();
+
+    int client2 = connectClient();
+    ASSERT_GT(client2, 0);
+    registerClient(client2, "banned");
+    sendCommand(client0, "MODE #test +b *!*@127.0.0.*");
+    clearServerOutput();
+    sendCommand(client2, "JOIN #test");
+    EXPECT_TRUE(outputContains("474 banned #test :Cannot join channel (+b)"));
+    clearServerOutput();
+
+    sendCommand(client0, "MODE #test +e banned");
+    EXPECT_TRUE(outputContains("MODE #test +e banned!*@*"));
+    clearServerOutput();
+    sendCommand(client2, "JOIN #test");
+    EXPECT_TRUE(outputContains(":banned!testuser@127.0.0.1 JOIN #test"));
+    clearServerOutput();
+
+    // a new ban list version drops the cached result for members
+    sendCommand(client0, "MODE #test -b *!*@127.0.0.*");
+    sendCommand(client0, "MODE #test -b basicUser1!*@*");
+    clearServerOutput();
+    sendCommand(client1, "PRIVMSG #test :hello again");
+    EXPECT_FALSE(outputContains("404 basicUser1"));
+    clearServerOutput();
+
+    int client3 = connectClient();
+    ASSERT_GT(client3, 0);
+    registerClient(client3, "invexed");
+    sendCommand(client0, "MODE #test +i");
+    sendCommand(client3, "JOIN #test");
+    EXPECT_TRUE(outputContains("473 invexed #test"));
+    clearServerOutput();
+    sendCommand(client0, "MODE #test +I invexed!*@*");
+    sendCommand(client3, "JOIN #test");
+    EXPECT_TRUE(outputContains(":invexed!testuser@127.0.0.1 JOIN #test"));
+    clearServerOutput();
+
+    sendCommand(client0, "MODE #test I");
+    EXPECT_TRUE(outputContains("346 basicUser0 #test invexed!*@*"));
+    EXPECT_TRUE(outputContains("347 basicUser0 #test"));
+}
@@ -0,0 +1,62 @@
+#include "TestSetup.hpp"
+
+TEST_F(TestSetup, MonitorPresence)
+{
+    int watcher = connectClient();
+    ASSERT_GT(watcher, 0);
+    registerClient(watcher, "watcher");
+    int online = connectClient();
+    ASSERT_GT(online, 0);
+    registerClient(online, "friendA");
+    clearServerOutput();
+
+    sendCommand(watcher, "MONITOR + FRIENDA,friendB");
+    EXPECT_TRUE(outputContains("730 watcher :friendA!testuser@127.0.0.1"));
+    EXPECT_TRUE(outputContains("731 watcher :friendB"));
+    clearServerOutput();
+
+    int later = connectClient();
+    ASSERT_GT(later, 0);
+    registerClient(later, "friendB");
+    EXPECT_TRUE(waitForOutput("730 watcher :friendB!testuser@127.0.0.1", 1000));
+    clearServerOutput();
+
+    sendCommand(later, "NICK stranger");
+    EXPECT_TRUE(outputContains("731 watcher :friendB"));
+    EXPECT_FALSE(outputContains("730 watcher :stranger"));
+    clearServerOutput();
+
+    sendCommand(online, "QUIT :bye");
+    EXPECT_TRUE(waitForOutput("731 watcher :friendA", 1000));
+    clearServerOutput();
+
+    sendCommand(watcher, "MONITOR L");
+    EXPECT_TRUE(outputContains("732 watcher :FRIENDA,friendB"));
+    EXPECT_TRUE(outputContains("733 watcher :End of MONITOR list"));
+    clearServerOutput();
+
+    sendCommand(watcher, "MONITOR - friendB");
+    sendCommand(watcher, "MONITOR S");
+    EXPECT_TRUE(outputContains("731 watcher :FRIENDA"));
+    EXPECT_FALSE(outputContains("FRIENDA,friendB"));
+    clearServerOutput();
+
+    // only watchers hear about anyone
+    sendCommand(later, "NICK friendB");
+    EXPECT_FALSE(outputContains("730"));
+}
+
+TEST_F(TestSetup, MonitorListFull)
+{
+    int watcher = connectClient();
+    ASSERT_GT(watcher, 0);
+    registerClient(watcher, "watcher");
+    std::string targets;
+    for (size_t i = 0; i < MONITOR_LIMIT; i++) {
+        targets += (targets.empty() ? "n" : ",n") + std::to_string(i);
+    }
+    sendCommand(watcher, "MONITOR + " + targets);
+    clearServerOutput();
+    sendCommand(watcher, "MONITOR + extra1,extra2");
+    EXPECT_TRUE(outputContains("734 watcher 100 extra1,extra2 :Monitor list is full"));
+}
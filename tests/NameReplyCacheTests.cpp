@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+#include <NameReplyCache.hpp>
+#include <Client.hpp>
+
+class NameReplyCacheTest : public ::testing::Test
+{
+protected:
+    // room for three 5 character entries per chunk
+    NameReplyCache cache{17};
+    Client alice{20};
+    Client bobby{21};
+    Client carol{22};
+    Client david{23};
+};
+
+// Test entries fill chunks up to the limit
+TEST_F(NameReplyCacheTest, FillsChunks)
+{
+    cache.add(&alice, "alice");
+    cache.add(&bobby, "@bobb");
+    cache.add(&carol, "carol");
+    cache.add(&david, "david");
+
+    ASSERT_EQ(cache.getChunks().size(), 2u);
+    EXPECT_EQ(cache.getChunks()[0], "alice @bobb carol");
+    EXPECT_EQ(cache.getChunks()[1], "david");
+    EXPECT_EQ(cache.size(), 4u);
+}
+
+// Test removal only drops the exact entry and frees room for the next add
+TEST_F(NameReplyCacheTest, RemoveAndReuse)
+{
+    cache.add(&alice, "ab");
+    cache.add(&bobby, "abc");
+    cache.add(&carol, "a");
+    cache.remove(&alice);
+    EXPECT_EQ(cache.getChunks()[0], "abc a");
+    EXPECT_FALSE(cache.contains(&alice));
+
+    cache.add(&david, "dd");
+    ASSERT_EQ(cache.getChunks().size(), 1u);
+    EXPECT_EQ(cache.getChunks()[0], "abc a dd");
+
+    cache.remove(&bobby);
+    cache.remove(&carol);
+    cache.remove(&david);
+    EXPECT_TRUE(cache.getChunks().empty());
+}
+
+// Test op and nick changes rewrite the entry
+TEST_F(NameReplyCacheTest, Update)
+{
+    cache.add(&alice, "alice");
+    cache.add(&bobby, "bobby");
+    cache.update(&alice, "@alice");
+    EXPECT_EQ(cache.getChunks()[0], "bobby @alice");
+
+    // no longer fits next to bobby, moves to a new chunk
+    cache.update(&bobby, "bobby_longer");
+    ASSERT_EQ(cache.getChunks().size(), 2u);
+    EXPECT_EQ(cache.getChunks()[0], "@alice");
+    EXPECT_EQ(cache.getChunks()[1], "bobby_longer");
+}
+
+// Test chunks dropped from the end and created again are not reused twice
+TEST_F(NameReplyCacheTest, ShrinkAndRegrow)
+{
+    cache.add(&alice, "alice");
+    cache.add(&bobby, "bobby");
+    cache.add(&carol, "carol");
+    cache.add(&david, "david");
+    cache.remove(&david);
+    cache.remove(&bobby);
+    ASSERT_EQ(cache.getChunks().size(), 1u);
+
+    // the second chunk comes back at the index it was dropped from and is released again
+    cache.add(&bobby, "bobby");
+    cache.add(&david, "david");
+    ASSERT_EQ(cache.getChunks().size(), 2u);
+    cache.remove(&david);
+    cache.add(&david, "dave");
+    ASSERT_EQ(cache.getChunks().size(), 2u);
+    EXPECT_EQ(cache.getChunks()[0], "alice carol bobby");
+    EXPECT_EQ(cache.getChunks()[1], "dave");
+    cache.remove(&alice);
+    cache.add(&alice, "alic");
+    EXPECT_EQ(cache.getChunks()[0], "carol bobby alic");
+}
@@ -78,3 +78,20 @@ TEST_F(NickNameTests, TooLong)
                    outputContains("432 basicUser0 " + longNick);
     EXPECT_TRUE(success);
 }
+
+// Test peers sharing several channels see the nick change only once
+TEST_F(NickNameTests, DeliveredOncePerPeer)
+{
+    std::vector<int> clients = basicSetupMultiple(2);
+    int client0 = clients[0];
+    int client1 = clients[1];
+
+    sendCommand(client0, "JOIN #chan1,#chan2");
+    sendCommand(client1, "JOIN #chan1,#chan2");
+    clearServerOutput();
+
+    sendCommand(client0, "NICK newname");
+    EXPECT_TRUE(outputContains(":basicUser0!testuser@127.0.0.1 NICK newname"));
+    // once for the changer, once for the single peer
+    EXPECT_EQ(countInOutput(":basicUser0!testuser@127.0.0.1 NICK newname"), 2);
+}
@@ -202,3 +202,20 @@ TEST_F(PartQuitTests, QuitFromMultipleChannels)
 
     // Cannot verify further commands from client2 since socket is closed
 }
+
+// Test peers sharing several channels get the QUIT only once
+TEST_F(PartQuitTests, QuitDeliveredOncePerPeer)
+{
+    std::vector<int> clients = basicSetupMultiple(2);
+    int client0 = clients[0]; // stays
+    int client1 = clients[1]; // quits
+
+    sendCommand(client0, "JOIN #chan1,#chan2");
+    sendCommand(client1, "JOIN #chan1,#chan2");
+    clearServerOutput();
+
+    sendCommand(client1, "QUIT :shared channels");
+    EXPECT_TRUE(outputContains("ERROR :Quit: shared channels"));
+    EXPECT_EQ(countInOutput(":basicUser1!testuser@127.0.0.1 QUIT :Quit: shared channels"), 1);
+    clearServerOutput();
+}
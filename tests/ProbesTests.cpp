@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+#include <MappedFile.hpp>
+#include <Probes.hpp>
+#include <cstring>
+#include <map>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <elf.h>
+
+namespace {
+
+struct ProbeNote
+{
+    uint64_t location;
+    std::string provider;
+    std::string name;
+    std::string arguments;
+};
+
+// the probe descriptors a tracer would find in this binary, which links the server library
+std::vector<ProbeNote> readProbes(const MappedFile &binary, std::vector<Elf64_Shdr> &sections)
+{
+    const char *data = binary.data();
+    Elf64_Ehdr header;
+    memcpy(&header, data, sizeof(header));
+    sections.resize(header.e_shnum);
+    memcpy(sections.data(), data + header.e_shoff, header.e_shnum * sizeof(Elf64_Shdr));
+    const char *sectionNames = data + sections[header.e_shstrndx].sh_offset;
+
+    std::vector<ProbeNote> probes;
+    for (const Elf64_Shdr &section : sections) {
+        if (strcmp(sectionNames + section.sh_name, ".note.stapsdt") != 0)
+            continue;
+        const char *note = data + section.sh_offset;
+        const char *end = note + section.sh_size;
+        while (note < end) {
+            Elf64_Nhdr noteHeader;
+            memcpy(&noteHeader, note, sizeof(noteHeader));
+            const char *desc = note + sizeof(noteHeader) + ((noteHeader.n_namesz + 3) & ~3u);
+            if (noteHeader.n_type == 3) {
+                ProbeNote probe;
+                memcpy(&probe.location, desc, sizeof(probe.location));
+                const char *strings = desc + 3 * sizeof(uint64_t);
+                probe.provider = strings;
+                probe.name = strings + probe.provider.size() + 1;
+                probe.arguments = strings + probe.provider.size() + probe.name.size() + 2;
+                probes.push_back(probe);
+            }
+            note = desc + ((noteHeader.n_descsz + 3) & ~3u);
+        }
+    }
+    return probes;
+}
+
+} // namespace
+
+TEST(ProbesTest, EveryProbeIsANopWithItsArguments)
+{
+#ifndef PROBE_ASM
+    GTEST_SKIP() << "built without FT_IRC_PROBES";
+#endif
+    MappedFile binary("/proc/self/exe");
+    ASSERT_GT(binary.size(), sizeof(Elf64_Ehdr));
+    std::vector<Elf64_Shdr> sections;
+    std::map<std::string, size_t> arguments;
+    for (const ProbeNote &probe : readProbes(binary, sections)) {
+        if (probe.provider != "ft_irc")
+            continue;
+        arguments[probe.name] = std::count(probe.arguments.begin(), probe.arguments.end(), '@');
+        // the file bytes at the probe's address are what runs until a tracer attaches
+        for (const Elf64_Shdr &section : sections) {
+            if (!(section.sh_flags & SHF_EXECINSTR) || probe.location < section.sh_addr ||
+                probe.location >= section.sh_addr + section.sh_size)
+                continue;
+            const char *code = binary.data() + section.sh_offset + probe.location - section.sh_addr;
+#if defined(__x86_64__)
+            EXPECT_EQ(static_cast<unsigned char>(*code), 0x90) << probe.name;
+#elif defined(__aarch64__)
+            uint32_t instruction;
+            memcpy(&instruction, code, sizeof(instruction));
+            EXPECT_EQ(instruction, 0xd503201fu) << probe.name;
+#endif
+        }
+    }
+    EXPECT_EQ(arguments, (std::map<std::string, size_t>{{"accept", 1},
+                                                        {"receive", 2},
+                                                        {"parse", 3},
+                                                        {"dispatch", 2},
+                                                        {"broadcast", 3},
+                                                        {"send", 2},
+                                                        {"disconnect", 1}}));
+}
@@ -0,0 +1,71 @@
+#include "TestSetup.hpp"
+#include <ClientIndex.hpp>
+#include <Client.hpp>
+#include <regex>
+
+TEST(ClientIndexTest, DetachedSessionsExpire)
+{
+    ClientIndex clients;
+    clients.add(100);
+    Client &client = clients.getByFd(100);
+    std::string token = clients.issueResumeToken(client);
+    EXPECT_EQ(token.size(), 32u);
+
+    auto now = std::chrono::steady_clock::now();
+    clients.detach(client, "Connection closed", now + std::chrono::seconds(RESUME_GRACE_SEC));
+    EXPECT_EQ(clients.findByFd(100), nullptr);
+    EXPECT_EQ(clients.findDetached(token), &client);
+    EXPECT_EQ(client.getFd(), -1);
+    EXPECT_TRUE(clients.expiredDetached(now).empty());
+
+    auto expired = clients.expiredDetached(now + std::chrono::seconds(RESUME_GRACE_SEC));
+    ASSERT_EQ(expired.size(), 1u);
+    EXPECT_EQ(expired[0].first, &client);
+    EXPECT_EQ(expired[0].second, "Connection closed");
+    clients.remove(client);
+    EXPECT_EQ(clients.detachedCount(), 0u);
+}
+
+TEST_F(TestSetup, ResumeReattachesWithoutFanOut)
+{
+    std::vector<int> clients = basicSetupMultiple(1);
+    int original = connectClient();
+    ASSERT_GT(original, 0);
+    sendCommand(original, "CAP LS 302");
+    sendCommand(original, "CAP REQ :draft/resume-0.5");
+    registerClient(original, "resumer");
+    sendCommand(original, "CAP END");
+    ASSERT_TRUE(waitForOutput("RESUME TOKEN ", 1000));
+    std::smatch match;
+    std::string output = getServerOutput();
+    ASSERT_TRUE(std::regex_search(output, match, std::regex("RESUME TOKEN ([0-9a-f]+)")));
+    std::string token = match[1];
+    sendCommand(original, "JOIN #test");
+    ASSERT_TRUE(waitForOutput(":resumer!testuser@127.0.0.1 JOIN #test", 1000));
+
+    close(original);
+    ASSERT_TRUE(waitForOutput("Client resumer detached: Connection", 1000));
+    clearServerOutput();
+
+    int replacement = connectClient();
+    ASSERT_GT(replacement, 0);
+    sendCommand(replacement, "CAP LS 302");
+    sendCommand(replacement, "PASS 42");
+    sendCommand(replacement, "RESUME " + token);
+    sendCommand(replacement, "CAP END");
+    EXPECT_TRUE(waitForOutput("RESUME SUCCESS resumer", 1000));
+    EXPECT_FALSE(outputContains("001 resumer"));
+    EXPECT_FALSE(outputContains("QUIT"));
+
+    // still a member, and the old token is spent
+    sendCommand(replacement, "PRIVMSG #test :back again");
+    EXPECT_TRUE(outputContains(":resumer!testuser@127.0.0.1 PRIVMSG #test :back again"));
+    EXPECT_FALSE(outputContains("JOIN #test"));
+
+    int thief = connectClient();
+    ASSERT_GT(thief, 0);
+    sendCommand(thief, "PASS 42");
+    sendCommand(thief, "RESUME " + token);
+    EXPECT_TRUE(outputContains("FAIL RESUME INVALID_TOKEN"));
+    (void)clients;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include <Server.hpp>
+#include <ConnectionManager.hpp>
+#include <Clock.hpp>
+#include <Log.hpp>
+#include "MemoryTransport.hpp"
+#include <string>
+
+// Runs a Server on the test's own thread over MemoryTransport and a VirtualClock. Nothing
+// sleeps and nothing binds a port: the test queues client input, then iterates the server
+// until it has nothing left to do, and idle iterations are what move time forward.
+class SimulationSetup : public ::testing::Test
+{
+protected:
+    VirtualClock clock;
+    // the server logs every line, nobody reads it here
+    QuietLog log;
+    MemoryTransport network{clock};
+    Server *server = nullptr;
+    FloodPolicy floodPolicy;
+
+    SimulationSetup()
+    {
+        floodPolicy.enabled = false;
+    }
+
+    void SetUp() override
+    {
+        Log::install(&log);
+        Clock::install(&clock);
+        Transport::install(&network);
+        server = new Server(6667, "42", false);
+        server->getConnectionManager().setFloodPolicy(floodPolicy);
+    }
+
+    void TearDown() override
+    {
+        delete server;
+        server = nullptr;
+        Transport::install(nullptr);
+        Clock::install(nullptr);
+        Log::install(nullptr);
+    }
+
+    // iterates until an iteration finds nothing to do, which costs that iteration's timeout
+    void settle()
+    {
+        Clock::TimePoint before;
+        do {
+            before = clock.current();
+            server->iterate();
+        } while (clock.current() == before);
+    }
+
+    // virtual time, the server runs whatever falls due on the way
+    void runFor(std::chrono::milliseconds duration)
+    {
+        Clock::TimePoint end = clock.current() + duration;
+        while (clock.current() < end)
+            server->iterate();
+    }
+
+    void send(int fd, const std::string &line)
+    {
+        network.write(fd, line + "\r\n");
+    }
+
+    // connected and welcomed, with the welcome burst already read
+    int registerClient(const std::string &nick)
+    {
+        int fd = network.connect();
+        send(fd, "PASS 42");
+        send(fd, "NICK " + nick);
+        send(fd, "USER testuser 0 * :Test User");
+        settle();
+        std::string welcome = network.read(fd);
+        EXPECT_NE(welcome.find(" 001 " + nick + " "), std::string::npos) << welcome;
+        return fd;
+    }
+};
@@ -0,0 +1,168 @@
+#include "SimulationSetup.hpp"
+#include <common.hpp>
+#include <vector>
+
+TEST_F(SimulationSetup, ChannelMessagesWithoutSockets)
+{
+    int alice = registerClient("alice");
+    int bob = registerClient("bob");
+    send(alice, "JOIN #sim");
+    settle();
+    send(bob, "JOIN #sim");
+    settle();
+    EXPECT_NE(network.read(alice).find(":bob!testuser@127.0.0.1 JOIN #sim"), std::string::npos);
+    network.read(bob);
+
+    send(alice, "PRIVMSG #sim :hello");
+    settle();
+    EXPECT_EQ(network.read(bob), ":alice!testuser@127.0.0.1 PRIVMSG #sim :hello\r\n");
+    EXPECT_EQ(network.read(alice), "");
+
+    network.hangUp(bob);
+    settle();
+    EXPECT_TRUE(network.isClosed(bob));
+    EXPECT_NE(network.read(alice).find(":bob!testuser@127.0.0.1 QUIT :Connection closed"),
+              std::string::npos);
+}
+
+// a socket that can't be watched for writes is dropped after the fan-out, not in the middle of it
+TEST_F(SimulationSetup, FailedWriteWatchDoesNotCutFanoutShort)
+{
+    int sender = registerClient("sender");
+    std::vector<int> members;
+    for (const char *nick : {"a", "b", "c", "d"})
+        members.push_back(registerClient(nick));
+    for (int fd : members)
+        send(fd, "JOIN #fanout");
+    send(sender, "JOIN #fanout");
+    settle();
+    for (int fd : members)
+        network.read(fd);
+    int broken = members[1];
+    network.setReceiveWindow(broken, 0);
+    network.failWatch(broken);
+
+    send(sender, "PRIVMSG #fanout :still delivered");
+    settle();
+    EXPECT_TRUE(network.isClosed(broken));
+    for (int fd : members) {
+        if (fd == broken)
+            continue;
+        std::string output = network.read(fd);
+        EXPECT_NE(output.find("PRIVMSG #fanout :still delivered"), std::string::npos) << fd;
+        EXPECT_NE(output.find(":b!testuser@127.0.0.1 QUIT :Connection error"), std::string::npos);
+    }
+}
+
+// ten thousand clients through a ping interval and a ping timeout, in virtual time
+TEST_F(SimulationSetup, PingTimeoutsAtScale)
+{
+    const int count = 10000;
+    std::vector<int> clients;
+    for (int i = 0; i < count; i++) {
+        int fd = network.connect();
+        send(fd, "PASS 42");
+        send(fd, "NICK sim" + std::to_string(i));
+        send(fd, "USER testuser 0 * :Test User");
+        clients.push_back(fd);
+    }
+    settle();
+    EXPECT_EQ(server->getClients().size(), static_cast<size_t>(count));
+    for (int fd : clients)
+        network.read(fd);
+
+    runFor(std::chrono::seconds(PING_INTERVAL_SEC + 1));
+    // every other client answers
+    for (int i = 0; i < count; i++) {
+        std::string ping = network.read(clients[i]);
+        ASSERT_EQ(ping.rfind("PING ", 0), 0u) << ping;
+        if (i % 2 == 0)
+            send(clients[i], "PONG " + ping.substr(5, ping.find('\r') - 5));
+    }
+    settle();
+
+    runFor(std::chrono::seconds(PING_TIMEOUT_SEC + 1));
+    EXPECT_EQ(server->getClients().size(), static_cast<size_t>(count / 2));
+    for (int i = 0; i < count; i++) {
+        EXPECT_EQ(network.isClosed(clients[i]), i % 2 == 1) << i;
+        if (i % 2 == 1) {
+            EXPECT_NE(network.read(clients[i]).find("ERROR :Ping timeout"), std::string::npos);
+        }
+    }
+}
+
+class SimulatedFloodTests : public SimulationSetup
+{
+protected:
+    SimulatedFloodTests()
+    {
+        floodPolicy.enabled = true;
+    }
+};
+
+// the bucket refills on the virtual clock, so the backlog drains exactly as fast as it allows
+TEST_F(SimulatedFloodTests, DeferredLinesRunAsTheBucketRefills)
+{
+    int sender = registerClient("sender");
+    int reader = registerClient("reader");
+    runFor(std::chrono::seconds(10));
+
+    std::string burst;
+    for (int i = 0; i < 20; i++)
+        burst += "PRIVMSG reader :line " + std::to_string(i) + "\r\n";
+    network.write(sender, burst);
+    settle();
+    std::string first = network.read(reader);
+    EXPECT_NE(first.find(":line 9\r\n"), std::string::npos);
+    EXPECT_EQ(first.find(":line 10\r\n"), std::string::npos);
+
+    runFor(std::chrono::milliseconds(1000 / static_cast<int>(FLOOD_RATE) * 5));
+    std::string rest = network.read(reader);
+    EXPECT_NE(rest.find(":line 14\r\n"), std::string::npos);
+    EXPECT_EQ(rest.find(":line 15\r\n"), std::string::npos);
+
+    runFor(std::chrono::seconds(10));
+    EXPECT_NE(network.read(reader).find(":line 19\r\n"), std::string::npos);
+}
+
+// input that arrives while a client is already scheduled or held back must not queue it twice
+TEST_F(SimulatedFloodTests, LinesArrivingWhileQueuedRunOnceInOrder)
+{
+    int sender = registerClient("sender");
+    int reader = registerClient("reader");
+    runFor(std::chrono::seconds(10));
+
+    for (int i = 0; i < 30; i++) {
+        network.write(sender, "PRIVMSG reader :line " + std::to_string(i) + "\r\n");
+        server->iterate();
+    }
+    runFor(std::chrono::seconds(20));
+
+    std::string expected;
+    for (int i = 0; i < 30; i++)
+        expected += ":sender!testuser@127.0.0.1 PRIVMSG reader :line " + std::to_string(i) + "\r\n";
+    EXPECT_EQ(network.read(reader), expected);
+}
+
+// the loop wakes when the held back line is affordable, not at its next 100 ms tick
+TEST_F(SimulatedFloodTests, LoopWakesWhenDeferredLineIsDue)
+{
+    floodPolicy.ratePerSec = 3;
+    server->getConnectionManager().setFloodPolicy(floodPolicy);
+    int sender = registerClient("sender");
+    int reader = registerClient("reader");
+    runFor(std::chrono::seconds(10));
+
+    std::string burst;
+    for (int i = 0; i <= FLOOD_BURST; i++)
+        burst += "PRIVMSG reader :line " + std::to_string(i) + "\r\n";
+    network.write(sender, burst);
+    Clock::TimePoint sent = clock.current();
+    std::string received;
+    while (received.find(":line 10\r\n") == std::string::npos) {
+        server->iterate();
+        received += network.read(reader);
+    }
+    // one token at 3 per second
+    EXPECT_EQ(clock.current() - sent, std::chrono::milliseconds(334));
+}
@@ -3,6 +3,7 @@
 #include <gtest/gtest.h>
 #include <Server.hpp>
 #include <Client.hpp>
+#include <ConnectionManager.hpp>
 #include <thread>
 #include <sstream>
 #include <iostream>
@@ -40,6 +41,10 @@ protected:
     std::condition_variable clientsReady;
     int readyClients = 0;
     int totalClients = 0;
+    // the tests fire commands faster than any real client, fixtures that test flood control
+    // turn it back on
+    FloodPolicy floodPolicy;
+    ThrottlePolicy throttlePolicy;
 
     // Helper function to send raw data without adding \r\n
     bool sendRawData(int clientSocket, const std::string &data)
@@ -67,7 +72,9 @@ protected:
     TestSetup(bool verbose = true)
         : verboseOutput(verbose)
         , serverFuture(serverPromise.get_future())
-    {}
+    {
+        floodPolicy.enabled = false;
+    }
 
     void SetUp() override
     {
@@ -79,6 +86,8 @@ protected:
         serverThread = std::thread([this]() {
             try {
                 Server *newServer = new Server(6667, "42", false);
+                newServer->getConnectionManager().setFloodPolicy(floodPolicy);
+                newServer->getConnectionManager().setThrottlePolicy(throttlePolicy);
                 serverPromise.set_value(newServer);
                 newServer->loop();
             }
@@ -321,6 +330,20 @@ protected:
         }
     }
 
+    // Count occurrences of text in the output, after letting pending sends land
+    int countInOutput(const std::string &text)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(RECHECK_OUTPUT_DELAY));
+        std::string output = getServerOutput();
+        int count = 0;
+        size_t pos = 0;
+        while ((pos = output.find(text, pos)) != std::string::npos) {
+            ++count;
+            pos += text.length();
+        }
+        return count;
+    }
+
     // Override outputContains to use the waiting mechanism
     bool outputContains(const std::string &text)
     {
@@ -0,0 +1,94 @@
+#include "SimulationSetup.hpp"
+#include <Tracer.hpp>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <unistd.h>
+
+class TracerTests : public SimulationSetup
+{
+protected:
+    std::string path = testing::TempDir() + "ft_irc_trace_test.json";
+
+    void TearDown() override
+    {
+        SimulationSetup::TearDown();
+        unlink(path.c_str());
+    }
+
+    // the tracer drains its ring and closes the array when the server goes away
+    std::string stopAndRead()
+    {
+        delete server;
+        server = nullptr;
+        std::ifstream in(path);
+        return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    }
+
+    // the events of every traced line named after command, one per line of the file
+    static std::vector<std::string> eventsNamed(const std::string &trace, const std::string &name)
+    {
+        std::vector<std::string> events;
+        std::istringstream lines(trace);
+        std::string line;
+        while (std::getline(lines, line))
+            if (line.find("{\"name\":\"" + name + "\"") != std::string::npos)
+                events.push_back(line);
+        return events;
+    }
+};
+
+TEST_F(TracerTests, FollowsChannelMessageThroughFanout)
+{
+    server->getConnectionManager().startTracing(path, 1.0);
+    int sender = registerClient("sender");
+    int first = registerClient("first");
+    int second = registerClient("second");
+    for (int client : {sender, first, second})
+        send(client, "JOIN #trace");
+    settle();
+    send(sender, "PRIVMSG #trace :hello");
+    settle();
+    EXPECT_NE(network.read(first).find("hello"), std::string::npos);
+
+    std::string trace = stopAndRead();
+    ASSERT_EQ(trace.rfind("[\n", 0), 0u);
+    EXPECT_EQ(trace.substr(trace.size() - 3), "\n]\n");
+    std::vector<std::string> privmsg = eventsNamed(trace, "PRIVMSG");
+    ASSERT_EQ(privmsg.size(), 1u);
+    EXPECT_NE(privmsg[0].find("\"recipients\":2,\"queued\":0"), std::string::npos) << privmsg[0];
+    EXPECT_NE(privmsg[0].find("\"fanout_latency_us\":"), std::string::npos);
+    EXPECT_NE(privmsg[0].find("\"tid\":" + std::to_string(sender)), std::string::npos);
+    // every traced line has its stages, only lines that reached someone have a fan-out
+    size_t lines = eventsNamed(trace, "wait").size();
+    EXPECT_EQ(eventsNamed(trace, "parse").size(), lines);
+    EXPECT_EQ(eventsNamed(trace, "execute").size(), lines);
+    EXPECT_GE(eventsNamed(trace, "fanout").size(), 1u);
+    EXPECT_LE(eventsNamed(trace, "fanout").size(), lines);
+}
+
+// lines are matched to their samples by position, several in one read must not shift them
+TEST_F(TracerTests, TracesEveryLineOfAChunk)
+{
+    server->getConnectionManager().startTracing(path, 1.0);
+    int client = registerClient("chunked");
+    network.write(client, "PING :one\r\nPING :two\r\nPING :thr");
+    settle();
+    network.write(client, "ee\r\n");
+    settle();
+
+    std::string trace = stopAndRead();
+    EXPECT_EQ(eventsNamed(trace, "PING").size(), 3u);
+    // PASS, NICK and USER
+    EXPECT_EQ(eventsNamed(trace, "wait").size(), 6u);
+}
+
+TEST_F(TracerTests, ZeroRateTracesNothing)
+{
+    server->getConnectionManager().startTracing(path, 0.0);
+    int client = registerClient("quiet");
+    send(client, "PING :nothing");
+    settle();
+
+    EXPECT_EQ(stopAndRead(), "[\n\n]\n");
+}
@@ -0,0 +1,123 @@
+#include "SimulationSetup.hpp"
+#include <TrafficCapture.hpp>
+#include <Error.hpp>
+#include <common.hpp>
+#include <fstream>
+#include <vector>
+#include <unistd.h>
+
+class TrafficCaptureTests : public SimulationSetup
+{
+protected:
+    std::string path = testing::TempDir() + "ft_irc_capture_test.bin";
+
+    void TearDown() override
+    {
+        SimulationSetup::TearDown();
+        unlink(path.c_str());
+    }
+
+    // the server's capture is flushed when it goes away
+    std::vector<CaptureRecord> stopAndRead()
+    {
+        delete server;
+        server = nullptr;
+        std::vector<CaptureRecord> records;
+        CaptureReader reader(path);
+        CaptureRecord record;
+        while (reader.next(record))
+            records.push_back(record);
+        return records;
+    }
+};
+
+// chunks are kept exactly as received, on the clock the server runs on
+TEST_F(TrafficCaptureTests, RecordsConnectionsAndBytesAsReceived)
+{
+    server->getConnectionManager().startCapture(path);
+    int client = network.connect();
+    network.write(client, "PASS 42\r\nNICK ca");
+    settle();
+    runFor(std::chrono::milliseconds(250));
+    network.write(client, "pture\r\nUSER testuser 0 * :Test User\r\n");
+    settle();
+    network.hangUp(client);
+    settle();
+
+    std::vector<CaptureRecord> records = stopAndRead();
+    ASSERT_EQ(records.size(), 4u);
+    EXPECT_EQ(records[0].kind, CaptureRecord::OPEN);
+    EXPECT_EQ(records[0].data, "127.0.0.1");
+    EXPECT_EQ(records[1].kind, CaptureRecord::DATA);
+    EXPECT_EQ(records[1].data, "PASS 42\r\nNICK ca");
+    EXPECT_EQ(records[2].kind, CaptureRecord::DATA);
+    EXPECT_EQ(records[2].data, "pture\r\nUSER testuser 0 * :Test User\r\n");
+    EXPECT_GE(records[2].atUs - records[1].atUs, 250000u);
+    EXPECT_EQ(records[3].kind, CaptureRecord::CLOSE);
+    for (const CaptureRecord &record : records)
+        EXPECT_EQ(record.connection, 0u);
+}
+
+// fds are reused, connections in the capture are not
+TEST_F(TrafficCaptureTests, NumbersConnectionsInAcceptOrder)
+{
+    server->getConnectionManager().startCapture(path);
+    int first = registerClient("first");
+    send(first, "QUIT");
+    settle();
+    int second = registerClient("second");
+    send(second, "QUIT");
+    settle();
+
+    std::vector<uint32_t> opened;
+    std::vector<uint32_t> closed;
+    for (const CaptureRecord &record : stopAndRead()) {
+        if (record.kind == CaptureRecord::OPEN)
+            opened.push_back(record.connection);
+        if (record.kind == CaptureRecord::CLOSE)
+            closed.push_back(record.connection);
+    }
+    EXPECT_EQ(opened, (std::vector<uint32_t>{0, 1}));
+    EXPECT_EQ(closed, (std::vector<uint32_t>{0, 1}));
+}
+
+// an idle server still writes what it buffered, it is on disk before the server goes away
+TEST_F(TrafficCaptureTests, IdleServerFlushesBufferedTail)
+{
+    server->getConnectionManager().startCapture(path);
+    int client = network.connect();
+    network.write(client, "PASS 42\r\n");
+    settle();
+    CaptureRecord record;
+    EXPECT_FALSE(CaptureReader(path).next(record));
+
+    runFor(std::chrono::milliseconds(CAPTURE_FLUSH_MS + 200));
+    CaptureReader reader(path);
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(record.kind, CaptureRecord::OPEN);
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(record.data, "PASS 42\r\n");
+}
+
+TEST_F(TrafficCaptureTests, TornTailEndsAtLastWholeRecord)
+{
+    server->getConnectionManager().startCapture(path);
+    registerClient("torn");
+    size_t whole = stopAndRead().size();
+    ASSERT_GT(whole, 1u);
+
+    std::ifstream in(path, std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << bytes.substr(0, bytes.size() - 3);
+
+    CaptureReader reader(path);
+    CaptureRecord record;
+    size_t count = 0;
+    while (reader.next(record))
+        count++;
+    EXPECT_EQ(count, whole - 1);
+
+    std::ofstream(path, std::ios::trunc) << "not a capture";
+    EXPECT_THROW(CaptureReader{path}, ServerError);
+}
@@ -403,9 +403,8 @@ TEST_F(TestSetup, ModeCommand)
 
     // Test removing modes
     sendCommand(client1, "MODE #modetest -i-t-k-l");
-    EXPECT_TRUE(outputContains(":user1!testuser@127.0.0.1 MODE #modetest -i"));
-    EXPECT_TRUE(outputContains(":user1!testuser@127.0.0.1 MODE #modetest -t"));
-    EXPECT_TRUE(outputContains(":user1!testuser@127.0.0.1 MODE #modetest -k"));
+    // folded into MODES sized lines
+    EXPECT_TRUE(outputContains(":user1!testuser@127.0.0.1 MODE #modetest -itk"));
     EXPECT_TRUE(outputContains(":user1!testuser@127.0.0.1 MODE #modetest -l"));
     clearServerOutput();
 
@@ -566,7 +565,8 @@ TEST_F(TestSetup, JoinCommandComprehensive)
     sendCommand(client2, "JOIN #testchan");
     EXPECT_TRUE(outputContains(":user2!testuser@127.0.0.1 JOIN #testchan"));
     // Both users should receive naming info for client2
-    EXPECT_TRUE(outputContains("353 user2 = #testchan :user2 @user1"));
+    // cached names keep join order
+    EXPECT_TRUE(outputContains("353 user2 = #testchan :@user1 user2"));
     clearServerOutput();
 
     // Test 3: Joining multiple channels at once
@@ -0,0 +1,386 @@
+#include <LoadGenerator.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// how long deliveries may still arrive after the last message was sent
+static const int64_t DRAIN_NS = 2000000000;
+static const int64_t PROGRESS_NS = 1000000000;
+static const int EPOLL_BATCH = 256;
+static const std::string MARKER = " :lg ";
+
+static int64_t seconds(double value)
+{
+    return static_cast<int64_t>(value * 1e9);
+}
+
+static std::string millis(uint64_t nanoseconds)
+{
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2) << nanoseconds / 1e6 << " ms";
+    return out.str();
+}
+
+LoadGenerator::LoadGenerator(const Scenario &scenario)
+    : _scenario(scenario)
+    , _random(scenario.seed)
+    , _epoll(epoll_create1(EPOLL_CLOEXEC))
+    , _users(scenario.users)
+    , _members(scenario.channels, 0)
+    , _startNs(0)
+    , _chatEndNs(0)
+    , _sent(0)
+    , _expected(0)
+    , _delivered(0)
+    , _bytesIn(0)
+    , _bytesOut(0)
+    , _registered(0)
+    , _failed(0)
+{
+    if (_epoll < 0)
+        throw std::runtime_error(std::string("epoll_create1: ") + strerror(errno));
+    double total = 0;
+    for (size_t rank = 1; rank <= _scenario.channels; rank++) {
+        total += 1.0 / std::pow(rank, _scenario.zipf);
+        _zipfCdf.push_back(total);
+    }
+    for (double &weight : _zipfCdf)
+        weight /= total;
+    for (User &user : _users)
+        user.channels = pickChannels();
+}
+
+LoadGenerator::~LoadGenerator()
+{
+    for (User &user : _users) {
+        if (user.fd >= 0)
+            close(user.fd);
+    }
+    close(_epoll);
+}
+
+int64_t LoadGenerator::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+std::string LoadGenerator::channelName(size_t channel)
+{
+    return "#lg" + std::to_string(channel);
+}
+
+// distinct channels drawn by popularity, a steep law may need the least popular filled in
+std::vector<size_t> LoadGenerator::pickChannels()
+{
+    std::vector<size_t> picked;
+    std::uniform_real_distribution<double> uniform(0, 1);
+    size_t wanted = _scenario.channelsPerUser;
+    for (size_t tries = 0; picked.size() < wanted && tries < 64 * wanted; tries++) {
+        size_t channel = std::lower_bound(_zipfCdf.begin(), _zipfCdf.end(), uniform(_random)) -
+                         _zipfCdf.begin();
+        channel = std::min(channel, _scenario.channels - 1);
+        if (std::find(picked.begin(), picked.end(), channel) == picked.end())
+            picked.push_back(channel);
+    }
+    for (size_t channel = 0; picked.size() < wanted; channel++) {
+        if (std::find(picked.begin(), picked.end(), channel) == picked.end())
+            picked.push_back(channel);
+    }
+    return picked;
+}
+
+void LoadGenerator::run()
+{
+    _startNs = now();
+    _chatEndNs = _startNs + seconds(_scenario.rampSec + _scenario.durationSec);
+    for (size_t index = 0; index < _users.size(); index++) {
+        int64_t offset = seconds(_scenario.rampSec) * index / _users.size();
+        _timers.push({_startNs + offset, index, TIMER_CONNECT});
+    }
+
+    epoll_event events[EPOLL_BATCH];
+    int64_t nextProgress = _startNs + PROGRESS_NS;
+    int64_t endNs = _chatEndNs + DRAIN_NS;
+    while (true) {
+        int64_t current = now();
+        if (current >= endNs || (current >= _chatEndNs && _delivered >= _expected))
+            break;
+        runTimers(current);
+        if (current >= nextProgress) {
+            progress(current);
+            nextProgress += PROGRESS_NS;
+        }
+        int64_t wake = std::min(endNs, nextProgress);
+        if (!_timers.empty())
+            wake = std::min(wake, _timers.top().dueNs);
+        int timeoutMs = std::max<int64_t>(0, (wake - now() + 999999) / 1000000);
+        int count = epoll_wait(_epoll, events, EPOLL_BATCH, timeoutMs);
+        if (count < 0 && errno != EINTR)
+            throw std::runtime_error(std::string("epoll_wait: ") + strerror(errno));
+        for (int i = 0; i < count; i++) {
+            size_t index = events[i].data.u64;
+            User &user = _users[index];
+            if (user.state == USER_CONNECTING && (events[i].events & (EPOLLOUT | EPOLLERR))) {
+                int error = 0;
+                socklen_t length = sizeof(error);
+                getsockopt(user.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+                if (error != 0) {
+                    fail(index, std::string("connect: ") + strerror(error));
+                    continue;
+                }
+                user.state = USER_REGISTERING;
+                if (!_scenario.password.empty())
+                    queue(index, "PASS " + _scenario.password);
+                queue(index, "NICK lg" + std::to_string(index));
+                queue(index, "USER lg 0 * :ft_irc load generator");
+                continue;
+            }
+            if (events[i].events & EPOLLOUT)
+                flush(index);
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                receive(index);
+        }
+    }
+}
+
+void LoadGenerator::runTimers(int64_t until)
+{
+    while (!_timers.empty() && _timers.top().dueNs <= until) {
+        Timer timer = _timers.top();
+        _timers.pop();
+        if (timer.kind == TIMER_CONNECT)
+            connectUser(timer.user);
+        else if (_users[timer.user].state == USER_CHATTING && timer.dueNs < _chatEndNs)
+            sendMessage(timer.user);
+    }
+}
+
+void LoadGenerator::scheduleMessage(size_t index, int64_t after)
+{
+    if (_scenario.rate <= 0)
+        return;
+    std::exponential_distribution<double> gap(_scenario.rate);
+    _timers.push({after + seconds(gap(_random)), index, TIMER_MESSAGE});
+}
+
+void LoadGenerator::connectUser(size_t index)
+{
+    User &user = _users[index];
+    addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *address = nullptr;
+    if (getaddrinfo(_scenario.host.c_str(), std::to_string(_scenario.port).c_str(), &hints,
+                    &address) != 0) {
+        fail(index, "cannot resolve " + _scenario.host);
+        return;
+    }
+    user.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int result = user.fd < 0 ? -1 : connect(user.fd, address->ai_addr, address->ai_addrlen);
+    freeaddrinfo(address);
+    if (user.fd < 0 || (result < 0 && errno != EINPROGRESS)) {
+        fail(index, std::string("connect: ") + strerror(errno));
+        return;
+    }
+    user.state = USER_CONNECTING;
+    epoll_event event = {};
+    event.events = EPOLLIN | EPOLLOUT;
+    event.data.u64 = index;
+    epoll_ctl(_epoll, EPOLL_CTL_ADD, user.fd, &event);
+    user.writable = true;
+}
+
+void LoadGenerator::fail(size_t index, const std::string &reason)
+{
+    User &user = _users[index];
+    if (user.state == USER_FAILED)
+        return;
+    if (_failed == 0)
+        std::cerr << "lg" << index << ": " << reason << std::endl;
+    _failed++;
+    if (user.state == USER_CHATTING || user.state == USER_JOINING)
+        _registered--;
+    for (size_t channel : user.joined)
+        _members[channel]--;
+    user.joined.clear();
+    user.state = USER_FAILED;
+    if (user.fd >= 0)
+        close(user.fd);
+    user.fd = -1;
+}
+
+void LoadGenerator::watch(size_t index, bool writable)
+{
+    User &user = _users[index];
+    if (user.writable == writable)
+        return;
+    epoll_event event = {};
+    event.events = writable ? EPOLLIN | EPOLLOUT : EPOLLIN;
+    event.data.u64 = index;
+    epoll_ctl(_epoll, EPOLL_CTL_MOD, user.fd, &event);
+    user.writable = writable;
+}
+
+void LoadGenerator::queue(size_t index, const std::string &line)
+{
+    _users[index].output += line + "\r\n";
+    if (_users[index].state != USER_CONNECTING)
+        flush(index);
+}
+
+void LoadGenerator::flush(size_t index)
+{
+    User &user = _users[index];
+    while (!user.output.empty()) {
+        ssize_t sent = send(user.fd, user.output.data(), user.output.size(), MSG_NOSIGNAL);
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            watch(index, true);
+            return;
+        }
+        if (sent < 0) {
+            fail(index, std::string("send: ") + strerror(errno));
+            return;
+        }
+        _bytesOut += sent;
+        user.output.erase(0, sent);
+    }
+    watch(index, false);
+}
+
+void LoadGenerator::receive(size_t index)
+{
+    User &user = _users[index];
+    char buffer[16384];
+    while (user.state != USER_FAILED) {
+        ssize_t got = recv(user.fd, buffer, sizeof(buffer), 0);
+        if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
+        if (got <= 0) {
+            fail(index, got == 0 ? "server closed the connection"
+                                 : std::string("recv: ") + strerror(errno));
+            return;
+        }
+        _bytesIn += got;
+        user.input.append(buffer, got);
+        size_t start = 0;
+        size_t end;
+        while ((end = user.input.find('\n', start)) != std::string::npos) {
+            size_t length = end - start;
+            if (length > 0 && user.input[end - 1] == '\r')
+                length--;
+            handleLine(index, user.input.substr(start, length));
+            start = end + 1;
+            if (user.state == USER_FAILED)
+                return;
+        }
+        user.input.erase(0, start);
+    }
+}
+
+void LoadGenerator::handleLine(size_t index, const std::string &line)
+{
+    User &user = _users[index];
+    std::istringstream words(line);
+    std::string command;
+    words >> command;
+    if (!command.empty() && command[0] == ':')
+        words >> command;
+
+    if (command == "PRIVMSG") {
+        size_t marker = line.find(MARKER);
+        if (marker == std::string::npos)
+            return;
+        int64_t sentNs = std::strtoll(line.c_str() + marker + MARKER.size(), nullptr, 10);
+        _latency.record(std::max<int64_t>(0, now() - sentNs));
+        _delivered++;
+    }
+    else if (command == "PING") {
+        queue(index, "PONG" + line.substr(line.find("PING") + 4));
+    }
+    else if (command == "001") {
+        _registered++;
+        user.state = USER_JOINING;
+        for (size_t channel : user.channels)
+            queue(index, "JOIN " + channelName(channel));
+    }
+    else if (command == "366") {
+        std::string nick;
+        std::string channel;
+        words >> nick >> channel;
+        if (channel.compare(0, 3, "#lg") != 0)
+            return;
+        size_t number = std::strtoul(channel.c_str() + 3, nullptr, 10);
+        if (number >= _members.size())
+            return;
+        user.joined.push_back(number);
+        _members[number]++;
+        if (user.state == USER_JOINING && user.joined.size() == user.channels.size()) {
+            user.state = USER_CHATTING;
+            scheduleMessage(index, now());
+        }
+    }
+    else if (command == "ERROR") {
+        fail(index, line);
+    }
+    else if (user.state != USER_CHATTING && command.size() == 3 &&
+             (command[0] == '4' || command[0] == '5')) {
+        fail(index, line);
+    }
+}
+
+// the text starts with the send time, padded up to the configured size
+void LoadGenerator::sendMessage(size_t index)
+{
+    User &user = _users[index];
+    std::uniform_int_distribution<size_t> pick(0, user.joined.size() - 1);
+    size_t channel = user.joined[pick(_random)];
+    std::string text = "lg " + std::to_string(now()) + " ";
+    if (text.size() < _scenario.messageBytes)
+        text.append(_scenario.messageBytes - text.size(), 'x');
+    queue(index, "PRIVMSG " + channelName(channel) + " :" + text);
+    _sent++;
+    _expected += _members[channel] - 1;
+    scheduleMessage(index, now());
+}
+
+void LoadGenerator::progress(int64_t at) const
+{
+    Histogram::Snapshot latency = _latency.snapshot();
+    std::cout << "t=" << (at - _startNs) / 1000000000 << "s registered " << _registered
+              << " failed " << _failed << " sent " << _sent << " delivered " << _delivered
+              << " p99 " << millis(latency.percentile(0.99)) << std::endl;
+}
+
+std::string LoadGenerator::report() const
+{
+    Histogram::Snapshot latency = _latency.snapshot();
+    double window = _scenario.durationSec;
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    out << "scenario: " << _scenario.describe() << "\n";
+    out << "users: " << _registered << " registered, " << _failed << " failed, "
+        << _users.size() - _registered - _failed << " still registering\n";
+    out << "messages: " << _sent << " sent (" << _sent / window << "/s), " << _delivered
+        << " of " << _expected << " expected deliveries ("
+        << (_expected ? 100.0 * _delivered / _expected : 100.0) << "%), "
+        << _delivered / window << " deliveries/s\n";
+    out << "fan-out latency: p50 " << millis(latency.percentile(0.5)) << ", p99 "
+        << millis(latency.percentile(0.99)) << ", p999 " << millis(latency.percentile(0.999))
+        << ", max " << millis(latency.max) << "\n";
+    out << "bytes: " << _bytesIn << " received, " << _bytesOut << " sent\n";
+    return out.str();
+}
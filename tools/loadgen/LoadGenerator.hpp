@@ -0,0 +1,95 @@
+#pragma once
+
+#include <Scenario.hpp>
+#include <Metrics.hpp>
+#include <string>
+#include <vector>
+#include <queue>
+#include <random>
+#include <cstdint>
+
+// Drives every simulated user from one epoll loop. Users connect during the ramp, register,
+// join their Zipf-chosen channels and then send PRIVMSGs carrying their send time, so each
+// copy another user receives is one fan-out latency sample.
+class LoadGenerator
+{
+public:
+    explicit LoadGenerator(const Scenario &scenario);
+    ~LoadGenerator();
+    LoadGenerator(const LoadGenerator &) = delete;
+    LoadGenerator &operator=(const LoadGenerator &) = delete;
+
+    // returns once the scenario has run and the last deliveries had time to arrive
+    void run();
+    std::string report() const;
+
+private:
+    enum UserState
+    {
+        USER_IDLE,
+        USER_CONNECTING,
+        USER_REGISTERING,
+        USER_JOINING,
+        USER_CHATTING,
+        USER_FAILED
+    };
+
+    struct User
+    {
+        int fd = -1;
+        UserState state = USER_IDLE;
+        std::string input;
+        std::string output;
+        bool writable = false;
+        // picked at startup, and the ones the server confirmed with 366
+        std::vector<size_t> channels;
+        std::vector<size_t> joined;
+    };
+
+    enum TimerKind
+    {
+        TIMER_CONNECT,
+        TIMER_MESSAGE
+    };
+
+    struct Timer
+    {
+        int64_t dueNs;
+        size_t user;
+        TimerKind kind;
+        bool operator>(const Timer &other) const { return dueNs > other.dueNs; }
+    };
+
+    Scenario _scenario;
+    std::mt19937_64 _random;
+    std::vector<double> _zipfCdf;
+    int _epoll;
+    std::vector<User> _users;
+    std::vector<size_t> _members;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> _timers;
+    int64_t _startNs;
+    int64_t _chatEndNs;
+    Histogram _latency;
+    uint64_t _sent;
+    uint64_t _expected;
+    uint64_t _delivered;
+    uint64_t _bytesIn;
+    uint64_t _bytesOut;
+    size_t _registered;
+    size_t _failed;
+
+    static int64_t now();
+    std::vector<size_t> pickChannels();
+    void scheduleMessage(size_t index, int64_t after);
+    void connectUser(size_t index);
+    void fail(size_t index, const std::string &reason);
+    void queue(size_t index, const std::string &line);
+    void flush(size_t index);
+    void watch(size_t index, bool writable);
+    void receive(size_t index);
+    void handleLine(size_t index, const std::string &line);
+    void sendMessage(size_t index);
+    void runTimers(int64_t until);
+    void progress(int64_t at) const;
+    static std::string channelName(size_t channel);
+};
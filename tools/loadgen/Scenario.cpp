@@ -0,0 +1,91 @@
+#include <Scenario.hpp>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+static std::string trim(const std::string &text)
+{
+    size_t begin = text.find_first_not_of(" \t\r");
+    if (begin == std::string::npos)
+        return "";
+    size_t end = text.find_last_not_of(" \t\r");
+    return text.substr(begin, end - begin + 1);
+}
+
+template <typename T>
+static T parse(const std::string &key, const std::string &value)
+{
+    std::istringstream in(value);
+    T result;
+    if (!(in >> result) || !in.eof())
+        throw std::invalid_argument("bad value for " + key + ": " + value);
+    return result;
+}
+
+void Scenario::loadFile(const std::string &path)
+{
+    std::ifstream file(path);
+    if (!file)
+        throw std::invalid_argument("cannot open " + path);
+    std::string line;
+    for (size_t number = 1; std::getline(file, line); number++) {
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty())
+            continue;
+        size_t equals = line.find('=');
+        if (equals == std::string::npos)
+            throw std::invalid_argument(path + ":" + std::to_string(number) +
+                                        ": expected key = value");
+        set(trim(line.substr(0, equals)), trim(line.substr(equals + 1)));
+    }
+}
+
+void Scenario::set(const std::string &key, const std::string &value)
+{
+    if (key == "host")
+        host = value;
+    else if (key == "port")
+        port = parse<int>(key, value);
+    else if (key == "password")
+        password = value;
+    else if (key == "users")
+        users = parse<size_t>(key, value);
+    else if (key == "channels")
+        channels = parse<size_t>(key, value);
+    else if (key == "channels_per_user")
+        channelsPerUser = parse<size_t>(key, value);
+    else if (key == "zipf")
+        zipf = parse<double>(key, value);
+    else if (key == "rate")
+        rate = parse<double>(key, value);
+    else if (key == "message_bytes")
+        messageBytes = parse<size_t>(key, value);
+    else if (key == "ramp")
+        rampSec = parse<double>(key, value);
+    else if (key == "duration")
+        durationSec = parse<double>(key, value);
+    else if (key == "seed")
+        seed = parse<uint64_t>(key, value);
+    else
+        throw std::invalid_argument("unknown scenario key: " + key);
+}
+
+void Scenario::validate()
+{
+    if (users == 0 || channels == 0 || channelsPerUser == 0)
+        throw std::invalid_argument("users, channels and channels_per_user must be at least 1");
+    if (rate < 0 || durationSec <= 0 || rampSec < 0)
+        throw std::invalid_argument("rate, ramp and duration must not be negative");
+    if (channelsPerUser > channels)
+        channelsPerUser = channels;
+}
+
+std::string Scenario::describe() const
+{
+    std::ostringstream out;
+    out << users << " users, " << channels << " channels (zipf " << zipf << "), "
+        << channelsPerUser << " channels per user, " << rate << " msg/s per user, "
+        << messageBytes << " byte messages, " << rampSec << "s ramp, " << durationSec
+        << "s run against " << host << ":" << port;
+    return out.str();
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+// What the load generator simulates. Read from "key = value" lines, '#' starts a comment, and
+// single key=value overrides from the command line.
+struct Scenario
+{
+    std::string host = "127.0.0.1";
+    int port = 6667;
+    std::string password = "42";
+    size_t users = 100;
+    size_t channels = 20;
+    size_t channelsPerUser = 3;
+    // channel popularity follows a Zipf law with this exponent, 0 is uniform
+    double zipf = 1.0;
+    // PRIVMSGs each user sends per second, Poisson distributed
+    double rate = 0.5;
+    size_t messageBytes = 64;
+    // users connect evenly spread over rampSec, then chat for durationSec
+    double rampSec = 2;
+    double durationSec = 10;
+    uint64_t seed = 42;
+
+    void loadFile(const std::string &path);
+    // one key=value, throws std::invalid_argument on unknown keys or bad values
+    void set(const std::string &key, const std::string &value);
+    // checked once everything is set, channels_per_user is capped at channels
+    void validate();
+    std::string describe() const;
+};
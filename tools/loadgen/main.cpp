@@ -0,0 +1,58 @@
+#include <LoadGenerator.hpp>
+#include <Scenario.hpp>
+#include <iostream>
+#include <stdexcept>
+#include <sys/resource.h>
+
+static int usage(const char *program)
+{
+    std::cerr << "Usage: " << program << " [scenario-file] [key=value ...]\n"
+              << "keys: host port password users channels channels_per_user zipf rate\n"
+              << "      message_bytes ramp duration seed" << std::endl;
+    return 1;
+}
+
+// every simulated user is a socket
+static void raiseDescriptorLimit()
+{
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Scenario scenario;
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "-h" || arg == "--help")
+                return usage(argv[0]);
+            size_t equals = arg.find('=');
+            if (equals == std::string::npos)
+                scenario.loadFile(arg);
+            else
+                scenario.set(arg.substr(0, equals), arg.substr(equals + 1));
+        }
+        scenario.validate();
+    }
+    catch (const std::invalid_argument &e) {
+        std::cerr << e.what() << std::endl;
+        return usage(argv[0]);
+    }
+
+    raiseDescriptorLimit();
+    try {
+        LoadGenerator generator(scenario);
+        std::cout << scenario.describe() << std::endl;
+        generator.run();
+        std::cout << generator.report();
+    }
+    catch (const std::exception &e) {
+        std::cerr << "Load generator error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,386 @@
+#include <Replayer.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// how long a connection the capture never closed may stay quiet before the replay ends
+static const int64_t DRAIN_NS = 2000000000;
+static const int64_t PROGRESS_NS = 1000000000;
+static const int EPOLL_BATCH = 256;
+static const std::string PROBE = ":replay-";
+
+template <typename T>
+static T parse(const std::string &key, const std::string &value)
+{
+    std::istringstream in(value);
+    T result;
+    if (!(in >> result) || !in.eof())
+        throw std::invalid_argument("bad value for " + key + ": " + value);
+    return result;
+}
+
+static std::string millis(uint64_t nanoseconds)
+{
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2) << nanoseconds / 1e6 << " ms";
+    return out.str();
+}
+
+void ReplayOptions::set(const std::string &key, const std::string &value)
+{
+    if (key == "host")
+        host = value;
+    else if (key == "port")
+        port = parse<int>(key, value);
+    else if (key == "speed")
+        speed = parse<double>(key, value);
+    else if (key == "probe")
+        probe = parse<bool>(key, value);
+    else if (key == "pid")
+        pid = parse<int>(key, value);
+    else
+        throw std::invalid_argument("unknown option: " + key);
+    if (speed <= 0)
+        throw std::invalid_argument("speed must be above 0");
+}
+
+std::string ReplayOptions::describe() const
+{
+    std::ostringstream out;
+    out << capture << " against " << host << ":" << port << " at " << speed << "x"
+        << (probe ? ", probed" : "");
+    return out.str();
+}
+
+Replayer::Replayer(const ReplayOptions &options)
+    : _options(options)
+    , _capture(options.capture)
+    , _hasNext(false)
+    , _epoll(epoll_create1(EPOLL_CLOEXEC))
+    , _startNs(0)
+    , _endNs(0)
+    , _lastInputNs(0)
+    , _capturedUs(0)
+    , _maxLagNs(0)
+    , _records(0)
+    , _bytesOut(0)
+    , _bytesIn(0)
+    , _linesIn(0)
+    , _open(0)
+    , _failed(0)
+    , _cpuStart(0)
+    , _cpuEnd(0)
+{
+    if (_epoll < 0)
+        throw std::runtime_error(std::string("epoll_create1: ") + strerror(errno));
+}
+
+Replayer::~Replayer()
+{
+    for (Session &session : _sessions) {
+        if (session.fd >= 0)
+            close(session.fd);
+    }
+    close(_epoll);
+}
+
+int64_t Replayer::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+int64_t Replayer::dueNs(const CaptureRecord &record) const
+{
+    return _startNs + static_cast<int64_t>(record.atUs * 1000 / _options.speed);
+}
+
+// utime and stime from /proc/<pid>/stat, the 14th and 15th fields
+double Replayer::serverCpuSeconds() const
+{
+    if (_options.pid <= 0)
+        return 0;
+    std::ifstream file("/proc/" + std::to_string(_options.pid) + "/stat");
+    std::string stat((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    size_t paren = stat.rfind(')');
+    if (paren == std::string::npos)
+        throw std::runtime_error("no process " + std::to_string(_options.pid));
+    std::istringstream fields(stat.substr(paren + 2));
+    std::string skip;
+    for (int field = 3; field < 14; field++)
+        fields >> skip;
+    unsigned long long user = 0;
+    unsigned long long system = 0;
+    fields >> user >> system;
+    return static_cast<double>(user + system) / sysconf(_SC_CLK_TCK);
+}
+
+void Replayer::run()
+{
+    _cpuStart = serverCpuSeconds();
+    _startNs = now();
+    _lastInputNs = _startNs;
+    _hasNext = _capture.next(_next);
+
+    epoll_event events[EPOLL_BATCH];
+    int64_t nextProgress = _startNs + PROGRESS_NS;
+    while (true) {
+        int64_t current = now();
+        while (_hasNext && dueNs(_next) <= current) {
+            _maxLagNs = std::max(_maxLagNs, current - dueNs(_next));
+            _capturedUs = _next.atUs;
+            apply(_next);
+            _hasNext = _capture.next(_next);
+        }
+        if (!_hasNext && (_open == 0 || current - _lastInputNs >= DRAIN_NS))
+            break;
+        if (current >= nextProgress) {
+            progress(current);
+            nextProgress += PROGRESS_NS;
+        }
+        int64_t wake = std::min(nextProgress, _lastInputNs + DRAIN_NS);
+        if (_hasNext)
+            wake = std::min(nextProgress, dueNs(_next));
+        int timeoutMs = std::max<int64_t>(0, (wake - now() + 999999) / 1000000);
+        int count = epoll_wait(_epoll, events, EPOLL_BATCH, timeoutMs);
+        if (count < 0 && errno != EINTR)
+            throw std::runtime_error(std::string("epoll_wait: ") + strerror(errno));
+        for (int i = 0; i < count; i++) {
+            size_t index = events[i].data.u64;
+            Session &session = _sessions[index];
+            if (session.closed)
+                continue;
+            if (session.connecting && (events[i].events & (EPOLLOUT | EPOLLERR))) {
+                int error = 0;
+                socklen_t length = sizeof(error);
+                getsockopt(session.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+                if (error != 0) {
+                    fail(index, std::string("connect: ") + strerror(error));
+                    continue;
+                }
+                session.connecting = false;
+            }
+            if (events[i].events & EPOLLOUT)
+                flush(index);
+            if (!session.closed && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+                receive(index);
+        }
+    }
+    _endNs = now();
+    _cpuEnd = serverCpuSeconds();
+}
+
+void Replayer::apply(const CaptureRecord &record)
+{
+    _records++;
+    if (record.kind == CaptureRecord::OPEN) {
+        openSession(record.connection);
+        return;
+    }
+    auto it = _byConnection.find(record.connection);
+    if (it == _byConnection.end() || _sessions[it->second].closed)
+        return;
+    size_t index = it->second;
+    Session &session = _sessions[index];
+    if (record.kind == CaptureRecord::CLOSE) {
+        _byConnection.erase(it);
+        session.closing = true;
+        if (session.output.empty() && !session.connecting)
+            shutdown(session.fd, SHUT_WR);
+        return;
+    }
+    std::string data = record.data;
+    if (_options.probe && session.registered && !data.empty() && data.back() == '\n')
+        data += "PING " + PROBE + std::to_string(now()) + "\r\n";
+    queue(index, data);
+}
+
+void Replayer::openSession(uint32_t connection)
+{
+    size_t index = _sessions.size();
+    _sessions.emplace_back();
+    _byConnection[connection] = index;
+    Session &session = _sessions[index];
+    addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *address = nullptr;
+    if (getaddrinfo(_options.host.c_str(), std::to_string(_options.port).c_str(), &hints,
+                    &address) != 0) {
+        fail(index, "cannot resolve " + _options.host);
+        return;
+    }
+    session.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int result = session.fd < 0 ? -1 : connect(session.fd, address->ai_addr, address->ai_addrlen);
+    freeaddrinfo(address);
+    if (session.fd < 0 || (result < 0 && errno != EINPROGRESS)) {
+        fail(index, std::string("connect: ") + strerror(errno));
+        return;
+    }
+    _open++;
+    session.connecting = true;
+    epoll_event event = {};
+    event.events = EPOLLIN | EPOLLOUT;
+    event.data.u64 = index;
+    epoll_ctl(_epoll, EPOLL_CTL_ADD, session.fd, &event);
+    session.writable = true;
+}
+
+void Replayer::closeSession(size_t index)
+{
+    Session &session = _sessions[index];
+    if (session.closed)
+        return;
+    session.closed = true;
+    if (session.fd >= 0) {
+        close(session.fd);
+        _open--;
+    }
+    session.fd = -1;
+    session.input.clear();
+    session.output.clear();
+}
+
+void Replayer::fail(size_t index, const std::string &reason)
+{
+    if (_failed == 0)
+        std::cerr << "connection " << index << ": " << reason << std::endl;
+    _failed++;
+    closeSession(index);
+}
+
+void Replayer::watch(size_t index, bool writable)
+{
+    Session &session = _sessions[index];
+    if (session.writable == writable)
+        return;
+    epoll_event event = {};
+    event.events = writable ? EPOLLIN | EPOLLOUT : EPOLLIN;
+    event.data.u64 = index;
+    epoll_ctl(_epoll, EPOLL_CTL_MOD, session.fd, &event);
+    session.writable = writable;
+}
+
+void Replayer::queue(size_t index, const std::string &data)
+{
+    _sessions[index].output += data;
+    if (!_sessions[index].connecting)
+        flush(index);
+}
+
+void Replayer::flush(size_t index)
+{
+    Session &session = _sessions[index];
+    while (!session.output.empty()) {
+        ssize_t sent = send(session.fd, session.output.data(), session.output.size(),
+                            MSG_NOSIGNAL);
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            watch(index, true);
+            return;
+        }
+        if (sent < 0) {
+            fail(index, std::string("send: ") + strerror(errno));
+            return;
+        }
+        _bytesOut += sent;
+        session.output.erase(0, sent);
+    }
+    watch(index, false);
+    if (session.closing)
+        shutdown(session.fd, SHUT_WR);
+}
+
+// what the server sends is only counted, and a closed socket ends the session
+void Replayer::receive(size_t index)
+{
+    Session &session = _sessions[index];
+    char buffer[16384];
+    while (!session.closed) {
+        ssize_t got = recv(session.fd, buffer, sizeof(buffer), 0);
+        if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
+        if (got <= 0) {
+            closeSession(index);
+            return;
+        }
+        _lastInputNs = now();
+        _bytesIn += got;
+        session.input.append(buffer, got);
+        size_t start = 0;
+        size_t end;
+        while ((end = session.input.find('\n', start)) != std::string::npos) {
+            size_t length = end - start;
+            if (length > 0 && session.input[end - 1] == '\r')
+                length--;
+            handleLine(index, session.input.substr(start, length));
+            start = end + 1;
+        }
+        session.input.erase(0, start);
+    }
+}
+
+void Replayer::handleLine(size_t index, const std::string &line)
+{
+    _linesIn++;
+    std::istringstream words(line);
+    std::string command;
+    words >> command;
+    if (!command.empty() && command[0] == ':')
+        words >> command;
+    if (command == "001") {
+        _sessions[index].registered = true;
+    }
+    else if (command == "PONG") {
+        size_t probe = line.rfind(PROBE);
+        if (probe == std::string::npos)
+            return;
+        int64_t sentNs = std::strtoll(line.c_str() + probe + PROBE.size(), nullptr, 10);
+        _latency.record(std::max<int64_t>(0, now() - sentNs));
+    }
+}
+
+void Replayer::progress(int64_t at) const
+{
+    Histogram::Snapshot latency = _latency.snapshot();
+    std::cout << "t=" << (at - _startNs) / 1000000000 << "s capture t="
+              << _capturedUs / 1000000 << "s records " << _records << " open " << _open
+              << " received " << _bytesIn << " bytes p99 " << millis(latency.percentile(0.99))
+              << std::endl;
+}
+
+std::string Replayer::report() const
+{
+    Histogram::Snapshot latency = _latency.snapshot();
+    double wall = (_endNs - _startNs) / 1e9;
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    out << "replay: " << _options.describe() << "\n";
+    out << "capture: " << _records << " records over " << _capturedUs / 1e6 << " s, replayed in "
+        << wall << " s, max schedule lag " << millis(_maxLagNs) << "\n";
+    out << "connections: " << _sessions.size() << " opened, " << _failed << " failed, " << _open
+        << " still open at the end\n";
+    out << "bytes: " << _bytesOut << " sent, " << _bytesIn << " received in " << _linesIn
+        << " lines\n";
+    if (_options.probe)
+        out << "probe latency: p50 " << millis(latency.percentile(0.5)) << ", p99 "
+            << millis(latency.percentile(0.99)) << ", p999 " << millis(latency.percentile(0.999))
+            << ", max " << millis(latency.max) << " over " << latency.count << " probes\n";
+    if (_options.pid > 0) {
+        double cpu = _cpuEnd - _cpuStart;
+        out << "server cpu: " << std::setprecision(2) << cpu << " s ("
+            << std::setprecision(1) << (wall > 0 ? 100 * cpu / wall : 0) << "% of one core)\n";
+    }
+    return out.str();
+}
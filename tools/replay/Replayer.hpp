@@ -0,0 +1,89 @@
+#pragma once
+
+#include <TrafficCapture.hpp>
+#include <Metrics.hpp>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+struct ReplayOptions
+{
+    std::string capture;
+    std::string host = "127.0.0.1";
+    int port = 6667;
+    // 2 replays twice as fast as captured
+    double speed = 1;
+    // follow every chunk sent by a registered connection with a PING, its PONG times the chunk
+    bool probe = true;
+    // the server's pid, its CPU time over the replay is reported when set
+    int pid = 0;
+
+    void set(const std::string &key, const std::string &value);
+    std::string describe() const;
+};
+
+// Re-drives a capture against a server from one epoll loop. Every captured connection gets
+// its own socket, opened, fed and half-closed at the captured offsets divided by the speed.
+class Replayer
+{
+public:
+    explicit Replayer(const ReplayOptions &options);
+    ~Replayer();
+    Replayer(const Replayer &) = delete;
+    Replayer &operator=(const Replayer &) = delete;
+
+    // returns once the capture ran out and the server closed every connection, or went quiet
+    void run();
+    std::string report() const;
+
+private:
+    struct Session
+    {
+        int fd = -1;
+        bool connecting = false;
+        bool registered = false;
+        // the capture closed it, the write side is shut once the output drained
+        bool closing = false;
+        bool closed = false;
+        bool writable = false;
+        std::string input;
+        std::string output;
+    };
+
+    ReplayOptions _options;
+    CaptureReader _capture;
+    CaptureRecord _next;
+    bool _hasNext;
+    int _epoll;
+    std::vector<Session> _sessions;
+    std::unordered_map<uint32_t, size_t> _byConnection;
+    int64_t _startNs;
+    int64_t _endNs;
+    int64_t _lastInputNs;
+    uint64_t _capturedUs;
+    Histogram _latency;
+    int64_t _maxLagNs;
+    uint64_t _records;
+    uint64_t _bytesOut;
+    uint64_t _bytesIn;
+    uint64_t _linesIn;
+    size_t _open;
+    size_t _failed;
+    double _cpuStart;
+    double _cpuEnd;
+
+    static int64_t now();
+    int64_t dueNs(const CaptureRecord &record) const;
+    double serverCpuSeconds() const;
+    void apply(const CaptureRecord &record);
+    void openSession(uint32_t connection);
+    void closeSession(size_t index);
+    void fail(size_t index, const std::string &reason);
+    void watch(size_t index, bool writable);
+    void queue(size_t index, const std::string &data);
+    void flush(size_t index);
+    void receive(size_t index);
+    void handleLine(size_t index, const std::string &line);
+    void progress(int64_t at) const;
+};
@@ -0,0 +1,57 @@
+#include <Replayer.hpp>
+#include <iostream>
+#include <stdexcept>
+#include <sys/resource.h>
+
+static int usage(const char *program)
+{
+    std::cerr << "Usage: " << program << " capture-file [key=value ...]\n"
+              << "keys: host port speed probe pid" << std::endl;
+    return 1;
+}
+
+// every captured connection is a socket
+static void raiseDescriptorLimit()
+{
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    ReplayOptions options;
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "-h" || arg == "--help")
+                return usage(argv[0]);
+            size_t equals = arg.find('=');
+            if (equals == std::string::npos)
+                options.capture = arg;
+            else
+                options.set(arg.substr(0, equals), arg.substr(equals + 1));
+        }
+        if (options.capture.empty())
+            throw std::invalid_argument("no capture file given");
+    }
+    catch (const std::invalid_argument &e) {
+        std::cerr << e.what() << std::endl;
+        return usage(argv[0]);
+    }
+
+    raiseDescriptorLimit();
+    try {
+        Replayer replayer(options);
+        std::cout << options.describe() << std::endl;
+        replayer.run();
+        std::cout << replayer.report();
+    }
+    catch (const std::exception &e) {
+        std::cerr << "Replay error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}